@@ -9,6 +9,7 @@
 
 #include "common/utils.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <cmath>
@@ -98,6 +99,9 @@ AooError AOO_CALL NullCodec_control(
         assert(size == sizeof(AooInt32));
         *reinterpret_cast<AooInt32 *>(ptr) = 0;
         break;
+    case kAooCodecCtlSetPacketLoss:
+        // no FEC
+        break;
     default:
         LOG_WARNING("Null codec: unsupported codec ctl " << ctl);
         return kAooErrorNotImplemented;
@@ -128,6 +132,28 @@ AooError AOO_CALL NullCodec_decode(
     return kAooOk;
 }
 
+AooError AOO_CALL NullCodec_encodePlanar(
+        AooCodec *c, const AooSample *const *inChannels, AooInt32 frameSize,
+        AooByte *outData, AooInt32 *size)
+{
+    // do nothing
+    *size = 0;
+
+    return kAooOk;
+}
+
+AooError AOO_CALL NullCodec_decodePlanar(
+        AooCodec *c, const AooByte *inData, AooInt32 size,
+        AooSample *const *outChannels, AooInt32 *frameSize)
+{
+    // just zero
+    auto dec = static_cast<NullCodec*>(c);
+    for (int i = 0; i < dec->numChannels_; ++i) {
+        std::fill(outChannels[i], outChannels[i] + *frameSize, 0);
+    }
+    return kAooOk;
+}
+
 AooError AOO_CALL serialize(
         const AooFormat *f, AooByte *buf, AooInt32 *size)
 {
@@ -151,7 +177,7 @@ AooError AOO_CALL deserialize(
 }
 
 AooCodecInterface g_interface = {
-    AOO_STRUCT_SIZE(AooCodecInterface, deserialize),
+    AOO_STRUCT_SIZE(AooCodecInterface, decoderDecodeFec),
     kAooCodecNull,
     // encoder
     NullCodec_new,
@@ -167,7 +193,12 @@ AooCodecInterface g_interface = {
     NullCodec_decode,
     // helper
     serialize,
-    deserialize
+    deserialize,
+    // non-interleaved
+    NullCodec_encodePlanar,
+    NullCodec_decodePlanar,
+    // FEC (not supported)
+    nullptr
 };
 
 NullCodec::NullCodec() {
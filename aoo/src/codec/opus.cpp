@@ -255,6 +255,51 @@ AooError AOO_CALL Encoder_control(
     #endif
         break;
     }
+    case kAooCodecCtlSetPacketLoss:
+    case OPUS_SET_PACKET_LOSS_PERC_REQUEST:
+    {
+        CHECKARG(opus_int32);
+        auto loss = as<opus_int32>(ptr);
+        auto err = opus_multistream_encoder_ctl(
+                    e->state_, OPUS_SET_PACKET_LOSS_PERC(loss));
+        if (err != OPUS_OK){
+            return kAooErrorBadArgument;
+        }
+        break;
+    }
+    case OPUS_GET_PACKET_LOSS_PERC_REQUEST:
+    {
+        CHECKARG(opus_int32);
+        auto loss = (opus_int32 *)ptr;
+        auto err = opus_multistream_encoder_ctl(
+                    e->state_, OPUS_GET_PACKET_LOSS_PERC(loss));
+        if (err != OPUS_OK){
+            return kAooErrorBadArgument;
+        }
+        break;
+    }
+    case OPUS_SET_INBAND_FEC_REQUEST:
+    {
+        CHECKARG(opus_int32);
+        auto fec = as<opus_int32>(ptr);
+        auto err = opus_multistream_encoder_ctl(
+                    e->state_, OPUS_SET_INBAND_FEC(fec));
+        if (err != OPUS_OK){
+            return kAooErrorBadArgument;
+        }
+        break;
+    }
+    case OPUS_GET_INBAND_FEC_REQUEST:
+    {
+        CHECKARG(opus_int32);
+        auto fec = (opus_int32 *)ptr;
+        auto err = opus_multistream_encoder_ctl(
+                    e->state_, OPUS_GET_INBAND_FEC(fec));
+        if (err != OPUS_OK){
+            return kAooErrorBadArgument;
+        }
+        break;
+    }
     case OPUS_SET_SIGNAL_REQUEST:
     {
         CHECKARG(opus_int32);
@@ -407,6 +452,24 @@ AooError Decoder_decode(
     }
 }
 
+// decode the lost block from the in-band FEC data of the following packet
+AooError Decoder_decodeFec(
+        AooCodec *c, const AooByte *inData, AooInt32 size,
+        AooSample *outSamples, AooInt32 *frameSize)
+{
+    auto d = static_cast<Decoder *>(c);
+    // NB: the frame size must match the duration of the lost block!
+    auto result = opus_multistream_decode_float(
+        d->state_, (const unsigned char *)inData, size, outSamples, *frameSize, 1);
+    if (result > 0){
+        *frameSize = result;
+        return kAooOk;
+    } else {
+        LOG_VERBOSE("Opus: opus_decode_float() failed with error code " << result);
+        return kAooErrorCodec;
+    }
+}
+
 //-------------------------- free functions ------------------------//
 
 AooError serialize(const AooFormat *f, AooByte *buf, AooInt32 *size)
@@ -460,7 +523,7 @@ AooError deserialize(
 }
 
 AooCodecInterface g_interface = {
-    AOO_STRUCT_SIZE(AooCodecInterface, deserialize),
+    AOO_STRUCT_SIZE(AooCodecInterface, decoderDecodeFec),
     kAooCodecOpus,
     // encoder
     Encoder_new,
@@ -476,7 +539,12 @@ AooCodecInterface g_interface = {
     Decoder_decode,
     // helper
     serialize,
-    deserialize
+    deserialize,
+    // non-interleaved (not supported)
+    nullptr,
+    nullptr,
+    // FEC
+    Decoder_decodeFec
 };
 
 Encoder::Encoder() {
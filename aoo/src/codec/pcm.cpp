@@ -6,9 +6,11 @@
 #include "codec/aoo_pcm.h"
 
 #include "../detail.hpp"
+#include "pcm_kernels.hpp"
 
 #include "common/utils.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <cmath>
@@ -17,16 +19,6 @@ namespace {
 
 //-------------------- helper functions -----------------------//
 
-// conversion routines between AooSample and PCM data
-union convert {
-    int8_t b[8];
-    int16_t i16;
-    int32_t i32;
-    int64_t i64;
-    float f;
-    double d;
-};
-
 int32_t bytes_per_sample(AooPcmBitDepth bitdepth)
 {
     switch (bitdepth){
@@ -47,116 +39,6 @@ int32_t bytes_per_sample(AooPcmBitDepth bitdepth)
     }
 }
 
-void sample_to_int8(AooSample in, AooByte *out)
-{
-    // convert to 8 bit range
-    AooSample temp = std::rint(in * INT8_MAX);
-    // check for overflow!
-    if (temp > INT8_MAX){
-        temp = INT8_MAX;
-    } else if (temp < INT8_MIN){
-        temp = INT8_MIN;
-    }
-    *out = (AooByte)(int8_t)temp;
-}
-
-void sample_to_int16(AooSample in, AooByte *out)
-{
-    convert c;
-    // convert to 16 bit range
-    AooSample temp = std::rint(in * INT16_MAX);
-    // check for overflow!
-    if (temp > INT16_MAX){
-        temp = INT16_MAX;
-    } else if (temp < INT16_MIN){
-        temp = INT16_MIN;
-    }
-    c.i16 = (int16_t)temp;
-#if BYTE_ORDER == BIG_ENDIAN
-    memcpy(out, c.b, 2); // optimized away
-#else
-    out[0] = c.b[1];
-    out[1] = c.b[0];
-#endif
-}
-
-void sample_to_int24(AooSample in, AooByte *out)
-{
-    convert c;
-    // convert to 32 bit range
-    double temp = std::rint(in * (double)INT32_MAX);
-    // check for overflow!
-    if (temp > INT32_MAX){
-        temp = INT32_MAX;
-    } else if (temp < INT32_MIN){
-        temp = INT32_MIN;
-    }
-    c.i32 = (int32_t)temp;
-    // only copy the highest 3 bytes!
-#if BYTE_ORDER == BIG_ENDIAN
-    out[0] = c.b[0];
-    out[1] = c.b[1];
-    out[2] = c.b[2];
-#else
-    out[0] = c.b[3];
-    out[1] = c.b[2];
-    out[2] = c.b[1];
-#endif
-}
-
-void sample_to_float32(AooSample in, AooByte *out)
-{
-    aoo::to_bytes<float>(in, out);
-}
-
-void sample_to_float64(AooSample in, AooByte *out)
-{
-    aoo::to_bytes<double>(in, out);
-}
-
-AooSample int8_to_sample(const AooByte *in){
-    return (AooSample)(int8_t)(*in) / (AooSample)INT8_MAX;
-}
-
-AooSample int16_to_sample(const AooByte *in){
-    convert c;
-#if BYTE_ORDER == BIG_ENDIAN
-    memcpy(c.b, in, 2); // optimized away
-#else
-    c.b[0] = in[1];
-    c.b[1] = in[0];
-#endif
-    return (AooSample)c.i16 / (AooSample)INT16_MAX;
-}
-
-AooSample int24_to_sample(const AooByte *in)
-{
-    convert c;
-    // copy to the highest 3 bytes!
-#if BYTE_ORDER == BIG_ENDIAN
-    c.b[0] = in[0];
-    c.b[1] = in[1];
-    c.b[2] = in[2];
-    c.b[3] = 0;
-#else
-    c.b[0] = 0;
-    c.b[1] = in[2];
-    c.b[2] = in[1];
-    c.b[3] = in[0];
-#endif
-    return (AooSample)c.i32 / (AooSample)INT32_MAX;
-}
-
-AooSample float32_to_sample(const AooByte *in)
-{
-    return aoo::from_bytes<float>(in);
-}
-
-AooSample float64_to_sample(const AooByte *in)
-{
-    return aoo::from_bytes<double>(in);
-}
-
 void print_format(const AooFormatPcm& f)
 {
     LOG_VERBOSE("PCM settings: "
@@ -201,7 +83,7 @@ bool validate_format(AooFormatPcm& f, bool loud = true)
         f.header.numChannels = 1;
     }
     // validate bitdepth
-    if (f.bitDepth < 0 || f.bitDepth > kAooPcmBitDepthSize){
+    if (f.bitDepth < 0 || f.bitDepth >= kAooPcmBitDepthSize){
         if (loud){
             LOG_WARNING("PCM: bad bit depth, using 32-bit float");
         }
@@ -218,6 +100,8 @@ struct PcmCodec : AooCodec {
 
     int numChannels_ = 0;
     int sampleSize_ = -1;
+    aoo::pcm::encode_fn encode_ = nullptr;
+    aoo::pcm::decode_fn decode_ = nullptr;
 };
 
 AooCodec * AOO_CALL PcmCodec_new() {
@@ -239,6 +123,10 @@ AooError AOO_CALL PcmCodec_setup(AooCodec *c, AooFormat *f) {
 
     codec->numChannels_ = fmt->header.numChannels;
     codec->sampleSize_ = bytes_per_sample(fmt->bitDepth);
+    // pick the fastest conversion routines for this CPU
+    auto& kernels = aoo::pcm::default_kernels();
+    codec->encode_ = kernels.encode[fmt->bitDepth];
+    codec->decode_ = kernels.decode[fmt->bitDepth];
 
     return kAooOk;
 }
@@ -253,6 +141,9 @@ AooError AOO_CALL PcmCodec_control(
         assert(size == sizeof(AooInt32));
         *reinterpret_cast<AooInt32 *>(ptr) = 0;
         break;
+    case kAooCodecCtlSetPacketLoss:
+        // no FEC
+        break;
     default:
         LOG_WARNING("PCM: unsupported codec ctl " << ctl);
         return kAooErrorNotImplemented;
@@ -276,35 +167,13 @@ AooError AOO_CALL PcmCodec_encode(
         return kAooErrorInsufficientBuffer;
     }
 
-    auto samples_to_bytes = [&](auto fn){
-        auto b = outData;
-        for (int i = 0; i < nsamples; ++i){
-            fn(inSamples[i], b);
-            b += samplesize;
-        }
-    };
-
-    switch (samplesize){
-    case 1:
-        samples_to_bytes(sample_to_int8);
-        break;
-    case 2:
-        samples_to_bytes(sample_to_int16);
-        break;
-    case 3:
-        samples_to_bytes(sample_to_int24);
-        break;
-    case 4:
-        samples_to_bytes(sample_to_float32);
-        break;
-    case 8:
-        samples_to_bytes(sample_to_float64);
-        break;
-    default:
-        // unknown bitdepth
+    if (!enc->encode_){
+        // not set up
         return kAooErrorBadArgument;
     }
 
+    enc->encode_(inSamples, outData, nsamples);
+
     *outSize = nbytes;
 
     return kAooOk;
@@ -334,35 +203,149 @@ AooError AOO_CALL PcmCodec_decode(
         return kAooErrorInsufficientBuffer;
     }
 
-    auto blob_to_samples = [&](auto convfn){
-        auto b = inData;
-        for (int i = 0; i < ninsamples; ++i, b += samplesize){
-            outSamples[i] = convfn(b);
+    if (!dec->decode_){
+        // not set up
+        return kAooErrorBadArgument;
+    }
+
+    dec->decode_(inData, outSamples, ninsamples);
+
+    *frameSize = ninsamples / nchannels;
+
+    return kAooOk;
+}
+
+// NB: we convert the samples in chunks to limit the size of the
+// temporary buffer; the kernels expect contiguous data.
+constexpr int32_t kPlanarChunkSize = 256;
+
+// copy 'n' samples of 'size' bytes from contiguous memory to strided memory
+template<int32_t size>
+void scatter_samples(const AooByte *in, AooByte *out, int32_t n, int32_t stride) {
+    for (int32_t i = 0; i < n; ++i, in += size, out += stride) {
+        memcpy(out, in, size);
+    }
+}
+
+void scatter_samples(const AooByte *in, AooByte *out, int32_t n,
+                     int32_t size, int32_t stride) {
+    switch (size) {
+    case 1: scatter_samples<1>(in, out, n, stride); break;
+    case 2: scatter_samples<2>(in, out, n, stride); break;
+    case 3: scatter_samples<3>(in, out, n, stride); break;
+    case 4: scatter_samples<4>(in, out, n, stride); break;
+    case 8: scatter_samples<8>(in, out, n, stride); break;
+    default: assert(false);
+    }
+}
+
+// copy 'n' samples of 'size' bytes from strided memory to contiguous memory
+template<int32_t size>
+void gather_samples(const AooByte *in, AooByte *out, int32_t n, int32_t stride) {
+    for (int32_t i = 0; i < n; ++i, in += stride, out += size) {
+        memcpy(out, in, size);
+    }
+}
+
+void gather_samples(const AooByte *in, AooByte *out, int32_t n,
+                    int32_t size, int32_t stride) {
+    switch (size) {
+    case 1: gather_samples<1>(in, out, n, stride); break;
+    case 2: gather_samples<2>(in, out, n, stride); break;
+    case 3: gather_samples<3>(in, out, n, stride); break;
+    case 4: gather_samples<4>(in, out, n, stride); break;
+    case 8: gather_samples<8>(in, out, n, stride); break;
+    default: assert(false);
+    }
+}
+
+// Convert each channel with the (SIMD) kernels and interleave the PCM bytes
+// directly, so that the caller doesn't have to interleave the audio samples.
+AooError AOO_CALL PcmCodec_encodePlanar(
+        AooCodec *c, const AooSample *const *inChannels, AooInt32 frameSize,
+        AooByte *outData, AooInt32 *outSize)
+{
+    auto enc = static_cast<PcmCodec*>(c);
+    auto nchannels = enc->numChannels_;
+    auto samplesize = enc->sampleSize_;
+    auto nbytes = frameSize * nchannels * samplesize;
+
+    if (*outSize < nbytes){
+        LOG_WARNING("PCM: size mismatch! input bytes: "
+                    << nbytes << ", output bytes " << *outSize);
+        return kAooErrorInsufficientBuffer;
+    }
+
+    if (!enc->encode_){
+        // not set up
+        return kAooErrorBadArgument;
+    }
+
+    if (nchannels == 1) {
+        enc->encode_(inChannels[0], outData, frameSize);
+    } else {
+        AooByte buf[kPlanarChunkSize * sizeof(double)];
+        auto stride = nchannels * samplesize;
+        for (int32_t onset = 0; onset < frameSize; onset += kPlanarChunkSize) {
+            auto n = std::min<int32_t>(frameSize - onset, kPlanarChunkSize);
+            for (int i = 0; i < nchannels; ++i) {
+                enc->encode_(inChannels[i] + onset, buf, n);
+                scatter_samples(buf, outData + onset * stride + i * samplesize,
+                                n, samplesize, stride);
+            }
         }
-    };
+    }
 
-    switch (samplesize){
-    case 1:
-        blob_to_samples(int8_to_sample);
-        break;
-    case 2:
-        blob_to_samples(int16_to_sample);
-        break;
-    case 3:
-        blob_to_samples(int24_to_sample);
-        break;
-    case 4:
-        blob_to_samples(float32_to_sample);
-        break;
-    case 8:
-        blob_to_samples(float64_to_sample);
-        break;
-    default:
-        // unknown bitdepth
+    *outSize = nbytes;
+
+    return kAooOk;
+}
+
+AooError AOO_CALL PcmCodec_decodePlanar(
+        AooCodec *c, const AooByte *inData, AooInt32 inSize,
+        AooSample *const *outChannels, AooInt32 *frameSize)
+{
+    auto dec = static_cast<PcmCodec*>(c);
+    auto nchannels = dec->numChannels_;
+    auto noutframes = *frameSize;
+    if (!inData) {
+        // dropped block, just zero
+        for (int i = 0; i < nchannels; ++i){
+            std::fill(outChannels[i], outChannels[i] + noutframes, 0);
+        }
+        return kAooOk;
+    }
+
+    auto samplesize = dec->sampleSize_;
+    auto ninframes = inSize / (samplesize * nchannels);
+
+    if (ninframes > noutframes) {
+        LOG_WARNING("PCM: size mismatch! input frames: "
+                    << ninframes << ", output frames " << noutframes);
+        return kAooErrorInsufficientBuffer;
+    }
+
+    if (!dec->decode_){
+        // not set up
         return kAooErrorBadArgument;
     }
 
-    *frameSize = ninsamples / nchannels;
+    if (nchannels == 1) {
+        dec->decode_(inData, outChannels[0], ninframes);
+    } else {
+        AooByte buf[kPlanarChunkSize * sizeof(double)];
+        auto stride = nchannels * samplesize;
+        for (int32_t onset = 0; onset < ninframes; onset += kPlanarChunkSize) {
+            auto n = std::min<int32_t>(ninframes - onset, kPlanarChunkSize);
+            for (int i = 0; i < nchannels; ++i) {
+                gather_samples(inData + onset * stride + i * samplesize, buf,
+                               n, samplesize, stride);
+                dec->decode_(buf, outChannels[i] + onset, n);
+            }
+        }
+    }
+
+    *frameSize = ninframes;
 
     return kAooOk;
 }
@@ -419,7 +402,7 @@ AooError AOO_CALL deserialize(
 }
 
 AooCodecInterface g_interface = {
-    AOO_STRUCT_SIZE(AooCodecInterface, deserialize),
+    AOO_STRUCT_SIZE(AooCodecInterface, decoderDecodeFec),
     kAooCodecPcm,
     // encoder
     PcmCodec_new,
@@ -435,7 +418,12 @@ AooCodecInterface g_interface = {
     PcmCodec_decode,
     // helper
     serialize,
-    deserialize
+    deserialize,
+    // non-interleaved
+    PcmCodec_encodePlanar,
+    PcmCodec_decodePlanar,
+    // FEC (not supported)
+    nullptr
 };
 
 PcmCodec::PcmCodec() {
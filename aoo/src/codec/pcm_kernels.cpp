@@ -0,0 +1,856 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#include "pcm_kernels.hpp"
+
+#include "common/utils.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+// SIMD kernels are only provided for 32-bit samples.
+#if AOO_SAMPLE_SIZE == 32
+# if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define AOO_PCM_SSE2 1
+#  if defined(__GNUC__) || defined(_MSC_VER)
+#   define AOO_PCM_AVX2 1
+#  endif
+# elif defined(__aarch64__) && defined(__ARM_NEON)
+#  define AOO_PCM_NEON 1
+# endif
+#endif
+
+#ifndef AOO_PCM_SSE2
+# define AOO_PCM_SSE2 0
+#endif
+#ifndef AOO_PCM_AVX2
+# define AOO_PCM_AVX2 0
+#endif
+#ifndef AOO_PCM_NEON
+# define AOO_PCM_NEON 0
+#endif
+
+#if AOO_PCM_SSE2 || AOO_PCM_AVX2
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>
+# endif
+#endif
+
+#if AOO_PCM_NEON
+# include <arm_neon.h>
+#endif
+
+// AVX2 kernels are compiled for the target instruction set
+// and only selected at runtime if the CPU supports it.
+#if AOO_PCM_AVX2 && defined(__GNUC__)
+# define AOO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+# define AOO_TARGET_AVX2
+#endif
+
+namespace aoo {
+namespace pcm {
+
+namespace {
+
+//------------------------ scalar ------------------------//
+
+// conversion routines between AooSample and PCM data
+union convert {
+    int8_t b[8];
+    int16_t i16;
+    int32_t i32;
+    int64_t i64;
+    float f;
+    double d;
+};
+
+inline void sample_to_int8(AooSample in, AooByte *out)
+{
+    // convert to 8 bit range
+    AooSample temp = std::rint(in * INT8_MAX);
+    // check for overflow!
+    if (temp > INT8_MAX){
+        temp = INT8_MAX;
+    } else if (temp < INT8_MIN){
+        temp = INT8_MIN;
+    }
+    *out = (AooByte)(int8_t)temp;
+}
+
+inline void sample_to_int16(AooSample in, AooByte *out)
+{
+    convert c;
+    // convert to 16 bit range
+    AooSample temp = std::rint(in * INT16_MAX);
+    // check for overflow!
+    if (temp > INT16_MAX){
+        temp = INT16_MAX;
+    } else if (temp < INT16_MIN){
+        temp = INT16_MIN;
+    }
+    c.i16 = (int16_t)temp;
+#if BYTE_ORDER == BIG_ENDIAN
+    memcpy(out, c.b, 2); // optimized away
+#else
+    out[0] = c.b[1];
+    out[1] = c.b[0];
+#endif
+}
+
+inline void sample_to_int24(AooSample in, AooByte *out)
+{
+    convert c;
+    // convert to 32 bit range
+    double temp = std::rint(in * (double)INT32_MAX);
+    // check for overflow!
+    if (temp > INT32_MAX){
+        temp = INT32_MAX;
+    } else if (temp < INT32_MIN){
+        temp = INT32_MIN;
+    }
+    c.i32 = (int32_t)temp;
+    // only copy the highest 3 bytes!
+#if BYTE_ORDER == BIG_ENDIAN
+    out[0] = c.b[0];
+    out[1] = c.b[1];
+    out[2] = c.b[2];
+#else
+    out[0] = c.b[3];
+    out[1] = c.b[2];
+    out[2] = c.b[1];
+#endif
+}
+
+inline void sample_to_float32(AooSample in, AooByte *out)
+{
+    aoo::to_bytes<float>(in, out);
+}
+
+inline void sample_to_float64(AooSample in, AooByte *out)
+{
+    aoo::to_bytes<double>(in, out);
+}
+
+inline AooSample int8_to_sample(const AooByte *in){
+    return (AooSample)(int8_t)(*in) / (AooSample)INT8_MAX;
+}
+
+inline AooSample int16_to_sample(const AooByte *in){
+    convert c;
+#if BYTE_ORDER == BIG_ENDIAN
+    memcpy(c.b, in, 2); // optimized away
+#else
+    c.b[0] = in[1];
+    c.b[1] = in[0];
+#endif
+    return (AooSample)c.i16 / (AooSample)INT16_MAX;
+}
+
+// build the 32-bit integer from the highest 3 bytes
+inline int32_t int24_to_int32(const AooByte *in)
+{
+    convert c;
+#if BYTE_ORDER == BIG_ENDIAN
+    c.b[0] = in[0];
+    c.b[1] = in[1];
+    c.b[2] = in[2];
+    c.b[3] = 0;
+#else
+    c.b[0] = 0;
+    c.b[1] = in[2];
+    c.b[2] = in[1];
+    c.b[3] = in[0];
+#endif
+    return c.i32;
+}
+
+inline AooSample int24_to_sample(const AooByte *in)
+{
+    return (AooSample)int24_to_int32(in) / (AooSample)INT32_MAX;
+}
+
+inline AooSample float32_to_sample(const AooByte *in)
+{
+    return aoo::from_bytes<float>(in);
+}
+
+inline AooSample float64_to_sample(const AooByte *in)
+{
+    return aoo::from_bytes<double>(in);
+}
+
+template<int32_t samplesize, void (*fn)(AooSample, AooByte *)>
+void encode_scalar(const AooSample *in, AooByte *out, int32_t n)
+{
+    for (int32_t i = 0; i < n; ++i, out += samplesize){
+        fn(in[i], out);
+    }
+}
+
+template<int32_t samplesize, AooSample (*fn)(const AooByte *)>
+void decode_scalar(const AooByte *in, AooSample *out, int32_t n)
+{
+    for (int32_t i = 0; i < n; ++i, in += samplesize){
+        out[i] = fn(in);
+    }
+}
+
+const kernels scalar_kernels = {
+    "scalar",
+    {
+        encode_scalar<1, sample_to_int8>,
+        encode_scalar<2, sample_to_int16>,
+        encode_scalar<3, sample_to_int24>,
+        encode_scalar<4, sample_to_float32>,
+        encode_scalar<8, sample_to_float64>
+    },
+    {
+        decode_scalar<1, int8_to_sample>,
+        decode_scalar<2, int16_to_sample>,
+        decode_scalar<3, int24_to_sample>,
+        decode_scalar<4, float32_to_sample>,
+        decode_scalar<8, float64_to_sample>
+    }
+};
+
+// NOTE: the SIMD kernels below process as many samples as possible
+// in vector registers and hand the remaining samples to the scalar
+// kernels. Float to integer conversion always rounds to nearest even,
+// just like std::rint() with the default rounding mode. We clamp *before*
+// rounding, which gives the same result because the limits are integers.
+
+//------------------------ SSE2 ------------------------//
+
+#if AOO_PCM_SSE2
+
+inline __m128i bswap16_sse2(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+inline __m128i bswap32_sse2(__m128i v) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return bswap16_sse2(v);
+}
+
+inline __m128i bswap64_sse2(__m128i v) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    return bswap16_sse2(v);
+}
+
+inline __m128i float_to_int_sse2(__m128 x, __m128 scale, __m128 lo, __m128 hi) {
+    x = _mm_mul_ps(x, scale);
+    x = _mm_min_ps(_mm_max_ps(x, lo), hi);
+    return _mm_cvtps_epi32(x);
+}
+
+// convert 4 samples to 32-bit integers with double precision
+inline __m128i float_to_int32_sse2(__m128 x) {
+    const __m128d scale = _mm_set1_pd(INT32_MAX);
+    const __m128d lo = _mm_set1_pd(INT32_MIN);
+    const __m128d hi = _mm_set1_pd(INT32_MAX);
+    auto d0 = _mm_mul_pd(_mm_cvtps_pd(x), scale);
+    auto d1 = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), scale);
+    d0 = _mm_min_pd(_mm_max_pd(d0, lo), hi);
+    d1 = _mm_min_pd(_mm_max_pd(d1, lo), hi);
+    return _mm_unpacklo_epi64(_mm_cvtpd_epi32(d0), _mm_cvtpd_epi32(d1));
+}
+
+inline void store_int24(const int32_t *in, AooByte *out, int32_t n) {
+    for (int32_t i = 0; i < n; ++i, out += 3) {
+        auto v = (uint32_t)in[i];
+        out[0] = (AooByte)(v >> 24);
+        out[1] = (AooByte)(v >> 16);
+        out[2] = (AooByte)(v >> 8);
+    }
+}
+
+void encode_int8_sse2(const AooSample *in, AooByte *out, int32_t n) {
+    const auto scale = _mm_set1_ps(INT8_MAX);
+    const auto lo = _mm_set1_ps(INT8_MIN);
+    const auto hi = _mm_set1_ps(INT8_MAX);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto v0 = float_to_int_sse2(_mm_loadu_ps(in + i), scale, lo, hi);
+        auto v1 = float_to_int_sse2(_mm_loadu_ps(in + i + 4), scale, lo, hi);
+        auto v2 = float_to_int_sse2(_mm_loadu_ps(in + i + 8), scale, lo, hi);
+        auto v3 = float_to_int_sse2(_mm_loadu_ps(in + i + 12), scale, lo, hi);
+        auto a = _mm_packs_epi32(v0, v1);
+        auto b = _mm_packs_epi32(v2, v3);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi16(a, b));
+    }
+    encode_scalar<1, sample_to_int8>(in + i, out + i, n - i);
+}
+
+void decode_int8_sse2(const AooByte *in, AooSample *out, int32_t n) {
+    const auto scale = _mm_set1_ps(INT8_MAX);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto b = _mm_loadu_si128((const __m128i *)(in + i));
+        // sign extend to 16 bit
+        auto lo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+        auto hi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+        // sign extend to 32 bit
+        __m128i v[4];
+        v[0] = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+        v[1] = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+        v[2] = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+        v[3] = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+        for (int k = 0; k < 4; ++k) {
+            _mm_storeu_ps(out + i + k * 4, _mm_div_ps(_mm_cvtepi32_ps(v[k]), scale));
+        }
+    }
+    decode_scalar<1, int8_to_sample>(in + i, out + i, n - i);
+}
+
+void encode_int16_sse2(const AooSample *in, AooByte *out, int32_t n) {
+    const auto scale = _mm_set1_ps(INT16_MAX);
+    const auto lo = _mm_set1_ps(INT16_MIN);
+    const auto hi = _mm_set1_ps(INT16_MAX);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v0 = float_to_int_sse2(_mm_loadu_ps(in + i), scale, lo, hi);
+        auto v1 = float_to_int_sse2(_mm_loadu_ps(in + i + 4), scale, lo, hi);
+        auto v = bswap16_sse2(_mm_packs_epi32(v0, v1));
+        _mm_storeu_si128((__m128i *)(out + i * 2), v);
+    }
+    encode_scalar<2, sample_to_int16>(in + i, out + i * 2, n - i);
+}
+
+void decode_int16_sse2(const AooByte *in, AooSample *out, int32_t n) {
+    const auto scale = _mm_set1_ps(INT16_MAX);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = bswap16_sse2(_mm_loadu_si128((const __m128i *)(in + i * 2)));
+        // sign extend to 32 bit
+        auto v0 = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        auto v1 = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_div_ps(_mm_cvtepi32_ps(v0), scale));
+        _mm_storeu_ps(out + i + 4, _mm_div_ps(_mm_cvtepi32_ps(v1), scale));
+    }
+    decode_scalar<2, int16_to_sample>(in + i * 2, out + i, n - i);
+}
+
+void encode_int24_sse2(const AooSample *in, AooByte *out, int32_t n) {
+    alignas(16) int32_t temp[4];
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto v = float_to_int32_sse2(_mm_loadu_ps(in + i));
+        _mm_store_si128((__m128i *)temp, v);
+        store_int24(temp, out + i * 3, 4);
+    }
+    encode_scalar<3, sample_to_int24>(in + i, out + i * 3, n - i);
+}
+
+void decode_int24_sse2(const AooByte *in, AooSample *out, int32_t n) {
+    // SSE2 has no byte shuffle, so we only vectorize the conversion.
+    const auto scale = _mm_set1_ps(INT32_MAX);
+    alignas(16) int32_t temp[4];
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            temp[k] = int24_to_int32(in + (i + k) * 3);
+        }
+        auto v = _mm_cvtepi32_ps(_mm_load_si128((const __m128i *)temp));
+        _mm_storeu_ps(out + i, _mm_div_ps(v, scale));
+    }
+    decode_scalar<3, int24_to_sample>(in + i * 3, out + i, n - i);
+}
+
+void encode_float32_sse2(const AooSample *in, AooByte *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto v = bswap32_sse2(_mm_castps_si128(_mm_loadu_ps(in + i)));
+        _mm_storeu_si128((__m128i *)(out + i * 4), v);
+    }
+    encode_scalar<4, sample_to_float32>(in + i, out + i * 4, n - i);
+}
+
+void decode_float32_sse2(const AooByte *in, AooSample *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto v = bswap32_sse2(_mm_loadu_si128((const __m128i *)(in + i * 4)));
+        _mm_storeu_ps(out + i, _mm_castsi128_ps(v));
+    }
+    decode_scalar<4, float32_to_sample>(in + i * 4, out + i, n - i);
+}
+
+void encode_float64_sse2(const AooSample *in, AooByte *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm_loadu_ps(in + i);
+        auto d0 = _mm_castpd_si128(_mm_cvtps_pd(x));
+        auto d1 = _mm_castpd_si128(_mm_cvtps_pd(_mm_movehl_ps(x, x)));
+        _mm_storeu_si128((__m128i *)(out + i * 8), bswap64_sse2(d0));
+        _mm_storeu_si128((__m128i *)(out + i * 8 + 16), bswap64_sse2(d1));
+    }
+    encode_scalar<8, sample_to_float64>(in + i, out + i * 8, n - i);
+}
+
+void decode_float64_sse2(const AooByte *in, AooSample *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto d0 = bswap64_sse2(_mm_loadu_si128((const __m128i *)(in + i * 8)));
+        auto d1 = bswap64_sse2(_mm_loadu_si128((const __m128i *)(in + i * 8 + 16)));
+        auto f0 = _mm_cvtpd_ps(_mm_castsi128_pd(d0));
+        auto f1 = _mm_cvtpd_ps(_mm_castsi128_pd(d1));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(f0, f1));
+    }
+    decode_scalar<8, float64_to_sample>(in + i * 8, out + i, n - i);
+}
+
+const kernels sse2_kernels = {
+    "sse2",
+    {
+        encode_int8_sse2,
+        encode_int16_sse2,
+        encode_int24_sse2,
+        encode_float32_sse2,
+        encode_float64_sse2
+    },
+    {
+        decode_int8_sse2,
+        decode_int16_sse2,
+        decode_int24_sse2,
+        decode_float32_sse2,
+        decode_float64_sse2
+    }
+};
+
+#endif // AOO_PCM_SSE2
+
+//------------------------ AVX2 ------------------------//
+
+#if AOO_PCM_AVX2
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // check if the OS supports AVX (OSXSAVE + AVX)
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+        return false;
+    }
+    // check if the OS saves the YMM registers
+    if ((_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+AOO_TARGET_AVX2
+inline __m256i float_to_int_avx2(__m256 x, __m256 scale, __m256 lo, __m256 hi) {
+    x = _mm256_mul_ps(x, scale);
+    x = _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+    return _mm256_cvtps_epi32(x);
+}
+
+// convert 4 samples to 32-bit integers with double precision
+AOO_TARGET_AVX2
+inline __m128i float_to_int32_avx2(__m128 x) {
+    const auto scale = _mm256_set1_pd(INT32_MAX);
+    const auto lo = _mm256_set1_pd(INT32_MIN);
+    const auto hi = _mm256_set1_pd(INT32_MAX);
+    auto d = _mm256_mul_pd(_mm256_cvtps_pd(x), scale);
+    d = _mm256_min_pd(_mm256_max_pd(d, lo), hi);
+    return _mm256_cvtpd_epi32(d);
+}
+
+AOO_TARGET_AVX2
+void encode_int8_avx2(const AooSample *in, AooByte *out, int32_t n) {
+    const auto scale = _mm256_set1_ps(INT8_MAX);
+    const auto lo = _mm256_set1_ps(INT8_MIN);
+    const auto hi = _mm256_set1_ps(INT8_MAX);
+    // the pack instructions operate on 128-bit lanes
+    const auto perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        auto v0 = float_to_int_avx2(_mm256_loadu_ps(in + i), scale, lo, hi);
+        auto v1 = float_to_int_avx2(_mm256_loadu_ps(in + i + 8), scale, lo, hi);
+        auto v2 = float_to_int_avx2(_mm256_loadu_ps(in + i + 16), scale, lo, hi);
+        auto v3 = float_to_int_avx2(_mm256_loadu_ps(in + i + 24), scale, lo, hi);
+        auto a = _mm256_packs_epi32(v0, v1);
+        auto b = _mm256_packs_epi32(v2, v3);
+        auto v = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(a, b), perm);
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+    }
+    encode_scalar<1, sample_to_int8>(in + i, out + i, n - i);
+}
+
+AOO_TARGET_AVX2
+void decode_int8_avx2(const AooByte *in, AooSample *out, int32_t n) {
+    const auto scale = _mm256_set1_ps(INT8_MAX);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto b = _mm_loadl_epi64((const __m128i *)(in + i));
+        auto v = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(b));
+        _mm256_storeu_ps(out + i, _mm256_div_ps(v, scale));
+    }
+    decode_scalar<1, int8_to_sample>(in + i, out + i, n - i);
+}
+
+AOO_TARGET_AVX2
+void encode_int16_avx2(const AooSample *in, AooByte *out, int32_t n) {
+    const auto scale = _mm256_set1_ps(INT16_MAX);
+    const auto lo = _mm256_set1_ps(INT16_MIN);
+    const auto hi = _mm256_set1_ps(INT16_MAX);
+    const auto swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                       1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto v0 = float_to_int_avx2(_mm256_loadu_ps(in + i), scale, lo, hi);
+        auto v1 = float_to_int_avx2(_mm256_loadu_ps(in + i + 8), scale, lo, hi);
+        // the pack instruction operates on 128-bit lanes
+        auto v = _mm256_permute4x64_epi64(_mm256_packs_epi32(v0, v1), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)(out + i * 2), _mm256_shuffle_epi8(v, swap));
+    }
+    encode_scalar<2, sample_to_int16>(in + i, out + i * 2, n - i);
+}
+
+AOO_TARGET_AVX2
+void decode_int16_avx2(const AooByte *in, AooSample *out, int32_t n) {
+    const auto scale = _mm256_set1_ps(INT16_MAX);
+    const auto swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(in + i * 2)), swap);
+        auto v = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b));
+        _mm256_storeu_ps(out + i, _mm256_div_ps(v, scale));
+    }
+    decode_scalar<2, int16_to_sample>(in + i * 2, out + i, n - i);
+}
+
+AOO_TARGET_AVX2
+void encode_int24_avx2(const AooSample *in, AooByte *out, int32_t n) {
+    // take the highest 3 bytes of each 32-bit integer in big endian order
+    const auto pack = _mm_setr_epi8(3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13,
+                                    -1, -1, -1, -1);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto v = _mm_shuffle_epi8(float_to_int32_avx2(_mm_loadu_ps(in + i)), pack);
+        auto dest = out + i * 3;
+        _mm_storel_epi64((__m128i *)dest, v);
+        auto rest = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+        memcpy(dest + 8, &rest, 4);
+    }
+    encode_scalar<3, sample_to_int24>(in + i, out + i * 3, n - i);
+}
+
+AOO_TARGET_AVX2
+void decode_int24_avx2(const AooByte *in, AooSample *out, int32_t n) {
+    const auto scale = _mm256_set1_ps(INT32_MAX);
+    // put 3 big endian bytes into the highest 3 bytes of a 32-bit integer
+    const auto unpack = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3,
+                                      -1, 8, 7, 6, -1, 11, 10, 9);
+    int32_t i = 0;
+    // each 16 byte load only uses 12 bytes, so we must not read past the end
+    for (; (i + 8) * 3 + 4 <= n * 3; i += 8) {
+        auto b0 = _mm_loadu_si128((const __m128i *)(in + i * 3));
+        auto b1 = _mm_loadu_si128((const __m128i *)(in + i * 3 + 12));
+        auto v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_shuffle_epi8(b0, unpack)),
+            _mm_shuffle_epi8(b1, unpack), 1);
+        _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    decode_scalar<3, int24_to_sample>(in + i * 3, out + i, n - i);
+}
+
+AOO_TARGET_AVX2
+void encode_float32_avx2(const AooSample *in, AooByte *out, int32_t n) {
+    const auto swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                       3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = _mm256_castps_si256(_mm256_loadu_ps(in + i));
+        _mm256_storeu_si256((__m256i *)(out + i * 4), _mm256_shuffle_epi8(v, swap));
+    }
+    encode_scalar<4, sample_to_float32>(in + i, out + i * 4, n - i);
+}
+
+AOO_TARGET_AVX2
+void decode_float32_avx2(const AooByte *in, AooSample *out, int32_t n) {
+    const auto swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                       3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = _mm256_loadu_si256((const __m256i *)(in + i * 4));
+        _mm256_storeu_ps(out + i, _mm256_castsi256_ps(_mm256_shuffle_epi8(v, swap)));
+    }
+    decode_scalar<4, float32_to_sample>(in + i * 4, out + i, n - i);
+}
+
+AOO_TARGET_AVX2
+void encode_float64_avx2(const AooSample *in, AooByte *out, int32_t n) {
+    const auto swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                       7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto d = _mm256_castpd_si256(_mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+        _mm256_storeu_si256((__m256i *)(out + i * 8), _mm256_shuffle_epi8(d, swap));
+    }
+    encode_scalar<8, sample_to_float64>(in + i, out + i * 8, n - i);
+}
+
+AOO_TARGET_AVX2
+void decode_float64_avx2(const AooByte *in, AooSample *out, int32_t n) {
+    const auto swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                       7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto d = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in + i * 8)), swap);
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_castsi256_pd(d)));
+    }
+    decode_scalar<8, float64_to_sample>(in + i * 8, out + i, n - i);
+}
+
+const kernels avx2_kernels = {
+    "avx2",
+    {
+        encode_int8_avx2,
+        encode_int16_avx2,
+        encode_int24_avx2,
+        encode_float32_avx2,
+        encode_float64_avx2
+    },
+    {
+        decode_int8_avx2,
+        decode_int16_avx2,
+        decode_int24_avx2,
+        decode_float32_avx2,
+        decode_float64_avx2
+    }
+};
+
+#endif // AOO_PCM_AVX2
+
+//------------------------ NEON ------------------------//
+
+#if AOO_PCM_NEON
+
+inline int32x4_t float_to_int_neon(float32x4_t x, float scale, float32x4_t lo, float32x4_t hi) {
+    x = vmulq_n_f32(x, scale);
+    x = vminq_f32(vmaxq_f32(x, lo), hi);
+    return vcvtnq_s32_f32(x);
+}
+
+// convert 4 samples to 32-bit integers with double precision
+inline int32x4_t float_to_int32_neon(float32x4_t x) {
+    const auto lo = vdupq_n_f64(INT32_MIN);
+    const auto hi = vdupq_n_f64(INT32_MAX);
+    auto d0 = vmulq_n_f64(vcvt_f64_f32(vget_low_f32(x)), INT32_MAX);
+    auto d1 = vmulq_n_f64(vcvt_high_f64_f32(x), INT32_MAX);
+    d0 = vminq_f64(vmaxq_f64(d0, lo), hi);
+    d1 = vminq_f64(vmaxq_f64(d1, lo), hi);
+    return vcombine_s32(vmovn_s64(vcvtnq_s64_f64(d0)), vmovn_s64(vcvtnq_s64_f64(d1)));
+}
+
+void encode_int8_neon(const AooSample *in, AooByte *out, int32_t n) {
+    const auto lo = vdupq_n_f32(INT8_MIN);
+    const auto hi = vdupq_n_f32(INT8_MAX);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto v0 = float_to_int_neon(vld1q_f32(in + i), INT8_MAX, lo, hi);
+        auto v1 = float_to_int_neon(vld1q_f32(in + i + 4), INT8_MAX, lo, hi);
+        auto v2 = float_to_int_neon(vld1q_f32(in + i + 8), INT8_MAX, lo, hi);
+        auto v3 = float_to_int_neon(vld1q_f32(in + i + 12), INT8_MAX, lo, hi);
+        auto a = vcombine_s16(vqmovn_s32(v0), vqmovn_s32(v1));
+        auto b = vcombine_s16(vqmovn_s32(v2), vqmovn_s32(v3));
+        vst1q_s8((int8_t *)(out + i), vcombine_s8(vqmovn_s16(a), vqmovn_s16(b)));
+    }
+    encode_scalar<1, sample_to_int8>(in + i, out + i, n - i);
+}
+
+void decode_int8_neon(const AooByte *in, AooSample *out, int32_t n) {
+    const auto scale = vdupq_n_f32(INT8_MAX);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = vmovl_s8(vld1_s8((const int8_t *)(in + i)));
+        auto v0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        auto v1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(out + i, vdivq_f32(v0, scale));
+        vst1q_f32(out + i + 4, vdivq_f32(v1, scale));
+    }
+    decode_scalar<1, int8_to_sample>(in + i, out + i, n - i);
+}
+
+void encode_int16_neon(const AooSample *in, AooByte *out, int32_t n) {
+    const auto lo = vdupq_n_f32(INT16_MIN);
+    const auto hi = vdupq_n_f32(INT16_MAX);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v0 = float_to_int_neon(vld1q_f32(in + i), INT16_MAX, lo, hi);
+        auto v1 = float_to_int_neon(vld1q_f32(in + i + 4), INT16_MAX, lo, hi);
+        auto v = vreinterpretq_u8_s16(vcombine_s16(vqmovn_s32(v0), vqmovn_s32(v1)));
+        vst1q_u8(out + i * 2, vrev16q_u8(v));
+    }
+    encode_scalar<2, sample_to_int16>(in + i, out + i * 2, n - i);
+}
+
+void decode_int16_neon(const AooByte *in, AooSample *out, int32_t n) {
+    const auto scale = vdupq_n_f32(INT16_MAX);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(in + i * 2)));
+        auto v0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        auto v1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(out + i, vdivq_f32(v0, scale));
+        vst1q_f32(out + i + 4, vdivq_f32(v1, scale));
+    }
+    decode_scalar<2, int16_to_sample>(in + i * 2, out + i, n - i);
+}
+
+void encode_int24_neon(const AooSample *in, AooByte *out, int32_t n) {
+    // take the highest 3 bytes of each 32-bit integer in big endian order
+    static const uint8_t pack_table[16] = {
+        3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, 255, 255, 255, 255
+    };
+    const auto pack = vld1q_u8(pack_table);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto v = vreinterpretq_u8_s32(float_to_int32_neon(vld1q_f32(in + i)));
+        v = vqtbl1q_u8(v, pack);
+        auto dest = out + i * 3;
+        vst1_u8(dest, vget_low_u8(v));
+        auto rest = vgetq_lane_u32(vreinterpretq_u32_u8(v), 2);
+        memcpy(dest + 8, &rest, 4);
+    }
+    encode_scalar<3, sample_to_int24>(in + i, out + i * 3, n - i);
+}
+
+void decode_int24_neon(const AooByte *in, AooSample *out, int32_t n) {
+    // put 3 big endian bytes into the highest 3 bytes of a 32-bit integer
+    static const uint8_t unpack_table[16] = {
+        255, 2, 1, 0, 255, 5, 4, 3, 255, 8, 7, 6, 255, 11, 10, 9
+    };
+    const auto unpack = vld1q_u8(unpack_table);
+    const auto scale = vdupq_n_f32(INT32_MAX);
+    int32_t i = 0;
+    // each 16 byte load only uses 12 bytes, so we must not read past the end
+    for (; (i + 4) * 3 + 4 <= n * 3; i += 4) {
+        auto v = vqtbl1q_u8(vld1q_u8(in + i * 3), unpack);
+        auto f = vcvtq_f32_s32(vreinterpretq_s32_u8(v));
+        vst1q_f32(out + i, vdivq_f32(f, scale));
+    }
+    decode_scalar<3, int24_to_sample>(in + i * 3, out + i, n - i);
+}
+
+void encode_float32_neon(const AooSample *in, AooByte *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto v = vreinterpretq_u8_f32(vld1q_f32(in + i));
+        vst1q_u8(out + i * 4, vrev32q_u8(v));
+    }
+    encode_scalar<4, sample_to_float32>(in + i, out + i * 4, n - i);
+}
+
+void decode_float32_neon(const AooByte *in, AooSample *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto v = vrev32q_u8(vld1q_u8(in + i * 4));
+        vst1q_f32(out + i, vreinterpretq_f32_u8(v));
+    }
+    decode_scalar<4, float32_to_sample>(in + i * 4, out + i, n - i);
+}
+
+void encode_float64_neon(const AooSample *in, AooByte *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto x = vld1q_f32(in + i);
+        auto d0 = vreinterpretq_u8_f64(vcvt_f64_f32(vget_low_f32(x)));
+        auto d1 = vreinterpretq_u8_f64(vcvt_high_f64_f32(x));
+        vst1q_u8(out + i * 8, vrev64q_u8(d0));
+        vst1q_u8(out + i * 8 + 16, vrev64q_u8(d1));
+    }
+    encode_scalar<8, sample_to_float64>(in + i, out + i * 8, n - i);
+}
+
+void decode_float64_neon(const AooByte *in, AooSample *out, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto d0 = vreinterpretq_f64_u8(vrev64q_u8(vld1q_u8(in + i * 8)));
+        auto d1 = vreinterpretq_f64_u8(vrev64q_u8(vld1q_u8(in + i * 8 + 16)));
+        vst1q_f32(out + i, vcombine_f32(vcvt_f32_f64(d0), vcvt_f32_f64(d1)));
+    }
+    decode_scalar<8, float64_to_sample>(in + i * 8, out + i, n - i);
+}
+
+const kernels neon_kernels = {
+    "neon",
+    {
+        encode_int8_neon,
+        encode_int16_neon,
+        encode_int24_neon,
+        encode_float32_neon,
+        encode_float64_neon
+    },
+    {
+        decode_int8_neon,
+        decode_int16_neon,
+        decode_int24_neon,
+        decode_float32_neon,
+        decode_float64_neon
+    }
+};
+
+#endif // AOO_PCM_NEON
+
+//------------------------ dispatch ------------------------//
+
+struct kernel_list {
+    kernel_list() {
+        list[count++] = &scalar_kernels;
+    #if AOO_PCM_SSE2
+        list[count++] = &sse2_kernels;
+    #endif
+    #if AOO_PCM_AVX2
+        if (cpu_has_avx2()) {
+            list[count++] = &avx2_kernels;
+        }
+    #endif
+    #if AOO_PCM_NEON
+        list[count++] = &neon_kernels;
+    #endif
+    }
+
+    const kernels *list[4];
+    int count = 0;
+};
+
+const kernel_list& get_kernel_list() {
+    static const kernel_list list;
+    return list;
+}
+
+} // namespace
+
+const kernels * get_kernels(int index) {
+    auto& k = get_kernel_list();
+    if (index >= 0 && index < k.count) {
+        return k.list[index];
+    } else {
+        return nullptr;
+    }
+}
+
+const kernels& default_kernels() {
+    auto& k = get_kernel_list();
+    assert(k.count > 0);
+    return *k.list[k.count - 1];
+}
+
+} // namespace pcm
+} // namespace aoo
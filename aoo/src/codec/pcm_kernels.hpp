@@ -0,0 +1,39 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#pragma once
+
+#include "aoo_types.h"
+#include "codec/aoo_pcm.h"
+
+#include <cstdint>
+
+namespace aoo {
+namespace pcm {
+
+// convert 'n' samples to big endian PCM data
+using encode_fn = void (*)(const AooSample *in, AooByte *out, int32_t n);
+// convert 'n' samples of big endian PCM data to AooSample
+using decode_fn = void (*)(const AooByte *in, AooSample *out, int32_t n);
+
+// A set of conversion kernels for a specific instruction set.
+// The tables are indexed by AooPcmBitDepth.
+// NOTE: all kernels must produce bit-identical results!
+struct kernels {
+    const char *name;
+    encode_fn encode[kAooPcmBitDepthSize];
+    decode_fn decode[kAooPcmBitDepthSize];
+};
+
+// Get the kernel set at the given index; returns nullptr if the index
+// is out of range. Only kernels supported by the current CPU are listed.
+// The first entry is always the scalar fallback and the last entry is
+// the preferred kernel set.
+const kernels * get_kernels(int index);
+
+// Get the preferred kernel set for the current CPU.
+const kernels& default_kernels();
+
+} // namespace pcm
+} // namespace aoo
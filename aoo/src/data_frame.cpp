@@ -2,39 +2,68 @@
 
 #include "common/bit_utils.hpp"
 
+#include <new>
+#include <utility>
+
 namespace aoo {
 
 //-------------------------- data_frame_allocator --------------------------------//
 
+namespace {
+
+thread_local bool t_process_thread = false;
+
+// used to map (non-process) threads to magazines
+size_t this_thread_index() {
+    static std::atomic<size_t> counter{0};
+    thread_local size_t index = counter.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+// NB: only called by the thread that owns the magazine
+void increment(std::atomic<uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+} // namespace
+
 // TODO: should we try to split larger blocks before allocating a new one?
 data_frame* data_frame_allocator::allocate(int32_t size) {
     auto index = size_to_bin(size);
-    // load head
-    auto frame = bins_[index].load(std::memory_order_relaxed);
-    do {
-        if (frame == nullptr) {
-            // allocate new frame
-            auto alloc_size = bin_to_alloc_size(index);
-            assert((alloc_size - sizeof(data_frame_header)) >= size);
-            frame = (data_frame_header*)aoo::allocate(alloc_size);
-            frame->next = nullptr;
-            frame->bin_index = index;
-            frame->frame_index = 0;
-#if AOO_DATA_FRAME_LEAK_DETECTION
-            auto num_bytes = num_alloc_bytes_.fetch_add(alloc_size, std::memory_order_relaxed) + alloc_size;
-            auto num_frames = num_alloc_frames_.fetch_add(1, std::memory_order_relaxed) + 1;
-#if AOO_DEBUG_DATA_FRAME_ALLOCATOR
-            LOG_DEBUG("data_frame_allocator: allocate " << alloc_size << " bytes (total bytes: "
-                      << num_bytes << ", total frames: " << num_frames << ")");
-#endif
-#endif
-            break;
+    data_frame_header *frame = nullptr;
+    auto& m = get_magazine();
+    if (m.try_lock()) {
+        frame = m.heads[index];
+        if (!frame) {
+            // Refill from the shared free list. We always take the whole
+            // list, so we don't have to worry about the ABA problem.
+            // NB: we don't know how many frames we got, so we leave the
+            // frame count at zero; it only needs to be a lower bound.
+            frame = bins_[index].exchange(nullptr, std::memory_order_acquire);
+        }
+        if (frame) {
+            m.heads[index] = frame->next;
+            if (m.counts[index] > 0) {
+                m.counts[index]--;
+            }
+            increment(m.hits);
+        } else {
+            increment(m.misses);
         }
-        // try to reuse existing frame.
-        // NB: compare_exchange() will update frame on failure!
-    } while (!bins_[index].compare_exchange_weak(frame, frame->next,
-                                                 std::memory_order_acq_rel,
-                                                 std::memory_order_relaxed));
+        m.unlock();
+    } else {
+        // magazine is used by another thread
+        frame = pop_shared(index);
+        if (frame) {
+            fallback_hits_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            fallback_misses_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!frame) {
+        frame = allocate_new(index);
+        assert((bin_to_alloc_size(index) - sizeof(data_frame_header)) >= size);
+    }
     frame->size = size;
 #if AOO_DEBUG_DATA_FRAME_ALLOCATOR
     auto num_frames = num_frames_.fetch_add(1, std::memory_order_acquire) + 1;
@@ -60,23 +89,87 @@ void data_frame_allocator::deallocate(data_frame *frame) {
     assert(frame->header.size != (int32_t)0xdeadbeef);
     frame->header.size = (int32_t)0xdeadbeef;
 #endif
-    // add to free list
     auto index = frame->header.bin_index;
-    frame->header.next = bins_[index].load(std::memory_order_relaxed);
+    auto& m = get_magazine();
+    if (m.try_lock()) {
+        // add to magazine
+        frame->header.next = m.heads[index];
+        m.heads[index] = &frame->header;
+        if (++m.counts[index] >= magazine_batch_size * 2) {
+            // return a batch to the shared free list and keep the rest.
+            auto head = m.heads[index];
+            auto tail = head;
+            for (int32_t i = 1; i < magazine_batch_size; ++i) {
+                tail = tail->next;
+            }
+            m.heads[index] = tail->next;
+            m.counts[index] -= magazine_batch_size;
+            push_shared(index, head, tail);
+        }
+        m.unlock();
+    } else {
+        // magazine is used by another thread
+        push_shared(index, &frame->header, &frame->header);
+    }
+}
+
+void data_frame_allocator::set_process_thread() {
+    t_process_thread = true;
+}
+
+data_frame_allocator::magazine& data_frame_allocator::get_magazine() {
+    if (t_process_thread) {
+        return magazines_[0];
+    } else {
+        return magazines_[1 + this_thread_index() % (magazine_count - 1)];
+    }
+}
+
+data_frame_header * data_frame_allocator::allocate_new(size_t index) {
+    auto alloc_size = bin_to_alloc_size(index);
+    auto frame = (data_frame_header*)aoo::allocate(alloc_size);
+    frame->next = nullptr;
+    frame->bin_index = index;
+    frame->frame_index = 0;
+    auto num_bytes = bin_bytes_[index].fetch_add(alloc_size, std::memory_order_relaxed) + alloc_size;
+#if AOO_DATA_FRAME_LEAK_DETECTION
+    auto num_frames = num_alloc_frames_.fetch_add(1, std::memory_order_relaxed) + 1;
+#if AOO_DEBUG_DATA_FRAME_ALLOCATOR
+    LOG_DEBUG("data_frame_allocator: allocate " << alloc_size << " bytes (bin bytes: "
+              << num_bytes << ", total frames: " << num_frames << ")");
+#endif
+#endif
+    (void)num_bytes;
+    return frame;
+}
+
+// Take a single frame from the shared free list. To avoid the ABA problem,
+// we take the whole list and push back the remaining frames. This is
+// only used if the magazine is busy, so the list traversal is fine.
+data_frame_header * data_frame_allocator::pop_shared(size_t index) {
+    auto head = bins_[index].exchange(nullptr, std::memory_order_acquire);
+    if (head && head->next) {
+        auto tail = head->next;
+        while (tail->next) {
+            tail = tail->next;
+        }
+        push_shared(index, head->next, tail);
+    }
+    return head;
+}
+
+void data_frame_allocator::push_shared(size_t index, data_frame_header *head,
+                                       data_frame_header *tail) {
+    tail->next = bins_[index].load(std::memory_order_relaxed);
     // check if the head has changed and update it atomically.
     // (if the CAS fails, 'next' is updated to the current head)
-    while (!bins_[index].compare_exchange_weak(frame->header.next, &frame->header,
-                                               std::memory_order_acq_rel,
+    while (!bins_[index].compare_exchange_weak(tail->next, head,
+                                               std::memory_order_release,
                                                std::memory_order_relaxed)) ;
 }
 
 void data_frame_allocator::release_memory() {
-#if AOO_DATA_FRAME_LEAK_DETECTION
-    LOG_DEBUG("data_frame_allocator: release memory (" << num_alloc_bytes_.load()
-              << " bytes, " << num_alloc_frames_.load() << " frames)");
-#endif
-    for (auto& b : bins_) {
-        auto ptr = b.exchange(nullptr, std::memory_order_relaxed);
+    auto free_list = [this](data_frame_header *ptr) {
         while (ptr) {
             assert(ptr->bin_index >= 0 && ptr->frame_index >= 0);
             auto next = ptr->next;
@@ -85,16 +178,36 @@ void data_frame_allocator::release_memory() {
             LOG_DEBUG("data_frame: bin index = " << ptr->bin_index << ", frame index = "
                       << ptr->frame_index << ", alloc size = " << alloc_size);
 #endif
+            bin_bytes_[ptr->bin_index].fetch_sub(alloc_size, std::memory_order_relaxed);
             aoo::deallocate(ptr, alloc_size);
 #if AOO_DATA_FRAME_LEAK_DETECTION
-            num_alloc_bytes_.fetch_sub(alloc_size, std::memory_order_relaxed);
             num_alloc_frames_.fetch_sub(1, std::memory_order_relaxed);
 #endif
             ptr = next;
         }
+    };
+#if AOO_DATA_FRAME_LEAK_DETECTION
+    size_t total_bytes = 0;
+    for (auto& b : bin_bytes_) {
+        total_bytes += b.load(std::memory_order_relaxed);
+    }
+    LOG_DEBUG("data_frame_allocator: release memory (" << total_bytes
+              << " bytes, " << num_alloc_frames_.load() << " frames)");
+#endif
+    for (auto& m : magazines_) {
+        for (size_t i = 0; i < bin_count; ++i) {
+            free_list(std::exchange(m.heads[i], nullptr));
+            m.counts[i] = 0;
+        }
+    }
+    for (auto& b : bins_) {
+        free_list(b.exchange(nullptr, std::memory_order_relaxed));
     }
 #if AOO_DATA_FRAME_LEAK_DETECTION
-    auto num_alloc_bytes = num_alloc_bytes_.exchange(0, std::memory_order_relaxed);
+    size_t num_alloc_bytes = 0;
+    for (auto& b : bin_bytes_) {
+        num_alloc_bytes += b.exchange(0, std::memory_order_relaxed);
+    }
     auto num_alloc_frames = num_alloc_frames_.exchange(0, std::memory_order_relaxed);
     if (num_alloc_frames != 0) {
         LOG_ERROR("data_frame_allocator: leaked " << num_alloc_frames << " frames");
@@ -106,10 +219,23 @@ void data_frame_allocator::release_memory() {
 #endif
 }
 
+void data_frame_allocator::get_stats(stats &s) const {
+    s.hits = fallback_hits_.load(std::memory_order_relaxed);
+    s.misses = fallback_misses_.load(std::memory_order_relaxed);
+    for (auto& m : magazines_) {
+        s.hits += m.hits.load(std::memory_order_relaxed);
+        s.misses += m.misses.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < bin_count; ++i) {
+        s.bytes[i] = bin_bytes_[i].load(std::memory_order_relaxed);
+    }
+}
+
 size_t data_frame_allocator::size_to_bin(size_t size) {
     assert(size > 0);
     // NB: it shouldn't be possible to receive a data frame that is larger
-    // than AOO_MAX_BLOCK_SIZE in the first place!
+    // than AOO_MAX_PACKET_SIZE in the first place! Larger allocations
+    // are only requested for block buffers, see block_buffer::create().
     if (size > max_bin_size) {
         throw std::runtime_error("data frame allocation request too large");
     }
@@ -252,4 +378,25 @@ data_frame* data_frame_storage::find_frame(int32_t index) const {
     return nullptr;
 }
 
+//-------------------------- block_buffer --------------------------------//
+
+block_buffer * block_buffer::create(data_frame_allocator &alloc, int32_t sequence,
+                                    int32_t size, int32_t num_frames) {
+    assert(size > 0 && num_frames > 0);
+    auto alloc_size = sizeof(block_buffer) + size;
+    if (num_frames > frame_limit || alloc_size > data_frame_allocator::max_bin_size) {
+        return nullptr;
+    }
+    auto frame = alloc.allocate(alloc_size);
+    return new (frame->data) block_buffer(frame, sequence, size, num_frames);
+}
+
+void block_buffer::release(data_frame_allocator &alloc) {
+    if (refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        auto frame = frame_;
+        this->~block_buffer();
+        alloc.deallocate(frame);
+    }
+}
+
 } // aoo
@@ -2,6 +2,8 @@
 
 #include "detail.hpp"
 
+#include "common/sync.hpp"
+
 #include <array>
 #include <atomic>
 #include <bitset>
@@ -70,14 +72,43 @@ inline constexpr size_t calc_bin_count(size_t min, size_t max) {
 // 1. reduce memory usage,
 // 2. prevent memory fragmentation
 // 3. support heterogenous stream data sizes
+//
+// Frames are typically allocated on the network thread(s) and
+// deallocated on the audio thread. To avoid CAS traffic on shared
+// cache lines for every single frame, each thread works on its own
+// "magazine" (a set of private free lists) and only exchanges frames
+// with the shared free lists in batches: a thread with an empty
+// magazine takes the whole shared free list with a single atomic
+// exchange, and a thread with a full magazine pushes a whole batch.
+// Since we never pop individual frames from the shared free lists,
+// there is no ABA problem.
+// Threads are mapped to magazines by their role: the first magazine is
+// reserved for the thread that currently processes the stream (i.e. the
+// audio thread or a process worker thread, see set_process_thread()),
+// all other threads (i.e. network threads) share the remaining magazines.
+// Each magazine is protected by a flag; if another thread is currently
+// using it, we fall back to the shared free lists.
 
 class data_frame_allocator {
 public:
     static constexpr size_t min_bin_size = 64;
-    static constexpr size_t max_bin_size = AOO_MAX_PACKET_SIZE;
+    // NB: larger than AOO_MAX_PACKET_SIZE because of block_buffer
+    static constexpr size_t max_bin_size = 1 << 16;
     static constexpr size_t min_bin_ilog2_size = 6;
     static_assert(1 << min_bin_ilog2_size == min_bin_size,
                   "bad value(s) for min_bin_[ilog2]_size");
+    static constexpr size_t bin_count = detail::calc_bin_count(min_bin_size, max_bin_size);
+    // number of magazines; the first one is reserved for the process thread.
+    static constexpr size_t magazine_count = 4;
+    static_assert(magazine_count >= 2, "need at least 2 magazines");
+    // number of frames that are returned to the shared free list in one go
+    static constexpr int32_t magazine_batch_size = 16;
+
+    struct stats {
+        uint64_t hits;
+        uint64_t misses;
+        std::array<size_t, bin_count> bytes;
+    };
 
     data_frame_allocator() = default;
     ~data_frame_allocator() { release_memory(); }
@@ -85,15 +116,56 @@ public:
     data_frame* allocate(int32_t size);
     void deallocate(data_frame *frame);
 
+    // Mark the calling thread as a process thread, see above.
+    // NB: this applies to all allocator instances.
+    static void set_process_thread();
+
+    // NB: must not be called concurrently with allocate() or deallocate()!
     void release_memory();
+
+    void get_stats(stats& s) const;
 private:
     static size_t size_to_bin(size_t size);
     static size_t bin_to_alloc_size(size_t index);
 
-    static constexpr size_t bin_count = detail::calc_bin_count(min_bin_size, max_bin_size);
+    data_frame_header * allocate_new(size_t index);
+    data_frame_header * pop_shared(size_t index);
+    void push_shared(size_t index, data_frame_header *head, data_frame_header *tail);
+
+    struct magazine {
+        std::atomic<bool> busy{false};
+        // only accessed by the thread that owns the magazine
+        std::array<data_frame_header*, bin_count> heads{}; // initialize!
+        std::array<int32_t, bin_count> counts{}; // initialize!
+        // only written by the thread that owns the magazine
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+
+        bool try_lock() {
+            return !busy.load(std::memory_order_relaxed) &&
+                   !busy.exchange(true, std::memory_order_acquire);
+        }
+
+        void unlock() {
+            busy.store(false, std::memory_order_release);
+        }
+        // Pad to prevent false sharing between magazines. NB: we can't
+        // use alignas() because the allocator itself may be allocated
+        // with aoo::allocate(), which does not support over-alignment.
+        char pad[sync::CACHELINE_SIZE];
+    };
+
+    magazine& get_magazine();
+
+    std::array<magazine, magazine_count> magazines_;
+    // shared free lists
     std::array<std::atomic<data_frame_header*>, bin_count> bins_{}; // initialize!
+    // total allocated memory per bin
+    std::array<std::atomic<size_t>, bin_count> bin_bytes_{}; // initialize!
+    // allocations that bypassed a (busy) magazine
+    std::atomic<uint64_t> fallback_hits_{0};
+    std::atomic<uint64_t> fallback_misses_{0};
 #if AOO_DATA_FRAME_LEAK_DETECTION
-    std::atomic<int> num_alloc_bytes_{0};
     std::atomic<int> num_alloc_frames_{0};
 #endif
 #if AOO_DEBUG_DATA_FRAME_ALLOCATOR
@@ -151,4 +223,56 @@ private:
     data_frame* find_frame(int32_t index) const;
 };
 
+//---------------------- block_buffer ----------------------------//
+
+// A contiguous buffer for all frames of a block. The network thread writes
+// incoming frames directly to their final position (see block_assembler),
+// so that the decoder can read the whole block in place.
+// The buffer is shared between the network thread and the audio thread
+// (see received_block), so it is reference counted. Each frame can only
+// be written once; see claim_frame().
+class block_buffer {
+public:
+    static constexpr int32_t frame_limit = data_frame_storage::frame_limit;
+
+    // returns nullptr if the block is too large
+    static block_buffer * create(data_frame_allocator& alloc, int32_t sequence,
+                                 int32_t size, int32_t num_frames);
+
+    void retain() {
+        refcount_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release(data_frame_allocator& alloc);
+
+    // claim a frame for writing; returns false if it has already been claimed.
+    bool claim_frame(int32_t index) {
+        assert(index >= 0 && index < num_frames_);
+        auto mask = (uint64_t)1 << (index & 63);
+        auto& word = claimed_[index >> 6];
+        return !(word.fetch_or(mask, std::memory_order_relaxed) & mask);
+    }
+
+    bool match(int32_t sequence, int32_t size, int32_t num_frames) const {
+        return sequence == sequence_ && size == size_ && num_frames == num_frames_;
+    }
+
+    int32_t sequence() const { return sequence_; }
+    int32_t size() const { return size_; }
+    int32_t num_frames() const { return num_frames_; }
+
+    AooByte * data() { return reinterpret_cast<AooByte *>(this + 1); }
+    const AooByte * data() const { return reinterpret_cast<const AooByte *>(this + 1); }
+private:
+    block_buffer(data_frame *frame, int32_t sequence, int32_t size, int32_t num_frames)
+        : frame_(frame), sequence_(sequence), size_(size), num_frames_(num_frames) {}
+
+    data_frame *frame_; // underlying memory
+    std::atomic<int32_t> refcount_{1};
+    int32_t sequence_;
+    int32_t size_;
+    int32_t num_frames_;
+    std::array<std::atomic<uint64_t>, frame_limit / 64> claimed_{};
+};
+
 } // aoo
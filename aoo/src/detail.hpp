@@ -113,14 +113,17 @@ struct endpoint {
     AooId id = 0;
     bool binary = false;
 
-    void send(const osc::OutboundPacketStream& msg, const sendfn& fn) const {
-        send((const AooByte *)msg.Data(), msg.Size(), fn);
+    void send(const osc::OutboundPacketStream& msg, const sendfn& fn,
+              AooFlag flags = 0) const {
+        send((const AooByte *)msg.Data(), msg.Size(), fn, flags);
     }
 #if AOO_NET
-    void send(const AooByte *data, AooSize size, const sendfn& fn) const;
+    void send(const AooByte *data, AooSize size, const sendfn& fn,
+              AooFlag flags = 0) const;
 #else
-    void send(const AooByte *data, AooSize size, const sendfn& fn) const {
-        fn(data, size, address, 0);
+    void send(const AooByte *data, AooSize size, const sendfn& fn,
+              AooFlag flags = 0) const {
+        fn(data, size, address, flags);
     }
 #endif
 };
@@ -136,7 +139,8 @@ AooSize write_relay_message(AooByte *buffer, AooSize bufsize, const AooByte *msg
                             AooSize msgsize, const ip_address& addr, bool binary);
 } // net
 
-inline void endpoint::send(const AooByte *data, AooSize size, const sendfn& fn) const {
+inline void endpoint::send(const AooByte *data, AooSize size, const sendfn& fn,
+                           AooFlag flags) const {
     if (relay.valid()) {
     #if AOO_DEBUG_RELAY
         LOG_DEBUG("relay message to " << *this << " via " << relay);
@@ -145,12 +149,12 @@ inline void endpoint::send(const AooByte *data, AooSize size, const sendfn& fn)
         auto result = net::write_relay_message(buffer, sizeof(buffer),
                                                data, size, address, binary);
         if (result > 0) {
-            fn(buffer, result, relay, 0);
+            fn(buffer, result, relay, flags);
         } else {
             LOG_ERROR("can't relay binary message: buffer too small");
         }
     } else {
-        fn(data, size, address, 0);
+        fn(data, size, address, flags);
     }
 }
 #endif
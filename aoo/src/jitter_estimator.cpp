@@ -0,0 +1,86 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#include "jitter_estimator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace aoo {
+
+void jitter_estimator::setup(double resolution, double range, double decay) {
+    assert(resolution > 0 && range > 0);
+    resolution_ = resolution;
+    decay_ = decay;
+    histogram_.resize(std::ceil(range / resolution) + 1);
+    reset();
+}
+
+void jitter_estimator::reset() {
+    std::fill(histogram_.begin(), histogram_.end(), 0);
+    weight_ = 1;
+    sum_ = 0;
+    jitter_ = 0;
+    last_headroom_ = 0;
+    last_seq_ = -1;
+    count_ = 0;
+}
+
+void jitter_estimator::add(int32_t seq, double headroom) {
+    if (histogram_.empty()) {
+        return;
+    }
+    // RFC 3550 jitter; only consider consecutive blocks.
+    if (count_ > 0 && seq == last_seq_ + 1) {
+        auto d = std::abs(headroom - last_headroom_);
+        jitter_ += (d - jitter_) * (1.0 / 16.0);
+    }
+    last_seq_ = seq;
+    last_headroom_ = headroom;
+    count_++;
+    // Instead of scaling down all bins, we scale up the weight of new values.
+    // Rescale everything before we run into floating point issues.
+    weight_ /= decay_;
+    if (weight_ > 1e100) {
+        for (auto& x : histogram_) {
+            x /= weight_;
+        }
+        sum_ /= weight_;
+        weight_ = 1;
+    }
+    // late blocks go into the first bin, very early blocks into the last bin.
+    auto index = std::max<double>(0, headroom / resolution_);
+    auto bin = std::min<size_t>(index, histogram_.size() - 1);
+    histogram_[bin] += weight_;
+    sum_ += weight_;
+}
+
+double jitter_estimator::percentile(double p) const {
+    auto threshold = sum_ * p;
+    double accum = 0;
+    for (size_t i = 0; i < histogram_.size(); ++i) {
+        accum += histogram_[i];
+        if (accum > threshold) {
+            return i * resolution_;
+        }
+    }
+    return (histogram_.size() - 1) * resolution_;
+}
+
+double adaptive_latency_speed(double headroom, double margin, double latency,
+                              double min_latency, double max_latency) {
+    if (headroom > margin + ADAPTIVE_LATENCY_HYSTERESIS) {
+        if (latency > min_latency) {
+            return ADAPTIVE_LATENCY_SHRINK;
+        }
+    } else if (headroom < margin) {
+        if (latency < max_latency) {
+            return ADAPTIVE_LATENCY_GROW;
+        }
+    }
+    return 1;
+}
+
+} // namespace aoo
@@ -0,0 +1,76 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#pragma once
+
+#include "detail.hpp"
+
+// Adaptive latency, see source_desc::adapt_latency().
+// Resolution of the headroom histogram in seconds.
+#define ADAPTIVE_LATENCY_RESOLUTION 0.00025
+// Time constant of the jitter statistics in seconds.
+#define ADAPTIVE_LATENCY_MEMORY 5.0
+// Min. number of blocks before we start to adapt.
+#define ADAPTIVE_LATENCY_MIN_COUNT 100
+// Percentile of the headroom distribution that we try to keep above the margin.
+#define ADAPTIVE_LATENCY_PERCENTILE 0.02
+// Hysteresis in seconds.
+#define ADAPTIVE_LATENCY_HYSTERESIS 0.001
+// Playback speed for reducing resp. increasing the latency.
+// NB: a speed change of 0.2% resp. 0.5% is practically inaudible.
+#define ADAPTIVE_LATENCY_SHRINK 1.002
+#define ADAPTIVE_LATENCY_GROW 0.995
+
+namespace aoo {
+
+//------------------------ jitter_estimator ----------------------------//
+
+// Network jitter statistics for the adaptive sink latency.
+//
+// The input values are the "headroom" of incoming blocks, i.e. the time
+// between the arrival of a block and the moment it is due for decoding.
+// Late blocks have a negative headroom.
+// * jitter() returns the interarrival jitter as described in RFC 3550,
+//   section 6.4.1: J += (|D(i-1, i)| - J) / 16. With a constant latency,
+//   D is just the headroom difference between two consecutive blocks.
+// * percentile() returns the given percentile of the headroom distribution.
+//   The histogram uses exponential forgetting, so that the statistics can
+//   follow changing network conditions.
+class jitter_estimator {
+public:
+    // 'resolution' and 'range' are in seconds; 'decay' is the
+    // forgetting factor, which is applied on every new value.
+    void setup(double resolution, double range, double decay);
+
+    void reset();
+
+    void add(int32_t seq, double headroom);
+
+    int32_t count() const { return count_; }
+
+    double jitter() const { return jitter_; }
+
+    // NB: the result is quantized to the lower edge of the histogram bin
+    double percentile(double p) const;
+private:
+    aoo::vector<double> histogram_;
+    double resolution_ = 0;
+    double decay_ = 1;
+    double weight_ = 1;
+    double sum_ = 0;
+    double jitter_ = 0;
+    double last_headroom_ = 0;
+    int32_t last_seq_ = -1;
+    int32_t count_ = 0;
+};
+
+// Returns the playback speed for the adaptive latency: ADAPTIVE_LATENCY_SHRINK
+// if the predicted 'headroom' exceeds the safety 'margin' (both in seconds),
+// ADAPTIVE_LATENCY_GROW if it falls below, otherwise 1. The latency is only
+// reduced while it is above 'min_latency' and only increased while it is
+// below 'max_latency' (in any unit).
+double adaptive_latency_speed(double headroom, double margin, double latency,
+                              double min_latency, double max_latency);
+
+} // namespace aoo
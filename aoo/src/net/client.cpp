@@ -204,6 +204,13 @@ AooError AOO_CALL aoo::net::Client::run(AooSeconds timeout){
                 cmd->perform(*this);
             }
 
+            // free old peer indexes, see update_peer_index()
+            {
+                sync::scoped_lock<sync::mutex> lock(peer_index_mutex_);
+                peer_id_index_.reclaim();
+                peer_address_index_.reclaim();
+                peer_name_index_.reclaim();
+            }
             if (peers_.reclaim()){
                 LOG_DEBUG("AooClient: free stale peers");
             }
@@ -262,55 +269,145 @@ AOO_API AooError AOO_CALL AooClient_send(
 
 AooError AOO_CALL aoo::net::Client::send(AooSeconds timeout)
 {
+    // sources and sinks are typically woken up by notify() after they have
+    // been processed, but they also need to be visited periodically, e.g. to
+    // send pings or to handle invitations. Server pings and peers are only
+    // visited when they are due, see update_peers().
     constexpr double interval = 0.1;
 
+    auto remaining = timeout;
+    bool notified = send_event_.try_wait();
+
     while (!quit_.load(std::memory_order_relaxed)) {
         auto now = time_tag::now();
 
+        // With send aggregation, all packets of this cycle are queued
+        // and sent in as few batches as possible, see the end of the loop.
+        // NB: this only works with our own socket!
+        bool internal = udp_sendfn_.fn() == udp_client::send;
+        bool aggregate = internal && send_aggregation_.load();
+        auto fn = aggregate ? sendfn(udp_client::send_aggregated, &udp_client_)
+                            : udp_sendfn_;
     #if AOO_CLIENT_SIMULATE
-        auto reply = simulate_.wrap(udp_sendfn_, now);
+        auto reply = simulate_.wrap(fn, now);
     #else
-        auto reply = udp_sendfn_;
+        auto reply = fn;
     #endif
 
-        // send sources and sinks
+        // send sources and sinks. They do not tell us if they have sent
+        // anything, so we count their packets, see 'didsomething' below.
+        struct packet_counter {
+            sendfn fn;
+            int32_t count;
+
+            static AooInt32 AOO_CALL send(void *user, const AooByte *data, AooInt32 size,
+                                          const void *address, AooAddrSize addrlen,
+                                          AooFlag flags) {
+                auto self = static_cast<packet_counter *>(user);
+                self->count++;
+                return self->fn.fn()(self->fn.user(), data, size, address, addrlen, flags);
+            }
+        } counter { reply, 0 };
+        bool have_dependants;
         {
             sync::scoped_shared_lock lock(source_sink_mutex_);
             for (auto& s : sources_){
-                s.source->send(reply.fn(), reply.user());
+                s.source->send(packet_counter::send, &counter);
             }
             for (auto& s : sinks_){
-                s.sink->send(reply.fn(), reply.user());
+                s.sink->send(packet_counter::send, &counter);
             }
+            have_dependants = !sources_.empty() || !sinks_.empty();
         }
 
         // send server/peer messages
+        bool didsomething = notified || counter.count > 0;
+        time_tag deadline;
         if (state_.load() != client_state::disconnected) {
-            udp_client_.update(*this, reply, now);
+            deadline = udp_client_.update(*this, reply, now, didsomething);
 
-            // NB: if we use a seqlock, we probably do not have
-            // to pass the settings to the send() method.
-            peer_settings_lock_.lock();
-            auto settings = peer_ping_settings_;
-            peer_settings_lock_.unlock();
-
-            // update peers
-            peer_lock lock(peers_);
-            for (auto& p : peers_){
-                p.send(*this, reply, now, settings);
+            auto next_peer = update_peers(reply, now, didsomething);
+            if (deadline.is_empty() || (!next_peer.is_empty() && next_peer < deadline)) {
+                deadline = next_peer;
             }
         }
 
+        // make sure that there are no pending packets, e.g. if
+        // the last packet of a batch could not be sent.
+        if (internal) {
+            udp_client_.flush();
+        }
+
+        // wait until the next deadline; negative: infinite
+        double sleep = -1;
+        if (!deadline.is_empty()) {
+            sleep = std::max<double>(0, time_tag::duration(now, deadline));
+        }
+        if (have_dependants && (sleep < 0 || sleep > interval)) {
+            sleep = interval;
+        }
+
         if (timeout >= 0) {
-            return kAooOk;
+            if (didsomething) {
+                return kAooOk;
+            } else if (remaining <= 0) {
+                return kAooErrorWouldBlock;
+            }
+            if (sleep < 0 || sleep > remaining) {
+                sleep = remaining;
+            }
+            remaining -= sleep;
+        }
+
+        if (sleep < 0) {
+            send_event_.wait();
+            notified = true;
         } else {
-            send_event_.wait_for(interval);
+            notified = send_event_.wait_for(sleep);
         }
     }
 
     return kAooOk;
 }
 
+aoo::time_tag aoo::net::Client::update_peers(const sendfn& fn, time_tag now,
+                                             bool& didsomething) {
+    // NB: if we use a seqlock, we probably do not have
+    // to pass the settings to the send() method.
+    peer_settings_lock_.lock();
+    auto settings = peer_ping_settings_;
+    peer_settings_lock_.unlock();
+
+    auto visit = [&](peer& p) {
+        auto deadline = p.send(*this, fn, now, settings);
+        peer_timers_.schedule(p, std::make_pair(p.group_id(), p.user_id()), deadline);
+        didsomething = true;
+    };
+
+    peer_lock lock(peers_);
+    // 1) visit all peers, e.g. after the ping settings have changed
+    if (reschedule_peers_.exchange(false)) {
+        for (auto& p : peers_) {
+            p.clear_dirty();
+            visit(p);
+        }
+    }
+    // 2) visit dirty peers
+    std::pair<AooId, AooId> id;
+    while (dirty_peers_.try_pop(id)) {
+        if (auto p = find_peer(id.first, id.second)) {
+            p->clear_dirty();
+            visit(*p);
+        }
+    }
+    // 3) visit due peers
+    peer_timers_.dispatch(now, [&](const std::pair<AooId, AooId>& id) {
+        return find_peer(id.first, id.second);
+    }, visit);
+
+    return peer_timers_.next();
+}
+
 AOO_API AooError AOO_CALL AooClient_receive(
     AooClient *client, AooSeconds timeout){
     return client->receive(timeout);
@@ -359,21 +456,19 @@ AooError AOO_CALL aoo::net::Client::handlePacket(
 
     if (type == kAooMsgTypeSource){
         // forward to matching source
-        sync::scoped_shared_lock lock(source_sink_mutex_);
-        for (auto& s : sources_){
-            if (s.id == id){
-                return s.source->handleMessage(data, size, addr, len);
-            }
+        AooError result;
+        if (source_index_.visit(id, [&](AooSource *source) {
+                result = source->handleMessage(data, size, addr, len); })) {
+            return result;
         }
         LOG_WARNING("AooClient: handle_message(): source not found");
         return kAooErrorNotFound;
     } else if (type == kAooMsgTypeSink){
         // forward to matching sink
-        sync::scoped_shared_lock lock(source_sink_mutex_);
-        for (auto& s : sinks_){
-            if (s.id == id){
-                return s.sink->handleMessage(data, size, addr, len);
-            }
+        AooError result;
+        if (sink_index_.visit(id, [&](AooSink *sink) {
+                result = sink->handleMessage(data, size, addr, len); })) {
+            return result;
         }
         LOG_WARNING("AooClient: handle_message(): sink not found");
         return kAooErrorNotFound;
@@ -470,6 +565,7 @@ AooError AOO_CALL aoo::net::Client::addSource(AooSource *src)
     }
 #endif
     sources_.push_back({ src, id });
+    update_source_index();
     src->control(kAooCtlSetClient,
                  reinterpret_cast<intptr_t>(this), nullptr, 0);
     return kAooOk;
@@ -487,6 +583,9 @@ AooError AOO_CALL aoo::net::Client::removeSource(AooSource *src)
     for (auto it = sources_.begin(); it != sources_.end(); ++it){
         if (it->source == src){
             sources_.erase(it);
+            update_source_index();
+            // wait until the source is not used by handlePacket() anymore
+            source_index_.synchronize();
             src->control(kAooCtlSetClient, 0, nullptr, 0);
             return kAooOk;
         }
@@ -495,6 +594,15 @@ AooError AOO_CALL aoo::net::Client::removeSource(AooSource *src)
     return kAooErrorNotFound;
 }
 
+// NB: called with the writer lock held
+void aoo::net::Client::update_source_index() {
+    decltype(source_index_)::map_type map;
+    for (auto& s : sources_) {
+        map.emplace(s.id, s.source);
+    }
+    source_index_.update(std::move(map));
+}
+
 AOO_API AooError AOO_CALL AooClient_addSink(
         AooClient *client, AooSink *sink)
 {
@@ -520,6 +628,7 @@ AooError AOO_CALL aoo::net::Client::addSink(AooSink *sink)
     }
 #endif
     sinks_.push_back({ sink, id });
+    update_sink_index();
     sink->control(kAooCtlSetClient,
                   reinterpret_cast<intptr_t>(this), nullptr, 0);
     return kAooOk;
@@ -537,6 +646,9 @@ AooError AOO_CALL aoo::net::Client::removeSink(AooSink *sink)
     for (auto it = sinks_.begin(); it != sinks_.end(); ++it){
         if (it->sink == sink){
             sinks_.erase(it);
+            update_sink_index();
+            // wait until the sink is not used by handlePacket() anymore
+            sink_index_.synchronize();
             sink->control(kAooCtlSetClient, 0, nullptr, 0);
             return kAooOk;
         }
@@ -545,6 +657,15 @@ AooError AOO_CALL aoo::net::Client::removeSink(AooSink *sink)
     return kAooErrorNotFound;
 }
 
+// NB: called with the writer lock held
+void aoo::net::Client::update_sink_index() {
+    decltype(sink_index_)::map_type map;
+    for (auto& s : sinks_) {
+        map.emplace(s.id, s.sink);
+    }
+    sink_index_.update(std::move(map));
+}
+
 AOO_API AooError AOO_CALL AooClient_connect(
         AooClient *client, const AooClientConnect *args,
         AooResponseHandler cb, void *context) {
@@ -708,30 +829,28 @@ AooError AOO_CALL aoo::net::Client::findPeerByName(
         void *address, AooAddrSize *addrlen)
 {
     peer_lock lock(peers_);
-    for (auto& p : peers_){
-        if (p.match(group, user)){
-            if (groupId) {
-                *groupId = p.group_id();
-            }
-            if (userId) {
-                *userId = p.user_id();
-            }
-            if (address && addrlen) {
-                auto addr = p.address();
-                if (addr.valid()) {
-                    if (*addrlen >= addr.length()) {
-                        memcpy(address, addr.address(), addr.length());
-                        *addrlen = addr.length();
-                    } else {
-                        return kAooErrorInsufficientBuffer;
-                    }
+    if (auto p = find_peer(group, user)) {
+        if (groupId) {
+            *groupId = p->group_id();
+        }
+        if (userId) {
+            *userId = p->user_id();
+        }
+        if (address && addrlen) {
+            auto addr = p->address();
+            if (addr.valid()) {
+                if (*addrlen >= addr.length()) {
+                    memcpy(address, addr.address(), addr.length());
+                    *addrlen = addr.length();
                 } else {
-                    // TODO: maybe return kAooErrorNotInitialized?
-                    *addrlen = 0;
+                    return kAooErrorInsufficientBuffer;
                 }
+            } else {
+                // TODO: maybe return kAooErrorNotInitialized?
+                *addrlen = 0;
             }
-            return kAooOk;
         }
+        return kAooOk;
     }
     return kAooErrorNotFound;
 }
@@ -747,16 +866,14 @@ AooError AOO_CALL aoo::net::Client::findPeerByAddress(
 {
     ip_address addr((const struct sockaddr *)address, addrlen);
     peer_lock lock(peers_);
-    for (auto& p : peers_){
-        if (p.match(addr)) {
-            if (groupId) {
-                *groupId = p.group_id();
-            }
-            if (userId) {
-                *userId = p.user_id();
-            }
-            return kAooOk;
+    if (auto p = find_peer(addr)) {
+        if (groupId) {
+            *groupId = p->group_id();
+        }
+        if (userId) {
+            *userId = p->user_id();
         }
+        return kAooOk;
     }
     return kAooErrorNotFound;
 }
@@ -775,28 +892,26 @@ AooError AOO_CALL aoo::net::Client::getPeerName(
         AooChar *userNameBuffer, AooSize *userNameSize)
 {
     peer_lock lock(peers_);
-    for (auto& p : peers_){
-        if (p.match(group, user)) {
-            if (groupNameBuffer && groupNameSize) {
-                auto size = p.group_name().size() + 1;
-                if (*groupNameSize >= size) {
-                    memcpy(groupNameBuffer, p.group_name().c_str(), size);
-                    *groupNameSize = size - 1; // exclude the 0 character!
-                } else {
-                    return kAooErrorInsufficientBuffer;
-                }
+    if (auto p = find_peer(group, user)) {
+        if (groupNameBuffer && groupNameSize) {
+            auto size = p->group_name().size() + 1;
+            if (*groupNameSize >= size) {
+                memcpy(groupNameBuffer, p->group_name().c_str(), size);
+                *groupNameSize = size - 1; // exclude the 0 character!
+            } else {
+                return kAooErrorInsufficientBuffer;
             }
-            if (userNameBuffer && userNameSize) {
-                auto size = p.user_name().size() + 1;
-                if (*userNameSize >= size) {
-                    memcpy(userNameBuffer, p.user_name().c_str(), size);
-                    *userNameSize = size - 1; // exclude the 0 character!
-                } else {
-                    return kAooErrorInsufficientBuffer;
-                }
+        }
+        if (userNameBuffer && userNameSize) {
+            auto size = p->user_name().size() + 1;
+            if (*userNameSize >= size) {
+                memcpy(userNameBuffer, p->user_name().c_str(), size);
+                *userNameSize = size - 1; // exclude the 0 character!
+            } else {
+                return kAooErrorInsufficientBuffer;
             }
-            return kAooOk;
         }
+        return kAooOk;
     }
     return kAooErrorNotFound;
 }
@@ -891,12 +1006,47 @@ AooError AOO_CALL aoo::net::Client::control(
         CHECKARG(AooBool);
         as<AooBool>(ptr) = binary_.load();
         break;
+    case kAooCtlSetSendAggregation:
+        CHECKARG(AooBool);
+        send_aggregation_.store(as<AooBool>(ptr));
+        break;
+    case kAooCtlGetSendAggregation:
+        CHECKARG(AooBool);
+        as<AooBool>(ptr) = send_aggregation_.load();
+        break;
+    case kAooCtlJoinMulticastGroup:
+    case kAooCtlLeaveMulticastGroup:
+    {
+        auto group = reinterpret_cast<const AooChar *>(index);
+        if (group == nullptr) {
+            return kAooErrorBadArgument;
+        }
+        // NB: the port is irrelevant for group membership, but
+        // ip_address() would return an invalid address for port 0.
+        ip_address addr(group, 1);
+        if (!addr.valid() || !addr.is_multicast()) {
+            return kAooErrorBadFormat;
+        }
+        return udp_client_.set_group_membership(addr, ctl == kAooCtlJoinMulticastGroup);
+    }
+    case kAooCtlSetMulticastTTL:
+    {
+        CHECKARG(AooInt32);
+        auto ttl = as<AooInt32>(ptr);
+        if (ttl < 0 || ttl > 255) {
+            return kAooErrorBadArgument;
+        }
+        return udp_client_.set_multicast_ttl(ttl);
+    }
     case kAooCtlSetPingSettings:
         CHECKARG(AooPingSettings);
         if (index == 0) {
             peer_settings_lock_.lock();
             peer_ping_settings_ = as<AooPingSettings>(ptr);
             peer_settings_lock_.unlock();
+            // reschedule peers
+            reschedule_peers_.store(true);
+            notify();
         } else if (index == 1) {
             server_settings_lock_.lock();
             server_ping_settings_ = as<AooPingSettings>(ptr);
@@ -963,11 +1113,9 @@ AooError AOO_CALL aoo::net::Client::control(
         auto ep = reinterpret_cast<const AooEndpoint *>(index);
         ip_address addr((sockaddr *)ep->address, ep->addrlen);
         peer_lock lock(peers_);
-        for (auto& peer : peers_){
-            if (peer.match(addr)){
-                as<AooBool>(ptr) = peer.need_relay();
-                return kAooOk;
-            }
+        if (auto peer = find_peer(addr)) {
+            as<AooBool>(ptr) = peer->need_relay();
+            return kAooOk;
         }
         return kAooErrorNotFound;
     }
@@ -977,11 +1125,9 @@ AooError AOO_CALL aoo::net::Client::control(
         auto ep = reinterpret_cast<const AooEndpoint *>(index);
         ip_address addr((sockaddr *)ep->address, ep->addrlen);
         peer_lock lock(peers_);
-        for (auto& peer : peers_){
-            if (peer.match(addr)){
-                as<ip_address>(ptr) = peer.relay_address();
-                return kAooOk;
-            }
+        if (auto peer = find_peer(addr)) {
+            as<ip_address>(ptr) = peer->relay_address();
+            return kAooOk;
         }
         return kAooErrorNotFound;
     }
@@ -1022,13 +1168,12 @@ bool Client::handle_peer_osc_message(const osc::ReceivedMessage& msg, int onset,
         auto remaining = msg.ArgumentCount() - 2;
         // forward to matching peer
         peer_lock lock(peers_);
-        for (auto& p : peers_) {
-            if (p.match(group, user)) {
-                p.handle_osc_message(*this, pattern, it, remaining, addr);
-                // notify send thread
-                notify();
-                return true;
-            }
+        if (auto p = find_peer(group, user)) {
+            p->handle_osc_message(*this, pattern, it, remaining, addr);
+            // notify send thread
+            mark_dirty(*p);
+            notify();
+            return true;
         }
         LOG_WARNING("AooClient: got " << pattern << " message from unknown peer "
                     << group << "|" << user << " " << addr);
@@ -1048,13 +1193,12 @@ bool Client::handle_peer_bin_message(const AooByte *data, AooSize size, int onse
     auto user = binmsg_user(data, size);
     // forward to matching peer
     peer_lock lock(peers_);
-    for (auto& p : peers_) {
-        if (p.match(group, user)) {
-            p.handle_bin_message(*this, data, size, onset, addr);
-            // notify send thread
-            notify();
-            return true;
-        }
+    if (auto p = find_peer(group, user)) {
+        p->handle_bin_message(*this, data, size, onset, addr);
+        // notify send thread
+        mark_dirty(*p);
+        notify();
+        return true;
     }
     LOG_WARNING("AooClient: got binary message from unknown peer "
                 << group << "|" << user << " " << addr);
@@ -1106,6 +1250,8 @@ void Client::perform(const connect_cmd& cmd)
     udp_client_.start_handshake(addrlist.front(), cmd.timeout_);
     // after start_handshake()! see udp_client::update()
     state_.store(client_state::handshake);
+    // wake up send thread
+    notify();
 }
 
 void Client::do_connect(const ip_host& server, AooSeconds timeout) {
@@ -1403,6 +1549,7 @@ void Client::handle_response(const group_leave_cmd& cmd, const osc::ReceivedMess
                 ++it;
             }
         }
+        update_peer_index();
         lock.unlock();
 
         // remove group membership
@@ -1542,10 +1689,18 @@ void Client::perform(const message& m, const sendfn& fn) {
     for (auto& peer : peers_) {
         if (peer.connected() && peer.match_wildcard(m.group_, m.user_)) {
             peer.send_message(m, fn, packet_size, binary);
+            // schedule resend resp. handle ack
+            mark_dirty(peer);
         }
     }
 }
 
+void Client::mark_dirty(peer& p) {
+    if (p.set_dirty()) {
+        dirty_peers_.push(p.group_id(), p.user_id());
+    }
+}
+
 void Client::send_event(event_ptr e)
 {
     switch (event_mode_){
@@ -1772,6 +1927,8 @@ void Client::handle_login(const osc::ReceivedMessage& msg){
 
             // connected!
             state_.store(client_state::connected);
+            // wake up send thread to start UDP pings
+            notify();
             LOG_VERBOSE("AooClient: successfully logged in (client ID: "
                         << id << ")");
             // start ping timer
@@ -1823,6 +1980,7 @@ void Client::handle_group_eject(const osc::ReceivedMessage& msg) {
             ++it;
         }
     }
+    update_peer_index();
     lock.unlock();
 
     // remove group membership
@@ -1919,11 +2077,9 @@ void Client::handle_peer_join(const osc::ReceivedMessage& msg){
 
     peer_lock lock(peers_);
     // check if peer already exists (shouldn't happen)
-    for (auto& p: peers_) {
-        if (p.match(group_id, user_id)){
-            LOG_ERROR("AooClient: peer " << p << " already added");
-            return;
-        }
+    if (auto p = find_peer(group_id, user_id)) {
+        LOG_ERROR("AooClient: peer " << *p << " already added");
+        return;
     }
     // find corresponding group
     auto membership = find_group_membership(group_name);
@@ -1967,6 +2123,10 @@ void Client::handle_peer_join(const osc::ReceivedMessage& msg){
     };
 
     auto peer = peers_.emplace_front(std::move(args));
+    update_peer_index();
+    // start handshake
+    mark_dirty(*peer);
+    notify();
 
     auto e = std::make_unique<peer_event>(kAooEventPeerHandshake, *peer);
     send_event(std::move(e));
@@ -2022,6 +2182,7 @@ void Client::handle_peer_leave(const osc::ReceivedMessage& msg){
     }
 
     peers_.erase(peer);
+    update_peer_index();
 
     LOG_VERBOSE("AooClient: peer " << group << "|" << user << " left");
 }
@@ -2036,15 +2197,13 @@ void Client::handle_peer_changed(const osc::ReceivedMessage& msg) {
     }
 
     peer_lock lock(peers_);
-    for (auto& peer : peers_) {
-        if (peer.match(group, user)) {
-            auto e = std::make_unique<peer_update_event>(group, user, *md);
-            send_event(std::move(e));
+    if (auto peer = find_peer(group, user)) {
+        auto e = std::make_unique<peer_update_event>(group, user, *md);
+        send_event(std::move(e));
 
-            LOG_VERBOSE("AooClient: peer " << peer << " has been updated");
+        LOG_VERBOSE("AooClient: peer " << *peer << " has been updated");
 
-            return;
-        }
+        return;
     }
 
     LOG_WARNING("AooClient: peer " << group << "|" << user
@@ -2103,6 +2262,7 @@ void Client::close() {
     // remove all peers
     peer_lock lock(peers_);
     peers_.clear();
+    update_peer_index();
 
     // clear pending request
     pending_requests_.clear();
@@ -2110,6 +2270,47 @@ void Client::close() {
     state_.store(client_state::disconnected);
 }
 
+// Rebuild the peer indexes; must be called after adding or removing peers
+// and when a peer has been connected (see peer::handle_first_ping()).
+// NB: since peers are only freed in the next peers_.reclaim(), it is safe
+// to use the result of the lookup as long as the peer list is locked.
+void Client::update_peer_index() {
+    decltype(peer_id_index_)::map_type id_map;
+    decltype(peer_address_index_)::map_type address_map;
+    decltype(peer_name_index_)::map_type name_map;
+
+    sync::scoped_lock<sync::mutex> lock(peer_index_mutex_);
+    peer_lock list_lock(peers_);
+    for (auto& p : peers_) {
+        id_map.emplace(peer_key(p.group_id(), p.user_id()), &p);
+        name_map.emplace(peer_key(p.group_name(), p.user_name()), &p);
+        if (p.connected()) {
+            address_map.emplace(p.address(), &p);
+        }
+    }
+    peer_id_index_.update(std::move(id_map));
+    peer_address_index_.update(std::move(address_map));
+    peer_name_index_.update(std::move(name_map));
+}
+
+peer * Client::find_peer(AooId group, AooId user) {
+    peer *result = nullptr;
+    peer_id_index_.find(peer_key(group, user), result);
+    return result;
+}
+
+peer * Client::find_peer(const ip_address& addr) {
+    peer *result = nullptr;
+    peer_address_index_.find(addr, result);
+    return result;
+}
+
+peer * Client::find_peer(std::string_view group, std::string_view user) {
+    peer *result = nullptr;
+    peer_name_index_.find(peer_key(group, user), result);
+    return result;
+}
+
 Client::group_membership * Client::find_group_membership(std::string_view name) {
     for (auto& g : groups_) {
         if (g.group_name == name) {
@@ -2202,6 +2403,41 @@ AooError udp_client::setup(Client& client, AooClientSettings& settings) {
     return kAooOk;
 }
 
+AooError udp_client::set_group_membership(const ip_address& group, bool join) {
+    if (!udp_server_.socket().is_open()) {
+        // external UDP socket
+        return kAooErrorNotPermitted;
+    }
+    try {
+        if (join) {
+            udp_server_.socket().join_group(group);
+        } else {
+            udp_server_.socket().leave_group(group);
+        }
+        return kAooOk;
+    } catch (const socket_error& e) {
+        LOG_ERROR("AooClient: could not " << (join ? "join" : "leave")
+                  << " multicast group " << group << ": " << e.what());
+        socket::set_last_error(e.code());
+        return kAooErrorSocket;
+    }
+}
+
+AooError udp_client::set_multicast_ttl(int ttl) {
+    if (!udp_server_.socket().is_open()) {
+        // external UDP socket
+        return kAooErrorNotPermitted;
+    }
+    try {
+        udp_server_.socket().set_multicast_ttl(ttl);
+        return kAooOk;
+    } catch (const socket_error& e) {
+        LOG_ERROR("AooClient: could not set multicast TTL: " << e.what());
+        socket::set_last_error(e.code());
+        return kAooErrorSocket;
+    }
+}
+
 AooError udp_client::receive(double timeout) {
     try {
         if (timeout >= 0) {
@@ -2295,7 +2531,9 @@ AooError udp_client::handle_osc_message(Client& client, const AooByte *data, int
     }
 }
 
-void udp_client::update(Client& client, const sendfn& fn, time_tag now){
+time_tag udp_client::update(Client& client, const sendfn& fn, time_tag now,
+                            bool& didsomething) {
+    time_tag deadline;
     auto state = client.current_state();
     if (state == client_state::handshake) {
         // initialize timer; see start_handshake()
@@ -2308,7 +2546,8 @@ void udp_client::update(Client& client, const sendfn& fn, time_tag now){
             // handshake has timed out!
             auto cmd = std::make_unique<Client::timeout_cmd>();
             client.push_command(std::move(cmd));
-            return;
+            didsomething = true;
+            return deadline;
         }
         // send handshake pings
         if (now >= next_ping_time_) {
@@ -2322,7 +2561,9 @@ void udp_client::update(Client& client, const sendfn& fn, time_tag now){
             send_server_message(msg, fn);
 
             next_ping_time_ += aoo::time_tag::from_seconds(client.query_interval());
+            didsomething = true;
         }
+        deadline = std::min(next_ping_time_, query_deadline_);
     } else if (state == client_state::connected) {
         // send regular pings
         // TODO: only do this when there are no (active) peers?
@@ -2337,13 +2578,18 @@ void udp_client::update(Client& client, const sendfn& fn, time_tag now){
             send_server_message(msg, fn);
 
             next_ping_time_ += aoo::time_tag::from_seconds(client.ping_interval());
+            didsomething = true;
         }
+        deadline = next_ping_time_;
     }
 
     // send outgoing peer/group messages
     messages_.consume_all([&](const auto& m) {
         client.perform(m, fn);
+        didsomething = true;
     });
+
+    return deadline;
 }
 
 void udp_client::start_handshake(const ip_address& remote,
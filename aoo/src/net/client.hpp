@@ -18,6 +18,8 @@
 #include "event.hpp"
 #include "peer.hpp"
 #include "ping_timer.hpp"
+#include "rcu_table.hpp"
+#include "timer_queue.hpp"
 #if AOO_CLIENT_SIMULATE
 # include "simulate.hpp"
 #endif
@@ -126,29 +128,51 @@ public:
 
     bool use_ipv4_mapped() const { return use_ipv4_mapped_; }
 
+    // only for the internal UDP socket
+    AooError set_group_membership(const ip_address& group, bool join);
+
+    AooError set_multicast_ttl(int ttl);
+
     AooError handle_osc_message(Client& client, const AooByte *data, int32_t n,
                                 const ip_address& addr, int32_t type, AooMsgType onset);
 
     AooError handle_bin_message(Client& client, const AooByte *data, int32_t n,
                                 const ip_address& addr, int32_t type, AooMsgType onset);
 
-    void update(Client& client, const sendfn& fn, time_tag now);
+    // returns the time of the next scheduled ping (empty if none)
+    time_tag update(Client& client, const sendfn& fn, time_tag now,
+                    bool& didsomething);
 
     void start_handshake(const ip_address& remote, AooSeconds timeout);
 
     void queue_message(message&& msg);
 
     static int send(void *user, const AooByte *data, AooInt32 size,
-                    const void *address, AooAddrSize addrlen, AooFlag) {
+                    const void *address, AooAddrSize addrlen, AooFlag flags) {
         aoo::ip_address addr((const struct sockaddr *)address, addrlen);
         auto& server = static_cast<udp_client *>(user)->udp_server_;
         try {
-            return server.send(addr, data, size);
+            return server.send(addr, data, size, flags & kAooSendMore);
         } catch (const socket_error& e) {
             socket::set_last_error(e.code());
             return -1;
         }
     }
+
+    // like send(), but always queue the packet; the packets
+    // are only sent when the queue is full or in flush().
+    static int send_aggregated(void *user, const AooByte *data, AooInt32 size,
+                               const void *address, AooAddrSize addrlen, AooFlag flags) {
+        return send(user, data, size, address, addrlen, flags | kAooSendMore);
+    }
+
+    void flush() {
+        try {
+            udp_server_.flush();
+        } catch (const socket_error& e) {
+            LOG_DEBUG("AooClient: could not flush UDP packets: " << e.what());
+        }
+    }
 private:
     void send_server_message(const osc::OutboundPacketStream& msg, const sendfn& fn);
 
@@ -383,6 +407,12 @@ public:
 
     void push_command(command_ptr cmd);
 
+    void update_peer_index();
+
+    // wake up the peer on the next send() cycle;
+    // call notify() afterwards when not on the send thread.
+    void mark_dirty(peer& p);
+
     client_state current_state() const { return state_.load(); }
 private:
     // networking
@@ -402,6 +432,13 @@ private:
     sync::mutex interface_mutex_; // TODO: replace with seqlock?
     std::vector<char> sendbuffer_;
     aoo::sync::event send_event_;
+    // Peers are only visited in send() when they are due or have been
+    // marked dirty, e.g. because of an incoming message.
+    // The timers are keyed by group + user ID.
+    timer_queue<std::pair<AooId, AooId>, peer> peer_timers_;
+    aoo::unbounded_mpsc_queue<std::pair<AooId, AooId>> dirty_peers_;
+    std::atomic<bool> reschedule_peers_{false};
+    time_tag update_peers(const sendfn& fn, time_tag now, bool& didsomething);
     // dependants
     struct source_desc {
         AooSource *source;
@@ -414,10 +451,36 @@ private:
     };
     aoo::vector<sink_desc> sinks_;
     sync::shared_mutex source_sink_mutex_;
+    // lock-free indexes for handlePacket();
+    // only updated with the writer lock held.
+    rcu_table<AooId, AooSource *> source_index_;
+    rcu_table<AooId, AooSink *> sink_index_;
+    void update_source_index();
+    void update_sink_index();
     // peers
     using peer_list = aoo::concurrent_list<peer>;
     using peer_lock = std::unique_lock<peer_list>;
     peer_list peers_;
+    // Lock-free peer indexes, see update_peer_index().
+    // NB: the peer list must be locked while using the result,
+    // so that the peer is not freed in the meantime.
+    static uint64_t peer_key(AooId group, AooId user) {
+        return ((uint64_t)(uint32_t)group << 32) | (uint32_t)user;
+    }
+    static std::string peer_key(std::string_view group, std::string_view user) {
+        // NB: names can't contain null characters
+        std::string key;
+        key.reserve(group.size() + user.size() + 1);
+        key.append(group).append(1, '\0').append(user);
+        return key;
+    }
+    rcu_table<uint64_t, peer *> peer_id_index_;
+    rcu_table<ip_address, peer *, ip_address::hash_type> peer_address_index_;
+    rcu_table<std::string, peer *> peer_name_index_;
+    sync::mutex peer_index_mutex_; // for writers
+    peer * find_peer(AooId group, AooId user);
+    peer * find_peer(const ip_address& addr);
+    peer * find_peer(std::string_view group, std::string_view user);
     // connect/login
     std::atomic<client_state> state_{client_state::disconnected};
     std::unique_ptr<connect_cmd> connection_;
@@ -462,6 +525,7 @@ private:
     sync::spinlock peer_settings_lock_; // LATER use seqlock?
     parameter<int32_t> packet_size_{AOO_PACKET_SIZE};
     parameter<bool> binary_{AOO_BINARY_FORMAT};
+    parameter<bool> send_aggregation_{AOO_CLIENT_SEND_AGGREGATION};
 #if AOO_CLIENT_SIMULATE
     network_simulator simulate_;
 #endif
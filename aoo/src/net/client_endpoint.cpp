@@ -77,19 +77,56 @@ bool client_endpoint::match(const ip_address& addr) const {
     return false;
 }
 
-void client_endpoint::send_message(const osc::OutboundPacketStream& msg) const {
+void client_endpoint::send_message(Server& server, const osc::OutboundPacketStream& msg) const {
+    if (overflow_) {
+        return; // client is about to be disconnected
+    }
     // prepend message size (int32_t)
-    auto data = msg.Data() - 4;
+    auto data = (const AooByte *)msg.Data() - 4;
     auto size = msg.Size() + 4;
     // we know that the buffer is not really constant
-    aoo::to_bytes<int32_t>(msg.Size(), const_cast<char *>(data));
+    aoo::to_bytes<int32_t>(msg.Size(), (char *)const_cast<AooByte *>(data));
+    if (server.batch_output()) {
+        // coalesce small messages; the buffer is flushed at the end
+        // of the current batch, see Server::flush_clients().
+        if (sendbuffer_.size() + size > max_batch_size) {
+            flush(server);
+            if (overflow_) {
+                return;
+            }
+            if (size > max_batch_size) {
+                write(server, data, size);
+                return;
+            }
+        }
+        if (sendbuffer_.empty()) {
+            server.add_pending_output(id_);
+        }
+        sendbuffer_.insert(sendbuffer_.end(), data, data + size);
+    } else {
+        write(server, data, size);
+    }
+}
+
+void client_endpoint::flush(Server& server) const {
+    if (!sendbuffer_.empty()) {
+        write(server, sendbuffer_.data(), sendbuffer_.size());
+        sendbuffer_.clear();
+    }
+}
+
+void client_endpoint::write(Server& server, const AooByte *data, AooSize size) const {
     try {
-        replyfn_((const AooByte *)data, size);
+        replyfn_(data, size);
     } catch (const socket_error& e) {
         LOG_WARNING("AooServer: send() failed for client "
                     << id_ << ": " << e.what());
         // TODO handle error
     }
+    if (!server.check_send_queue(id_)) {
+        overflow_ = true;
+        sendbuffer_.clear();
+    }
 }
 
 void client_endpoint::send_error(Server& server, AooId token, AooRequestType type,
@@ -123,7 +160,7 @@ void client_endpoint::send_error(Server& server, AooId token, AooRequestType typ
     }
     msg << osc::EndMessage;
 
-    send_message(msg);
+    send_message(server, msg);
 }
 
 void client_endpoint::send_notification(Server& server, const AooData &data) const {
@@ -132,7 +169,7 @@ void client_endpoint::send_notification(Server& server, const AooData &data) con
     msg << osc::BeginMessage(kAooMsgClientMessage)
         << osc::Blob(data.data, data.size) << osc::EndMessage;
 
-    send_message(msg);
+    send_message(server, msg);
 }
 
 void client_endpoint::send_peer_join(Server& server, const group& grp, const user& usr,
@@ -163,7 +200,7 @@ void client_endpoint::send_peer_join(Server& server, const group& grp, const use
     }
     msg << osc::EndMessage;
 
-    send_message(msg);
+    send_message(server, msg);
 }
 
 void client_endpoint::send_peer_leave(Server& server, const group& grp, const user& usr) const {
@@ -174,7 +211,7 @@ void client_endpoint::send_peer_leave(Server& server, const group& grp, const us
     msg << osc::BeginMessage(kAooMsgClientPeerLeave)
         << grp.id() << usr.id() << osc::EndMessage;
 
-    send_message(msg);
+    send_message(server, msg);
 }
 
 void client_endpoint::send_group_update(Server& server, const group& grp, AooId usr) {
@@ -183,7 +220,7 @@ void client_endpoint::send_group_update(Server& server, const group& grp, AooId
     msg << osc::BeginMessage(kAooMsgClientGroupChanged)
         << grp.id() << usr << grp.metadata() << osc::EndMessage;
 
-    send_message(msg);
+    send_message(server, msg);
 }
 
 void client_endpoint::send_user_update(Server& server, const user& usr) {
@@ -192,7 +229,7 @@ void client_endpoint::send_user_update(Server& server, const user& usr) {
     msg << osc::BeginMessage(kAooMsgClientUserChanged)
         << usr.group() << usr.id() << usr.metadata() << osc::EndMessage;
 
-    send_message(msg);
+    send_message(server, msg);
 }
 
 void client_endpoint::send_peer_update(Server& server, const user& peer) {
@@ -201,7 +238,7 @@ void client_endpoint::send_peer_update(Server& server, const user& peer) {
     msg << osc::BeginMessage(kAooMsgClientPeerChanged)
         << peer.group() << peer.id() << peer.metadata() << osc::EndMessage;
 
-    send_message(msg);
+    send_message(server, msg);
 }
 
 void client_endpoint::on_close(Server& server) {
@@ -237,7 +274,7 @@ std::pair<bool, double> client_endpoint::update(Server& server, aoo::time_tag no
 
         msg << osc::BeginMessage(kAooMsgClientPing) << osc::EndMessage;
 
-        send_message(msg);
+        send_message(server, msg);
     }
     if (result.state == ping_state::inactive) {
         if (active_) {
@@ -270,7 +307,7 @@ void client_endpoint::on_group_leave(Server& server, const group& grp,
         msg << osc::BeginMessage(kAooMsgClientGroupEject)
             << grp.id() << osc::EndMessage;
 
-        send_message(msg);
+        send_message(server, msg);
     }
     for (auto it = group_users_.begin(); it != group_users_.end(); ++it) {
         if (it->group == grp.id() && it->user == usr.id()) {
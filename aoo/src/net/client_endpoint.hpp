@@ -185,7 +185,11 @@ public:
 
     bool match(const ip_address& addr) const;
 
-    void send_message(const osc::OutboundPacketStream& msg) const;
+    // NB: messages are buffered while the server is batching output,
+    // see Server::batch_output().
+    void send_message(Server& server, const osc::OutboundPacketStream& msg) const;
+
+    void flush(Server& server) const;
 
     void send_error(Server& server, AooId token, AooRequestType type,
                     AooError result, const AooResponseError *response = nullptr);
@@ -218,8 +222,14 @@ public:
         ping_timer_.pong();
     }
 private:
+    void write(Server& server, const AooByte *data, AooSize size) const;
+
     AooId id_;
     aoo::tcp_server::reply_func replyfn_;
+    // coalesced outgoing messages; larger messages are sent directly.
+    mutable std::vector<AooByte> sendbuffer_;
+    mutable bool overflow_ = false;
+    static const size_t max_batch_size = 16384;
     std::string version_;
     osc_stream_receiver receiver_;
     ip_address_list public_addresses_;
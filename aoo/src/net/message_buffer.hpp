@@ -17,6 +17,9 @@ struct sent_message {
     // methods
     bool need_resend(aoo::time_tag now);
 
+    // only valid after need_resend() has been called
+    aoo::time_tag next_resend_time() const { return next_time_; }
+
     bool has_frame(int32_t index) const {
         return !frames_[index];
     }
@@ -7,6 +7,12 @@
 #include <vector>
 #include <cassert>
 
+// max. size of a single OSC message in a TCP stream;
+// protects against bad actors announcing huge messages.
+#ifndef AOO_MAX_STREAM_MESSAGE_SIZE
+# define AOO_MAX_STREAM_MESSAGE_SIZE (1 << 24)
+#endif
+
 namespace aoo {
 namespace net {
 
@@ -18,9 +24,21 @@ public:
     void handle_message(const char *data, int32_t n, Fn&& handler);
 
     void reset();
+
+    // number of bytes of an incomplete message
+    size_t pending() const { return buffer_.size(); }
 private:
+    void check_size(int32_t size);
+    void check_data(const char *data);
+
+    // Carry-over buffer for incomplete messages (including the size prefix).
+    // Complete messages are passed to the handler directly from the input
+    // buffer, so usually only the trailing message of a TCP segment
+    // ends up here.
     std::vector<char> buffer_;
     int32_t message_size_ = 0;
+    // release memory after large messages
+    static const size_t max_capacity = 65536;
 };
 
 //------------------------------------------------------------------------------------//
@@ -28,49 +46,74 @@ private:
 template<typename Fn>
 inline void osc_stream_receiver::handle_message(const char *data, int32_t n, Fn&& handler) {
     const char *ptr = data;
-    int32_t remaining = n;
+    const char *end = data + n;
     assert(n > 0);
 
-    while (remaining > 0) {
+    // 1) complete the pending message, if any
+    if (!buffer_.empty()) {
         if (buffer_.size() < sizeof(message_size_)) {
             // message size in progress
             auto bytes_missing = sizeof(message_size_) - buffer_.size();
-            auto count = std::min<int32_t>(bytes_missing, remaining);
+            auto count = std::min<int32_t>(bytes_missing, end - ptr);
             buffer_.insert(buffer_.end(), ptr, ptr + count);
             ptr += count;
-            remaining -= count;
-            if (buffer_.size() == sizeof(message_size_)) {
-                // got message size
-                auto msgsize = aoo::from_bytes<int32_t>(buffer_.data());
-                // OSC packet size must be a multiple of 4!
-                if (msgsize <= 0 || ((msgsize & 3) != 0)) {
-                    reset();
-                    throw osc::MalformedPacketException("bad OSC packet size");
-                }
-                message_size_ = msgsize;
-                // NB: do not reserve the buffer because the message size
-                // may come from a bad actor and may be huge!
+            if (buffer_.size() < sizeof(message_size_)) {
+                return; // wait for more data
             }
-        } else {
-            // message data in progress
-            int32_t bytes_received = buffer_.size() - sizeof(message_size_);
-            int32_t bytes_missing = message_size_ - bytes_received;
-            // When we get the first data bytes, check if this is really an OSC message
-            // to prevent bad actors from overflowing our buffer with bogus data.
-            if (bytes_received == 0 && ptr[0] != '/') {
-                reset();
-                throw osc::MalformedMessageException("not an OSC message");
+            // got message size
+            auto msgsize = aoo::from_bytes<int32_t>(buffer_.data());
+            check_size(msgsize);
+            message_size_ = msgsize;
+            // NB: do not reserve the buffer because the message size
+            // may come from a bad actor and may be huge!
+            if (ptr == end) {
+                return; // wait for more data
             }
-            auto count = std::min<int32_t>(bytes_missing, remaining);
-            buffer_.insert(buffer_.end(), ptr, ptr + count);
-            ptr += count;
-            remaining -= count;
-            if (bytes_missing == count) {
-                // message complete!
-                assert(buffer_.size() == message_size_ + sizeof(message_size_));
-                osc::ReceivedPacket packet(buffer_.data() + sizeof(message_size_), message_size_);
-                handler(packet);
-                reset();
+        }
+        // message data in progress
+        int32_t bytes_received = buffer_.size() - sizeof(message_size_);
+        int32_t bytes_missing = message_size_ - bytes_received;
+        // When we get the first data bytes, check if this is really an OSC message
+        // to prevent bad actors from overflowing our buffer with bogus data.
+        if (bytes_received == 0) {
+            check_data(ptr);
+        }
+        auto count = std::min<int32_t>(bytes_missing, end - ptr);
+        buffer_.insert(buffer_.end(), ptr, ptr + count);
+        ptr += count;
+        if (bytes_missing > count) {
+            return; // wait for more data
+        }
+        // message complete!
+        assert(buffer_.size() == message_size_ + sizeof(message_size_));
+        osc::ReceivedPacket packet(buffer_.data() + sizeof(message_size_), message_size_);
+        handler(packet);
+        reset();
+    }
+
+    // 2) handle complete messages in place
+    while ((end - ptr) >= (int32_t)sizeof(message_size_)) {
+        auto msgsize = aoo::from_bytes<int32_t>(ptr);
+        check_size(msgsize);
+        auto msgdata = ptr + sizeof(message_size_);
+        if ((end - msgdata) < msgsize) {
+            break; // incomplete
+        }
+        check_data(msgdata);
+        osc::ReceivedPacket packet(msgdata, msgsize);
+        handler(packet);
+        ptr = msgdata + msgsize;
+    }
+
+    // 3) store the incomplete trailing message
+    if (ptr != end) {
+        assert(buffer_.empty());
+        buffer_.assign(ptr, end);
+        if (buffer_.size() >= sizeof(message_size_)) {
+            // message size has already been checked above
+            message_size_ = aoo::from_bytes<int32_t>(buffer_.data());
+            if (buffer_.size() > sizeof(message_size_)) {
+                check_data(buffer_.data() + sizeof(message_size_));
             }
         }
     }
@@ -78,9 +121,32 @@ inline void osc_stream_receiver::handle_message(const char *data, int32_t n, Fn&
 }
 
 inline void osc_stream_receiver::reset() {
-    buffer_.clear();
+    if (buffer_.capacity() > max_capacity) {
+        std::vector<char>().swap(buffer_);
+    } else {
+        buffer_.clear();
+    }
     message_size_ = 0;
 }
 
+inline void osc_stream_receiver::check_size(int32_t size) {
+    // OSC packet size must be a multiple of 4!
+    if (size <= 0 || ((size & 3) != 0)) {
+        reset();
+        throw osc::MalformedPacketException("bad OSC packet size");
+    }
+    if (size > AOO_MAX_STREAM_MESSAGE_SIZE) {
+        reset();
+        throw osc::MalformedPacketException("OSC packet too large");
+    }
+}
+
+inline void osc_stream_receiver::check_data(const char *data) {
+    if (data[0] != '/') {
+        reset();
+        throw osc::MalformedMessageException("not an OSC message");
+    }
+}
+
 } // net
 } // aoo
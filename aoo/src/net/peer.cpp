@@ -75,10 +75,10 @@ ip_address peer::address() const {
     }
 }
 
-void peer::send(Client& client, const sendfn& fn, time_tag now,
-                const AooPingSettings& settings) {
+time_tag peer::send(Client& client, const sendfn& fn, time_tag now,
+                    const AooPingSettings& settings) {
     if (connected()) {
-        do_send(client, fn, now, settings);
+        return do_send(client, fn, now, settings);
     } else if (!timeout_) {
         // try to establish UDP connection with peer
 
@@ -99,7 +99,7 @@ void peer::send(Client& client, const sendfn& fn, time_tag now,
                 handshake_deadline_.clear(); // reset timer
                 LOG_WARNING("AooClient: UDP handshake with " << *this
                             << " timed out, try to relay over " << relay_address_);
-                return;
+                return now; // start relay handshake in the next cycle
             }
 
             // couldn't establish connection!
@@ -114,7 +114,7 @@ void peer::send(Client& client, const sendfn& fn, time_tag now,
 
             timeout_ = true;
 
-            return;
+            return time_tag{};
         }
 
         // send handshake pings to all addresses until we get a reply
@@ -161,11 +161,17 @@ void peer::send(Client& client, const sendfn& fn, time_tag now,
 
             LOG_DEBUG("AooClient: send handshake ping to " << *this);
         }
+
+        return std::min(next_handshake_, handshake_deadline_);
+    } else {
+        // timed out; only a message from the peer can bring us back,
+        // see Client::handle_peer_osc_message() resp. handle_peer_bin_message().
+        return time_tag{};
     }
 }
 
-void peer::do_send(Client& client, const sendfn& fn, time_tag now,
-                   const AooPingSettings& settings) {
+time_tag peer::do_send(Client& client, const sendfn& fn, time_tag now,
+                       const AooPingSettings& settings) {
     // send regular ping or probe ping
     auto result = ping_timer_.update(now, settings, true);
     if (result.ping) {
@@ -272,6 +278,8 @@ void peer::do_send(Client& client, const sendfn& fn, time_tag now,
             break;
         }
     }
+    // next ping
+    auto next_time = now + aoo::time_tag::from_seconds(result.wait);
     // 6) resend messages
     if (!send_buffer_.empty()) {
         bool binary = client.binary();
@@ -303,8 +311,10 @@ void peer::do_send(Client& client, const sendfn& fn, time_tag now,
                     }
                 }
             }
+            next_time = std::min(next_time, msg.next_resend_time());
         }
     }
+    return next_time;
 }
 
 // OSC:
@@ -539,6 +549,8 @@ void peer::handle_first_ping(Client &client, const aoo::ip_address& addr) {
 
     connected_.store(true, std::memory_order_release);
 
+    client.update_peer_index();
+
     // push event
     auto e = std::make_unique<peer_event>(kAooEventPeerJoin, *this);
     client.send_event(std::move(e));
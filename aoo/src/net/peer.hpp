@@ -103,8 +103,22 @@ public:
 
     const aoo::metadata& metadata() const { return metadata_; }
 
-    void send(Client& client, const sendfn& fn, time_tag now,
-              const AooPingSettings& settings);
+    // returns the time of the next scheduled action (empty if none)
+    time_tag send(Client& client, const sendfn& fn, time_tag now,
+                  const AooPingSettings& settings);
+
+    // scheduling for the send thread, see Client::send()
+    bool set_dirty() {
+        return !dirty_.exchange(true, std::memory_order_acq_rel);
+    }
+
+    void clear_dirty() {
+        dirty_.store(false, std::memory_order_release);
+    }
+
+    time_tag scheduled_time() const { return scheduled_time_; }
+
+    void set_scheduled_time(time_tag t) { scheduled_time_ = t; }
 
     void send_message(const message& msg, const sendfn& fn, int32_t packet_size, bool binary);
 
@@ -133,8 +147,8 @@ private:
 
     void handle_ack(Client& client, const AooByte *data, AooSize size);
 
-    void do_send(Client& client, const sendfn& fn, time_tag now,
-                 const AooPingSettings& settings);
+    time_tag do_send(Client& client, const sendfn& fn, time_tag now,
+                     const AooPingSettings& settings);
 
     void send_packet_osc(const message_packet& frame, const sendfn& fn) const;
 
@@ -187,6 +201,8 @@ private:
     std::atomic<bool> connected_{false};
     std::atomic<bool> got_ping_{false};
     std::atomic<bool> binary_ack_{false};
+    std::atomic<bool> dirty_{false};
+    time_tag scheduled_time_; // only accessed by the send thread
     int32_t next_sequence_reliable_ = 0;
     int32_t next_sequence_unreliable_ = 0;
     message_send_buffer send_buffer_;
@@ -77,7 +77,12 @@ public:
             ping = true;
         }
 
-        auto wait = std::max<double>(0.0, aoo::time_tag::duration(now, next_ping_));
+        // NB: also wake up at the deadline to switch to probe state
+        auto next = next_ping_;
+        if (state_ == ping_state::ping && deadline_ < next) {
+            next = deadline_;
+        }
+        auto wait = std::max<double>(0.0, aoo::time_tag::duration(now, next));
         return { state_, ping, wait };
     }
 private:
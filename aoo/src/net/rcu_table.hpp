@@ -0,0 +1,198 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// number of reader slots per rcu_table; threads are distributed
+// over the slots in the order of their first read access.
+#ifndef AOO_RCU_READER_SLOTS
+# define AOO_RCU_READER_SLOTS 16
+#endif
+
+namespace aoo {
+namespace net {
+
+namespace detail {
+
+// NB: several threads may share the same slot, this only matters
+// for performance, not for correctness.
+inline int rcu_reader_slot() {
+    static std::atomic<int> counter{0};
+    thread_local int slot =
+        counter.fetch_add(1, std::memory_order_relaxed) % AOO_RCU_READER_SLOTS;
+    return slot;
+}
+
+} // namespace detail
+
+//------------------------ rcu_table ----------------------------//
+
+// A read-mostly hash table for lookups on hot paths, e.g. the network
+// receive thread.
+//
+// The table itself is immutable. The writer builds a new table and
+// swaps it atomically (RCU algorithm); old tables are reclaimed after
+// a grace period, i.e. when all readers that might still see them have
+// finished. Readers only touch their own reader slot, so concurrent lookups
+// from several threads (e.g. the server relay threads) do not contend
+// on a shared cache line.
+//
+// Grace periods work like in SRCU: each reader slot has two counters
+// and readers increment the counter selected by the current epoch.
+// The writer waits until the counter of the *previous* epoch has dropped
+// to zero and then advances the epoch. New readers always use the counter
+// of the current epoch, so the writer never waits for them and cannot
+// be starved by readers that never pause. A table that has been retired
+// in epoch N can be freed in epoch N + 2, because both counters have been
+// zero at some point after the table was replaced.
+// * find() may be called concurrently from any thread without locking.
+// * update() and reclaim() must not be called concurrently.
+template<typename Key, typename T, typename Hash = std::hash<Key>>
+class rcu_table {
+public:
+    using map_type = std::unordered_map<Key, T, Hash>;
+
+    rcu_table() = default;
+
+    ~rcu_table() {
+        delete current_.load();
+        for (auto& t : retired_) {
+            delete t.table;
+        }
+    }
+
+    rcu_table(const rcu_table&) = delete;
+    rcu_table& operator=(const rcu_table&) = delete;
+
+    // look up the value for the given key;
+    // returns false if the key is not in the table.
+    bool find(const Key& key, T& result) const {
+        return visit(key, [&](const T& value) { result = value; });
+    }
+
+    // Call 'fn' with the value for the given key; returns false if the key
+    // is not in the table. Unlike find(), the read reference is held until
+    // 'fn' returns, so that synchronize() in the writer can be used to wait
+    // until the value is not in use anymore.
+    template<typename Fn>
+    bool visit(const Key& key, Fn&& fn) const {
+        bool found = false;
+        // NB: the epoch may change right after we have read it,
+        // this is taken care of in reclaim().
+        auto index = epoch_.load(std::memory_order_relaxed) & 1;
+        auto& count = slots_[detail::rcu_reader_slot()].count[index];
+        // NB: the increment must not be reordered with the following
+        // load of the table pointer, see reclaim().
+        count.fetch_add(1, std::memory_order_seq_cst);
+        if (auto table = current_.load(std::memory_order_seq_cst)) {
+            if (auto it = table->find(key); it != table->end()) {
+                fn(it->second);
+                found = true;
+            }
+        }
+        count.fetch_sub(1, std::memory_order_release);
+        return found;
+    }
+
+    // replace the current table
+    void update(map_type map) {
+        auto table = new map_type(std::move(map));
+        if (auto old = current_.exchange(table, std::memory_order_seq_cst)) {
+            retired_.push_back({ old, epoch_.load(std::memory_order_relaxed) });
+        }
+        reclaim();
+    }
+
+    void clear() {
+        if (auto old = current_.exchange(nullptr, std::memory_order_seq_cst)) {
+            retired_.push_back({ old, epoch_.load(std::memory_order_relaxed) });
+        }
+        reclaim();
+    }
+
+    // Free old tables whose grace period has expired. Returns false
+    // if some tables could not be reclaimed yet; in this case, the
+    // method should be called again later. Never blocks.
+    bool reclaim() {
+        // we need at most two epochs, see above
+        for (int i = 0; i < 2 && !retired_.empty(); ++i) {
+            auto epoch = epoch_.load(std::memory_order_relaxed);
+            free_retired(epoch);
+            if (retired_.empty()) {
+                break;
+            }
+            // Wait for readers of the previous epoch. Readers that have
+            // read the epoch just before it was advanced might still increment
+            // the old counter, but each thread can do this at most once per
+            // epoch, so the counter is guaranteed to drop to zero eventually.
+            // A reader that increments a counter after we have read it can
+            // only see the current table (see visit()).
+            auto index = (epoch + 1) & 1;
+            for (int j = 0; j < AOO_RCU_READER_SLOTS; ++j) {
+                if (slots_[j].count[index].load(std::memory_order_seq_cst) != 0) {
+                    return false;
+                }
+            }
+            // now the drained counter becomes the current one
+            epoch_.store(epoch + 1, std::memory_order_relaxed);
+        }
+        free_retired(epoch_.load(std::memory_order_relaxed));
+        return retired_.empty();
+    }
+
+    // Free old tables, waiting for active readers if necessary.
+    // Afterwards, no reader can see a value which is not contained
+    // in the current table anymore. Only waits for readers that have
+    // started before the table has been updated.
+    // NB: must not be called while visiting the table!
+    void synchronize() {
+        while (!reclaim()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // only for the writer!
+    size_t size() const {
+        auto table = current_.load(std::memory_order_relaxed);
+        return table ? table->size() : 0;
+    }
+private:
+    void free_retired(uint32_t epoch) {
+        auto it = retired_.begin();
+        for (; it != retired_.end(); ++it) {
+            // NB: tables are retired in order
+            if ((int32_t)(epoch - it->epoch) < 2) {
+                break;
+            }
+            // NB: the counter loads in reclaim() synchronize
+            // with the decrements in visit().
+            delete it->table;
+        }
+        retired_.erase(retired_.begin(), it);
+    }
+
+    std::atomic<const map_type *> current_{nullptr};
+    std::atomic<uint32_t> epoch_{0};
+    // put each reader slot on its own cache line
+    struct alignas(64) reader_slot {
+        std::atomic<int32_t> count[2] = { 0, 0 };
+    };
+    std::unique_ptr<reader_slot[]> slots_{new reader_slot[AOO_RCU_READER_SLOTS]};
+    struct retired_table {
+        const map_type *table;
+        uint32_t epoch;
+    };
+    std::vector<retired_table> retired_;
+};
+
+} // namespace net
+} // namespace aoo
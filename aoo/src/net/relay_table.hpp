@@ -0,0 +1,21 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#pragma once
+
+#include "common/net_utils.hpp"
+
+#include "rcu_table.hpp"
+
+namespace aoo {
+namespace net {
+
+//------------------------ relay_table ----------------------------//
+
+// A read-mostly routing table that maps relay destination addresses
+// to the validated (and possibly IPv4-mapped) outbound addresses.
+using relay_table = rcu_table<ip_address, ip_address, ip_address::hash_type>;
+
+} // namespace net
+} // namespace aoo
@@ -73,16 +73,35 @@ AooError AOO_CALL aoo::net::Server::setup(AooServerSettings& settings) {
         udp_sendfn_ = sendfn(Server::send, this);
     }
 
+    int relay_threads = 1;
+    if (AOO_CHECK_FIELD(&settings, AooServerSettings, relayThreads)
+            && settings.relayThreads > 1) {
+        if (external) {
+            LOG_WARNING("AooServer: relay threads require the internal UDP socket");
+        } else {
+        #ifdef __linux__
+            relay_threads = settings.relayThreads;
+        #else
+            // SO_REUSEPORT only does load balancing on Linux
+            LOG_WARNING("AooServer: relay threads not supported on this platform");
+        #endif
+        }
+    }
+
     // in case run() has been called in non-blocking mode
     close();
 
+    relay_threads_.clear();
+
     // TODO: honor flags for UDP and TCP sockets! For now just use default.
     if (!external) {
         try {
             // TODO: settings
-            udp_server_.start(settings.portNumber,
-                [this](auto... args) { handle_udp_packet(args...);
-            });
+            udp_server_.set_share_port(relay_threads > 1);
+            udp_server_.start_batched(settings.portNumber,
+                [this](auto&&... args) { handle_udp_batch(udp_server_, args...); },
+                udp_batch_size);
+            start_relay_threads(relay_threads - 1);
         } catch (const aoo::udp_error& e) {
             LOG_ERROR("AooServer: failed to start UDP server: " << e.what());
             aoo::socket::set_last_error(e.code());
@@ -142,6 +161,7 @@ AooError AOO_CALL aoo::net::Server::run(AooSeconds timeout) {
                 settings_lock_.unlock();
 
                 sync::scoped_lock lock(mutex_); // writer lock to protect client list
+                output_batch batch(*this);
                 for (auto& [id, client] : clients_) {
                     auto [timeout, wait] = client.update(*this, now, settings);
                     if (timeout) {
@@ -159,12 +179,35 @@ AooError AOO_CALL aoo::net::Server::run(AooSeconds timeout) {
                     tcp_server_.close(id);
                 }
                 client_timeouts.clear();
+
+                // remove clients that can't keep up, see check_send_queue()
+                if (!overflow_clients_.empty()) {
+                    auto overflow = std::move(overflow_clients_);
+                    overflow_clients_.clear();
+                    for (auto& id : overflow) {
+                        // the client might have timed out in the meantime
+                        if (find_client(id)) {
+                            remove_client(id, kAooErrorOverflow, "client send queue overflow");
+                            // remove from TCP server and discard the queued data!
+                            tcp_server_.close(id, true);
+                        }
+                    }
+                }
+
+                // free old relay tables, see update_relay_table().
+                relay_table_.reclaim();
             }
 
             // check and dispatch messages
-            message_queue_.consume_all([this](const auto& msg) {
-                dispatch_message(msg);
-            });
+            // NB: notifications are coalesced per client; this greatly
+            // reduces the number of writes for group broadcasts.
+            if (!message_queue_.empty()) {
+                sync::scoped_lock lock(mutex_); // writer lock to protect client list
+                output_batch batch(*this);
+                message_queue_.consume_all([this](const auto& msg) {
+                    dispatch_message(msg);
+                });
+            }
 
             // finally wait for network events (with timeout)
             // NB: the TCP handler methods will lock the mutex to
@@ -245,10 +288,26 @@ AooError AOO_CALL aoo::net::Server::handlePacket(
     const void *address, AooAddrSize addrlen)
 {
     aoo::ip_address addr((struct sockaddr *)address, addrlen);
-    handle_udp_packet(data, size, addr);
+    handle_udp_packet(data, size, addr, udp_sendfn_);
     return kAooOk;
 }
 
+// NB: called concurrently by all UDP receive threads!
+void aoo::net::Server::handle_udp_batch(udp_server& server,
+                                        const udp_recv_slot *packets, int count) {
+    // queue outgoing packets and send them in a single batch.
+    sendfn reply(Server::send_queued, &server);
+    for (int i = 0; i < count; ++i) {
+        auto& p = packets[i];
+        handle_udp_packet(p.data, p.size, p.address, reply);
+    }
+    try {
+        server.flush();
+    } catch (const socket_error& e) {
+        LOG_DEBUG("AooServer: could not send UDP packets: " << e.what());
+    }
+}
+
 AOO_API AooError AOO_CALL AooServer_stop(AooServer *server)
 {
     return server->stop();
@@ -257,9 +316,42 @@ AOO_API AooError AOO_CALL AooServer_stop(AooServer *server)
 AooError AOO_CALL aoo::net::Server::stop() {
     tcp_server_.stop();
     udp_server_.stop();
+    stop_relay_threads();
     return kAooOk;
 }
 
+void aoo::net::Server::start_relay_threads(int count) {
+    auto port = udp_server_.port();
+    for (int i = 0; i < count; ++i) {
+        auto r = std::make_unique<relay_thread>();
+        auto server = &r->server;
+        server->set_share_port(true);
+        server->start_batched(port,
+            [this, server](auto&&... args) { handle_udp_batch(*server, args...); },
+            udp_batch_size);
+        r->thread = std::thread([server]() {
+            try {
+                server->run();
+            } catch (const udp_error& e) {
+                LOG_ERROR("AooServer: UDP relay thread failed: " << e.what());
+            }
+        });
+        relay_threads_.push_back(std::move(r));
+    }
+    if (count > 0) {
+        LOG_VERBOSE("AooServer: started " << count << " additional UDP relay threads");
+    }
+}
+
+void aoo::net::Server::stop_relay_threads() {
+    for (auto& r : relay_threads_) {
+        r->server.stop();
+        if (r->thread.joinable()) {
+            r->thread.join();
+        }
+    }
+}
+
 AOO_API AooError AOO_CALL AooServer_setEventHandler(
     AooServer *server, AooEventHandler fn, void *user, AooEventMode mode) {
     return server->setEventHandler(fn, user, mode);
@@ -691,6 +783,37 @@ AooError AOO_CALL aoo::net::Server::control(
         as<AooPingSettings>(ptr) = ping_settings_;
         settings_lock_.unlock();
         break;
+    case kAooCtlSetClientQueueLimit:
+        CHECKARG(AooInt32);
+        client_queue_limit_.store(std::max<AooInt32>(0, as<AooInt32>(ptr)));
+        break;
+    case kAooCtlGetClientQueueLimit:
+        CHECKARG(AooInt32);
+        as<AooInt32>(ptr) = client_queue_limit_.load();
+        break;
+    case kAooCtlGetUdpReceiveStats:
+    {
+        CHECKARG(AooUdpReceiveStats);
+        if (udp_sendfn_.fn() != Server::send) {
+            // external UDP socket
+            return kAooErrorNotPermitted;
+        }
+        auto& result = as<AooUdpReceiveStats>(ptr);
+        auto stats = udp_server_.get_receive_stats();
+        result.packetCount = stats.packets;
+        result.callCount = stats.calls;
+        result.maxBatchSize = stats.max_batch;
+        result.overflowCount = stats.overflow;
+        // accumulate relay threads
+        for (auto& r : relay_threads_) {
+            auto stats = r->server.get_receive_stats();
+            result.packetCount += stats.packets;
+            result.callCount += stats.calls;
+            result.maxBatchSize = std::max(result.maxBatchSize, stats.max_batch);
+            result.overflowCount += stats.overflow;
+        }
+        break;
+    }
     default:
         LOG_WARNING("AooServer: unsupported control " << ctl);
         return kAooErrorNotImplemented;
@@ -819,6 +942,8 @@ void Server::on_user_joined_group(const group& grp, const user& usr,
         }
     }
 
+    update_relay_table();
+
     // send event
     auto e = std::make_unique<group_join_event>(grp, usr);
     send_event(std::move(e));
@@ -861,6 +986,8 @@ void Server::do_remove_user_from_group(group& grp, user& usr) {
             remove_group(grp.id());
         }
     }
+
+    update_relay_table();
 }
 
 osc::OutboundPacketStream Server::start_message(size_t extra_size) {
@@ -891,6 +1018,8 @@ bool Server::remove_client(AooId id, AooError err, std::string_view msg) {
         LOG_ERROR("AooServer: removeClient: client " << id << " not found");
         return false;
     }
+    // send pending messages
+    it->second.flush(*this);
     // remove from group(s) and send notifications
     it->second.on_close(*this);
 
@@ -911,6 +1040,8 @@ bool Server::remove_client(AooId id, AooError err, std::string_view msg) {
 void Server::handle_client_data(AooId id, int err, const AooByte *data,
                                 AooInt32 size, const aoo::ip_address& addr) {
     sync::scoped_lock lock(mutex_); // writer lock; see run() method
+    // replies and notifications are sent after handling the data
+    output_batch batch(*this);
 
     auto client = find_client(id);
     if (!client) {
@@ -951,7 +1082,7 @@ void Server::handle_ping(client_endpoint& client,
 
     reply << osc::BeginMessage(kAooMsgClientPong) << osc::EndMessage;
 
-    client.send_message(reply);
+    client.send_message(*this, reply);
 }
 
 void Server::handle_pong(client_endpoint &client,
@@ -1083,7 +1214,7 @@ AooError Server::do_login(client_endpoint& client, AooId token,
         << (int32_t)0 << metadata_view(response.metadata)
         << osc::EndMessage;
 
-    client.send_message(msg);
+    client.send_message(*this, msg);
 
     auto e = std::make_unique<client_login_event>(client, kAooOk, aoo::metadata(request.metadata));
     send_event(std::move(e));
@@ -1238,7 +1369,7 @@ AooError Server::do_group_join(client_endpoint &client, AooId token,
         << relay_addr
         << osc::EndMessage;
 
-    client.send_message(msg);
+    client.send_message(*this, msg);
 
     // after reply!
     on_user_joined_group(*grp, *usr, client);
@@ -1285,7 +1416,7 @@ AooError Server::do_group_leave(client_endpoint& client, AooId token,
                 << token << kAooErrorNone
                 << osc::EndMessage;
 
-            client.send_message(msg);
+            client.send_message(*this, msg);
 
             return kAooOk;
         } else {
@@ -1372,7 +1503,7 @@ AooError Server::do_group_update(client_endpoint &client, AooId token,
         << token << kAooErrorNone << grp->metadata()
         << osc::EndMessage;
 
-    client.send_message(msg);
+    client.send_message(*this, msg);
 
     // send event
     auto e = std::make_unique<group_update_event>(*grp, *usr);
@@ -1457,7 +1588,7 @@ AooError Server::do_user_update(client_endpoint &client, AooId token,
         << token << kAooErrorNone << usr->metadata()
         << osc::EndMessage;
 
-    client.send_message(msg);
+    client.send_message(*this, msg);
 
     // send event
     auto e = std::make_unique<user_update_event>(*usr);
@@ -1498,7 +1629,7 @@ AooError Server::do_custom_request(client_endpoint& client, AooId token,
         << token << kAooErrorNone << (int32_t)response.flags
         << metadata_view(&response.data) << osc::EndMessage;
 
-    client.send_message(msg);
+    client.send_message(*this, msg);
 
     return kAooOk;
 }
@@ -1506,7 +1637,7 @@ AooError Server::do_custom_request(client_endpoint& client, AooId token,
 //----------------------- UDP messages --------------------------//
 
 void Server::handle_udp_packet(const AooByte *data, AooInt32 size,
-                               const aoo::ip_address& addr) {
+                               const aoo::ip_address& addr, const sendfn& reply) {
     AooMsgType type;
     int32_t onset;
     auto err = parse_pattern(data, size, type, onset);
@@ -1516,16 +1647,16 @@ void Server::handle_udp_packet(const AooByte *data, AooInt32 size,
     }
 
     if (type == kAooMsgTypeServer){
-        handle_udp_message(data, size, onset, addr);
+        handle_udp_message(data, size, onset, addr, reply);
     } else if (type == kAooMsgTypeRelay){
-        handle_relay(data, size, addr);
+        handle_relay(data, size, addr, reply);
     } else {
         LOG_WARNING("AooServer: not a client message!");
     }
 }
 
 void Server::handle_udp_message(const AooByte *data, AooSize size, int onset,
-                                const ip_address& addr) {
+                                const ip_address& addr, const sendfn& reply) {
     if (binmsg_check(data, size)) {
         LOG_WARNING("AooServer: unsupported binary message");
         return;
@@ -1539,9 +1670,9 @@ void Server::handle_udp_message(const AooByte *data, AooSize size, int onset,
         LOG_DEBUG("AooServer: handle client UDP message " << pattern);
 
         if (pattern == kAooMsgPing) {
-            handle_ping(msg, addr);
+            handle_ping(msg, addr, reply);
         } else if (pattern == kAooMsgQuery) {
-            handle_query(msg, addr);
+            handle_query(msg, addr, reply);
         } else {
             LOG_ERROR("AooServer: unknown message " << pattern);
             return;
@@ -1553,7 +1684,8 @@ void Server::handle_udp_message(const AooByte *data, AooSize size, int onset,
     }
 }
 
-void Server::handle_relay(const AooByte *data, AooSize size, const ip_address& addr) {
+void Server::handle_relay(const AooByte *data, AooSize size,
+                          const ip_address& addr, const sendfn& reply) {
     if (!internal_relay_.load()) {
     #if AOO_DEBUG_RELAY
         LOG_DEBUG("AooServer: ignore relay message from " << addr);
@@ -1563,27 +1695,19 @@ void Server::handle_relay(const AooByte *data, AooSize size, const ip_address& a
 
     auto src_addr = addr.unmapped();
 
+    // The relay table is authoritative: we only forward messages to the
+    // public addresses of active group members. The table already contains
+    // the (possibly IPv4-mapped) socket address, see update_relay_table().
     auto check_addr = [&](ip_address& addr) {
-        if (addr.is_ipv4_mapped()) {
-            LOG_DEBUG("AooServer: relay destination must not be IPv4-mapped");
-            return false;
-        }
-        if (address_family_ == ip_address::IPv6 && addr.type() == ip_address::IPv4) {
-            if (use_ipv4_mapped_) {
-                // map address to IPv4
-                addr = addr.ipv4_mapped();
-            } else {
-                // cannot relay to IPv4 address with IPv6-only socket
-                LOG_DEBUG("AooClient: cannot relay to destination address " << addr);
-                return false;
-            }
-        } else if (address_family_ == ip_address::IPv4 && addr.type() == ip_address::IPv6) {
-            // cannot relay to IPv6 address with IPv4-only socket
-            LOG_DEBUG("AooClient: cannot relay to destination address " << addr);
+        if (relay_table_.find(addr, addr)) {
+            return true;
+        } else {
+        #if AOO_DEBUG_RELAY
+            LOG_DEBUG("AooServer: drop relay message from " << src_addr
+                      << " to unknown destination " << addr);
+        #endif
             return false;
         }
-        // ip_address::Unspec -> always pass
-        return true;
     };
 
     if (binmsg_check(data, size)) {
@@ -1600,14 +1724,14 @@ void Server::handle_relay(const AooByte *data, AooSize size, const ip_address& a
             if (src_addr.type() == dst_addr.type()) {
                 // simply replace the header (= rewrite address)
                 binmsg_write_relay(const_cast<AooByte *>(data), size, src_addr);
-                send_udp(dst_addr, data, size);
+                reply(data, size, dst_addr);
             } else {
                 // rewrite whole message
                 AooByte buf[AOO_MAX_PACKET_SIZE];
                 auto result = write_relay_message(buf, sizeof(buf), data + onset,
                                                   size - onset, src_addr, true);
                 if (result > 0) {
-                    send_udp(dst_addr, buf, result);
+                    reply(buf, result, dst_addr);
                 } else {
                     LOG_ERROR("AooServer: can't relay: buffer too small");
                 }
@@ -1641,14 +1765,60 @@ void Server::handle_relay(const AooByte *data, AooSize size, const ip_address& a
         #if AOO_DEBUG_RELAY
             LOG_DEBUG("AooServer: forward OSC relay message from " << addr << " to " << dst);
         #endif
-            send_udp(dst_addr, (const AooByte *)out.Data(), out.Size());
+            reply((const AooByte *)out.Data(), out.Size(), dst_addr);
         } catch (const osc::Exception& e){
             LOG_ERROR("AooServer: exception in handle_relay: " << e.what());
         }
     }
 }
 
-void Server::handle_ping(const osc::ReceivedMessage& msg, const ip_address& addr) {
+bool Server::check_relay_address(ip_address& addr) const {
+    if (addr.is_ipv4_mapped()) {
+        LOG_DEBUG("AooServer: relay destination must not be IPv4-mapped");
+        return false;
+    }
+    if (address_family_ == ip_address::IPv6 && addr.type() == ip_address::IPv4) {
+        if (use_ipv4_mapped_) {
+            // map address to IPv4
+            addr = addr.ipv4_mapped();
+        } else {
+            // cannot relay to IPv4 address with IPv6-only socket
+            LOG_DEBUG("AooServer: cannot relay to destination address " << addr);
+            return false;
+        }
+    } else if (address_family_ == ip_address::IPv4 && addr.type() == ip_address::IPv6) {
+        // cannot relay to IPv6 address with IPv4-only socket
+        LOG_DEBUG("AooServer: cannot relay to destination address " << addr);
+        return false;
+    }
+    // ip_address::Unspec -> always pass
+    return true;
+}
+
+// NB: must be called with the mutex locked, whenever a user joins or leaves a group.
+void Server::update_relay_table() {
+    relay_table::map_type map;
+    for (auto& [_, grp] : groups_) {
+        for (auto& usr : grp.users()) {
+            if (!usr.active()) {
+                continue;
+            }
+            if (auto client = find_client(usr)) {
+                for (auto& addr : client->public_addresses()) {
+                    auto dst = addr;
+                    if (check_relay_address(dst)) {
+                        map.emplace(addr, dst);
+                    }
+                }
+            }
+        }
+    }
+    LOG_DEBUG("AooServer: update relay table (" << map.size() << " entries)");
+    relay_table_.update(std::move(map));
+}
+
+void Server::handle_ping(const osc::ReceivedMessage& msg, const ip_address& addr,
+                         const sendfn& fn) {
     // reply with /pong message
     // NB: don't prepend size for UDP message!
     char buf[512];
@@ -1656,10 +1826,11 @@ void Server::handle_ping(const osc::ReceivedMessage& msg, const ip_address& addr
     reply << osc::BeginMessage(kAooMsgClientPong)
           << osc::EndMessage;
 
-    send_udp(addr, (const AooByte *)reply.Data(), reply.Size());
+    fn((const AooByte *)reply.Data(), reply.Size(), addr);
 }
 
-void Server::handle_query(const osc::ReceivedMessage& msg, const ip_address& addr) {
+void Server::handle_query(const osc::ReceivedMessage& msg, const ip_address& addr,
+                          const sendfn& fn) {
     // NB: do not prepend size for UDP message!
     char buf[AOO_MAX_PACKET_SIZE];
     osc::OutboundPacketStream reply(buf, sizeof(buf));
@@ -1667,7 +1838,7 @@ void Server::handle_query(const osc::ReceivedMessage& msg, const ip_address& add
           << addr.unmapped() // return unmapped(!) public IP
           << osc::EndMessage;
 
-    send_udp(addr, (const AooByte *)reply.Data(), reply.Size());
+    fn((const AooByte *)reply.Data(), reply.Size(), addr);
 }
 
 AooId Server::get_next_client_id(){
@@ -1757,6 +1928,31 @@ void Server::dispatch_message(const message &msg) {
     }
 }
 
+bool Server::check_send_queue(AooId client) {
+    auto limit = client_queue_limit_.load();
+    if (limit > 0) {
+        auto queued = tcp_server_.queued_bytes(client);
+        if (queued > (size_t)limit) {
+            LOG_WARNING("AooServer: client " << client << " can't keep up ("
+                        << queued << " bytes queued); disconnecting");
+            overflow_clients_.push_back(client);
+            // wake up run() method
+            tcp_server_.notify();
+            return false;
+        }
+    }
+    return true;
+}
+
+void Server::flush_clients() {
+    for (auto& id : pending_output_) {
+        if (auto client = find_client(id)) {
+            client->flush(*this);
+        }
+    }
+    pending_output_.clear();
+}
+
 void Server::send_event(event_ptr e) {
     switch (event_mode_){
     case kAooEventModePoll:
@@ -1780,6 +1976,7 @@ void Server::close() {
     clients_.clear();
     groups_.clear();
     message_queue_.clear();
+    relay_table_.clear();
 }
 
 } // net
@@ -9,6 +9,7 @@
 #include "client_endpoint.hpp"
 #include "detail.hpp"
 #include "event.hpp"
+#include "relay_table.hpp"
 #include "tcp_server.hpp"
 #include "udp_server.hpp"
 
@@ -19,6 +20,7 @@
 #include "osc/OscOutboundPacketStream.h"
 #include "osc/OscReceivedElements.h"
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -139,24 +141,48 @@ public:
 
     osc::OutboundPacketStream start_message(size_t extra_size = 0);
 
+    // While the server is handling network events or dispatching
+    // notifications, outgoing client messages are buffered and sent
+    // with a single write per client, see client_endpoint::send_message().
+    bool batch_output() const { return output_batch_ > 0; }
+
+    void add_pending_output(AooId client) {
+        pending_output_.push_back(client);
+    }
+
+    // returns false if the client has exceeded the send queue limit
+    bool check_send_queue(AooId client);
+
     void handle_message(client_endpoint& client, const osc::ReceivedMessage& msg, int32_t size);
 private:
     // UDP
+    // NB: UDP messages are handled without locking, so that they
+    // can be received on several threads, see start_relay_threads().
+    void handle_udp_batch(aoo::udp_server& server,
+                          const udp_recv_slot *packets, int count);
+
     void handle_udp_packet(const AooByte *data, AooInt32 size,
-                           const aoo::ip_address& addr);
+                           const aoo::ip_address& addr, const sendfn& reply);
 
     void handle_udp_message(const AooByte *data, AooSize size, int onset,
-                            const ip_address& addr);
+                            const ip_address& addr, const sendfn& reply);
 
-    void handle_relay(const AooByte *data, AooSize size, const aoo::ip_address& addr);
+    void handle_relay(const AooByte *data, AooSize size,
+                      const aoo::ip_address& addr, const sendfn& reply);
 
-    void handle_ping(const osc::ReceivedMessage& msg, const ip_address& addr);
+    void handle_ping(const osc::ReceivedMessage& msg, const ip_address& addr,
+                     const sendfn& fn);
 
-    void handle_query(const osc::ReceivedMessage& msg, const ip_address& addr);
+    void handle_query(const osc::ReceivedMessage& msg, const ip_address& addr,
+                      const sendfn& fn);
 
-    void send_udp(const ip_address& addr, const AooByte *data, AooSize size) {
-        udp_sendfn_(data, size, addr);
-    }
+    bool check_relay_address(ip_address& addr) const;
+
+    void update_relay_table();
+
+    void start_relay_threads(int count);
+
+    void stop_relay_threads();
 
     // TCP
     AooId accept_client(const aoo::ip_address& addr, aoo::tcp_server::reply_func fn);
@@ -227,9 +253,27 @@ private:
 
     void close();
 
+    void flush_clients();
+
+    // buffer outgoing client messages for the lifetime of the object;
+    // must be created with the writer lock held!
+    struct output_batch {
+        output_batch(Server& server) : server_(server) {
+            server_.output_batch_++;
+        }
+        ~output_batch() {
+            if (--server_.output_batch_ == 0) {
+                server_.flush_clients();
+            }
+        }
+    private:
+        Server& server_;
+    };
+
     //----------------------------------------------------------------//
 
     // UDP server
+    static const int udp_batch_size = 32;
     sendfn udp_sendfn_;
     int port_ = 0; // unused
     ip_address::ip_type address_family_ = ip_address::Unspec;
@@ -244,8 +288,29 @@ private:
     AooId next_group_id_{0};
     // networking
     aoo::udp_server udp_server_;
+    // additional UDP sockets for multi-threaded relaying; they share
+    // the port with udp_server_, see start_relay_threads().
+    struct relay_thread {
+        ~relay_thread() {
+            server.stop();
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        aoo::udp_server server;
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<relay_thread>> relay_threads_;
+    // routing table for relay messages, see update_relay_table().
+    relay_table relay_table_;
     aoo::tcp_server tcp_server_;
     std::vector<char> sendbuffer_;
+    // clients with buffered output, see output_batch
+    int32_t output_batch_ = 0;
+    std::vector<AooId> pending_output_;
+    // clients that exceeded the send queue limit; they are
+    // disconnected in run(), see check_send_queue().
+    std::vector<AooId> overflow_clients_;
     // message queue
     struct message {
         AooId group;
@@ -285,6 +350,7 @@ private:
     std::string password_;
     parameter<bool> internal_relay_{AOO_SERVER_INTERNAL_RELAY};
     parameter<bool> group_auto_create_{AOO_GROUP_AUTO_CREATE};
+    parameter<int32_t> client_queue_limit_{AOO_SERVER_CLIENT_QUEUE_LIMIT};
     AooPingSettings ping_settings_ {
         AOO_SERVER_PING_INTERVAL,
         AOO_SERVER_PROBE_TIME,
@@ -294,11 +360,25 @@ private:
     sync::spinlock settings_lock_;
 
     static int send(void *user, const AooByte *data, AooInt32 size,
-                    const void *address, AooAddrSize addrlen, AooFlag) {
+                    const void *address, AooAddrSize addrlen, AooFlag flags) {
         aoo::ip_address addr((const struct sockaddr *)address, addrlen);
         auto& server = static_cast<Server *>(user)->udp_server_;
         try {
-            return server.send(addr, data, size);
+            return server.send(addr, data, size, flags & kAooSendMore);
+        } catch (const socket_error& e) {
+            socket::set_last_error(e.code());
+            return -1;
+        }
+    }
+
+    // queue packet until the end of the current receive batch,
+    // see handle_udp_batch().
+    static int send_queued(void *user, const AooByte *data, AooInt32 size,
+                           const void *address, AooAddrSize addrlen, AooFlag) {
+        aoo::ip_address addr((const struct sockaddr *)address, addrlen);
+        auto server = static_cast<aoo::udp_server *>(user);
+        try {
+            return server->send(addr, data, size, true);
         } catch (const socket_error& e) {
             socket::set_last_error(e.code());
             return -1;
@@ -14,6 +14,35 @@
 
 namespace aoo {
 
+namespace {
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+// Write as much as possible to a non-blocking socket;
+// returns the number of bytes that have been written.
+AooSize write_socket(socket_type sock, const AooByte *data, AooSize size) {
+    AooSize nbytes = 0;
+    while (nbytes < size) {
+        // NB: MSG_NOSIGNAL prevents SIGPIPE if the client has gone away
+        auto result = ::send(sock, (const char *)data + nbytes, size - nbytes, MSG_NOSIGNAL);
+        if (result >= 0) {
+            nbytes += result;
+        } else {
+            auto err = socket::get_last_error();
+            if (err == socket_error::would_block) {
+                break;
+            } else if (err != EINTR) {
+                throw socket_error(err);
+            }
+        }
+    }
+    return nbytes;
+}
+
+} // namespace
+
 void tcp_server::start(int port, accept_handler accept, receive_handler receive) {
     do_close();
 
@@ -21,6 +50,8 @@ void tcp_server::start(int port, accept_handler accept, receive_handler receive)
         event_socket_ = udp_socket(port_tag{}, 0);
         listen_socket_ = tcp_socket(port_tag{}, port, true);
         listen_socket_.listen();
+        // accept clients until the socket would block, see accept_client()
+        listen_socket_.set_non_blocking(true);
     } catch (const socket_error& e) {
         event_socket_.close();
         listen_socket_.close();
@@ -30,6 +61,26 @@ void tcp_server::start(int port, accept_handler accept, receive_handler receive)
     accept_handler_ = std::move(accept);
     receive_handler_ = std::move(receive);
 
+#if AOO_TCP_SERVER_EPOLL
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        auto err = socket::get_last_error();
+        event_socket_.close();
+        listen_socket_.close();
+        throw tcp_error(err);
+    }
+    // NB: the listen socket and event socket are level-triggered,
+    // only the client sockets are edge-triggered.
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = listen_key;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_socket_.native_handle(), &ev);
+    ev.events = EPOLLIN;
+    ev.data.u64 = event_key;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_socket_.native_handle(), &ev);
+
+    epoll_events_.resize(256);
+#else
     // prepare poll array for listen and event socket
     poll_array_.resize(2);
 
@@ -40,6 +91,7 @@ void tcp_server::start(int port, accept_handler accept, receive_handler receive)
     poll_array_[event_index].events = POLLIN;
     poll_array_[event_index].revents = 0;
     poll_array_[event_index].fd = event_socket_.native_handle();
+#endif
 
     last_error_ = 0;
     running_.store(true);
@@ -72,7 +124,80 @@ bool tcp_server::run(double timeout) {
     return true;
 }
 
+#if AOO_TCP_SERVER_EPOLL
+
 bool tcp_server::do_run(double timeout) {
+    auto timeout_ms = timeout >= 0 ? std::ceil(timeout * 1000) : -1;
+    int result = epoll_wait(epoll_fd_, epoll_events_.data(),
+                            epoll_events_.size(), timeout_ms);
+    if (result < 0) {
+        auto err = socket::get_last_error();
+        if (err != EINTR) {
+            throw tcp_error(err);
+        }
+        return false;
+    } else if (result == 0) {
+        return false; // timeout
+    }
+
+    bool accept = false;
+    for (int i = 0; i < result; ++i) {
+        auto& e = epoll_events_[i];
+        if (e.data.u64 == event_key) {
+            // drain event socket
+            char dummy[64];
+            try {
+                event_socket_.receive(dummy, sizeof(dummy));
+            } catch (const socket_error& e) {
+                LOG_ERROR("tcp_server: could not drain event socket: " << e.what());
+            }
+        } else if (e.data.u64 == listen_key) {
+            accept = true;
+        } else {
+            auto index = e.data.u64;
+            if (index >= clients_.size() || !clients_[index].socket.is_open()) {
+                continue; // client has been removed in the meantime
+            }
+            auto& c = clients_[index];
+            if (e.events & EPOLLOUT) {
+                // socket has become writable again
+                try {
+                    sync::scoped_lock<sync::mutex> lock(mutex_);
+                    flush_client(c);
+                } catch (const socket_error& err) {
+                    LOG_DEBUG("tcp_server: send() failed: " << err.what());
+                    if (c.id != kAooIdInvalid) {
+                        handle_client_error(c, err.code());
+                    }
+                    close_and_remove_client(index);
+                    continue;
+                }
+            }
+            if (e.events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+                receive_from_client(index, e.events & (EPOLLRDHUP | EPOLLERR | EPOLLHUP));
+            }
+        }
+    }
+
+    // finally accept new clients (modifies the client list!)
+    if (accept) {
+        accept_client();
+    }
+
+    return true;
+}
+
+#else
+
+bool tcp_server::do_run(double timeout) {
+    // only ask for POLLOUT if there is queued data
+    {
+        sync::scoped_lock<sync::mutex> lock(mutex_);
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            poll_array_[client_index + i].events = clients_[i].queue.empty() ?
+                POLLIN : (POLLIN | POLLOUT);
+        }
+    }
     // NOTE: macOS/BSD requires the negative timeout to be exactly -1!
     auto timeout_ms = timeout >= 0 ? std::ceil(timeout * 1000) : -1;
 #ifdef _WIN32
@@ -99,15 +224,91 @@ bool tcp_server::do_run(double timeout) {
         }
     }
 
-    // first receive from clients
-    receive_from_clients();
+    // first send to and receive from clients
+    for (size_t i = 0; i < clients_.size(); ++i) {
+        auto& fdp = poll_array_[client_index + i];
+        auto revents = std::exchange(fdp.revents, 0);
+        if (revents == 0) {
+            continue; // no event
+        }
+    #ifdef _WIN32
+        if (fdp.fd == INVALID_SOCKET) {
+            // Windows does not simply ignore invalid socket descriptors,
+            // instead it would return POLLNVAL...
+            continue;
+        }
+    #endif
+        auto& c = clients_[i];
+
+        if (revents & POLLERR) {
+            LOG_DEBUG("tcp_server: POLLERR");
+        }
+        if (revents & POLLHUP) {
+            LOG_DEBUG("tcp_server: POLLHUP");
+        }
+        if (revents & POLLNVAL) {
+            // invalid socket, shouldn't happen...
+            LOG_DEBUG("tcp_server: POLLNVAL");
+            handle_client_error(c, EINVAL);
+            close_and_remove_client(i);
+            continue;
+        }
+        if (revents & POLLOUT) {
+            // socket has become writable again
+            try {
+                sync::scoped_lock<sync::mutex> lock(mutex_);
+                flush_client(c);
+            } catch (const socket_error& e) {
+                LOG_DEBUG("tcp_server: send() failed: " << e.what());
+                if (c.id != kAooIdInvalid) {
+                    handle_client_error(c, e.code());
+                }
+                close_and_remove_client(i);
+                continue;
+            }
+        }
+        if (revents & (POLLIN | POLLERR | POLLHUP)) {
+            receive_from_client(i);
+        }
+    }
+
+    purge_stale_clients();
 
     // finally accept new clients (modifies the client list!)
-    accept_client();
+    if (std::exchange(poll_array_[listen_index].revents, 0) != 0) {
+        accept_client();
+    }
 
     return true;
 }
 
+void tcp_server::purge_stale_clients() {
+    if (stale_clients_.size() > max_stale_clients) {
+        sync::scoped_lock<sync::mutex> lock(mutex_);
+
+        clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+            [](auto& c) { return !c.socket.is_open(); }), clients_.end());
+
+        poll_array_.erase(std::remove_if(poll_array_.begin() + client_index, poll_array_.end(),
+            [](auto& p) { return p.fd == invalid_socket; }), poll_array_.end());
+
+        stale_clients_.clear();
+
+        // update indices
+        client_ids_.clear();
+        client_serials_.clear();
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            auto& c = clients_[i];
+            if (c.id != kAooIdInvalid) {
+                client_ids_[c.id] = i;
+            }
+            client_serials_[c.serial] = i;
+        }
+    }
+}
+
+#endif
+
 void tcp_server::stop() {
     bool running = running_.exchange(false);
     if (running) {
@@ -131,86 +332,150 @@ void tcp_server::do_close() {
 
     event_socket_.close();
 
-    clients_.clear();
+#if AOO_TCP_SERVER_EPOLL
+    if (epoll_fd_ >= 0) {
+        ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+#else
     poll_array_.clear();
+#endif
+
+    sync::scoped_lock<sync::mutex> lock(mutex_);
+    clients_.clear();
+    client_ids_.clear();
+    client_serials_.clear();
     stale_clients_.clear();
     client_count_ = 0;
 }
 
 int tcp_server::send(AooId client, const AooByte *data, AooSize size) {
-    // LATER optimize look up
-    for (auto& c : clients_) {
-        if (c.id == client) {
-            // there is some controversy on whether send() in blocking mode
-            // might do partial writes. To be sure, we call send() in a loop.
-            try {
-                int32_t nbytes = 0;
-                while (nbytes < size) {
-                    auto result = c.socket.send(data + nbytes, size - nbytes);
-                    nbytes += result;
-                }
-            } catch (const socket_error& e) {
-                throw tcp_error(e);
-            }
-
-            return size;
-        }
+    sync::scoped_lock<sync::mutex> lock(mutex_);
+    if (auto it = client_ids_.find(client); it != client_ids_.end()) {
+        return send_to_client(clients_[it->second], data, size);
     }
     LOG_ERROR("tcp_server: send(): unknown client (" << client << ")");
     return 0; // ?
 }
 
-bool tcp_server::close(AooId client) {
-    for (size_t i = 0; i < clients_.size(); ++i) {
-        if (clients_[i].id == client) {
-        #if 1
-            // "lingering close": shutdown() will send FIN, causing the
-            // client to terminate the connection. However, it is important
-            // that we read all pending data before calling close(), otherwise
-            // we might accidentally send RST and the client might lose data.
-            clients_[i].socket.shutdown(shutdown_send);
-            clients_[i].id = kAooIdInvalid;
-        #else
-            close_and_remove_client(i);
-        #endif
-            LOG_DEBUG("tcp_server: close client " << client);
-            return true;
-        }
+int tcp_server::send_to_client(uint64_t serial, const AooByte *data, AooSize size) {
+    sync::scoped_lock<sync::mutex> lock(mutex_);
+    if (auto it = client_serials_.find(serial); it != client_serials_.end()) {
+        return send_to_client(clients_[it->second], data, size);
     }
-    return false;
+    LOG_DEBUG("tcp_server: send(): client has been removed");
+    return 0;
 }
 
-void tcp_server::receive_from_clients() {
-    for (int i = 0; i < clients_.size(); ++i) {
-        auto& fdp = poll_array_[client_index + i];
-        auto revents = std::exchange(fdp.revents, 0);
-        if (revents == 0) {
-            continue; // no event
+// NB: called with mutex locked
+int tcp_server::send_to_client(client& c, const AooByte *data, AooSize size) {
+    AooSize nbytes = 0;
+    if (c.queue.empty()) {
+        // try to send directly
+        try {
+            nbytes = write_socket(c.socket.native_handle(), data, size);
+        } catch (const socket_error& e) {
+            throw tcp_error(e);
         }
-    #ifdef _WIN32
-        if (fdp.fd == INVALID_SOCKET) {
-            // Windows does not simply ignore invalid socket descriptors,
-            // instead it would return POLLNVAL...
-            continue;
+    }
+    if (nbytes < size) {
+        // queue the remaining data; it will be sent as soon as
+        // the socket becomes writable again.
+        bool was_empty = c.queue.empty();
+        c.queue.insert(c.queue.end(), data + nbytes, data + size);
+    #if AOO_TCP_SERVER_EPOLL
+        (void)was_empty; // EPOLLOUT is always enabled (edge-triggered)
+    #else
+        if (was_empty) {
+            // wake up the network thread so that it polls for POLLOUT
+            event_socket_.signal();
         }
     #endif
-        auto& c = clients_[i];
+    #if AOO_DEBUG_TCP_SERVER
+        LOG_DEBUG("tcp_server: queued " << (size - nbytes) << " bytes for client "
+                  << c.id << " (total: " << (c.queue.size() - c.queue_offset) << ")");
+    #endif
+    }
+    return size;
+}
 
-        if (revents & POLLERR) {
-            LOG_DEBUG("tcp_server: POLLERR");
+// NB: called with mutex locked; returns true if the queue is empty.
+bool tcp_server::flush_client(client& c) {
+    if (!c.queue.empty()) {
+        auto data = c.queue.data() + c.queue_offset;
+        auto size = c.queue.size() - c.queue_offset;
+        c.queue_offset += write_socket(c.socket.native_handle(), data, size);
+        if (c.queue_offset == c.queue.size()) {
+            c.queue.clear();
+            c.queue_offset = 0;
+        } else if (c.queue_offset > c.queue.size() / 2) {
+            // compact; amortized O(1)
+            c.queue.erase(c.queue.begin(), c.queue.begin() + c.queue_offset);
+            c.queue_offset = 0;
         }
-        if (revents & POLLHUP) {
-            LOG_DEBUG("tcp_server: POLLHUP");
+    }
+    if (c.queue.empty() && c.shutdown) {
+        // pending "lingering close", see close()
+        c.socket.shutdown(shutdown_send);
+        c.shutdown = false;
+    }
+    return c.queue.empty();
+}
+
+size_t tcp_server::queued_bytes(AooId client) {
+    sync::scoped_lock<sync::mutex> lock(mutex_);
+    if (auto it = client_ids_.find(client); it != client_ids_.end()) {
+        auto& c = clients_[it->second];
+        return c.queue.size() - c.queue_offset;
+    }
+    return 0;
+}
+
+bool tcp_server::close(AooId client, bool discard) {
+    sync::scoped_lock<sync::mutex> lock(mutex_);
+    if (auto it = client_ids_.find(client); it != client_ids_.end()) {
+        auto& c = clients_[it->second];
+        client_ids_.erase(it);
+        if (discard) {
+            // drop queued data and shut down both directions; the socket
+            // will be closed when we receive the EOF, see receive_from_client().
+            std::vector<AooByte>().swap(c.queue);
+            c.queue_offset = 0;
+            c.shutdown = false;
+            c.socket.shutdown(shutdown_both);
+            c.id = kAooIdInvalid;
+            LOG_DEBUG("tcp_server: abort client " << client);
+            return true;
         }
-        if (revents & POLLNVAL) {
-            // invalid socket, shouldn't happen...
-            LOG_DEBUG("tcp_server: POLLNVAL");
-            handle_client_error(c, EINVAL);
-            close_and_remove_client(i);
-            return;
+    #if 1
+        // "lingering close": shutdown() will send FIN, causing the
+        // client to terminate the connection. However, it is important
+        // that we read all pending data before calling close(), otherwise
+        // we might accidentally send RST and the client might lose data.
+        // NB: if there is still queued data, we have to wait until
+        // it has been sent, see flush_client().
+        if (c.queue.empty()) {
+            c.socket.shutdown(shutdown_send);
+        } else {
+            c.shutdown = true;
         }
+        c.id = kAooIdInvalid;
+    #else
+        close_and_remove_client(it->second);
+    #endif
+        LOG_DEBUG("tcp_server: close client " << client);
+        return true;
+    }
+    return false;
+}
 
-        // receive data from client
+void tcp_server::receive_from_client(size_t index, bool hangup) {
+    // NB: with epoll we use edge-triggered notifications,
+    // so we have to read until the socket would block.
+    // If the peer has hung up, the EOF may arrive together with the
+    // last data in the same edge, so we must read until we get it.
+    for (;;) {
+        auto& c = clients_[index];
         try {
             AooByte buffer[AOO_MAX_PACKET_SIZE];
             auto result = c.socket.receive(buffer, sizeof(buffer));
@@ -218,64 +483,74 @@ void tcp_server::receive_from_clients() {
                 if (result > 0) {
                     // received data
                     receive_handler_(c.id, 0, buffer, result, c.address);
+                #if AOO_TCP_SERVER_EPOLL
+                    if (!hangup && result < (int)sizeof(buffer)) {
+                        // short read: the socket has been drained;
+                        // new data will trigger another event.
+                        return;
+                    }
+                #endif
                 } else {
                     // client disconnected
                     LOG_DEBUG("tcp_server: connection closed by client");
                     handle_client_error(c, 0);
-                    close_and_remove_client(i);
+                    close_and_remove_client(index);
+                    return;
                 }
             } else {
                 // "lingering close": read from socket until EOF, see close() method.
                 if (result == 0) {
-                    close_and_remove_client(i);
+                    close_and_remove_client(index);
+                    return;
                 }
             }
         } catch (const socket_error& e) {
-            if (e.code() == EINTR) {
+            if (e.code() == socket_error::would_block) {
+                return; // drained
+            } else if (e.code() == EINTR) {
                 continue;
             }
             LOG_DEBUG("tcp_server: recv() failed: " << e.what());
             if (c.id != kAooIdInvalid) {
                 handle_client_error(c, e.code());
             }
-            close_and_remove_client(i);
+            close_and_remove_client(index);
+            return;
         }
+    #if !AOO_TCP_SERVER_EPOLL
+        return; // level-triggered
+    #endif
     }
-
-#if 1
-    // purge stale clients (if necessary)
-    if (stale_clients_.size() > max_stale_clients) {
-        clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
-            [](auto& c) { return !c.socket.is_open(); }), clients_.end());
-
-        poll_array_.erase(std::remove_if(poll_array_.begin(), poll_array_.end(),
-            [](auto& p) { return p.fd == invalid_socket; }), poll_array_.end());
-
-        stale_clients_.clear();
-    }
-#endif
 }
 
-void tcp_server::close_and_remove_client(int index) {
+void tcp_server::close_and_remove_client(size_t index) {
+    sync::scoped_lock<sync::mutex> lock(mutex_);
     auto& c = clients_[index];
-    c.socket.close();
+#if AOO_TCP_SERVER_EPOLL
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c.socket.native_handle(), nullptr);
+#else
     // mark as stale (will be ignored in poll())
     poll_array_[client_index + index].fd = invalid_socket;
+#endif
+    c.socket.close();
     stale_clients_.push_back(index);
+    client_serials_.erase(c.serial);
     if (c.id != kAooIdInvalid) {
         LOG_DEBUG("tcp_server: close socket and remove client " << c.id);
+        client_ids_.erase(c.id);
     } else {
         LOG_DEBUG("tcp_server: close client socket");
     }
+    // release memory
+    std::vector<AooByte>().swap(c.queue);
+    c.queue_offset = 0;
+    c.shutdown = false;
     client_count_--;
 }
 
 void tcp_server::accept_client() {
-    auto revents = std::exchange(poll_array_[listen_index].revents, 0);
-    if (revents == 0) {
-        return; // no event
-    }
-
+#if !AOO_TCP_SERVER_EPOLL
+    auto revents = poll_array_[listen_index].revents;
     if (revents & POLLNVAL) {
         LOG_DEBUG("tcp_server: POLLNVAL");
         throw tcp_error(EINVAL);
@@ -288,48 +563,80 @@ void tcp_server::accept_client() {
         LOG_DEBUG("tcp_server: POLLHUP");
         // shouldn't happen on listening socket...
     }
+#endif
 
-    try {
-        auto [sock, addr] = listen_socket_.accept();
-        auto sockfd = sock.native_handle();
-        auto replyfn = [sockfd](const AooByte *data, AooSize size) {
-            AooSize nbytes = 0;
-            while (nbytes < size) {
-                auto result = ::send(sockfd, (const char *)data + nbytes, size - nbytes, 0);
-                if (result >= 0) {
-                    nbytes += result;
+    // accept all pending connections
+    for (;;) {
+        try {
+            auto [sock, addr] = listen_socket_.accept();
+            sock.set_non_blocking(true);
+            auto sockfd = sock.native_handle();
+            // add client with invalid ID, so that the reply function
+            // can already be used in the accept handler.
+            size_t index;
+            auto serial = next_serial_++;
+            {
+                sync::scoped_lock<sync::mutex> lock(mutex_);
+                if (!stale_clients_.empty()) {
+                    // reuse stale client
+                    index = stale_clients_.back();
+                    stale_clients_.pop_back();
+                    clients_[index] = client {
+                        addr, std::move(sock), kAooIdInvalid, serial, false, {}, 0
+                    };
+                #if !AOO_TCP_SERVER_EPOLL
+                    poll_array_[client_index + index].fd = sockfd;
+                #endif
                 } else {
-                    throw socket_error(socket::get_last_error());
+                    // add new client
+                    index = clients_.size();
+                    clients_.push_back(client {
+                        addr, std::move(sock), kAooIdInvalid, serial, false, {}, 0
+                    });
+                #if !AOO_TCP_SERVER_EPOLL
+                    pollfd p;
+                    p.fd = sockfd;
+                    p.events = POLLIN;
+                    p.revents = 0;
+                    poll_array_.push_back(p);
+                #endif
                 }
+                client_serials_[serial] = index;
+                client_count_++;
             }
-            return nbytes;
-        };
-        auto id = accept_handler_(addr, replyfn);
-        if (id == kAooIdInvalid) {
-            // user refused to accept client
-            return;
-        }
-
-        if (!stale_clients_.empty()) {
-            // reuse stale client
-            auto index = stale_clients_.back();
-            stale_clients_.pop_back();
-
-            clients_[index] = client { addr, std::move(sock), id };
-            poll_array_[client_index + index].fd = sockfd;
-        } else {
-            // add new client
-            clients_.push_back(client { addr, std::move(sock), id });
-            pollfd p;
-            p.fd = sockfd;
-            p.events = POLLIN;
-            p.revents = 0;
-            poll_array_.push_back(p);
+            auto replyfn = [this, serial](const AooByte *data, AooSize size) {
+                return send_to_client(serial, data, size);
+            };
+            auto id = accept_handler_(addr, replyfn);
+            if (id == kAooIdInvalid) {
+                // user refused to accept client
+                close_and_remove_client(index);
+                continue;
+            }
+            {
+                sync::scoped_lock<sync::mutex> lock(mutex_);
+                clients_[index].id = id;
+                client_ids_[id] = index;
+            }
+        #if AOO_TCP_SERVER_EPOLL
+            epoll_event ev;
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.u64 = index;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sockfd, &ev) != 0) {
+                auto err = socket::get_last_error();
+                LOG_ERROR("tcp_server: epoll_ctl() failed: " << socket::strerror(err));
+                handle_client_error(clients_[index], err);
+                close_and_remove_client(index);
+                continue;
+            }
+        #endif
+            LOG_DEBUG("tcp_server: accepted client " << addr << " " << id);
+        } catch (const accept_error& e) {
+            if (e.code() != socket_error::would_block) {
+                handle_accept_error(e);
+            }
+            break;
         }
-        LOG_DEBUG("tcp_server: accepted client " << addr << " " << id);
-        client_count_++;
-    } catch (const accept_error& e) {
-        handle_accept_error(e);
     }
 }
 
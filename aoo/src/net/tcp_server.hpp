@@ -1,9 +1,20 @@
 #pragma once
 
 #include <functional>
+#include <unordered_map>
 #include <vector>
 #include <atomic>
 
+// Use epoll() instead of poll() on Linux; the cost of a wakeup
+// does not depend on the number of connected clients.
+#ifndef AOO_TCP_SERVER_EPOLL
+# ifdef __linux__
+#  define AOO_TCP_SERVER_EPOLL 1
+# else
+#  define AOO_TCP_SERVER_EPOLL 0
+# endif
+#endif
+
 #ifndef _WIN32
 # include <sys/poll.h>
 # include <unistd.h>
@@ -14,7 +25,12 @@
 # include <errno.h>
 #endif
 
+#if AOO_TCP_SERVER_EPOLL
+# include <sys/epoll.h>
+#endif
+
 #include "common/net_utils.hpp"
+#include "common/sync.hpp"
 
 namespace aoo {
 
@@ -46,27 +62,46 @@ public:
     void start(int port, accept_handler accept, receive_handler receive);
     bool run(double timeout = -1.0);
     bool running() const { return running_.load(std::memory_order_relaxed); }
+    int port() const { return listen_socket_.port(); }
     void stop();
     void notify();
 
+    // Send data to a client; can be called from any thread.
+    // The sockets are non-blocking: data that can't be sent immediately
+    // is queued and sent as soon as the socket becomes writable again,
+    // so that a slow client can't stall the whole server.
     int send(AooId client, const AooByte *data, AooSize size);
-    bool close(AooId client);
+    // Close the connection to a client. By default, queued data is
+    // still sent before the connection is shut down; if 'discard'
+    // is true, the data is dropped and the socket is shut down
+    // immediately, e.g. for clients that don't read their data.
+    bool close(AooId client, bool discard = false);
     int client_count() const { return client_count_; }
+    // number of queued bytes for the given client
+    size_t queued_bytes(AooId client);
 private:
     struct client {
         ip_address address;
         tcp_socket socket;
         AooId id;
+        uint64_t serial; // distinguishes re-used client slots
+        bool shutdown = false; // shutdown after sending all queued data
+        // outgoing data that could not be sent yet
+        std::vector<AooByte> queue;
+        size_t queue_offset = 0;
     };
 
     bool do_run(double timeout);
     void accept_client();
     void handle_accept_error(const accept_error& e);
-    void receive_from_clients();
+    void receive_from_client(size_t index, bool hangup = false);
     void handle_client_error(const client& c, int code) {
         receive_handler_(c.id, code, nullptr, 0, c.address);
     }
-    void close_and_remove_client(int index);
+    int send_to_client(uint64_t serial, const AooByte *data, AooSize size);
+    int send_to_client(client& c, const AooByte *data, AooSize size);
+    bool flush_client(client& c);
+    void close_and_remove_client(size_t index);
     void do_close();
 
     tcp_socket listen_socket_;
@@ -74,17 +109,33 @@ private:
     int last_error_ = 0;
     std::atomic<bool> running_{false};
 
+#if AOO_TCP_SERVER_EPOLL
+    int epoll_fd_ = -1;
+    std::vector<epoll_event> epoll_events_;
+    static const uint64_t listen_key = UINT64_MAX;
+    static const uint64_t event_key = UINT64_MAX - 1;
+#else
+    void purge_stale_clients();
+
     std::vector<pollfd> poll_array_;
     static const size_t listen_index = 0;
     static const size_t event_index = 1;
     static const size_t client_index = 2;
+#endif
 
     accept_handler accept_handler_;
     receive_handler receive_handler_;
 
+    // NB: the client list may only be modified by the network thread,
+    // but send() may be called from any thread, so structural changes
+    // and the send queues are protected by a mutex.
     std::vector<client> clients_;
+    std::unordered_map<AooId, size_t> client_ids_; // ID -> index
+    std::unordered_map<uint64_t, size_t> client_serials_; // serial -> index
     std::vector<size_t> stale_clients_;
-    int32_t client_count_ = 0;
+    sync::mutex mutex_;
+    uint64_t next_serial_ = 0;
+    std::atomic<int32_t> client_count_{0};
     static const int max_stale_clients = 100;
 };
 
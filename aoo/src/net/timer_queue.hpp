@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common/priority_queue.hpp"
+#include "common/time.hpp"
+
+#include "../detail.hpp"
+
+namespace aoo {
+namespace net {
+
+// A deadline queue for objects which are visited when they are due,
+// e.g. the peers of a client, see Client::update_peers().
+// Timers are invalidated lazily: a timer only counts if its deadline
+// matches the scheduled time of the object, so we never have to
+// remove a timer when an object is rescheduled or removed.
+// 'T' must have scheduled_time() and set_scheduled_time() methods.
+template<typename Key, typename T>
+class timer_queue {
+public:
+    // schedule an object, unless it is scheduled earlier anyway.
+    // Returns true if a new timer has been added.
+    bool schedule(T& obj, const Key& key, time_tag deadline) {
+        if (!deadline.is_empty()) {
+            auto scheduled = obj.scheduled_time();
+            if (scheduled.is_empty() || deadline < scheduled) {
+                timers_.push(timer { deadline, key });
+                obj.set_scheduled_time(deadline);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // visit all objects which are due. 'find' returns a pointer to
+    // the object with the given key (or nullptr if it has been removed).
+    // NB: an object is visited at most once per call.
+    template<typename Find, typename Visit>
+    void dispatch(time_tag now, Find&& find, Visit&& visit) {
+        // first collect all due timers, so that 'visit'
+        // can safely reschedule the object.
+        due_.clear();
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            due_.push_back(timers_.top());
+            timers_.pop();
+        }
+        for (auto& t : due_) {
+            T *obj = find(t.key);
+            if (obj && obj->scheduled_time() == t.deadline) {
+                obj->set_scheduled_time(time_tag{});
+                visit(*obj);
+            } // else: stale timer
+        }
+    }
+
+    // the earliest deadline; might belong to a stale timer.
+    time_tag next() const {
+        return timers_.empty() ? time_tag{} : timers_.top().deadline;
+    }
+
+    size_t size() const {
+        return timers_.size();
+    }
+
+    void clear() {
+        timers_.clear();
+    }
+private:
+    struct timer {
+        time_tag deadline;
+        Key key;
+
+        bool operator>(const timer& other) const {
+            return deadline > other.deadline;
+        }
+    };
+    aoo::priority_queue<timer, std::greater<timer>> timers_;
+    aoo::vector<timer> due_; // scratch buffer
+};
+
+} // net
+} // aoo
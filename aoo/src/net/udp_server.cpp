@@ -3,12 +3,42 @@
 #include "common/log.hpp"
 #include "common/utils.hpp"
 
+#include <algorithm>
+
 namespace aoo {
 
 void udp_server::start(int port, receive_handler receive, bool threaded) {
     do_close();
 
     receive_handler_ = std::move(receive);
+    batch_handler_ = nullptr;
+
+    do_start(port, 1, threaded);
+}
+
+void udp_server::start_batched(int port, batch_handler receive,
+                               int batch_size, bool threaded) {
+    do_close();
+
+    receive_handler_ = nullptr;
+    batch_handler_ = std::move(receive);
+
+    do_start(port, std::clamp(batch_size, 1, max_batch_size), threaded);
+}
+
+void udp_server::do_start(int port, int batch_size, bool threaded) {
+    // preallocate packet slots
+    buffer_.resize(batch_size * max_udp_packet_size);
+    slots_.resize(batch_size);
+    for (int i = 0; i < batch_size; ++i) {
+        slots_[i].data = buffer_.data() + i * max_udp_packet_size;
+        slots_[i].capacity = max_udp_packet_size;
+        slots_[i].size = 0;
+    }
+    stat_packets_.store(0);
+    stat_calls_.store(0);
+    stat_max_batch_.store(0);
+    stat_overflow_.store(0);
 
     // Don't try to reuse ports because it would lead to silent errors
     // if the port is already taken by another application.
@@ -16,7 +46,7 @@ void udp_server::start(int port, receive_handler receive, bool threaded) {
     // and join the network thread.
     // TODO: figure out if some operating systems let UDP sockets linger.
     try {
-        socket_ = udp_socket(port_tag{}, port, false);
+        socket_ = udp_socket(port_tag{}, port, false, share_port_);
         bind_addr_ = socket_.address();
     } catch (const socket_error& e) {
         throw udp_error(e);
@@ -43,11 +73,16 @@ void udp_server::start(int port, receive_handler receive, bool threaded) {
     running_.store(true);
     threaded_ = threaded;
     if (threaded_) {
-        packet_queue_.clear();
+        // preallocate packet queue
+        queue_data_.resize(queue_packet_size_, queue_capacity_);
+        queue_info_.resize(queue_capacity_);
+        queue_slots_.resize(std::min(queue_capacity_, max_batch_size));
         // TODO: lower thread priority?
         thread_ = std::thread([this](){
             try {
-                this->receive(-1.0);
+                while (running_.load()) {
+                    this->receive(-1.0);
+                }
             } catch (const udp_error& e) {
                 LOG_DEBUG("udp_server: thread function failed: " << e.what());
                 // TODO: report error to main thread
@@ -63,19 +98,10 @@ bool udp_server::run(double timeout) {
         if (threaded_) {
             // a) threaded
             if (timeout == 0) {
-                if (!packet_queue_.empty()) {
-                    packet_queue_.consume_all([this](auto& packet){
-                        receive_handler_(packet.data.data(), packet.data.size(), packet.address);
-                    });
-                    return true;
-                } else {
-                    return false;
-                }
+                return pop_packets();
             } else {
                 if (event_.wait_for(timeout)) {
-                    packet_queue_.consume_all([this](auto& packet){
-                        receive_handler_(packet.data.data(), packet.data.size(), packet.address);
-                    });
+                    pop_packets();
                     return true;
                 } else {
                     return false;
@@ -101,9 +127,7 @@ bool udp_server::run(double timeout) {
         if (threaded_) {
             // a) threaded
             while (running_.load()) {
-                packet_queue_.consume_all([&](auto& packet){
-                    receive_handler_(packet.data.data(), packet.data.size(), packet.address);
-                });
+                pop_packets();
                 // wait for packets
                 event_.wait();
             }
@@ -124,6 +148,14 @@ void udp_server::stop() {
     bool running = running_.exchange(false);
     if (running) {
         // wake up receive
+    #ifdef __linux__
+        if (share_port_) {
+            // the signal packet might be delivered to another socket that
+            // shares the same port. Fortunately, on Linux shutdown() also
+            // wakes up a blocking recv() on unconnected UDP sockets.
+            socket_.shutdown(shutdown_receive);
+        } else
+    #endif
         if (!socket_.signal()) {
             // force wakeup by closing the socket.
             // this is not nice and probably undefined behavior,
@@ -149,6 +181,111 @@ void udp_server::notify() {
     }
 }
 
+int udp_server::send(const aoo::ip_address& addr, const AooByte *data,
+                     AooSize size, bool more) {
+    sync::scoped_lock<sync::mutex> lock(send_mutex_);
+    if (!more && send_entries_.empty()) {
+        // fast path
+        return socket_.send(data, size, addr);
+    }
+    // queue packet
+    auto onset = send_buffer_.size();
+    send_buffer_.insert(send_buffer_.end(), data, data + size);
+    send_entries_.push_back(send_entry { onset, size, addr });
+    if (!more || send_entries_.size() >= max_send_batch) {
+        do_flush();
+    }
+    return size;
+}
+
+void udp_server::flush() {
+    sync::scoped_lock<sync::mutex> lock(send_mutex_);
+    if (!send_entries_.empty()) {
+        do_flush();
+    }
+}
+
+// NB: must be called with send_mutex_ locked!
+int udp_server::do_flush() {
+    // NB: only take pointers after the send buffer has been filled
+    // because it might have been reallocated.
+    send_packets_.clear();
+    for (auto& e : send_entries_) {
+        send_packets_.push_back(udp_packet_ref {
+            send_buffer_.data() + e.onset, (int)e.size, &e.address });
+    }
+    auto clear = [this]() {
+        send_buffer_.clear();
+        send_entries_.clear();
+    };
+    // always clear the queue, even if sending fails!
+    try {
+        auto result = socket_.send_batch(send_packets_.data(), send_packets_.size());
+        clear();
+        return result;
+    } catch (const socket_error&) {
+        clear();
+        throw;
+    }
+}
+
+void udp_server::dispatch(const udp_recv_slot *packets, int count) {
+    if (batch_handler_) {
+        batch_handler_(packets, count);
+    } else {
+        for (int i = 0; i < count; ++i) {
+            auto& p = packets[i];
+            receive_handler_(p.data, p.size, p.address);
+        }
+    }
+}
+
+// called by the receive thread
+void udp_server::push_packets(const udp_recv_slot *packets, int count) {
+    for (int i = 0; i < count; ++i) {
+        auto& p = packets[i];
+        if (p.size > queue_packet_size_ || queue_info_.write_available() == 0) {
+            // packet too large or queue full
+            auto overflow = stat_overflow_.load() + 1;
+            stat_overflow_.store(overflow);
+            LOG_DEBUG("udp_server: drop packet (" << overflow << " total)");
+            continue;
+        }
+        std::copy(p.data, p.data + p.size, queue_data_.write_data());
+        queue_data_.write_commit();
+        auto info = queue_info_.write_data();
+        info->size = p.size;
+        info->address = p.address;
+        queue_info_.write_commit();
+    }
+}
+
+// called by the network thread; returns true if any packets have been dispatched.
+bool udp_server::pop_packets() {
+    bool didsomething = false;
+    int count;
+    while ((count = std::min<int>(queue_info_.read_available(), queue_slots_.size())) > 0) {
+        // dispatch packets in batches
+        for (int i = 0; i < count; ++i) {
+            auto& slot = queue_slots_[i];
+            auto info = queue_info_.peek_data(i);
+            // NB: the slot points directly into the slab, so we may only
+            // release the buffers after the packets have been dispatched.
+            slot.data = const_cast<AooByte *>(queue_data_.peek_data(i));
+            slot.capacity = queue_packet_size_;
+            slot.size = info->size;
+            slot.address = info->address;
+        }
+        dispatch(queue_slots_.data(), count);
+        for (int i = 0; i < count; ++i) {
+            queue_data_.read_commit();
+            queue_info_.read_commit();
+        }
+        didsomething = true;
+    }
+    return didsomething;
+}
+
 void udp_server::do_close() {
     socket_.close();
     bind_addr_.clear();
@@ -164,22 +301,34 @@ udp_server::~udp_server() {
 
 bool udp_server::receive(double timeout) {
     try {
-        aoo::ip_address address;
-        auto [success, result] = socket_.receive(buffer_.data(), buffer_.size(),
-                                                 address, timeout);
+        auto [success, count] = socket_.receive_batch(slots_.data(), slots_.size(),
+                                                      timeout);
         if (success) {
-            if (result > 0) {
+            // update statistics (only written by this thread)
+            stat_packets_.store(stat_packets_.load() + count);
+            stat_calls_.store(stat_calls_.load() + 1);
+            if (count > stat_max_batch_.load()) {
+                stat_max_batch_.store(count);
+            }
+            // remove empty packets (used for signalling) and truncated packets.
+            // NB: only swap the slots, the packet data stays in place.
+            int n = 0;
+            for (int i = 0; i < count; ++i) {
+                if (slots_[i].size > 0) {
+                    if (i != n) {
+                        std::swap(slots_[i], slots_[n]);
+                    }
+                    n++;
+                }
+            }
+            if (n > 0) {
                 if (threaded_) {
-                    packet_queue_.produce([&, len=result](auto& packet){
-                        packet.data.assign(buffer_.data(), buffer_.data() + len);
-                        packet.address = address;
-                    });
+                    push_packets(slots_.data(), n);
                     event_.set(); // notify main thread (if blocking)
                 } else {
-                    receive_handler_(buffer_.data(), result, address);
+                    dispatch(slots_.data(), n);
                 }
             }
-            // ignore timeout or empty packet (used for signalling)
             return true;
         } else {
             // timeout
@@ -37,11 +37,34 @@ public:
     using receive_handler = std::function<void(const AooByte *data, AooSize size,
                                                const aoo::ip_address& addr)>;
 
-    udp_server() : buffer_(max_udp_packet_size) {}
+    // receives a whole batch of packets, see start_batched().
+    // NB: the packets are only valid for the duration of the call!
+    using batch_handler = std::function<void(const udp_recv_slot *packets, int count)>;
+
+    static const int max_batch_size = 64;
+
+    // default settings for the packet queue in threaded mode.
+    // NB: the default packet size accepts any UDP packet (e.g. relayed
+    // packets which can be larger than AOO_MAX_PACKET_SIZE); the queue
+    // memory is preallocated, so it takes capacity * packet size bytes.
+    static const int default_queue_capacity = 256;
+    static const int default_queue_packet_size = max_udp_packet_size;
+
+    struct receive_stats {
+        uint64_t packets;
+        uint64_t calls;
+        int32_t max_batch;
+        // packets dropped in threaded mode because the
+        // queue was full or the packet was too large.
+        uint64_t overflow;
+    };
+
+    udp_server() = default;
     ~udp_server();
 
     int port() const { return bind_addr_.port(); }
     const udp_socket& socket() const { return socket_; }
+    udp_socket& socket() { return socket_; }
     aoo::ip_address::ip_type type() const { return bind_addr_.type(); }
 
     udp_server(const udp_server&) = delete;
@@ -54,8 +77,27 @@ public:
     void set_receive_buffer_size(int size) {
         receive_buffer_size_ = size;
     }
+    // share the port with other udp_server instances, see
+    // udp_socket(port_tag, port_type, bool, bool). NB: all
+    // instances, including the first one, must set this option!
+    void set_share_port(bool b) {
+        share_port_ = b;
+    }
+    // max. number of pending packets in threaded mode
+    void set_queue_capacity(int capacity) {
+        queue_capacity_ = capacity;
+    }
+    // max. packet size in threaded mode; larger packets are dropped
+    // and counted in receive_stats::overflow.
+    void set_queue_packet_size(int size) {
+        queue_packet_size_ = size;
+    }
 
     void start(int port, receive_handler receive, bool threaded = false);
+    // Receive up to 'batch_size' packets per system call (if supported by the
+    // platform) and pass them to the handler in a single call.
+    void start_batched(int port, batch_handler receive, int batch_size,
+                       bool threaded = false);
     bool run(double timeout = -1);
     bool running() const { return running_.load(std::memory_order_relaxed); }
     void stop();
@@ -64,30 +106,78 @@ public:
     int send(const aoo::ip_address& addr, const AooByte *data, AooSize size) {
         return socket_.send(data, size, addr);
     }
+
+    // If 'more' is true, the packet is copied and queued; otherwise it
+    // is sent together with all pending packets in a single batch.
+    int send(const aoo::ip_address& addr, const AooByte *data,
+             AooSize size, bool more);
+
+    // send all pending packets
+    void flush();
+
+    // can be called from any thread
+    receive_stats get_receive_stats() const {
+        return receive_stats { stat_packets_.load(), stat_calls_.load(),
+                               stat_max_batch_.load(), stat_overflow_.load() };
+    }
 private:
+    void do_start(int port, int batch_size, bool threaded);
     bool receive(double timeout);
+    void dispatch(const udp_recv_slot *packets, int count);
+    void push_packets(const udp_recv_slot *packets, int count);
+    bool pop_packets();
     void do_close();
 
     udp_socket socket_;
     aoo::ip_address bind_addr_;
     int send_buffer_size_ = 0;
     int receive_buffer_size_ = 0;
+    bool share_port_ = false;
     std::atomic<bool> running_{false};
     bool threaded_ = false;
 
+    // preallocated packet slots for receive()
     std::vector<AooByte> buffer_;
-
-    struct udp_packet {
-        std::vector<AooByte> data;
+    std::vector<udp_recv_slot> slots_;
+    // NB: only written by the receive thread
+    sync::relaxed_atomic<uint64_t> stat_packets_{0};
+    sync::relaxed_atomic<uint64_t> stat_calls_{0};
+    sync::relaxed_atomic<int32_t> stat_max_batch_{0};
+    sync::relaxed_atomic<uint64_t> stat_overflow_{0};
+
+    // Packet queue for threaded mode: a preallocated slab of fixed-size
+    // packet buffers, recycled after the packets have been dispatched.
+    // NB: the data block is always committed before the info block,
+    // so the reader only needs to check the latter.
+    struct packet_info {
+        int32_t size;
         ip_address address;
     };
-    using packet_queue = aoo::lockfree::unbounded_mpsc_queue<udp_packet>;
-    packet_queue packet_queue_;
+    int queue_capacity_ = default_queue_capacity;
+    int queue_packet_size_ = default_queue_packet_size;
+    aoo::lockfree::spsc_queue<AooByte> queue_data_;
+    aoo::lockfree::spsc_queue<packet_info> queue_info_;
+    std::vector<udp_recv_slot> queue_slots_; // see pop_packets()
+
+    // pending outgoing packets, see send()
+    struct send_entry {
+        size_t onset;
+        AooSize size;
+        ip_address address;
+    };
+    static const size_t max_send_batch = 64;
+    std::vector<AooByte> send_buffer_;
+    std::vector<send_entry> send_entries_;
+    std::vector<udp_packet_ref> send_packets_;
+    aoo::sync::mutex send_mutex_;
+
+    int do_flush();
 
     std::thread thread_;
     aoo::sync::event event_;
 
     receive_handler receive_handler_;
+    batch_handler batch_handler_;
 };
 
 } // aoo
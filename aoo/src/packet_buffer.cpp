@@ -42,7 +42,10 @@ int32_t sent_block::get_frame(int32_t index, AooByte *data, int32_t count) const
 //-------------------- history_buffer ----------------------//
 
 void history_buffer::clear(){
-    head_ = 0;
+    // invalidate all blocks, see find()
+    for (auto& b : buffer_) {
+        b.sequence = -1;
+    }
     size_ = 0;
 }
 
@@ -55,73 +58,82 @@ void history_buffer::resize(int32_t n){
 }
 
 sent_block * history_buffer::find(int32_t seq){
-    // the code below only works if the buffer is not empty!
-    if (size_ > 0){
-        // check if sequence number is outdated
-        // (tail always starts at buffer begin and becomes
-        // equal to head once the buffer is full)
-        auto head = buffer_.begin() + head_;
-        auto tail = (size_ == capacity()) ? head : buffer_.begin();
-        if (seq < tail->sequence){
+    // blocks are stored at index 'seq % capacity', see push()
+    if (size_ > 0 && seq >= 0){
+        auto& b = buffer_[seq % capacity()];
+        if (b.sequence == seq){
+            return &b;
+        } else if (b.sequence > seq){
+            // slot has already been overwritten by a newer block
             LOG_DEBUG("history buffer: block " << seq << " too old");
             return nullptr;
         }
-
-    #if 0
-        // linear search
-        auto end = buffer_.begin() + size_;
-        for (auto it = buffer_.begin(); it != end; ++it){
-            if (it->sequence == seq){
-                return &(*it);
-            }
-        }
-    #else
-        // binary search
-        auto dofind = [&](auto begin, auto end) -> sent_block * {
-            auto result = std::lower_bound(begin, end, seq, [](auto& a, auto& b){
-                return a.sequence < b;
-            });
-            if (result != end && result->sequence == seq){
-                return &(*result);
-            } else {
-                return nullptr;
-            }
-        };
-        if (head != tail){
-            // buffer not full, just search range [tail, head]
-            auto result = dofind(tail, head);
-            if (result){
-                return result;
-            }
-        } else {
-            // blocks are always pushed in chronological order,
-            // so the ranges [begin, head] and [head, end] will always be sorted.
-            auto result = dofind(buffer_.begin(), head);
-            if (!result){
-                result = dofind(head, buffer_.end());
-            }
-            if (result){
-                return result;
-            }
-        }
-    #endif
     }
 
     LOG_ERROR("history buffer: couldn't find block " << seq);
     return nullptr;
 }
 
-sent_block * history_buffer::push()
+sent_block * history_buffer::push(int32_t seq)
 {
     assert(!buffer_.empty());
-    auto old = head_++;
-    if (head_ >= capacity()){
-        head_ = 0;
-    }
+    assert(seq >= 0);
     if (size_ < capacity()){
         ++size_;
     }
-    return &buffer_[old];
+    // NB: the caller sets the sequence number, see sent_block::set()
+    return &buffer_[seq % capacity()];
+}
+
+//---------------------- parity_encoder ------------------------//
+
+void parity_encoder::write_header(int32_t total_size, int32_t msg_size, uint32_t flags,
+                                  double samplerate, uint64_t tt, AooByte *buffer) {
+    aoo::write_bytes<int32_t>(total_size, buffer);
+    aoo::write_bytes<int32_t>(msg_size, buffer);
+    aoo::write_bytes<uint32_t>(flags, buffer);
+    aoo::write_bytes<double>(samplerate, buffer);
+    aoo::write_bytes<uint64_t>(tt, buffer);
+}
+
+const AooByte* parity_encoder::read_header(const AooByte *buffer, data_packet& d) {
+    auto it = buffer;
+    d.total_size = aoo::read_bytes<int32_t>(it);
+    d.msg_size = aoo::read_bytes<int32_t>(it);
+    d.flags = aoo::read_bytes<uint32_t>(it);
+    d.samplerate = aoo::read_bytes<double>(it);
+    d.tt = aoo::read_bytes<uint64_t>(it);
+    return it;
+}
+
+void parity_encoder::xor_bytes(AooByte *dest, const AooByte *src, int32_t n) {
+    for (int32_t i = 0; i < n; ++i) {
+        dest[i] ^= src[i];
+    }
+}
+
+bool parity_encoder::add(const data_packet& d, int32_t window) {
+    if (count_ > 0 && (d.sequence != next_ || window != window_)) {
+        LOG_DEBUG("parity_encoder: discard incomplete window " << sequence_);
+        count_ = 0;
+    }
+    if (count_ == 0) {
+        sequence_ = d.sequence;
+        window_ = window;
+        buffer_.clear();
+    }
+    // grow (and zero-pad) as needed
+    auto size = header_size + d.total_size;
+    if (size > (int32_t)buffer_.size()) {
+        buffer_.resize(size, 0);
+    }
+    AooByte header[header_size];
+    auto sr = (d.flags & kAooBinMsgDataSampleRate) ? d.samplerate : 0;
+    write_header(d.total_size, d.msg_size, d.flags, sr, d.tt, header);
+    xor_bytes(buffer_.data(), header, header_size);
+    xor_bytes(buffer_.data() + header_size, d.data, d.total_size);
+    next_ = d.sequence + 1; // NB: can't overflow, see Source::send_data()
+    return ++count_ == window_;
 }
 
 //---------------------- received_block ------------------------//
@@ -143,7 +155,7 @@ void received_block::init(int32_t seq)
 
 void received_block::init(const data_packet& d)
 {
-    assert(frames_.size() == 0);
+    assert(frames_.size() == 0 && buffer_ == nullptr);
     assert((d.total_size > 0) == (d.num_frames > 0));
 
     auto prev_sequence = d.sequence;
@@ -164,6 +176,47 @@ void received_block::init(const data_packet& d)
     frames_.init(d.num_frames);
 }
 
+bool received_block::add_frame(int32_t index, int32_t offset, int32_t size,
+                               block_buffer *buffer, data_frame_allocator& alloc) {
+    assert(!placeholder() && !complete());
+    if (buffer->size() != total_size || buffer->num_frames() != num_frames()) {
+        LOG_ERROR("jitter buffer: block buffer does not match block " << sequence);
+        buffer->release(alloc);
+        return false;
+    }
+    if (!buffer_) {
+        if (received_frames > 0) {
+            // block already contains separate frames; this should not happen
+            // with well-formed packets, see block_assembler::write().
+            LOG_ERROR("jitter buffer: can't add block buffer to block " << sequence);
+            buffer->release(alloc);
+            return false;
+        }
+        buffer_ = buffer; // take reference
+    } else if (buffer != buffer_) {
+        // The frame has been written to another buffer because our buffer
+        // has been evicted from the block_assembler, so we copy it over.
+        // If we can't claim the frame, the network thread has already written
+        // it to our buffer and we will receive it later.
+        bool claimed = buffer_->claim_frame(index);
+        if (claimed) {
+            memcpy(buffer_->data() + offset, buffer->data() + offset, size);
+        }
+        buffer->release(alloc);
+        if (!claimed) {
+            return false;
+        }
+    } else {
+        buffer->release(alloc); // we already hold a reference
+    }
+#if AOO_DEBUG_JITTER_BUFFER
+    LOG_DEBUG("jitter buffer: add frame " << index << " with " << size << " bytes");
+#endif
+    received_bits_.set(index);
+    received_frames++;
+    return true;
+}
+
 bool received_block::update(double time, double interval) {
     if (timestamp_ > 0 && (time - timestamp_) < interval){
         return false;
@@ -200,71 +253,47 @@ void jitter_buffer::resize(int32_t n) {
     data_.resize(n);
 }
 
+int32_t jitter_buffer::index(int32_t seq) const {
+    auto i = seq % capacity();
+    return i < 0 ? i + capacity() : i;
+}
+
 received_block* jitter_buffer::find(int32_t seq) {
-    // first try the end, as we most likely have to complete the most recent block
-    if (empty()){
+    // blocks are stored at index 'seq % capacity', see push().
+    // NB: the buffer always contains consecutive blocks, so we only
+    // have to check if the sequence number is in range. The sequence number
+    // may come straight from the network, so compute the offset with 64-bit
+    // integers to avoid overflow.
+    if (empty()) {
         return nullptr;
-    } else if (back().sequence == seq){
-        return &back();
-    }
-    if (size_ < search_threshold) {
-        // linear search
-        if (head_ > tail_){
-            for (int32_t i = tail_; i < head_; ++i){
-                if (data_[i].sequence == seq){
-                    return &data_[i];
-                }
-            }
-        } else {
-            for (int32_t i = 0; i < head_; ++i){
-                if (data_[i].sequence == seq){
-                    return &data_[i];
-                }
-            }
-            for (int32_t i = tail_; i < capacity(); ++i){
-                if (data_[i].sequence == seq){
-                    return &data_[i];
-                }
-            }
-        }
+    }
+    auto offset = (int64_t)seq - (int64_t)front().sequence;
+    if (offset < 0 || offset >= size_) {
         return nullptr;
+    }
+    auto& b = data_[index(seq)];
+    if (b.sequence == seq){
+        return &b;
     } else {
-        // binary search
-        // (blocks are always pushed in chronological order)
-        auto dofind = [&](auto begin, auto end) -> received_block * {
-            auto result = std::lower_bound(begin, end, seq, [](auto& a, auto& b){
-                return a.sequence < b;
-            });
-            if (result != end && result->sequence == seq){
-                return &(*result);
-            } else {
-                return nullptr;
-            }
-        };
-
-        auto begin = data_.data();
-        if (head_ > tail_){
-            // [tail, head]
-            return dofind(begin + tail_, begin + head_);
-        } else {
-            // [begin, head] + [tail, end]
-            auto result = dofind(begin, begin + head_);
-            if (!result){
-                result = dofind(begin + tail_, begin + data_.capacity());
-            }
-            return result;
-        }
+        LOG_ERROR("jitter buffer: block " << seq << " has wrong sequence number ("
+                  << b.sequence << ")");
+        return nullptr;
     }
 }
 
 received_block* jitter_buffer::push(int32_t seq){
     assert(!full());
+    assert((last_pushed_ == sentinel) || ((seq - last_pushed_) == 1));
+    if (empty()){
+        // realign so that the block index matches the sequence number
+        head_ = tail_ = index(seq);
+    }
     auto current = head_;
+    assert(current == index(seq));
     if (++head_ == capacity()){
         head_ = 0;
     }
     size_++;
-    assert((last_pushed_ == sentinel) || ((seq - last_pushed_) == 1));
     last_pushed_ = seq;
     auto block = &data_[current];
 #if 0
@@ -335,6 +364,245 @@ jitter_buffer::const_iterator jitter_buffer::end() const {
     return const_iterator(this);
 }
 
+//----------------------- block_assembler ----------------------//
+
+block_assembler::~block_assembler() {
+    reset();
+}
+
+void block_assembler::reset() {
+    for (auto& s : slots_) {
+        if (s.buffer) {
+            s.buffer->release(alloc_);
+        }
+        s = slot{};
+    }
+}
+
+void block_assembler::resize(int32_t n) {
+    reset();
+    slots_.resize(n);
+}
+
+int32_t block_assembler::frame_offset(const data_packet& d) {
+    // all frames have the same size, except for the last one.
+    if (d.frame_index < 0 || d.frame_index >= d.num_frames
+            || d.size <= 0 || d.size > d.total_size) {
+        return -1;
+    }
+    if (d.frame_index == d.num_frames - 1) {
+        return d.total_size - d.size;
+    } else {
+        auto offset = (int64_t)d.frame_index * d.size;
+        return (offset + d.size) <= d.total_size ? offset : -1;
+    }
+}
+
+block_buffer* block_assembler::write(const data_packet& d, bool& duplicate) {
+    duplicate = false;
+    if (slots_.empty()) {
+        return nullptr;
+    }
+    auto offset = frame_offset(d);
+    if (offset < 0) {
+        return nullptr;
+    }
+    block_buffer *buffer;
+    {
+        sync::scoped_lock<sync::spinlock> lock(lock_);
+        auto index = d.sequence % (int32_t)slots_.size();
+        auto& s = slots_[index < 0 ? index + slots_.size() : index];
+        if (s.buffer && !s.buffer->match(d.sequence, d.total_size, d.num_frames)) {
+            // evict older block
+            s.buffer->release(alloc_);
+            s = slot{};
+        }
+        if (!s.buffer) {
+            s.buffer = block_buffer::create(alloc_, d.sequence, d.total_size, d.num_frames);
+            if (!s.buffer) {
+                return nullptr;
+            }
+        }
+        buffer = s.buffer;
+        if (!buffer->claim_frame(d.frame_index)) {
+            duplicate = true;
+            return nullptr;
+        }
+        if (++s.count == d.num_frames) {
+            // block is complete: pass our reference to the caller
+            s = slot{};
+        } else {
+            buffer->retain(); // for the caller
+        }
+    }
+    // write frame without holding the lock
+    memcpy(buffer->data() + offset, d.data, d.size);
+    return buffer;
+}
+
+//----------------------- parity_buffer ----------------------//
+
+parity_buffer::~parity_buffer() {
+    reset();
+}
+
+void parity_buffer::reset() {
+    for (auto& e : data_) {
+        e.block.clear(alloc_);
+        e.count = 0;
+    }
+    size_ = 0;
+}
+
+void parity_buffer::resize(int32_t n) {
+    reset();
+    data_.resize(n);
+}
+
+parity_buffer::entry* parity_buffer::find(int32_t seq) {
+    if (size_ > 0) {
+        for (auto& e : data_) {
+            if (e.count > 0 && e.block.sequence == seq) {
+                return &e;
+            }
+        }
+    }
+    return nullptr;
+}
+
+parity_buffer::entry* parity_buffer::push(int32_t seq, int32_t count) {
+    assert(!data_.empty());
+    entry *result = nullptr;
+    for (auto& e : data_) {
+        if (e.count == 0) {
+            result = &e;
+            break;
+        } else if (!result || e.block.sequence < result->block.sequence) {
+            result = &e;
+        }
+    }
+    if (result->count > 0) {
+        LOG_DEBUG("parity buffer: discard parity block " << result->block.sequence);
+        remove(*result);
+    }
+    result->count = count;
+    size_++;
+    return result;
+}
+
+void parity_buffer::remove(entry& e) {
+    assert(e.count > 0);
+    e.block.clear(alloc_);
+    e.count = 0;
+    size_--;
+}
+
+int32_t parity_buffer::recover(jitter_buffer& jb, double samplerate) {
+    auto oldest = jb.last_popped();
+    auto newest = jb.last_pushed();
+    int32_t count = 0;
+    for (auto& p : data_) {
+        if (p.count == 0) {
+            continue; // unused
+        }
+        auto first = p.block.sequence;
+        auto last = first + p.count - 1;
+        if (first <= oldest) {
+            // NB: we can't use blocks that have already been consumed
+            LOG_DEBUG("parity buffer: discard parity block " << first);
+            remove(p);
+            continue;
+        }
+        if (last > newest) {
+            continue; // wait for remaining blocks
+        }
+        // find incomplete blocks
+        received_block *missing = nullptr;
+        int32_t num_missing = 0;
+        for (auto seq = first; seq <= last; ++seq) {
+            auto b = jb.find(seq);
+            if (!b) {
+                // e.g. the window started before the stream
+                num_missing = -1;
+                break;
+            } else if (!b->complete()) {
+                missing = b;
+                num_missing++;
+            }
+        }
+        if (num_missing <= 0) {
+            // nothing to do (or nothing we can do)
+            remove(p);
+        } else if (num_missing == 1 && p.block.complete()) {
+            if (recover_block(p, jb, *missing, samplerate)) {
+                LOG_VERBOSE("AooSink: recovered block " << missing->sequence);
+                count++;
+            }
+            remove(p);
+        }
+        // otherwise wait for more frames (e.g. resent data)
+    }
+    return count;
+}
+
+bool parity_buffer::recover_block(entry& p, jitter_buffer& jb,
+                                  received_block& block, double samplerate) {
+    // XOR the parity block with all other blocks of the window
+    auto size = p.block.total_size;
+    auto data = (AooByte *)alloca(size);
+    auto temp = (AooByte *)alloca(size);
+    p.block.copy_frames(data);
+    auto first = p.block.sequence;
+    for (auto seq = first; seq < first + p.count; ++seq) {
+        if (seq == block.sequence) {
+            continue;
+        }
+        auto b = jb.find(seq);
+        auto n = parity_encoder::header_size + b->total_size;
+        if (n > size) {
+            LOG_ERROR("AooSink: block " << seq << " exceeds parity block size");
+            return false;
+        }
+        // NB: the block samplerate has been replaced with the
+        // nominal samplerate if it has not been transmitted.
+        auto sr = (b->flags & kAooBinMsgDataSampleRate) ? b->samplerate : 0;
+        parity_encoder::write_header(b->total_size, b->message_size,
+                                     b->flags, sr, b->tt, temp);
+        if (b->total_size > 0) {
+            b->copy_frames(temp + parity_encoder::header_size);
+        }
+        parity_encoder::xor_bytes(data, temp, n);
+    }
+    // reconstruct the block
+    data_packet d;
+    auto it = parity_encoder::read_header(data, d);
+    d.sequence = block.sequence;
+    d.channel = p.block.channel;
+    if (d.total_size < 0 || d.total_size > (size - parity_encoder::header_size)
+            || d.msg_size < 0 || d.msg_size > d.total_size) {
+        LOG_ERROR("AooSink: could not recover block " << block.sequence);
+        return false;
+    }
+    if (!(d.flags & kAooBinMsgDataSampleRate)) {
+        d.samplerate = samplerate;
+    }
+    auto maxframesize = (int32_t)data_frame_allocator::max_bin_size;
+    auto dv = std::div(d.total_size, maxframesize);
+    d.num_frames = dv.quot + (dv.rem != 0);
+    // replace any frames we might have received so far
+    block.clear(alloc_);
+    block.init(d);
+    for (int32_t i = 0; i < d.num_frames; ++i) {
+        auto onset = i * maxframesize;
+        auto n = std::min<int32_t>(d.total_size - onset, maxframesize);
+        auto frame = alloc_.allocate(n);
+        memcpy(frame->data, it + onset, n);
+        block.add_frame(i, frame);
+    }
+    assert(block.complete());
+    return true;
+}
+
 std::ostream& operator<<(std::ostream& os, const jitter_buffer& jb){
     os << "jitterbuffer (" << jb.size() << " / " << jb.capacity() << "): ";
     for (auto& b : jb){
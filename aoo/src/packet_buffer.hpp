@@ -3,6 +3,10 @@
 #include "detail.hpp"
 #include "data_frame.hpp"
 
+#include "common/sync.hpp"
+
+#include <bitset>
+
 namespace aoo {
 
 struct data_frame;
@@ -65,13 +69,56 @@ public:
     }
     void resize(int32_t n);
     sent_block * find(int32_t seq);
-    sent_block * push();
+    sent_block * push(int32_t seq);
 private:
     aoo::vector<sent_block> buffer_;
-    int32_t head_ = 0;
     int32_t size_ = 0;
 };
 
+//---------------------------- parity_encoder ------------------------------//
+
+// Computes the XOR parity over a window of consecutive blocks.
+// Every block is serialized as total_size (int32), msg_size (int32),
+// flags (uint32), samplerate (float64), tt (uint64), data..., and padded
+// with zeros to the size of the largest block in the window. The sink
+// can rebuild a single missing block from the parity block and the other
+// blocks in the window, see parity_buffer::recover().
+// NB: the samplerate is 0 if it is not transmitted, i.e. if the
+// kAooBinMsgDataSampleRate flag is not set.
+class parity_encoder {
+public:
+    static constexpr int32_t header_size = 28;
+    // see binary parity message
+    static constexpr int32_t max_window = 255;
+
+    static void write_header(int32_t total_size, int32_t msg_size, uint32_t flags,
+                             double samplerate, uint64_t tt, AooByte *buffer);
+
+    // returns the data onset
+    static const AooByte* read_header(const AooByte *buffer, data_packet& d);
+
+    static void xor_bytes(AooByte *dest, const AooByte *src, int32_t n);
+
+    // returns true if the window is complete; a gap in the
+    // sequence numbers (e.g. after an xrun) starts a new window.
+    bool add(const data_packet& d, int32_t window);
+
+    void reset() {
+        count_ = 0;
+    }
+
+    int32_t sequence() const { return sequence_; }
+    int32_t count() const { return count_; }
+    const AooByte* data() const { return buffer_.data(); }
+    int32_t size() const { return buffer_.size(); }
+private:
+    aoo::vector<AooByte> buffer_;
+    int32_t sequence_ = 0;
+    int32_t next_ = 0;
+    int32_t count_ = 0;
+    int32_t window_ = 0;
+};
+
 
 
 //---------------------------- received_block ------------------------------//
@@ -92,17 +139,26 @@ public:
 
     void clear(data_frame_allocator& alloc) {
         frames_.clear(alloc);
+        if (buffer_) {
+            buffer_->release(alloc);
+            buffer_ = nullptr;
+            received_bits_.reset();
+        }
         received_frames = 0;
     }
 
     int32_t num_frames() const { return frames_.size(); }
 
     bool has_frame(int32_t index) const {
-        return frames_.has_frame(index);
+        if (buffer_) {
+            return received_bits_.test(index);
+        } else {
+            return frames_.has_frame(index);
+        }
     }
 
     void add_frame(int32_t index, data_frame* frame) {
-        assert(!placeholder() && !complete());
+        assert(!placeholder() && !complete() && !buffer_);
     #if AOO_DEBUG_JITTER_BUFFER
         LOG_DEBUG("jitter buffer: add frame " << index << " with " << frame->size << " bytes");
     #endif
@@ -110,9 +166,27 @@ public:
         received_frames++;
     }
 
+    // add a frame that has already been written to a block buffer,
+    // see block_assembler. Takes ownership of the buffer reference.
+    // Returns false if the frame could not be added.
+    bool add_frame(int32_t index, int32_t offset, int32_t size,
+                   block_buffer* buffer, data_frame_allocator& alloc);
+
     void copy_frames(AooByte* buffer) {
         assert(complete());
-        frames_.copy_frames(buffer, total_size);
+        if (buffer_) {
+            memcpy(buffer, buffer_->data(), total_size);
+        } else {
+            frames_.copy_frames(buffer, total_size);
+        }
+    }
+
+    bool has_buffer() const { return buffer_ != nullptr; }
+
+    // the contiguous block data or nullptr, see block_buffer
+    const AooByte* data() const {
+        assert(complete());
+        return buffer_ ? buffer_->data() : nullptr;
     }
 
     int32_t resend_count() const { return num_tries_; }
@@ -143,6 +217,8 @@ private:
     bool resent_ = false;
     double timestamp_ = 0;
     data_frame_storage frames_;
+    block_buffer *buffer_ = nullptr;
+    std::bitset<block_buffer::frame_limit> received_bits_;
 };
 
 //---------------------------- jitter_buffer ------------------------------//
@@ -191,7 +267,6 @@ public:
     using iterator = base_iterator<received_block, jitter_buffer>;
     using const_iterator = base_iterator<const received_block, const jitter_buffer>;
 
-    static constexpr int32_t search_threshold = 10;
     static constexpr int32_t sentinel = INT32_MIN;
 
     jitter_buffer(data_frame_allocator& alloc) : alloc_(alloc) {}
@@ -244,6 +319,8 @@ public:
 
     friend std::ostream& operator<<(std::ostream& os, const jitter_buffer& b);
 private:
+    int32_t index(int32_t seq) const;
+
     data_frame_allocator& alloc_;
     aoo::vector<received_block> data_;
     int32_t size_ = 0;
@@ -253,4 +330,97 @@ private:
     int32_t last_popped_ = -1;
 };
 
+//---------------------------- block_assembler ------------------------------//
+
+// Reassembles incoming data frames on the network thread(s) directly into
+// contiguous block buffers, so that the audio thread doesn't have to copy
+// the frames again. Block buffers are stored at index 'seq % capacity';
+// a newer block simply evicts an older one. If an evicted block receives
+// more frames, these go to a new block buffer and the audio thread copies
+// them over, see received_block::add_frame().
+// The block buffers are still handed to the audio thread with the packet
+// queue, because the audio thread needs every frame for the jitter buffer
+// logic (resend requests, jitter estimation, etc.).
+// NB: the spinlock protects the slot table against concurrent write() calls
+// from several network threads and is never taken by the audio thread.
+class block_assembler {
+public:
+    block_assembler(data_frame_allocator& alloc) : alloc_(alloc) {}
+    ~block_assembler();
+
+    // NB: must not be called concurrently with write()!
+    // The sink calls this with the source_desc writer lock,
+    // see source_desc::update().
+    void reset();
+
+    // NB: see reset()
+    void resize(int32_t n);
+
+    // Write a frame to its block buffer and return a new reference to the
+    // buffer. Returns nullptr if the frame has already been written
+    // ('duplicate' is set to true) or if the block can't be assembled,
+    // e.g. because it is too large.
+    block_buffer* write(const data_packet& d, bool& duplicate);
+
+    // returns -1 if the frame does not fit into the block
+    static int32_t frame_offset(const data_packet& d);
+private:
+    struct slot {
+        block_buffer *buffer = nullptr;
+        int32_t count = 0; // number of written frames
+    };
+    data_frame_allocator& alloc_;
+    aoo::vector<slot> slots_;
+    sync::spinlock lock_;
+};
+
+//---------------------------- parity_buffer ------------------------------//
+
+// Holds incoming parity blocks until their window is complete
+// or has been consumed, see recover().
+class parity_buffer {
+public:
+    struct entry {
+        received_block block;
+        int32_t count = 0; // number of blocks in the window; 0 = unused
+    };
+
+    parity_buffer(data_frame_allocator& alloc) : alloc_(alloc) {}
+    ~parity_buffer();
+
+    void reset();
+
+    void resize(int32_t n);
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    entry* find(int32_t seq);
+
+    // NB: replaces the oldest entry if the buffer is full
+    entry* push(int32_t seq, int32_t count);
+
+    void remove(entry& e);
+
+    // Rebuild missing blocks in the jitter buffer. A parity window can be
+    // recovered if all other blocks of the window are complete. Parity blocks
+    // are discarded once the window is complete or has been (partially)
+    // consumed. 'samplerate' is the nominal samplerate, which is used if the
+    // source does not send its real samplerate. Returns the number of
+    // recovered blocks.
+    int32_t recover(jitter_buffer& jb, double samplerate);
+
+    // NB: also iterates over unused entries!
+    entry* begin() { return data_.data(); }
+    entry* end() { return data_.data() + data_.size(); }
+private:
+    bool recover_block(entry& p, jitter_buffer& jb, received_block& block,
+                       double samplerate);
+
+    data_frame_allocator& alloc_;
+    aoo::vector<entry> data_;
+    int32_t size_ = 0;
+};
+
 } // aoo
@@ -2,14 +2,96 @@
 #include "common/utils.hpp"
 
 #include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// SIMD dot product is only provided for 32-bit samples.
+#if AOO_SAMPLE_SIZE == 32
+# if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  define AOO_RESAMPLER_SSE 1
+#  include <xmmintrin.h>
+# elif defined(__aarch64__) && defined(__ARM_NEON)
+#  define AOO_RESAMPLER_NEON 1
+#  include <arm_neon.h>
+# endif
+#endif
+
+#ifndef AOO_RESAMPLER_SSE
+# define AOO_RESAMPLER_SSE 0
+#endif
+#ifndef AOO_RESAMPLER_NEON
+# define AOO_RESAMPLER_NEON 0
+#endif
 
 namespace aoo {
 
+namespace {
+
+// dot product of two arrays; 'n' must be a multiple of 8.
+inline AooSample dot_product(const AooSample *a, const AooSample *b, int32_t n) {
+#if AOO_RESAMPLER_SSE
+    auto sum0 = _mm_setzero_ps();
+    auto sum1 = _mm_setzero_ps();
+    for (int32_t i = 0; i < n; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    sum0 = _mm_add_ps(sum0, sum1);
+    // horizontal sum
+    auto shuf = _mm_shuffle_ps(sum0, sum0, _MM_SHUFFLE(2, 3, 0, 1));
+    auto sums = _mm_add_ps(sum0, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+#elif AOO_RESAMPLER_NEON
+    auto sum0 = vdupq_n_f32(0);
+    auto sum1 = vdupq_n_f32(0);
+    for (int32_t i = 0; i < n; i += 8) {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+#else
+    // use several accumulators so that the compiler can vectorize the loop
+    AooSample sum[4] = { 0, 0, 0, 0 };
+    for (int32_t i = 0; i < n; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+}
+
+// zeroth order modified Bessel function of the first kind
+double bessel_i0(double x) {
+    double sum = 1;
+    double term = 1;
+    auto y = x * x * 0.25;
+    for (int k = 1; k < 100; ++k) {
+        term *= y / (k * k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+// Kaiser window parameter; gives about 80 dB stopband attenuation.
+constexpr double kaiser_beta = 8.0;
+
+} // namespace
+
 void dynamic_resampler::free_buffer() {
     if (buffer_) {
-        auto alloc_size = (size_ + extra_space) * nchannels_ * sizeof(AooSample);
+        auto alloc_size = (size_ + extra_space_) * nchannels_ * sizeof(AooSample);
         // undo buffer shift! see setup()
-        void *ptr = buffer_ - buffer_shift * nchannels_;
+        void *ptr = buffer_ - buffer_shift_ * frame_stride();
         aoo::deallocate(ptr, alloc_size);
         buffer_ = nullptr;
         size_ = 0;
@@ -28,25 +110,66 @@ const char* dynamic_resampler::method_to_string(resample_method method) {
         return "linear";
     case resample_method::cubic:
         return "cubic";
+    case resample_method::polyphase:
+        return "polyphase";
     default:
         return "?";
     }
 }
 
+// Create a bank of windowed sinc filters, one for each fractional position
+// ("phase"), plus an extra filter so that we can interpolate between adjacent
+// phases. 'cutoff' is relative to the input samplerate.
+// Each filter is normalized to unity gain at DC.
+void dynamic_resampler::make_filter_bank(double cutoff) {
+    if (cutoff == filter_cutoff_ && !filter_bank_.empty()) {
+        return; // nothing to do
+    }
+    const auto half = latency_polyphase;
+    const auto scale = 1.0 / bessel_i0(kaiser_beta);
+    filter_bank_.resize((polyphase_phases + 1) * polyphase_taps);
+    for (int32_t i = 0; i <= polyphase_phases; ++i) {
+        auto fract = (double)i / (double)polyphase_phases;
+        auto filter = filter_bank_.data() + i * polyphase_taps;
+        double sum = 0;
+        for (int32_t j = 0; j < polyphase_taps; ++j) {
+            // distance between the tap and the read position;
+            // the first tap is at -(half - 1), see read().
+            auto x = (double)(j - (half - 1)) - fract;
+            // windowed sinc
+            auto t = 2.0 * M_PI * cutoff * x;
+            auto sinc = (std::abs(t) > 1e-12) ? std::sin(t) / t : 1.0;
+            auto w = x / half;
+            auto window = (w * w < 1.0) ?
+                bessel_i0(kaiser_beta * std::sqrt(1.0 - w * w)) * scale : 0.0;
+            auto value = sinc * window;
+            filter[j] = value;
+            sum += value;
+        }
+        for (int32_t j = 0; j < polyphase_taps; ++j) {
+            filter[j] /= sum;
+        }
+    }
+    filter_cutoff_ = cutoff;
+}
+
 // extra space for samplerate fluctuations and non-pow-of-2 blocksizes.
 // must be larger than 2!
 #define AOO_RESAMPLER_SPACE 2.5
 
 void dynamic_resampler::setup(int32_t nfrom, int32_t nto, bool fixed_n,
                               int32_t srfrom, int32_t srto, bool fixed_sr,
-                              int32_t nchannels, AooResampleMethod mode) {
+                              int32_t nchannels, AooResampleMethod mode,
+                              bool planar) {
     ideal_ratio_ = (double)srto / (double)srfrom;
     fixed_sr_ = fixed_sr;
     latency_ = 0;
     if (fixed_sr && srfrom == srto) {
         method_ = resample_method::none; // no resampling required
-    } else if (fixed_sr && srto < srfrom && (srfrom % srto) == 0) {
+    } else if (fixed_sr && srto < srfrom && (srfrom % srto) == 0
+               && mode != kAooResamplePolyphase) {
         // downsampling with (fixed) integer ratio
+        // NB: the polyphase filter always needs to band-limit the signal!
         method_ = resample_method::skip;
     } else {
         switch (mode) {
@@ -61,6 +184,10 @@ void dynamic_resampler::setup(int32_t nfrom, int32_t nto, bool fixed_n,
             method_ = resample_method::cubic;
             latency_ = latency_cubic;
             break;
+        case kAooResamplePolyphase:
+            method_ = resample_method::polyphase;
+            latency_ = latency_polyphase;
+            break;
         default:
             LOG_ERROR("bad resample method");
             method_ = resample_method::linear;
@@ -82,30 +209,58 @@ void dynamic_resampler::setup(int32_t nfrom, int32_t nto, bool fixed_n,
             // upsampling
             size = std::max<int32_t>(nfrom, nto);
         }
+        // Add extra frames and shift buffer by one frame to avoid index bound
+        // checks in linear and cubic interpolation. These extra frames mirror
+        // the first two frames resp. the last frame. See read() and write().
+        // The polyphase filter needs 'latency_polyphase - 1' frames before
+        // and 'latency_polyphase' frames after the read position.
+        int32_t shift, extra;
+        if (method_ == resample_method::polyphase) {
+            shift = latency_polyphase - 1;
+            extra = polyphase_taps - 1;
+        } else {
+            shift = 1;
+            extra = 3;
+        }
         size *= AOO_RESAMPLER_SPACE;
+        // make room for the interpolation latency and for the frames
+        // before the read position, which write() must not overwrite.
+        size += latency_ + shift - 1;
     #if AOO_DEBUG_RESAMPLER
         LOG_DEBUG("resampler setup: reblock from " << nfrom << " to " << nto
                   << (fixed_n ? " (fixed)" : "") << ", resample from " << srfrom
                   << " to " << srto << (fixed_sr ? " (fixed)" : "") << ", method: "
                   << method_to_string(method_) << ", capacity: " << size);
     #endif
-        // Add extra frames and shift buffer by one frame to avoid index bound
-        // checks in linear and cubic interpolation. These extra frames mirror
-        // the first two frames resp. the last frame. See read() and write().
-        auto old_nsamples = buffer_ ? (size_ + extra_space) * nchannels_ : 0;
-        auto nsamples = (size + extra_space) * nchannels;
-        if (old_nsamples != nsamples) {
+        // With planar data, every channel has its own extra frames.
+        auto old_nsamples = buffer_ ? (size_ + extra_space_) * nchannels_ : 0;
+        auto nsamples = (size + extra) * nchannels;
+        if (old_nsamples != nsamples || buffer_shift_ != shift || planar_ != planar) {
             // reallocate buffer
             free_buffer();
             auto buf = (AooSample*)aoo::allocate(nsamples * sizeof(AooSample));
         #if 1
             std::fill(buf, buf + nsamples, 0);
         #endif
-            buffer_ = buf + buffer_shift * nchannels;
+            buffer_ = buf + shift * (planar ? 1 : nchannels);
         }
         size_ = size;
+        buffer_shift_ = shift;
+        extra_space_ = extra;
     }
     nchannels_ = nchannels;
+    planar_ = planar;
+
+    if (method_ == resample_method::polyphase) {
+        // The cutoff frequency is relative to the input samplerate.
+        // For downsampling, we must filter below the output Nyquist frequency.
+        // The Kaiser window transition width is (A - 8) / (2.285 * 2pi * N),
+        // with A = beta / 0.1102 + 8.7; we center it below the Nyquist frequency.
+        auto atten = kaiser_beta / 0.1102 + 8.7;
+        auto transition = (atten - 8.0) / (2.285 * 2.0 * M_PI * polyphase_taps);
+        auto cutoff = 0.5 * std::min<double>(1.0, ideal_ratio_) - 0.5 * transition;
+        make_filter_bank(cutoff);
+    }
 
     if (method_ != resample_method::none) {
         update(srfrom, srto);
@@ -114,15 +269,48 @@ void dynamic_resampler::setup(int32_t nfrom, int32_t nto, bool fixed_n,
     reset();
 }
 
+void dynamic_resampler::zero_frames(int32_t onset, int32_t nframes) {
+    if (planar_) {
+        auto stride = channel_stride();
+        for (int i = 0; i < nchannels_; ++i) {
+            auto buf = buffer_ + i * stride;
+            std::fill(buf + onset, buf + onset + nframes, 0);
+        }
+    } else {
+        std::fill(buffer_ + onset * nchannels_,
+                  buffer_ + (onset + nframes) * nchannels_, 0);
+    }
+}
+
+void dynamic_resampler::copy_frames(int32_t from, int32_t to, int32_t nframes) {
+    if (planar_) {
+        auto stride = channel_stride();
+        for (int i = 0; i < nchannels_; ++i) {
+            auto buf = buffer_ + i * stride;
+            std::copy(buf + from, buf + from + nframes, buf + to);
+        }
+    } else {
+        std::copy(buffer_ + from * nchannels_, buffer_ + (from + nframes) * nchannels_,
+                  buffer_ + to * nchannels_);
+    }
+}
+
 void dynamic_resampler::reset() {
-    if (method_ == resample_method::cubic) {
+    if (method_ == resample_method::polyphase) {
+        assert(buffer_ != nullptr);
+        // write 'latency_polyphase' frames of zero(s);
+        // also clear the mirrored frames before the buffer.
+        zero_frames(-buffer_shift_, buffer_shift_ + latency_polyphase);
+        wrpos_ = latency_polyphase;
+        rdpos_ = 0.0;
+        balance_ = latency_polyphase;
+    } else if (method_ == resample_method::cubic) {
         assert(buffer_ != nullptr);
         // write two frames of zero(s)
-        std::fill(buffer_, buffer_ + latency_cubic * nchannels_, 0);
+        zero_frames(0, latency_cubic);
         // set last frame to zero and mirror
-        auto end = buffer_ + size_ * nchannels_;
-        std::fill(end - nchannels_, end, 0);
-        std::fill(buffer_ - buffer_shift * nchannels_, buffer_, 0);
+        zero_frames(size_ - 1, 1);
+        zero_frames(-buffer_shift_, buffer_shift_);
         wrpos_ = latency_cubic;
         rdpos_ = 0.0;
         balance_ = latency_cubic;
@@ -132,7 +320,7 @@ void dynamic_resampler::reset() {
         // TODO: the latency could be reduced further.
         // For example, with a (fixed?) upsampling factor of 2
         // we can actually start reading at 0.5.
-        std::fill(buffer_, buffer_ + latency_linear * nchannels_, 0);
+        zero_frames(0, latency_linear);
         wrpos_ = latency_linear;
         rdpos_ = 0.0;
         balance_ = latency_linear;
@@ -154,70 +342,145 @@ void dynamic_resampler::update(double srfrom, double srto) {
 
 bool dynamic_resampler::write(const AooSample *data, int32_t nframes) {
     auto space = (int32_t)((double)size_ - balance_);
-    // leave extra space for cubic interpolation
-    if ((space - 1) < nframes) {
+    // keep the frames before the read position, see setup() and read()
+    if ((space - buffer_shift_) < nframes) {
         return false;
     }
     auto pos = wrpos_;
     auto end = wrpos_ + nframes;
-    if (end > size_) {
-        auto split = size_ - pos;
+    auto split = std::min<int32_t>(end, size_) - pos;
+    if (planar_) {
+        auto stride = channel_stride();
+        for (int i = 0; i < nchannels_; ++i) {
+            auto in = data + i * nframes;
+            auto buf = buffer_ + i * stride;
+            std::copy(in, in + split, buf + pos);
+            std::copy(in + split, in + nframes, buf);
+        }
+    } else {
         std::copy(data, data + (split * nchannels_), buffer_ + (pos * nchannels_));
         std::copy(data + (split * nchannels_), data + (nframes * nchannels_), buffer_);
+    }
+    if (end >= size_) {
         wrpos_ = end - size_;
     } else {
-        std::copy(data, data + (nframes * nchannels_), buffer_ + (pos * nchannels_));
-        wrpos_ = (end == size_) ? 0 : end;
+        wrpos_ = end;
     }
     if (method_ != resample_method::none) {
-        auto bufstart = buffer_ - buffer_shift * nchannels_;
-        auto bufend = buffer_ + size_ * nchannels_;
-        if (pos < 2 || end > size_) {
-            // mirror first two samples (if either one has been written)
-            std::copy(buffer_, buffer_ + 2 * nchannels_, bufend);
+        auto head = buffer_shift_;
+        auto tail = extra_space_ - buffer_shift_;
+        if (pos < tail || end > size_) {
+            // mirror first frame(s) (if any of them has been written)
+            copy_frames(0, size_, tail);
         }
         if (end >= size_) {
-            // mirror last sample
-            std::copy(bufend - nchannels_, bufend, bufstart);
+            // mirror last frame(s)
+            copy_frames(size_ - head, -head, head);
         }
     }
     balance_ += nframes;
     return true;
 }
 
+// NB: the interpolation loops use separate frame and channel strides,
+// so that they work for both interleaved and planar buffers/data.
 bool dynamic_resampler::read(AooSample *data, int32_t nframes) {
+    auto nchannels = (int32_t)nchannels_;
+    // buffer strides
+    auto fs = frame_stride();
+    auto cs = channel_stride();
+    // output strides
+    auto ofs = planar_ ? 1 : nchannels;
+    auto ocs = planar_ ? nframes : 1;
+
     switch (method_) {
+    case resample_method::polyphase: {
+        // polyphase windowed sinc interpolation
+        auto fadvance = advance_;
+        auto balance = balance_;
+        auto readframes = (double)nframes * fadvance;
+        if ((balance - (double)latency_polyphase) < readframes) {
+            return false;
+        }
+        auto pos = rdpos_;
+        auto start = pos;
+        auto limit = (double)size_;
+        auto bank = filter_bank_.data();
+        const auto ntaps = polyphase_taps;
+        alignas(16) AooSample coeffs[polyphase_taps];
+        alignas(16) AooSample frames[polyphase_taps];
+
+        for (int i = 0; i < nframes; ++i) {
+            auto ipos = (int32_t)pos;
+            // interpolate between the two nearest filters; this works for
+            // any fractional position, so we can follow the drift ratio.
+            auto phase = (pos - (double)ipos) * polyphase_phases;
+            auto iphase = (int32_t)phase;
+            auto fract = (AooSample)(phase - (double)iphase);
+            auto c0 = bank + iphase * ntaps;
+            auto c1 = c0 + ntaps;
+            for (int k = 0; k < ntaps; ++k) {
+                coeffs[k] = c0[k] + (c1[k] - c0[k]) * fract;
+            }
+            auto in = buffer_ + (ipos - (latency_polyphase - 1)) * fs;
+            if (planar_ || nchannels == 1) {
+                // contiguous
+                for (int j = 0; j < nchannels; ++j) {
+                    data[i * ofs + j * ocs] = dot_product(coeffs, in + j * cs, ntaps);
+                }
+            } else {
+                for (int j = 0; j < nchannels; ++j) {
+                    // deinterleave
+                    for (int k = 0; k < ntaps; ++k) {
+                        frames[k] = in[k * nchannels + j];
+                    }
+                    data[i * ofs + j] = dot_product(coeffs, frames, ntaps);
+                }
+            }
+            pos += fadvance;
+            if (pos >= limit) {
+                pos -= limit;
+            }
+        }
+    #if 1
+        // avoid cumulative floating point error
+        pos = start + readframes;
+        if (pos >= limit) {
+            pos -= limit;
+        }
+    #endif
+        rdpos_ = pos;
+        balance_ = balance - readframes;
+        break;
+    }
     case resample_method::cubic: {
-        // linear interpolation
+        // cubic interpolation
         auto fadvance = advance_;
         auto balance = balance_;
         auto readframes = (double)nframes * fadvance;
         if ((balance - (double)latency_cubic) < readframes) {
             return false;
         }
-        auto size = size_;
-        auto nchannels = (int32_t)nchannels_;
         auto pos = rdpos_;
         auto start = pos;
-        auto limit = (double)size;
-        auto nsamples = nframes * nchannels;
+        auto limit = (double)size_;
         const AooSample one_over_six = 1./6.;
 
-        for (int i = 0; i < nsamples; i += nchannels) {
+        for (int i = 0; i < nframes; ++i) {
             auto ipos = (int32_t)pos;
             auto fract = (AooSample)(pos - (double)ipos);
-            auto ia = (ipos - 1) * nchannels;
-            auto ib = (ipos) * nchannels;
-            auto ic = (ipos + 1) * nchannels;
-            auto id = (ipos + 2) * nchannels;
+            auto ia = (ipos - 1) * fs;
+            auto ib = (ipos) * fs;
+            auto ic = (ipos + 1) * fs;
+            auto id = (ipos + 2) * fs;
             for (int j = 0; j < nchannels; ++j) {
-                auto a = buffer_[ia + j];
-                auto b = buffer_[ib + j];
-                auto c = buffer_[ic + j];
-                auto d = buffer_[id + j];
+                auto a = buffer_[ia + j * cs];
+                auto b = buffer_[ib + j * cs];
+                auto c = buffer_[ic + j * cs];
+                auto d = buffer_[id + j * cs];
                 // taken from Pd's [tabread4~]
                 auto cminusb = c - b;
-                data[i + j] = b + fract * (
+                data[i * ofs + j * ocs] = b + fract * (
                     cminusb - one_over_six * ((AooSample)1.0 - fract) * (
                         (d - a - (AooSample)3.0 * cminusb) * fract +
                         (d + a * (AooSample)2.0 - b * (AooSample)3.0)
@@ -248,21 +511,18 @@ bool dynamic_resampler::read(AooSample *data, int32_t nframes) {
         if ((balance - (double)latency_linear) < readframes) {
             return false;
         }
-        auto size = size_;
-        auto nchannels = (int32_t)nchannels_;
         auto pos = rdpos_;
         auto start = pos;
-        auto limit = (double)size;
-        auto nsamples = nframes * nchannels;
-        for (int i = 0; i < nsamples; i += nchannels) {
+        auto limit = (double)size_;
+        for (int i = 0; i < nframes; ++i) {
             auto ipos = (int32_t)pos;
             auto fract = (AooSample)(pos - (double)ipos);
-            auto index0 = ipos * nchannels;
-            auto index1 = (ipos + 1) * nchannels;
+            auto index0 = ipos * fs;
+            auto index1 = (ipos + 1) * fs;
             for (int j = 0; j < nchannels; ++j) {
-                auto a = buffer_[index0 + j];
-                auto b = buffer_[index1 + j];
-                data[i + j] = a + (b - a) * fract;
+                auto a = buffer_[index0 + j * cs];
+                auto b = buffer_[index1 + j * cs];
+                data[i * ofs + j * ocs] = a + (b - a) * fract;
             }
             pos += fadvance;
             if (pos >= limit) {
@@ -288,15 +548,13 @@ bool dynamic_resampler::read(AooSample *data, int32_t nframes) {
         if (balance < readframes) {
             return false;
         }
-        auto nchannels = (int32_t)nchannels_;
         auto pos = rdpos_;
         auto start = pos;
         auto limit = (double)size_;
-        auto nsamples = nframes * nchannels;
-        for (int i = 0; i < nsamples; i += nchannels) {
+        for (int i = 0; i < nframes; ++i) {
             auto ipos = (int32_t)pos;
             for (int j = 0; j < nchannels; ++j) {
-                data[i + j] = buffer_[ipos * nchannels + j];
+                data[i * ofs + j * ocs] = buffer_[ipos * fs + j * cs];
             }
             pos += fadvance;
             if (pos >= limit) {
@@ -323,12 +581,10 @@ bool dynamic_resampler::read(AooSample *data, int32_t nframes) {
             return false;
         }
         auto limit = size_;
-        auto nchannels = (int32_t)nchannels_;
-        auto nsamples = nframes * nchannels;
         auto ipos = (int32_t)rdpos_;
-        for (int i = 0; i < nsamples; i += nchannels) {
+        for (int i = 0; i < nframes; ++i) {
             for (int j = 0; j < nchannels; ++j) {
-                data[i + j] = buffer_[ipos * nchannels + j];
+                data[i * ofs + j * ocs] = buffer_[ipos * fs + j * cs];
             }
             ipos += iadvance;
             if (ipos >= limit) {
@@ -347,19 +603,21 @@ bool dynamic_resampler::read(AooSample *data, int32_t nframes) {
             return false;
         }
         auto size = size_;
-        auto nchannels = (int32_t)nchannels_;
         auto pos = (int32_t)rdpos_;
         auto end = pos + nframes;
-        if (end > size_) {
-            auto n1 = size_ - pos;
-            auto n2 = end - size;
-            std::copy(buffer_ + (pos * nchannels), buffer_ + (size * nchannels), data);
-            std::copy(buffer_, buffer_ + (n2 * nchannels), data + (n1 * nchannels));
-            rdpos_ = n2;
+        auto split = std::min<int32_t>(end, size) - pos;
+        if (planar_) {
+            for (int j = 0; j < nchannels; ++j) {
+                auto buf = buffer_ + j * cs;
+                auto out = data + j * nframes;
+                std::copy(buf + pos, buf + pos + split, out);
+                std::copy(buf, buf + (nframes - split), out + split);
+            }
         } else {
-            std::copy(buffer_ + (pos * nchannels), buffer_ + (end * nchannels), data);
-            rdpos_ = (end == size) ? 0 : end;
+            std::copy(buffer_ + (pos * nchannels), buffer_ + ((pos + split) * nchannels), data);
+            std::copy(buffer_, buffer_ + ((nframes - split) * nchannels), data + (split * nchannels));
         }
+        rdpos_ = (end >= size) ? end - size : end;
         balance_ = ibalance - nframes;
         break;
     }
@@ -10,9 +10,13 @@ class dynamic_resampler {
 public:
     ~dynamic_resampler() { free_buffer(); }
 
+    // If 'planar' is true, the input and output data of write() resp. read()
+    // is non-interleaved, i.e. channel after channel with 'nframes' samples
+    // each, and the internal buffer is also stored channel after channel.
     void setup(int32_t nfrom, int32_t nto, bool fixed_n,
                int32_t srfrom, int32_t srto, bool fixed_sr,
-               int32_t nchannels, AooResampleMethod mode);
+               int32_t nchannels, AooResampleMethod mode,
+               bool planar = false);
     void reset();
     void update(double srfrom, double srto);
 
@@ -27,36 +31,60 @@ public:
     int32_t latency() const { return latency_; } // in terms of the writer
     bool bypass() const { return bypass_; }
     bool fixed_sr() const { return fixed_sr_; }
+    bool planar() const { return planar_; }
 private:
     void free_buffer();
 
+    // distance between two frames resp. two channels in the buffer
+    int32_t frame_stride() const { return planar_ ? 1 : nchannels_; }
+    int32_t channel_stride() const {
+        return planar_ ? size_ + extra_space_ : 1;
+    }
+    // zero resp. copy frames (in all channels); the frame
+    // indices may point into the extra space before/after the buffer.
+    void zero_frames(int32_t onset, int32_t nframes);
+    void copy_frames(int32_t from, int32_t to, int32_t nframes);
+
     enum class resample_method : uint8_t {
         none,
         skip,
         hold,
         linear,
-        cubic
+        cubic,
+        polyphase
     };
 
     static const char* method_to_string(resample_method method);
 
+    void make_filter_bank(double cutoff);
+
     static constexpr int32_t latency_linear = 1;
     static constexpr int32_t latency_cubic = 2;
-    static constexpr size_t buffer_shift = 1;
-    static constexpr size_t extra_space = 3;
+    // polyphase filter: number of taps (must be a multiple of 8)
+    // and number of phases (= fractional positions).
+    static constexpr int32_t polyphase_taps = 64;
+    static constexpr int32_t polyphase_phases = 128;
+    static constexpr int32_t latency_polyphase = polyphase_taps / 2;
 
     AooSample *buffer_ = nullptr;
     int32_t size_ = 0;
+    // extra frames before resp. after the buffer, see setup()
+    int16_t buffer_shift_ = 0;
+    int16_t extra_space_ = 0;
     int16_t nchannels_ = 0;
     int16_t latency_ = 0;
     resample_method method_ = resample_method::none;
     bool bypass_ = false;
     bool fixed_sr_ = false;
+    bool planar_ = false;
     int32_t wrpos_ = 0;
     double rdpos_ = 0;
     double balance_ = 0;
     double advance_ = 1.0;
     double ideal_ratio_ = 1.0;
+    // (polyphase_phases + 1) * polyphase_taps coefficients
+    aoo::vector<AooSample> filter_bank_;
+    double filter_cutoff_ = 0;
 };
 
 }
@@ -0,0 +1,92 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#include "resend_scheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace aoo {
+
+void coalesce_request(aoo::vector<data_request>& requests,
+                      const data_request& r) {
+    if (r.offset < 0) {
+        // whole block: replaces all requests for individual frames
+        requests.erase(std::remove_if(requests.begin(), requests.end(),
+                                      [&](auto& x) { return x.sequence == r.sequence; }),
+                       requests.end());
+        requests.push_back(r);
+        return;
+    }
+    for (auto& x : requests) {
+        if (x.sequence == r.sequence) {
+            if (x.offset < 0) {
+                return; // whole block already requested
+            } else if (x.offset == r.offset) {
+                x.bitset |= r.bitset;
+                return;
+            }
+        }
+    }
+    requests.push_back(r);
+}
+
+//------------------------ token_bucket ----------------------------//
+
+void token_bucket::setup(double rate, double capacity) {
+    rate_ = std::max<double>(rate, 0);
+    capacity_ = std::max<double>(capacity, 0);
+    tokens_ = std::min<double>(tokens_, capacity_);
+}
+
+void token_bucket::refill(double elapsed) {
+    if (elapsed > 0) {
+        tokens_ = std::min<double>(tokens_ + elapsed * rate_, capacity_);
+    }
+}
+
+bool token_bucket::consume(int32_t nbytes) {
+    if (unlimited()) {
+        return true;
+    } else if (tokens_ >= nbytes) {
+        tokens_ -= nbytes;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+//------------------------ resend_filter ----------------------------//
+
+bool resend_filter::contains(int32_t sequence, int32_t frame,
+                             double time, double interval) {
+    prune(time - interval);
+    for (auto i = head_; i < records_.size(); ++i) {
+        auto& r = records_[i];
+        if (r.sequence == sequence && r.frame == frame) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void resend_filter::add(int32_t sequence, int32_t frame, double time) {
+    assert(records_.empty() || time >= records_.back().time);
+    records_.push_back(record { sequence, frame, time });
+}
+
+void resend_filter::prune(double deadline) {
+    while (head_ < records_.size() && records_[head_].time <= deadline) {
+        head_++;
+    }
+    if (head_ == records_.size()) {
+        clear();
+    } else if (head_ > records_.size() / 2) {
+        // compact; amortized O(1)
+        records_.erase(records_.begin(), records_.begin() + head_);
+        head_ = 0;
+    }
+}
+
+} // aoo
@@ -0,0 +1,88 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#pragma once
+
+#include "detail.hpp"
+
+#include <stdint.h>
+
+namespace aoo {
+
+struct data_request {
+    int32_t sequence;
+    int16_t offset; // -1: whole block
+    uint16_t bitset;
+};
+
+// Merge a data request into a list of (pending) data requests,
+// so that each frame is only contained once.
+void coalesce_request(aoo::vector<data_request>& requests,
+                      const data_request& r);
+
+//------------------------ token_bucket ----------------------------//
+
+// Paces resent data. The bucket is refilled with 'rate' bytes per second
+// and holds at most 'capacity' bytes, so that short bursts can pass while
+// the long-term rate is bounded. A rate of 0 means "unlimited".
+class token_bucket {
+public:
+    void setup(double rate, double capacity);
+
+    // fill the bucket
+    void reset() { tokens_ = capacity_; }
+
+    // add tokens for the given time span (in seconds)
+    void refill(double elapsed);
+
+    // try to take 'nbytes' tokens
+    bool consume(int32_t nbytes);
+
+    bool unlimited() const { return rate_ <= 0; }
+
+    double rate() const { return rate_; }
+
+    double tokens() const { return tokens_; }
+private:
+    double rate_ = 0;
+    double capacity_ = 0;
+    double tokens_ = 0;
+};
+
+//------------------------ resend_filter ----------------------------//
+
+// Remembers which frames have recently been resent, so that repeated
+// requests for the same frame can be suppressed. This typically happens
+// when the round trip time exceeds the resend interval of the sink,
+// or when several members of a multicast group miss the same frame.
+//
+// NB: the time must not go backwards; records are kept in insertion order,
+// so that expired records can simply be removed from the front.
+class resend_filter {
+public:
+    // check if the frame has been resent within the last 'interval' seconds;
+    // also removes expired records.
+    bool contains(int32_t sequence, int32_t frame, double time, double interval);
+
+    void add(int32_t sequence, int32_t frame, double time);
+
+    void clear() {
+        records_.clear();
+        head_ = 0;
+    }
+
+    size_t size() const { return records_.size() - head_; }
+private:
+    void prune(double deadline);
+
+    struct record {
+        int32_t sequence;
+        int32_t frame;
+        double time;
+    };
+    aoo::vector<record> records_;
+    size_t head_ = 0;
+};
+
+} // aoo
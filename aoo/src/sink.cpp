@@ -376,6 +376,55 @@ AooError AOO_CALL aoo::Sink::control(
         CHECKARG(AooBool);
         as<AooBool>(ptr) = binary_.load();
         break;
+    // parallel processing
+    case kAooCtlSetProcessThreadCount:
+    {
+        CHECKARG(int32_t);
+        auto count = std::max<int32_t>(0, as<int32_t>(ptr));
+        // create the new pool before taking the lock
+        std::unique_ptr<worker_pool> pool;
+        if (count > 0) {
+            pool = std::make_unique<worker_pool>();
+            pool->start(count);
+        }
+        // swap pools; the audio thread only ever tries to lock.
+        {
+            sync::scoped_lock<sync::spinlock> lock(worker_pool_lock_);
+            worker_pool_.swap(pool);
+            process_threads_.store(count);
+        }
+        // the old pool (if any) is stopped and freed here.
+        break;
+    }
+    case kAooCtlGetProcessThreadCount:
+    {
+        CHECKARG(int32_t);
+        // don't take the worker pool lock, otherwise the audio
+        // thread might fail to lock it and process serially.
+        as<int32_t>(ptr) = process_threads_.load();
+        break;
+    }
+    // adaptive latency
+    case kAooCtlSetAdaptiveLatency:
+    {
+        CHECKARG(AooBool);
+        bool b = as<AooBool>(ptr);
+        if (adaptive_latency_.exchange(b) != b){
+            reset_sources();
+        }
+        break;
+    }
+    case kAooCtlGetAdaptiveLatency:
+        CHECKARG(AooBool);
+        as<AooBool>(ptr) = adaptive_latency_.load();
+        break;
+    case kAooCtlGetFrameAllocatorStats:
+    {
+        CHECKARG(AooFrameAllocatorStats);
+        GETSOURCEARG
+        src->get_frame_allocator_stats(as<AooFrameAllocatorStats>(ptr));
+        break;
+    }
 #if AOO_NET
     case kAooCtlSetClient:
         client_ = reinterpret_cast<AooClient *>(index);
@@ -447,6 +496,8 @@ AooError AOO_CALL aoo::Sink::handleMessage(
         switch (cmd){
         case kAooBinMsgCmdData:
             return handle_data_message(data + onset, size - onset, id, addr);
+        case kAooBinMsgCmdParity:
+            return handle_parity_message(data + onset, size - onset, id, addr);
         default:
             LOG_WARNING("AooSink: unsupported binary message");
             return kAooErrorNotImplemented;
@@ -516,6 +567,8 @@ AooError AOO_CALL aoo::Sink::process(
         AooStreamMessageHandler messageHandler, void *user) {
     // check nsamples
     assert(fixed_blocksize() ? nsamples == blocksize_ : nsamples <= blocksize_);
+    // use the dedicated magazine of the frame allocator
+    data_frame_allocator::set_process_thread();
     // Always update timers, even if there are no sources.
     // Do it *before* trying to lock the mutex.
     // (The DLL is only ever touched in this method.)
@@ -574,8 +627,20 @@ AooError AOO_CALL aoo::Sink::process(
     // NB: we only remove sources in this thread,
     // so we do not need to lock the source mutex!
     source_lock lock(sources_);
+    // try to decode sources in parallel. NB: never block on the lock;
+    // if the worker pool is being reconfigured, process serially.
+    bool parallel = false;
+    if (worker_pool_lock_.try_lock()) {
+        if (worker_pool_) {
+            parallel = process_parallel(nsamples, t);
+        }
+        worker_pool_lock_.unlock();
+    }
     for (auto it = sources_.begin(); it != sources_.end();){
-        if (it->process(*this, data, nsamples, t, messageHandler, user)){
+        // if the sources have already been decoded, only mix them
+        bool active = parallel ? it->mix(*this, data, nsamples, messageHandler, user)
+                               : it->process(*this, data, nsamples, t, messageHandler, user);
+        if (active){
             didsomething = true;
         } else if (!it->check_active(*this)){
             LOG_VERBOSE("AooSink: removed inactive source " << it->ep);
@@ -711,6 +776,34 @@ void Sink::send_event(event_ptr e, AooThreadLevel level) const {
     }
 }
 
+// called with source list and worker pool locked
+bool Sink::process_parallel(int32_t nsamples, time_tag tt) {
+    // only worth it for more than one source
+    auto it = sources_.begin();
+    if (it == sources_.end() || std::next(it) == sources_.end()) {
+        return false;
+    }
+    process_nsamples_ = nsamples;
+    process_tt_ = tt;
+    // decode sources in chunks of 'max_parallel_sources'.
+    // NB: sources which are added concurrently are not in the list;
+    // their mix() method simply does nothing in this cycle.
+    while (it != sources_.end()) {
+        int32_t count = 0;
+        while (it != sources_.end() && count < max_parallel_sources) {
+            process_list_[count++] = &(*it);
+            ++it;
+        }
+        worker_pool_->run([](void *x, int index) {
+            auto self = static_cast<Sink *>(x);
+            data_frame_allocator::set_process_thread();
+            self->process_list_[index]->decode(
+                *self, self->process_nsamples_, self->process_tt_);
+        }, this, count);
+    }
+    return true;
+}
+
 void Sink::dispatch_requests(){
     source_request r;
     while (requestqueue_.try_pop(r)){
@@ -1078,6 +1171,48 @@ wrong_size:
     return kAooErrorBadFormat;
 }
 
+// binary parity message:
+// stream_id (int32), seq (int32), channel (uint8), count (uint8), size (uint16),
+// total (int32), nframes (int16), frame (int16), data...
+
+AooError Sink::handle_parity_message(const AooByte *msg, int32_t n,
+                                     AooId id, const ip_address& addr)
+{
+    net_packet d;
+    auto it = msg;
+
+    if (n < 20){
+        goto wrong_size;
+    }
+    d.stream_id = aoo::read_bytes<int32_t>(it);
+    d.sequence = aoo::read_bytes<int32_t>(it);
+    d.channel = aoo::read_bytes<uint8_t>(it);
+    d.parity_count = aoo::read_bytes<uint8_t>(it);
+    d.size = aoo::read_bytes<uint16_t>(it);
+    d.total_size = aoo::read_bytes<uint32_t>(it);
+    d.num_frames = aoo::read_bytes<uint16_t>(it);
+    d.frame_index = aoo::read_bytes<uint16_t>(it);
+    d.msg_size = 0;
+    d.samplerate = 0;
+    d.tt = 0;
+    d.flags = 0;
+    d.data = it;
+
+    if ((n - 20) < d.size) {
+        goto wrong_size;
+    }
+    if (d.parity_count < 2 || d.size == 0 || d.frame_index >= d.num_frames) {
+        LOG_ERROR("AooSink: bad binary parity message");
+        return kAooErrorBadFormat;
+    }
+
+    return handle_data_packet(d, true, addr, id);
+
+wrong_size:
+    LOG_ERROR("AooSink: binary parity message too small!");
+    return kAooErrorBadFormat;
+}
+
 AooError Sink::handle_data_packet(net_packet& d, bool binary,
                                   const ip_address& addr, AooId id)
 {
@@ -1164,6 +1299,12 @@ source_desc::~source_desc() {
     flush_packet_queue();
     // flush stream message queue
     reset_stream();
+    for (auto it = ready_messages_; it; ){
+        auto next = it->next;
+        auto alloc_size = sizeof(stream_message_header) + it->size;
+        aoo::rt_deallocate(it, alloc_size);
+        it = next;
+    }
 }
 
 bool source_desc::check_active(const Sink& s) {
@@ -1236,6 +1377,7 @@ void source_desc::update(const Sink& s){
         int32_t min_latency_samples = min_latency_blocks / convert * (double)s.samplerate() + 0.5;
         int32_t latency_samples = latency * (double)s.samplerate() + 0.5;
         latency_samples_ = std::max<int32_t>(latency_samples, min_latency_samples);
+        min_latency_samples_ = min_latency_samples;
         // calculate jitter buffer size
         auto buffersize = s.buffersize();
         if (buffersize <= 0) {
@@ -1255,6 +1397,11 @@ void source_desc::update(const Sink& s){
         // of buffers we wait before we start decoding, see try_decode_block().
         auto old_buffer_size = jitter_buffer_.capacity();
         jitter_buffer_.resize(jitter_buffersize);
+        // a parity window contains at least 2 blocks
+        parity_buffer_.resize(jitter_buffersize / 2 + 1);
+        // NB: we are holding the writer lock, so the network thread
+        // can't access the block assembler.
+        block_assembler_.resize(jitter_buffersize);
         if (old_buffer_size && old_buffer_size != jitter_buffersize) {
 #if 1
             // Release the frame memory, but only if the size has changed!
@@ -1268,10 +1415,32 @@ void source_desc::update(const Sink& s){
 
         reset_stream();
 
+        // scratch buffer for decode()
+        process_buffer_.resize(s.blocksize() * format_->numChannels);
+
+        // use non-interleaved audio if the decoder supports it
+        planar_ = AOO_PLANAR_AUDIO && AooDecoder_hasPlanar(decoder_.get());
+        fec_ = AooDecoder_hasFec(decoder_.get());
+
+        // setup adaptive latency; the headroom can't exceed the jitter buffer size.
+        // NB: the resampler is always active because we change the playback speed.
+        adaptive_ = s.adaptive_latency();
+        if (adaptive_) {
+            auto period = (double)format_->blockSize / (double)format_->sampleRate;
+            auto decay = std::exp(-period / ADAPTIVE_LATENCY_MEMORY);
+            jitter_estimator_.setup(ADAPTIVE_LATENCY_RESOLUTION,
+                                    jitter_buffersize * period + latency, decay);
+        }
+        speed_ = 1;
+        latency_base_ = 0;
+        latency_adjust_ = 0;
+        last_late_ = -1;
+
         // setup resampler
         resampler_.setup(format_->blockSize, s.blocksize(), s.fixed_blocksize(),
-                         format_->sampleRate, s.samplerate(), !s.dynamic_resampling(),
-                         format_->numChannels, s.resample_method());
+                         format_->sampleRate, s.samplerate(),
+                         !(s.dynamic_resampling() || adaptive_),
+                         format_->numChannels, s.resample_method(), planar_);
         if (resampler_.bypass()) {
             LOG_DEBUG("AooSink: bypass resampler");
         }
@@ -1342,6 +1511,19 @@ float source_desc::get_buffer_fill_ratio() {
     }
 }
 
+void source_desc::get_frame_allocator_stats(AooFrameAllocatorStats& stats) const {
+    static_assert(data_frame_allocator::bin_count <= kAooFrameAllocatorMaxBins,
+                  "too many data frame allocator bins");
+    data_frame_allocator::stats s;
+    frame_allocator_.get_stats(s);
+    stats.hitCount = s.hits;
+    stats.missCount = s.misses;
+    stats.minBinSize = data_frame_allocator::min_bin_size;
+    stats.numBins = data_frame_allocator::bin_count;
+    std::fill(std::begin(stats.binBytes), std::end(stats.binBytes), 0);
+    std::copy(s.bytes.begin(), s.bytes.end(), stats.binBytes);
+}
+
 void source_desc::add_xrun(double nblocks){
     xrunblocks_ += nblocks;
 }
@@ -1626,11 +1808,26 @@ AooError source_desc::handle_data(const Sink& s, net_packet& d, bool binary)
         d.samplerate = format_->sampleRate;
     }
 
-    // copy blob data and push to queue
+    // copy blob data and push to queue.
+    // First try to write the frame directly to its block buffer;
+    // otherwise copy it into a separate data frame.
+    // NB: parity blocks always use separate data frames, see add_parity().
     if (d.size > 0) {
-        auto frame = frame_allocator_.allocate(d.size);
-        memcpy(frame->data, d.data, d.size);
-        d.frame = frame;
+        bool duplicate = false;
+        if (d.parity_count == 0) {
+            d.buffer = block_assembler_.write(d, duplicate);
+        }
+        if (d.buffer) {
+            d.frame = nullptr;
+        } else if (duplicate) {
+            LOG_DEBUG("AooSink: frame " << d.frame_index << " of block "
+                      << d.sequence << " already received");
+            return kAooOk;
+        } else {
+            auto frame = frame_allocator_.allocate(d.size);
+            memcpy(frame->data, d.data, d.size);
+            d.frame = frame;
+        }
     } else {
         d.frame = nullptr;
     }
@@ -1730,6 +1927,13 @@ void source_desc::send(const Sink& s, const sendfn& fn){
 bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
                           time_tag tt, AooStreamMessageHandler handler, void *user)
 {
+    decode(s, nsamples, tt);
+    return mix(s, buffer, nsamples, handler, user);
+}
+
+void source_desc::decode(const Sink& s, int32_t nsamples, time_tag tt)
+{
+    process_result_ = false;
     // synchronize with update()!
     // the mutex should be uncontended most of the time.
     shared_lock lock(mutex_, sync::try_to_lock);
@@ -1739,11 +1943,11 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
             LOG_DEBUG("AooSink: process would block");
         }
         // how to report this to the client?
-        return false;
+        return;
     }
 
     if (!decoder_){
-        return false;
+        return;
     }
 
     // store events in buffer and only dispatch at the very end,
@@ -1799,12 +2003,10 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
                 // deactivate stream immediately
                 stream_state_ = stream_state::inactive;
 
-                lock.unlock(); // unlock before sending event!
-
                 auto e = make_event<stream_state_event>(ep, kAooStreamStateInactive, 0);
-                s.send_event(std::move(e), kAooThreadLevelAudio);
+                queue_event(std::move(e));
             }
-            return false;
+            return;
         }
     }
 
@@ -1834,8 +2036,18 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
         });
     }
 
+    // first try to rebuild missing blocks from parity data,
+    // then request the remaining ones.
+    if (!parity_buffer_.empty()) {
+        stats.recovered += parity_buffer_.recover(jitter_buffer_, format_->sampleRate);
+    }
+
     check_missing_blocks(s);
 
+    if (adaptive_) {
+        adapt_latency(s);
+    }
+
 #if AOO_DEBUG_JITTER_BUFFER
     LOG_DEBUG(jitterbuffer_);
     LOG_DEBUG("oldest: " << jitterbuffer_.last_popped()
@@ -1846,9 +2058,10 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
     auto nchannels = format_->numChannels;
     auto outsize = nsamples * nchannels;
     assert(outsize > 0);
-    // allocate a temporary buffer for reading from the resampler
-    // or directly decoding block data.
-    auto buf = (AooSample *)alloca(outsize * sizeof(AooSample));
+    // the scratch buffer for reading from the resampler or directly
+    // decoding block data; it is resized in update().
+    assert(process_buffer_.size() >= outsize);
+    auto buf = process_buffer_.data();
 #if AOO_DEBUG_STREAM_MESSAGE && 0
     LOG_DEBUG("AooSink: process samples: " << process_samples_
               << ", stream samples: " << stream_samples_
@@ -1857,16 +2070,11 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
 #endif
     if (resampler_.bypass()) {
         // bypass the resampler;
-        // try_decode_block() writes directly into the stack buffer.
+        // try_decode_block() writes directly into the scratch buffer.
         for (;;) {
             if (!try_decode_block(s, buf, stats)) {
                 on_underrun(s);
-
-                lock.unlock(); // unlock before sending event!
-
-                flush_events(s);
-
-                return false;
+                return;
             }
 
             // if there have been xruns, skip one block of audio and try again.
@@ -1897,12 +2105,7 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
                 }
             } else if (!try_decode_block(s, nullptr, stats)) {
                 on_underrun(s);
-
-                lock.unlock(); // unlock before sending event!
-
-                flush_events(s);
-
-                return false;
+                return;
             }
         }
     }
@@ -1934,29 +2137,59 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
         }
     }
 
-    dispatch_stream_messages(s, nsamples, handler, user);
+    collect_stream_messages(s, nsamples);
 
-    // sum source into sink (interleaved -> non-interleaved),
-    // starting at the desired sink channel offset.
-    // out-of-bound source channels are silently ignored.
-    if (buffer) {
-        auto realnchannels = s.nchannels();
-        for (int i = 0; i < nchannels; ++i){
-            auto chn = i + channel_;
-            if (chn < realnchannels){
-                auto out = buffer[chn];
-                for (int j = 0; j < nsamples; ++j){
-                    out[j] += buf[j * nchannels + i];
+    process_stats_ = stats;
+    process_channels_ = nchannels;
+    process_result_ = true;
+}
+
+bool source_desc::mix(const Sink& s, AooSample **buffer, int32_t nsamples,
+                      AooStreamMessageHandler handler, void *user)
+{
+    auto result = process_result_;
+    process_result_ = false;
+
+    if (result) {
+        dispatch_stream_messages(handler, user);
+
+        // sum source into sink (interleaved/planar -> non-interleaved),
+        // starting at the desired sink channel offset.
+        // out-of-bound source channels are silently ignored.
+        // NB: the scratch buffer might have been resized by update()
+        // in the meantime; in this case we drop the block.
+        shared_lock lock(mutex_, sync::try_to_lock);
+        if (buffer && lock.owns_lock() && !did_update_) {
+            auto buf = process_buffer_.data();
+            auto nchannels = process_channels_;
+            auto realnchannels = s.nchannels();
+            for (int i = 0; i < nchannels; ++i){
+                auto chn = i + channel_;
+                if (chn < realnchannels){
+                    auto out = buffer[chn];
+                    if (planar_) {
+                        auto in = buf + i * nsamples;
+                        for (int j = 0; j < nsamples; ++j){
+                            out[j] += in[j];
+                        }
+                    } else {
+                        for (int j = 0; j < nsamples; ++j){
+                            out[j] += buf[j * nchannels + i];
+                        }
+                    }
                 }
             }
         }
     }
 
     // send events
-    lock.unlock();
-
     flush_events(s);
 
+    if (!result) {
+        return false;
+    }
+
+    auto& stats = process_stats_;
     if (stats.dropped > 0){
         // add to dropped blocks for packet loss reporting
         dropped_blocks_.fetch_add(stats.dropped, std::memory_order_relaxed);
@@ -1974,13 +2207,19 @@ bool source_desc::process(const Sink& s, AooSample **buffer, int32_t nsamples,
         auto e = make_event<block_xrun_event>(ep, stats.xrun);
         s.send_event(std::move(e), kAooThreadLevelAudio);
     }
+    if (stats.recovered > 0){
+        // push block recovered event
+        auto e = make_event<block_recover_event>(ep, stats.recovered);
+        s.send_event(std::move(e), kAooThreadLevelAudio);
+    }
 
     return true;
 }
 
-void source_desc::check_latency(const Sink& s) {
-    auto buffer_latency = stream_samples_;
-    if (buffer_latency != buffer_latency_) {
+void source_desc::check_latency(const Sink& s, int32_t tolerance) {
+    // NB: latency_adjust_ is only non-zero with adaptive latency
+    int32_t buffer_latency = latency_base_ + latency_adjust_;
+    if (std::abs(buffer_latency - buffer_latency_) > tolerance) {
         buffer_latency_ = buffer_latency;
 
         // calculate and report latencies
@@ -2009,6 +2248,45 @@ void source_desc::check_latency(const Sink& s) {
     }
 }
 
+// Record the headroom of a block, i.e. the time between its arrival
+// and the moment it is needed by the decoder; late blocks have a negative
+// headroom. The value is normalized to the initial latency, so that the
+// statistics are not affected by our own latency changes.
+void source_desc::update_jitter(const Sink& s, int32_t seq) {
+    if (!adaptive_ || stream_state_ != stream_state::active
+            || jitter_buffer_.last_popped() == jitter_buffer::sentinel) {
+        return;
+    }
+    // NB: the resampler balance is in source samples
+    auto ahead = (double)(seq - jitter_buffer_.last_popped() - 1) * format_->blockSize
+            + resampler_.balance();
+    auto headroom = ahead / (double)format_->sampleRate;
+    jitter_estimator_.add(seq, headroom - latency_adjust_ / (double)s.samplerate());
+}
+
+// Adapt the buffer latency to the current network jitter. Instead of adding
+// or removing samples, we slightly change the playback speed (via the dynamic
+// resampler) until the predicted headroom matches the safety margin.
+// The configured latency is both the initial and the maximum latency.
+void source_desc::adapt_latency(const Sink& s) {
+    speed_ = 1;
+    if (stream_state_ != stream_state::active
+            || jitter_estimator_.count() < ADAPTIVE_LATENCY_MIN_COUNT) {
+        return;
+    }
+    auto sr = (double)s.samplerate();
+    // predicted headroom at the current latency
+    auto headroom = jitter_estimator_.percentile(ADAPTIVE_LATENCY_PERCENTILE)
+            + latency_adjust_ / sr;
+    // safety margin: one process block + the current jitter
+    auto margin = (double)s.blocksize() / sr + jitter_estimator_.jitter();
+    // NB: the initial latency is also the max. latency
+    speed_ = adaptive_latency_speed(headroom, margin, latency_base_ + latency_adjust_,
+                                    min_latency_samples_, latency_base_);
+    // only report significant changes
+    check_latency(s, s.blocksize());
+}
+
 void source_desc::on_underrun(const Sink &s) {
     // buffer ran out -> "inactive"
     // TODO: delay "inactive" and "stop" event by codec delay (if non-zero)
@@ -2052,6 +2330,11 @@ void source_desc::on_underrun(const Sink &s) {
     }
 }
 
+void source_desc::reset_jitter_buffer() {
+    jitter_buffer_.reset();
+    parity_buffer_.reset();
+}
+
 void source_desc::handle_underrun(const Sink& s){
     LOG_VERBOSE("AooSink: jitter buffer underrun!");
 
@@ -2060,7 +2343,7 @@ void source_desc::handle_underrun(const Sink& s){
     }
     // always reset buffer! otherwise add_packet() might try to fill
     // the difference to the last received block with empty blocks!
-    jitter_buffer_.reset();
+    reset_jitter_buffer();
 
 #if 1
     // TODO: maybe not necessary with BUFFER_PLC?
@@ -2092,7 +2375,7 @@ void source_desc::handle_underrun(const Sink& s){
 void source_desc::handle_overrun(const Sink& s){
     LOG_VERBOSE("AooSink: jitter buffer overrun!");
 
-    jitter_buffer_.reset();
+    reset_jitter_buffer();
 
 #if 1
     // TODO: maybe not necessary with BUFFER_PLC?
@@ -2125,6 +2408,9 @@ bool source_desc::add_packet(const Sink& s, const net_packet& d,
         if (d.frame) {
             frame_allocator_.deallocate(d.frame);
         }
+        if (d.buffer) {
+            d.buffer->release(frame_allocator_);
+        }
     });
     // we have to check the stream_id (again) because the stream
     // might have changed in between!
@@ -2133,16 +2419,30 @@ bool source_desc::add_packet(const Sink& s, const net_packet& d,
         return false;
     }
 
+    if (d.parity_count > 0) {
+        if (add_parity(d)) {
+            guard.dismiss(); // !
+            return true;
+        } else {
+            return false;
+        }
+    }
+
     if (d.sequence <= jitter_buffer_.last_popped()) {
         // try to detect wrap around
         if ((jitter_buffer_.last_popped() - d.sequence) >= (INT32_MAX / 2)) {
             LOG_VERBOSE("AooSink: stream sequence has wrapped around!");
-            jitter_buffer_.reset();
+            reset_jitter_buffer();
             // continue!
         } else {
             // block too old, discard!
             LOG_VERBOSE("AooSink: discard old block " << d.sequence);
             LOG_DEBUG("AooSink: oldest: " << jitter_buffer_.last_popped());
+            // record late block (only once)
+            if (d.sequence != last_late_) {
+                update_jitter(s, d.sequence);
+                last_late_ = d.sequence;
+            }
             return false;
         }
     }
@@ -2227,6 +2527,10 @@ bool source_desc::add_packet(const Sink& s, const net_packet& d,
             // empty block already received
             LOG_VERBOSE("AooSink: empty block " << d.sequence << " already received");
             return false;
+        } else if (block->complete()) {
+            // block already recovered, see recover_blocks()
+            LOG_DEBUG("AooSink: block " << d.sequence << " already complete");
+            return false;
         } else if (block->has_frame(d.frame_index)){
             // frame already received
             LOG_VERBOSE("AooSink: frame " << d.frame_index << " of block " << d.sequence << " already received");
@@ -2247,13 +2551,55 @@ bool source_desc::add_packet(const Sink& s, const net_packet& d,
         }
     }
 
-    guard.dismiss(); // !
-
     // add frame to block (if not empty)
-    if (d.size > 0) {
+    if (d.buffer) {
+        guard.dismiss(); // !
+        auto offset = block_assembler::frame_offset(d);
+        if (!block->add_frame(d.frame_index, offset, d.size, d.buffer, frame_allocator_)) {
+            return false;
+        }
+    } else if (d.size > 0) {
+        if (block->has_buffer()) {
+            // should not happen with well-formed packets
+            LOG_ERROR("AooSink: can't add frame " << d.frame_index
+                      << " to block " << d.sequence);
+            return false;
+        }
+        guard.dismiss(); // !
         block->add_frame(d.frame_index, d.frame);
+    } else {
+        guard.dismiss(); // !
     }
 
+    if (block->complete()) {
+        update_jitter(s, d.sequence);
+    }
+
+    return true;
+}
+
+bool source_desc::add_parity(const net_packet& d) {
+    // NB: the source never sends a window across a sequence wrap around
+    auto last = d.sequence + d.parity_count - 1;
+    if (last <= jitter_buffer_.last_popped()) {
+        LOG_DEBUG("AooSink: discard old parity block " << d.sequence);
+        return false;
+    }
+    auto p = parity_buffer_.find(d.sequence);
+    if (!p) {
+        p = parity_buffer_.push(d.sequence, d.parity_count);
+        p->block.init(d);
+    } else if (p->block.complete() || p->block.has_frame(d.frame_index)) {
+        LOG_DEBUG("AooSink: parity frame " << d.frame_index << " of block "
+                  << d.sequence << " already received");
+        return false;
+    } else if (p->count != d.parity_count || p->block.total_size != d.total_size
+               || p->block.num_frames() != d.num_frames) {
+        LOG_ERROR("AooSink: parity frame " << d.frame_index << " of block "
+                  << d.sequence << " does not match");
+        return false;
+    }
+    p->block.add_frame(d.frame_index, d.frame);
     return true;
 }
 
@@ -2309,7 +2655,7 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
             }
             // use packet loss concealment
             AooInt32 count = framesize;
-            if (AooDecoder_decode(decoder_.get(), nullptr, 0, buffer, &count) != kAooOk) {
+            if (decode_samples(nullptr, 0, buffer, &count) != kAooOk) {
                 LOG_WARNING("AooSink: couldn't decode block!");
                 // fill with zeros
                 std::fill(buffer, buffer + bufsize, 0);
@@ -2354,6 +2700,8 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
             // buffering -> active
             stream_state_ = stream_state::active;
             stream_start_ = stream_samples_ + source_codec_delay_ + sink_codec_delay_ + sample_offset_;
+            latency_base_ = stream_samples_;
+            latency_adjust_ = 0;
 
             check_latency(s);
         }
@@ -2371,6 +2719,7 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
     int32_t size;
     int32_t msgsize;
     double sr;
+    bool fec = false;
 
     auto& b = jitter_buffer_.front();
     if (b.complete()){
@@ -2380,9 +2729,13 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
         }
         size = b.total_size;
         if (size > 0) {
-            auto buffer = (AooByte*)alloca(size);
-            b.copy_frames(buffer);
-            data = buffer;
+            // decode in place if the block is contiguous
+            data = b.data();
+            if (!data) {
+                auto frames = (AooByte*)alloca(size);
+                b.copy_frames(frames);
+                data = frames;
+            }
             msgsize = b.message_size;
         } else {
             // empty block
@@ -2404,6 +2757,29 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
         stats.dropped++;
         LOG_VERBOSE("AooSink: dropped block " << b.sequence);
         LOG_DEBUG("AooSink: remaining blocks: " << jitter_buffer_.size() - 1);
+        // If the next block has already arrived, try to recover the
+        // dropped block from its redundant data (e.g. Opus in-band FEC).
+        // NB: we still count the block as dropped because the packet loss
+        // drives the amount of redundancy on the source side.
+        if (fec_) {
+            auto next = jitter_buffer_.find(b.sequence + 1);
+            if (next && next->complete() && next->total_size > next->message_size) {
+                data = next->data();
+                if (!data) {
+                    auto frames = (AooByte*)alloca(next->total_size);
+                    next->copy_frames(frames);
+                    data = frames;
+                }
+                // only pass the audio data! The stream messages belong
+                // to the next block and are scheduled together with it.
+                data += next->message_size;
+                size = next->total_size - next->message_size;
+                msgsize = 0;
+                fec = true;
+                LOG_VERBOSE("AooSink: recover block " << b.sequence
+                            << " from block " << next->sequence);
+            }
+        }
     }
 
     // decode and push audio data to resampler
@@ -2415,7 +2791,7 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
         buffer = (AooSample *)alloca(bufsize * sizeof(AooSample));
     }
 
-    if (AooDecoder_decode(decoder_.get(), data + msgsize, size - msgsize, buffer, &count) != kAooOk) {
+    if (decode_samples(data + msgsize, size - msgsize, buffer, &count, fec) != kAooOk) {
         LOG_WARNING("AooSink: couldn't decode block!");
         // decoder failed - fill with zeros
         std::fill(buffer, buffer + bufsize, 0);
@@ -2431,7 +2807,17 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
                 // difference between source and sink.
                 // NB: we only do this if dynamic resampling is enabled here on this sink,
                 // regardless whether the source sends its real samplerate or not!
-                resampler_.update(sr, s.real_samplerate());
+                // With adaptive latency, we also change the playback speed,
+                // see adapt_latency().
+                if (s.dynamic_resampling()) {
+                    resampler_.update(sr * speed_, s.real_samplerate());
+                } else {
+                    resampler_.update(format_->sampleRate * speed_, s.samplerate());
+                }
+                if (speed_ != 1) {
+                    auto nominal = (double)s.samplerate() / (double)format_->sampleRate;
+                    latency_adjust_ += (double)framesize * nominal * (1.0 / speed_ - 1.0);
+                }
             }
         } else {
             LOG_ERROR("AooSink: bug: couldn't write to resampler");
@@ -2461,7 +2847,8 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
         sched_stream_message(&msg->header);
     }
 
-    double resample = (double)s.samplerate() / sr;
+    // NB: take the playback speed into account!
+    double resample = (double)s.samplerate() / (sr * speed_);
 
     // schedule stream messages
     if (msgsize > 0) {
@@ -2508,6 +2895,41 @@ bool source_desc::try_decode_block(const Sink& s, AooSample* buffer, stream_stat
     return true;
 }
 
+// decode a block into the given buffer; the buffer is either interleaved
+// or non-interleaved with a channel stride of 'nframes', see update().
+// If 'fec' is true, recover the preceding block from the redundant data.
+AooError source_desc::decode_samples(const AooByte *data, int32_t size,
+                                     AooSample *buffer, AooInt32 *nframes, bool fec) {
+    if (fec) {
+        if (planar_) {
+            // FEC decoding is always interleaved
+            auto nchannels = format_->numChannels;
+            auto nsamples = (*nframes) * nchannels;
+            auto temp = (AooSample *)alloca(nsamples * sizeof(AooSample));
+            auto err = AooDecoder_decodeFec(decoder_.get(), data, size, temp, nframes);
+            if (err == kAooOk) {
+                for (int i = 0; i < nchannels; ++i) {
+                    for (int j = 0; j < *nframes; ++j) {
+                        buffer[i * (*nframes) + j] = temp[j * nchannels + i];
+                    }
+                }
+            }
+            return err;
+        } else {
+            return AooDecoder_decodeFec(decoder_.get(), data, size, buffer, nframes);
+        }
+    } else if (planar_) {
+        auto nchannels = format_->numChannels;
+        auto channels = (AooSample **)alloca(nchannels * sizeof(AooSample *));
+        for (int i = 0; i < nchannels; ++i) {
+            channels[i] = buffer + i * (*nframes);
+        }
+        return AooDecoder_decodePlanar(decoder_.get(), data, size, channels, nframes);
+    } else {
+        return AooDecoder_decode(decoder_.get(), data, size, buffer, nframes);
+    }
+}
+
 // /aoo/src/<id>/data <sink> <stream_id> <seq0> <frame0> <seq1> <frame1> ...
 
 // deal with "holes" in block queue
@@ -2586,9 +3008,11 @@ void source_desc::sched_stream_message(stream_message_header *msg) {
     }
 }
 
-void source_desc::dispatch_stream_messages(const Sink &s, int nsamples,
-                                           AooStreamMessageHandler fn, void *user) {
-    // dispatch stream messages
+// move due stream messages to the ready list; the actual messages are
+// dispatched later in dispatch_stream_messages(), see mix().
+void source_desc::collect_stream_messages(const Sink &s, int nsamples) {
+    assert(ready_messages_ == nullptr);
+    auto tail = &ready_messages_;
     auto deadline = process_samples_ + nsamples;
     while (stream_messages_) {
         auto it = stream_messages_;
@@ -2597,6 +3021,7 @@ void source_desc::dispatch_stream_messages(const Sink &s, int nsamples,
             if (offset >= nsamples) {
                 break;
             }
+            auto next = it->next;
             if (it->type == kAooDataStreamTime) {
                 // a) stream time event
                 if (offset >= 0) {
@@ -2618,35 +3043,19 @@ void source_desc::dispatch_stream_messages(const Sink &s, int nsamples,
             } else {
                 // b) stream message
                 if (offset >= 0) {
-                    AooStreamMessage msg;
-                    msg.sampleOffset = offset;
-                    msg.channel = it->channel;
-                    msg.type = it->type;
-                    msg.size = it->size;
-                    msg.data = (const AooByte *)reinterpret_cast<flat_stream_message *>(it)->data;
-
-                    AooEndpoint ep;
-                    ep.address = this->ep.address.address();
-                    ep.addrlen = this->ep.address.length();
-                    ep.id = this->ep.id;
-
-                #if AOO_DEBUG_STREAM_MESSAGE
-                    LOG_DEBUG("AooSink: dispatch stream message "
-                              << "(type: " << aoo_dataTypeToString(msg.type)
-                              << ", channel: " << msg.channel << ", size: " << msg.size
-                              << ", offset: " << msg.sampleOffset << ")");
-                #endif
-
-                    // NB: the stream message handler is called with the mutex locked!
-                    // See the documentation of AooStreamMessageHandler.
-                    fn(user, &msg, &ep);
+                    // store the sample offset and append to ready list
+                    it->time = offset;
+                    it->next = nullptr;
+                    *tail = it;
+                    tail = &it->next;
+                    stream_messages_ = next;
+                    continue;
                 } else {
                     // this may happen with xruns
                     LOG_VERBOSE("AooSink: skip stream message (offset: " << offset << ")");
                 }
             }
 
-            auto next = it->next;
             auto alloc_size = sizeof(stream_message_header) + it->size;
             aoo::rt_deallocate(it, alloc_size);
             stream_messages_ = next;
@@ -2657,12 +3066,48 @@ void source_desc::dispatch_stream_messages(const Sink &s, int nsamples,
     process_samples_ = deadline;
 }
 
+void source_desc::dispatch_stream_messages(AooStreamMessageHandler fn, void *user) {
+    while (ready_messages_) {
+        auto it = ready_messages_;
+
+        AooStreamMessage msg;
+        msg.sampleOffset = it->time;
+        msg.channel = it->channel;
+        msg.type = it->type;
+        msg.size = it->size;
+        msg.data = (const AooByte *)reinterpret_cast<flat_stream_message *>(it)->data;
+
+        AooEndpoint ep;
+        ep.address = this->ep.address.address();
+        ep.addrlen = this->ep.address.length();
+        ep.id = this->ep.id;
+
+    #if AOO_DEBUG_STREAM_MESSAGE
+        LOG_DEBUG("AooSink: dispatch stream message "
+                  << "(type: " << aoo_dataTypeToString(msg.type)
+                  << ", channel: " << msg.channel << ", size: " << msg.size
+                  << ", offset: " << msg.sampleOffset << ")");
+    #endif
+
+        // See the documentation of AooStreamMessageHandler.
+        fn(user, &msg, &ep);
+
+        auto next = it->next;
+        auto alloc_size = sizeof(stream_message_header) + it->size;
+        aoo::rt_deallocate(it, alloc_size);
+        ready_messages_ = next;
+    }
+}
+
 void source_desc::flush_packet_queue() {
     LOG_DEBUG("AooSink: flush packet queue");
     packet_queue_.consume_all([&](auto& packet) {
         if (packet.frame) {
             frame_allocator_.deallocate(packet.frame);
         }
+        if (packet.buffer) {
+            packet.buffer->release(frame_allocator_);
+        }
     });
 }
 
@@ -19,8 +19,10 @@
 #include "packet_buffer.hpp"
 #include "detail.hpp"
 #include "events.hpp"
+#include "jitter_estimator.hpp"
 #include "resampler.hpp"
 #include "time_dll.hpp"
+#include "worker_pool.hpp"
 
 #include "osc/OscOutboundPacketStream.h"
 #include "osc/OscReceivedElements.h"
@@ -31,6 +33,7 @@ struct stream_stats {
     int32_t dropped = 0;
     int32_t resent = 0;
     int32_t xrun = 0;
+    int32_t recovered = 0;
 };
 
 enum class request_type {
@@ -109,6 +112,11 @@ enum class stream_state : uint8_t {
 
 struct net_packet : data_packet {
     int32_t stream_id;
+    // number of blocks covered by a parity packet; 0 = data packet
+    int32_t parity_count = 0;
+    // the frame has already been written to this block buffer;
+    // in this case, 'frame' is NULL. See block_assembler.
+    block_buffer *buffer = nullptr;
 };
 
 struct stream_message_header {
@@ -183,12 +191,26 @@ public:
     bool process(const Sink& s, AooSample **buffer, int32_t nsamples,
                  time_tag tt, AooStreamMessageHandler handler, void *user);
 
+    // process() is split into two phases:
+    // 1. decode() decodes and resamples audio into the scratch buffer
+    //    and collects due events and stream messages. It does not touch
+    //    any shared state, so it may run on a worker thread in parallel
+    //    with the decode() methods of other sources.
+    // 2. mix() sums the scratch buffer into the output and dispatches
+    //    events and stream messages. Always called on the audio thread.
+    void decode(const Sink& s, int32_t nsamples, time_tag tt);
+
+    bool mix(const Sink& s, AooSample **buffer, int32_t nsamples,
+             AooStreamMessageHandler handler, void *user);
+
     void invite(const Sink& s, AooId token, AooData *metadata);
 
     void uninvite(const Sink& s);
 
     float get_buffer_fill_ratio();
 
+    void get_frame_allocator_stats(AooFrameAllocatorStats& stats) const;
+
     void add_xrun(double nblocks);
 private:
     using shared_lock = sync::shared_lock<sync::shared_mutex>;
@@ -198,7 +220,11 @@ private:
 
     void update(const Sink& s);
 
-    void check_latency(const Sink& s);
+    void check_latency(const Sink& s, int32_t tolerance = 0);
+
+    void update_jitter(const Sink& s, int32_t seq);
+
+    void adapt_latency(const Sink& s);
 
     void on_underrun(const Sink& s);
 
@@ -209,14 +235,22 @@ private:
     bool add_packet(const Sink& s, const net_packet& d,
                     stream_stats& stats);
 
+    bool add_parity(const net_packet& d);
+
+    void reset_jitter_buffer();
+
     bool try_decode_block(const Sink& s, AooSample* buffer, stream_stats& stats);
 
+    AooError decode_samples(const AooByte *data, int32_t size,
+                            AooSample *buffer, AooInt32 *nframes, bool fec = false);
+
     void check_missing_blocks(const Sink& s);
 
     void sched_stream_message(stream_message_header *msg);
 
-    void dispatch_stream_messages(const Sink& s, int nsamples,
-                                  AooStreamMessageHandler fn, void *user);
+    void collect_stream_messages(const Sink& s, int nsamples);
+
+    void dispatch_stream_messages(AooStreamMessageHandler fn, void *user);
 
     void flush_packet_queue();
 
@@ -275,14 +309,27 @@ private:
     // resampler
     dynamic_resampler resampler_;
     // packet queue and jitter buffer
-    // NB: frame_allocator_ must come *before* jitter_buffer_!
+    // NB: frame_allocator_ must come *before* jitter_buffer_, parity_buffer_
+    // and block_assembler_!
     data_frame_allocator frame_allocator_;
     aoo::unbounded_mpsc_queue<net_packet> packet_queue_;
     jitter_buffer jitter_buffer_{frame_allocator_};
+    parity_buffer parity_buffer_{frame_allocator_};
+    block_assembler block_assembler_{frame_allocator_}; // network thread
     int32_t latency_blocks_ = 0;
     int32_t latency_samples_ = 0;
+    // adaptive latency, see adapt_latency()
+    jitter_estimator jitter_estimator_;
+    double latency_base_ = 0; // buffer latency after buffering
+    double latency_adjust_ = 0; // accumulated latency change
+    double speed_ = 1; // playback speed
+    int32_t min_latency_samples_ = 0;
+    int32_t last_late_ = -1; // last late block
+    bool adaptive_ = false;
     // stream messages
     stream_message_header *stream_messages_ = nullptr;
+    // due messages, see collect_stream_messages()
+    stream_message_header *ready_messages_ = nullptr;
     double stream_samples_ = 0;
     int64_t process_samples_ = 0;
     void reset_stream();
@@ -304,6 +351,16 @@ private:
     event_buffer event_buffer_;
     void queue_event(event_ptr e);
     void flush_events(const Sink& s);
+    // decode() results, see mix()
+    aoo::vector<AooSample> process_buffer_;
+    stream_stats process_stats_;
+    int16_t process_channels_ = 0;
+    // decoded audio (and thus the resampler and process buffer)
+    // is non-interleaved; see update()
+    bool planar_ = false;
+    // the decoder can recover lost blocks from the following block
+    bool fec_ = false;
+    bool process_result_ = false;
     // thread synchronization
     sync::shared_mutex mutex_; // LATER replace with a spinlock?
 };
@@ -362,6 +419,8 @@ public:
 
     bool dynamic_resampling() const { return dynamic_resampling_.load(); }
 
+    bool adaptive_latency() const { return adaptive_latency_.load(); }
+
     AooResampleMethod resample_method() const { return resample_method_.load(); }
 
     AooSeconds latency() const { return latency_.load(); }
@@ -400,6 +459,16 @@ private:
     using source_lock = std::unique_lock<source_list>;
     source_list sources_;
     sync::mutex source_mutex_;
+    // parallel processing
+    static constexpr int32_t max_parallel_sources = 64;
+    std::unique_ptr<worker_pool> worker_pool_;
+    sync::spinlock worker_pool_lock_;
+    // NB: the getter must not take the lock, see kAooCtlGetProcessThreadCount
+    std::atomic<int32_t> process_threads_{0};
+    std::array<source_desc *, max_parallel_sources> process_list_;
+    int32_t process_nsamples_ = 0;
+    time_tag process_tt_;
+    bool process_parallel(int32_t nsamples, time_tag tt);
     // timing
     time_dll dll_;
     parameter<AooSampleRate> realsr_{0};
@@ -421,6 +490,7 @@ private:
     parameter<float> dll_bandwidth_{ AOO_DLL_BANDWIDTH };
     parameter<bool> resend_{ AOO_RESEND_DATA };
     parameter<bool> dynamic_resampling_{ AOO_DYNAMIC_RESAMPLING };
+    parameter<bool> adaptive_latency_{ AOO_SINK_ADAPTIVE_LATENCY };
     parameter<bool> binary_{ AOO_BINARY_FORMAT };
     parameter<char> resample_method_{ AOO_RESAMPLE_MODE };
 
@@ -464,6 +534,9 @@ private:
     AooError handle_data_message(const AooByte *msg, int32_t n,
                                  AooId id, const ip_address& addr);
 
+    AooError handle_parity_message(const AooByte *msg, int32_t n,
+                                   AooId id, const ip_address& addr);
+
     AooError handle_data_packet(net_packet& d, bool binary,
                                 const ip_address& addr, AooId id);
 
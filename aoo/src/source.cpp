@@ -26,6 +26,32 @@ const int32_t kDataHeaderSize = kDataMaxAddrSize + 52;
 // args: 40 bytes max. (12 bytes min.)
 const int32_t kBinDataHeaderSize = kAooBinMsgLargeHeaderSize + 40;
 
+// binary parity message:
+// args: 20 bytes
+const int32_t kBinParityHeaderSize = kAooBinMsgLargeHeaderSize + 20;
+
+//------------------- data_osc_header -------------------//
+
+void data_osc_header::update(AooId sink, AooId source, AooId stream) {
+    // address pattern, padded with zeros to 4 bytes
+    auto len = snprintf((char *)data, max_size, "%s/%d%s",
+                        kAooMsgDomain kAooMsgSink, (int)sink, kAooMsgData);
+    auto onset = (len + 4) & ~3;
+    std::fill(data + len, data + onset, 0);
+    // type tag string; filled in by send_packet_osc()
+    typetag_onset = onset;
+    std::fill(data + onset, data + onset + typetag_size, 0);
+    // source ID and stream ID
+    auto it = data + onset + typetag_size;
+    aoo::write_bytes<int32_t>(source, it);
+    aoo::write_bytes<int32_t>(stream, it);
+    size = it - data;
+    assert(size <= max_size);
+
+    source_id = source;
+    stream_id = stream;
+}
+
 //-------------------- sink_desc ------------------------//
 
 // called while locked
@@ -134,6 +160,48 @@ void sink_desc::activate(Source& s, bool b) {
     }
 }
 
+bool sink_desc::is_member(const ip_address& addr) const {
+    sync::scoped_lock<sync::mutex> lock(member_mutex_);
+    return members_.find(addr) != members_.end();
+}
+
+void sink_desc::add_member(const ip_address& addr) {
+    sync::scoped_lock<sync::mutex> lock(member_mutex_);
+    members_.try_emplace(addr);
+}
+
+void sink_desc::set_member_rtt(const ip_address& addr, double rtt) {
+    sync::scoped_lock<sync::mutex> lock(member_mutex_);
+    if (auto it = members_.find(addr); it != members_.end()) {
+        it->second.rtt = rtt;
+        it->second.pings = 0;
+        // NB: the max. RTT only shrinks in expire_members()
+        if (rtt > max_member_rtt_.load(std::memory_order_relaxed)) {
+            max_member_rtt_.store(rtt, std::memory_order_relaxed);
+        }
+    }
+}
+
+void sink_desc::expire_members(int32_t max_pings) {
+    sync::scoped_lock<sync::mutex> lock(member_mutex_);
+    double max_rtt = 0;
+    for (auto it = members_.begin(); it != members_.end(); ) {
+        if (++it->second.pings > max_pings) {
+            LOG_VERBOSE("AooSource: " << it->first << " left multicast group " << ep);
+            it = members_.erase(it);
+        } else {
+            max_rtt = std::max<double>(max_rtt, it->second.rtt);
+            ++it;
+        }
+    }
+    max_member_rtt_.store(max_rtt, std::memory_order_relaxed);
+}
+
+int32_t sink_desc::member_count() const {
+    sync::scoped_lock<sync::mutex> lock(member_mutex_);
+    return members_.size();
+}
+
 } // namespace aoo
 
 //---------------------- Source -------------------------//
@@ -156,6 +224,7 @@ AOO_API void AOO_CALL AooSource_free(AooSource *src){
 }
 
 aoo::Source::~Source() {
+    stop_encoder_thread();
     // free previous (unaccepted) metadata, if any
     free_metadata(stream_state_.load());
 }
@@ -247,6 +316,7 @@ AooError AOO_CALL aoo::Source::control(
         scoped_lock lock(update_mutex_); // writer lock!
         resampler_.reset();
         audio_queue_.reset();
+        encoded_queue_.reset();
         if (encoder_) {
             AooEncoder_reset(encoder_.get());
         }
@@ -396,6 +466,48 @@ AooError AOO_CALL aoo::Source::control(
         CHECKARG(int32_t);
         as<int32_t>(ptr) = redundancy_.load();
         break;
+    // set/get FEC window
+    case kAooCtlSetFecWindow:
+    {
+        CHECKARG(int32_t);
+        // a window of 1 would just duplicate every block (= redundancy);
+        // the upper limit is given by the binary parity message.
+        auto n = as<int32_t>(ptr);
+        fec_window_.store(n > 1 ? std::min<int32_t>(n, parity_encoder::max_window) : 0);
+        break;
+    }
+    case kAooCtlGetFecWindow:
+        CHECKARG(int32_t);
+        as<int32_t>(ptr) = fec_window_.load();
+        break;
+    // set/get resend bandwidth
+    case kAooCtlSetResendBandwidth:
+        CHECKARG(int32_t);
+        resend_bandwidth_.store(std::max<int32_t>(as<int32_t>(ptr), 0));
+        break;
+    case kAooCtlGetResendBandwidth:
+        CHECKARG(int32_t);
+        as<int32_t>(ptr) = resend_bandwidth_.load();
+        break;
+    // set/get resend deduplication interval
+    case kAooCtlSetResendDedupInterval:
+        CHECKARG(AooSeconds);
+        resend_dedup_interval_.store(std::max<AooSeconds>(as<AooSeconds>(ptr), 0));
+        break;
+    case kAooCtlGetResendDedupInterval:
+        CHECKARG(AooSeconds);
+        as<AooSeconds>(ptr) = resend_dedup_interval_.load();
+        break;
+    // get resend statistics
+    case kAooCtlGetResendStats:
+    {
+        CHECKARG(AooResendStats);
+        auto& stats = as<AooResendStats>(ptr);
+        stats.requestCount = resend_requested_.load(std::memory_order_relaxed);
+        stats.sentCount = resend_sent_.load(std::memory_order_relaxed);
+        stats.suppressedCount = resend_suppressed_.load(std::memory_order_relaxed);
+        break;
+    }
     case kAooCtlSetBinaryFormat:
         CHECKARG(AooBool);
         binary_.store(as<AooBool>(ptr));
@@ -412,6 +524,18 @@ AooError AOO_CALL aoo::Source::control(
         CHECKARG(AooSeconds);
         as<AooSeconds>(ptr) = tt_interval_.load();
         break;
+    case kAooCtlSetEncoderThread:
+        CHECKARG(AooBool);
+        if (as<AooBool>(ptr)) {
+            start_encoder_thread();
+        } else {
+            stop_encoder_thread();
+        }
+        break;
+    case kAooCtlGetEncoderThread:
+        CHECKARG(AooBool);
+        as<AooBool>(ptr) = encoder_threaded_.load();
+        break;
 #if AOO_NET
     case kAooCtlSetClient:
         client_ = reinterpret_cast<AooClient *>(index);
@@ -783,30 +907,10 @@ AooError AOO_CALL aoo::Source::process(
         return kAooErrorIdle;
     }
 
-    // non-interleaved -> interleaved
     // only as many channels as current format needs
     auto nfchannels = format_->numChannels;
     auto bufsize = nsamples * nfchannels;
     assert(bufsize > 0);
-    auto buf = (AooSample *)alloca(bufsize * sizeof(AooSample));
-    if (data) {
-        for (int i = 0; i < nfchannels; ++i){
-            if (i < nchannels_){
-                for (int j = 0; j < nsamples; ++j){
-                    buf[j * nfchannels + i] = data[i][j];
-                }
-            } else {
-                // zero remaining channel
-                for (int j = 0; j < nsamples; ++j){
-                    buf[j * nfchannels + i] = 0;
-                }
-            }
-        }
-    } else {
-        // no buffers -> fill with zeros
-        std::fill(buf, buf + bufsize, 0);
-    }
-
     double sr;
     if (dynamic_resampling){
         sr = realsr_.load() / (double)samplerate_ * (double)format_->sampleRate;
@@ -827,7 +931,7 @@ AooError AOO_CALL aoo::Source::process(
         if (audio_queue_.write_available()){
             auto ptr = (block_data *)audio_queue_.write_data();
             // copy audio samples
-            std::copy(buf, buf + bufsize, ptr->data);
+            copy_input(data, ptr->data, nsamples);
             // push samplerate
             ptr->sr = sr;
 
@@ -839,6 +943,8 @@ AooError AOO_CALL aoo::Source::process(
             return kAooErrorOverflow;
         }
     } else {
+        auto buf = (AooSample *)alloca(bufsize * sizeof(AooSample));
+        copy_input(data, buf, nsamples);
         // try to write to resampler
         if (!resampler_.write(buf, nsamples)) {
             LOG_WARNING("AooSource: send buffer overflow");
@@ -859,6 +965,8 @@ AooError AOO_CALL aoo::Source::process(
             audio_queue_.write_commit();
         }
     }
+    // notify encoder thread (if enabled)
+    notify_encoder();
     return kAooOk;
 }
 
@@ -1113,6 +1221,44 @@ sink_desc * Source::find_sink(const ip_address& addr, AooId id){
     return nullptr;
 }
 
+// Find the multicast sink group for a message from one of its members.
+// Only endpoints that have joined the group are accepted, see join_group().
+sink_desc * Source::find_group(const ip_address& addr, AooId id){
+    for (auto& sink : sinks_){
+        if (sink.is_multicast() && sink.ep.id == id && sink.is_member(addr)){
+            return &sink;
+        }
+    }
+    return nullptr;
+}
+
+// Add an endpoint to a multicast sink group. An endpoint can only join
+// if it has proven that it actually receives the group traffic, i.e. if it
+// knows the current stream ID (data and stop requests) or if it replies
+// to a ping that has been sent to the group (see handle_pong()); in the
+// latter case, 'stream_id' is kAooIdInvalid.
+sink_desc * Source::join_group(const ip_address& addr, AooId id, AooId stream_id){
+    for (auto& sink : sinks_){
+        if (sink.is_multicast() && sink.ep.id == id && sink.is_active() &&
+                (stream_id == kAooIdInvalid || sink.stream_id() == stream_id)){
+            if (!sink.is_member(addr)) {
+                LOG_VERBOSE("AooSource: " << addr << " joined multicast group " << sink.ep);
+                sink.add_member(addr);
+            }
+            return &sink;
+        }
+    }
+    return nullptr;
+}
+
+// check if the time tag belongs to one of the last two pings that
+// have been sent to a multicast group, see send_ping().
+bool Source::is_group_ping(time_tag tt) const {
+    return !tt.is_empty() &&
+        (tt.value() == last_ping_tt_[0].load(std::memory_order_relaxed) ||
+         tt.value() == last_ping_tt_[1].load(std::memory_order_relaxed));
+}
+
 aoo::sink_desc * Source::get_sink_arg(intptr_t index){
     auto ep = (const AooEndpoint *)index;
     if (!ep){
@@ -1141,6 +1287,7 @@ sink_desc * Source::do_add_sink(const ip_address& addr, AooId id, AooId stream_i
         scoped_lock lock(update_mutex_); // writer lock!
         resampler_.reset();
         audio_queue_.reset();
+        encoded_queue_.reset();
         if (encoder_) {
             AooEncoder_reset(encoder_.get());
         }
@@ -1151,7 +1298,8 @@ sink_desc * Source::do_add_sink(const ip_address& addr, AooId id, AooId stream_i
 #if AOO_NET
     ip_address relay;
     // check if the peer needs to be relayed
-    if (client_){
+    // NB: multicast sinks can't be relayed
+    if (client_ && !addr.is_multicast()){
         AooBool b;
         AooEndpoint ep { addr.address(), (AooAddrSize)addr.length(), id };
         if (client_->control(kAooCtlNeedRelay, reinterpret_cast<intptr_t>(&ep),
@@ -1225,6 +1373,10 @@ AooError Source::set_format(AooFormat &f){
         LOG_ERROR("AooSource: couldn't setup encoder!");
         return err;
     }
+    // use non-interleaved audio if the encoder supports it
+    planar_ = AOO_PLANAR_AUDIO && AooEncoder_hasPlanar(encoder_.get());
+    // the encoder setup resets the expected packet loss
+    encoder_packet_loss_ = 0;
 
     // save validated format
     auto fmt = (AooFormat*)aoo::allocate(f.structSize);
@@ -1303,6 +1455,7 @@ void Source::make_new_stream(aoo::time_tag tt, AooData *md) {
     resampler_.reset();
 
     audio_queue_.reset();
+    encoded_queue_.reset();
 
     history_.clear(); // !
 
@@ -1373,6 +1526,44 @@ void Source::update_audio_queue(){
     #if 1
         audio_queue_.shrink_to_fit();
     #endif
+        // NB: the block buffers are only allocated on demand
+        // by the encoder thread, see encode_block().
+        encoded_queue_.resize(nbuffers);
+    }
+}
+
+// copy the (non-interleaved) input channels to the given buffer, which is
+// either interleaved or planar (see planar_). Channels which are missing
+// in the input are filled with zeros.
+void Source::copy_input(const AooSample *const *data, AooSample *buf, int32_t nsamples) {
+    auto nfchannels = format_->numChannels;
+    if (!data) {
+        // no buffers -> fill with zeros
+        std::fill(buf, buf + nsamples * nfchannels, 0);
+    } else if (planar_) {
+        for (int i = 0; i < nfchannels; ++i){
+            auto out = buf + i * nsamples;
+            if (i < nchannels_){
+                std::copy(data[i], data[i] + nsamples, out);
+            } else {
+                // zero remaining channel
+                std::fill(out, out + nsamples, 0);
+            }
+        }
+    } else {
+        // non-interleaved -> interleaved
+        for (int i = 0; i < nfchannels; ++i){
+            if (i < nchannels_){
+                for (int j = 0; j < nsamples; ++j){
+                    buf[j * nfchannels + i] = data[i][j];
+                }
+            } else {
+                // zero remaining channel
+                for (int j = 0; j < nsamples; ++j){
+                    buf[j * nfchannels + i] = 0;
+                }
+            }
+        }
     }
 }
 
@@ -1380,7 +1571,7 @@ void Source::update_resampler() {
     if (format_ && samplerate_ > 0) {
         resampler_.setup(blocksize_, format_->blockSize, flags_ & kAooFixedBlockSize,
                          samplerate_, format_->sampleRate, true, // always fixed sr!
-                         format_->numChannels, resample_method_.load());
+                         format_->numChannels, resample_method_.load(), planar_);
         if (resampler_.bypass()) {
             LOG_DEBUG("AooSource: bypass resampler");
         }
@@ -1546,7 +1737,7 @@ void Source::send_start(const sendfn& fn){
     shared_lock updatelock(update_mutex_); // reader lock!
 
     // wait until we have data to send
-    if (audio_queue_.read_available() == 0) {
+    if (audio_queue_.read_available() == 0 && encoded_queue_.read_available() == 0) {
         return;
     }
 
@@ -1568,7 +1759,11 @@ void Source::send_start(const sendfn& fn){
     auto latency = static_cast<int32_t>(reblock + resampler_.latency() * ratio);
     // get codec delay
     AooInt32 codec_delay = 0;
-    AooEncoder_control(encoder_.get(), kAooCodecCtlGetLatency, AOO_ARG(codec_delay));
+    {
+        // the encoder thread might be encoding concurrently
+        sync::scoped_lock<sync::mutex> lock(codec_mutex_);
+        AooEncoder_control(encoder_.get(), kAooCodecCtlGetLatency, AOO_ARG(codec_delay));
+    }
 
     // cache sequence number start
     auto seq_start = sequence_;
@@ -1672,43 +1867,69 @@ AooSize write_bin_data(AooByte *buffer, AooSize size,
 // /aoo/sink/<id>/data <src> <stream_id> <seq> (<tt>) (<sr>) <channel_onset>
 // <totalsize> (<msgsize>) (<nframes>) (<frame>) (<data>)
 
-void send_packet_osc(const endpoint& ep, AooId id, int32_t stream_id,
-                     const data_packet& d, const sendfn& fn) {
-    char buf[AOO_MAX_PACKET_SIZE];
-    osc::OutboundPacketStream msg(buf, sizeof(buf));
+void send_packet_osc(const endpoint& ep, data_osc_header& header, AooId id,
+                     int32_t stream_id, const data_packet& d,
+                     const sendfn& fn, AooFlag flags = 0) {
+    // only (re)build the header if the source or stream ID has changed
+    if (!header.valid(id, stream_id)) {
+        header.update(ep.id, id, stream_id);
+    }
 
-    char address[kDataMaxAddrSize];
-    snprintf(address, sizeof(address), "%s/%d%s",
-             kAooMsgDomain kAooMsgSink, (int)ep.id, kAooMsgData);
+    AooByte buf[AOO_MAX_PACKET_SIZE];
+    memcpy(buf, header.data, header.size);
+
+    // type tag string; always 12 characters (+ padding), see data_osc_header.
+    auto tags = (char *)buf + header.typetag_onset;
+    *tags++ = ',';
+    *tags++ = 'i'; // source ID
+    *tags++ = 'i'; // stream ID
+    *tags++ = 'i'; // sequence
+    *tags++ = (d.flags & kAooBinMsgDataTimeStamp) ? 't' : 'N';
+    *tags++ = (d.flags & kAooBinMsgDataSampleRate) ? 'd' : 'N';
+    *tags++ = 'i'; // channel
+    *tags++ = 'i'; // total size
+    *tags++ = (d.flags & kAooBinMsgDataStreamMessage) ? 'i' : 'N';
+    if (d.flags & kAooBinMsgDataFrames) {
+        *tags++ = 'i';
+        *tags++ = 'i';
+    } else {
+        *tags++ = 'N';
+        *tags++ = 'N';
+    }
+    *tags++ = (d.flags & kAooBinMsgDataXRun) ? 'N' : 'b';
 
-    msg << osc::BeginMessage(address) << id << stream_id << d.sequence;
+    // remaining arguments
+    auto it = buf + header.size;
+    aoo::write_bytes<int32_t>(d.sequence, it);
     if (d.flags & kAooBinMsgDataTimeStamp) {
-        msg << osc::TimeTag(d.tt);
-    } else {
-        msg << osc::Nil;
+        aoo::write_bytes<uint64_t>(d.tt, it);
     }
     if (d.flags & kAooBinMsgDataSampleRate) {
-        msg << d.samplerate;
-    } else {
-        msg << osc::Nil;
+        aoo::write_bytes<double>(d.samplerate, it);
     }
-    msg << d.channel << d.total_size;
+    aoo::write_bytes<int32_t>(d.channel, it);
+    aoo::write_bytes<int32_t>(d.total_size, it);
     if (d.flags & kAooBinMsgDataStreamMessage) {
-        msg << d.msg_size;
-    } else {
-        msg << osc::Nil;
+        aoo::write_bytes<int32_t>(d.msg_size, it);
     }
     if (d.flags & kAooBinMsgDataFrames) {
-        msg << d.num_frames << d.frame_index;
-    } else {
-        msg << osc::Nil << osc::Nil;
-    }
-    if (d.flags & kAooBinMsgDataXRun) {
-        msg << osc::Nil;
-    } else {
-        msg << osc::Blob(d.data, d.size);
+        aoo::write_bytes<int32_t>(d.num_frames, it);
+        aoo::write_bytes<int32_t>(d.frame_index, it);
+    }
+    if (!(d.flags & kAooBinMsgDataXRun)) {
+        // blob, padded with zeros to 4 bytes
+        auto padded = (d.size + 3) & ~3;
+        if (d.size < 0 || (it - buf) + 4 + padded > (int32_t)sizeof(buf)) {
+            LOG_ERROR("AooSource: can't send data packet: bad blob size (" << d.size << ")");
+            return;
+        }
+        aoo::write_bytes<int32_t>(d.size, it);
+        if (d.size > 0) {
+            memcpy(it, d.data, d.size);
+        }
+        std::fill(it + d.size, it + padded, 0);
+        it += padded;
     }
-    msg << osc::EndMessage;
 
 #if AOO_DEBUG_DATA
     LOG_DEBUG("AooSource: send block: seq = " << d.sequence << ", tt = " << d.tt << ", sr = "
@@ -1716,7 +1937,7 @@ void send_packet_osc(const endpoint& ep, AooId id, int32_t stream_id,
               << ", msgsize = " << d.msgsize << ", nframes = " << d.nframes
               << ", frame = " << d.frame << ", size " << d.size);
 #endif
-    ep.send(msg, fn);
+    ep.send(buf, it - buf, fn, flags);
 }
 
 // binary data message:
@@ -1725,7 +1946,7 @@ void send_packet_osc(const endpoint& ep, AooId id, int32_t stream_id,
 // [tt (uint64)], data...
 
 void send_packet_bin(const endpoint& ep, AooId id, AooId stream_id,
-                     const data_packet& d, const sendfn& fn) {
+                     const data_packet& d, const sendfn& fn, AooFlag flags = 0) {
     AooByte buf[AOO_MAX_PACKET_SIZE];
 
     auto onset = aoo::binmsg_write_header(buf, sizeof(buf), kAooMsgTypeSink,
@@ -1740,11 +1961,15 @@ void send_packet_bin(const endpoint& ep, AooId id, AooId stream_id,
               << d.nframes << ", frame = " << d.frame << ", size " << d.size);
 #endif
 
-    ep.send(buf, size, fn);
+    ep.send(buf, size, fn, flags);
 }
 
+// Send a data packet to all sinks. All packets except for the very last one
+// are marked with kAooSendMore, so that the send function can batch them.
+// If 'more' is true, the last packet is also marked with kAooSendMore.
 void send_packet(const aoo::vector<cached_sink>& sinks, const AooId id,
-                 data_packet& d, const sendfn &fn, bool binary) {
+                 data_packet& d, const sendfn &fn, bool binary, bool more = false) {
+    auto last = sinks.size() - 1;
     if (binary){
         AooByte buf[AOO_MAX_PACKET_SIZE];
 
@@ -1754,7 +1979,8 @@ void send_packet(const aoo::vector<cached_sink>& sinks, const AooId id,
                                       kAooIdInvalid, d);
         auto end = args + argsize;
 
-        for (auto& s : sinks) {
+        for (size_t i = 0; i < sinks.size(); ++i) {
+            auto& s = sinks[i];
         #if AOO_DEBUG_DATA
             LOG_DEBUG("AooSource: send block: seq = " << d.sequence << << ", tt = " << d.tt
                       << ", sr = " << d.samplerate << ", chn = " << s.channel << ", msgsize = "
@@ -1770,13 +1996,75 @@ void send_packet(const aoo::vector<cached_sink>& sinks, const AooId id,
             aoo::to_bytes(s.stream_id, args);
             args[8] = s.channel;
 
-            s.ep.send(start, end - start, fn);
+            AooFlag flags = (i < last || more) ? kAooSendMore : 0;
+            s.ep.send(start, end - start, fn, flags);
         }
     } else {
-        for (auto& s : sinks){
+        for (size_t i = 0; i < sinks.size(); ++i) {
+            auto& s = sinks[i];
             // set channel!
             d.channel = s.channel;
-            send_packet_osc(s.ep, id, s.stream_id, d, fn);
+            AooFlag flags = (i < last || more) ? kAooSendMore : 0;
+            send_packet_osc(s.ep, *s.osc_header, id, s.stream_id, d, fn, flags);
+        }
+    }
+}
+
+// binary parity message:
+// stream_id (int32), seq (int32), channel (uint8), count (uint8), size (uint16),
+// total (int32), nframes (int16), frame (int16), data...
+//
+// 'seq' is the first block and 'count' the number of blocks in the window,
+// see parity_encoder. NB: there is no OSC equivalent; older sinks just
+// ignore unknown binary commands.
+
+void send_parity(const aoo::vector<cached_sink>& sinks, const AooId id,
+                 const parity_encoder& parity, int32_t maxframesize,
+                 const sendfn& fn, bool more = false) {
+    auto total = parity.size();
+    auto dv = std::div(total, maxframesize);
+    auto nframes = dv.quot + (dv.rem != 0);
+    auto last = sinks.size() - 1;
+
+    AooByte buf[AOO_MAX_PACKET_SIZE];
+    // start at max. header size
+    auto args = buf + kAooBinMsgLargeHeaderSize;
+
+    for (int32_t i = 0; i < nframes; ++i) {
+        auto onset = i * maxframesize;
+        auto size = std::min<int32_t>(total - onset, maxframesize);
+        // write arguments
+        auto it = args;
+        aoo::write_bytes<int32_t>(kAooIdInvalid, it); // stream ID
+        aoo::write_bytes<int32_t>(parity.sequence(), it);
+        aoo::write_bytes<uint8_t>(0, it); // channel
+        aoo::write_bytes<uint8_t>(parity.count(), it);
+        aoo::write_bytes<uint16_t>(size, it);
+        aoo::write_bytes<uint32_t>(total, it);
+        aoo::write_bytes<uint16_t>(nframes, it);
+        aoo::write_bytes<uint16_t>(i, it);
+        memcpy(it, parity.data() + onset, size);
+        auto end = it + size;
+
+        for (size_t j = 0; j < sinks.size(); ++j) {
+            auto& s = sinks[j];
+        #if AOO_DEBUG_DATA
+            LOG_DEBUG("AooSource: send parity: seq = " << parity.sequence()
+                      << ", count = " << parity.count() << ", chn = " << s.channel
+                      << ", totalsize = " << total << ", nframes = " << nframes
+                      << ", frame = " << i << ", size " << size);
+        #endif
+            // write header
+            bool large =  s.ep.id > 255 || id > 255;
+            auto start = large ? buf : (args - kAooBinMsgHeaderSize);
+            aoo::binmsg_write_header(start, args - start, kAooMsgTypeSink,
+                                     kAooBinMsgCmdParity, s.ep.id, id);
+            // replace stream ID and channel
+            aoo::to_bytes(s.stream_id, args);
+            args[8] = s.channel;
+
+            AooFlag flags = (i < (nframes - 1) || j < last || more) ? kAooSendMore : 0;
+            s.ep.send(start, end - start, fn, flags);
         }
     }
 }
@@ -1877,7 +2165,7 @@ void Source::send_xruns(const sendfn &fn) {
 
             // save block (if we have a history buffer)
             if (history_.capacity() > 0) {
-                history_.push()->set(d, 0);
+                history_.push(d.sequence)->set(d, 0);
             }
 
             // now we can unlock
@@ -1893,16 +2181,31 @@ void Source::send_xruns(const sendfn &fn) {
 
 // This method reads audio samples from the ringbuffer,
 // encodes them and sends them to all sinks.
+// If the encoder thread is enabled, we get the encoded
+// blocks from the encoded block queue instead.
 void Source::send_data(const sendfn& fn){
     // *first* handle xruns
     send_xruns(fn);
 
     // then send audio
     shared_lock updatelock(update_mutex_); // reader lock
-    while (audio_queue_.read_available()) {
+    for (;;) {
         // NB: recheck one every iteration because we temporarily release the lock!
         if (!encoder_ || sequence_ == invalid_stream) {
-            return;
+            break;
+        }
+        // NB: always drain the encoded block queue, so we don't lose
+        // any blocks after the encoder thread has been stopped.
+        if (encoded_queue_.read_available() > 0) {
+            encoded_queue_.consume([&](auto& block) {
+                // swap buffers to avoid memory allocations
+                std::swap(send_block_, block);
+            });
+        } else if (!encoder_threaded_.load(std::memory_order_relaxed)
+                   && audio_queue_.read_available() > 0) {
+            encode_block(send_block_);
+        } else {
+            break;
         }
 
         // reset and reserve space for message count
@@ -1985,8 +2288,12 @@ void Source::send_data(const sendfn& fn){
 
         stream_samples_ = deadline;
 
+        // the block has not been encoded (no sinks or encoder error)
+        if (!send_block_.active) {
+            continue;
+        }
+
         // cache sinks
-        bool had_sinks = cached_sinks_.size();
         cached_sinks_.clear();
         sink_lock lock(sinks_);
         for (auto& s : sinks_){
@@ -1995,54 +2302,24 @@ void Source::send_data(const sendfn& fn){
             }
         }
         lock.unlock();
-        // if we don't have any (active) sinks, we do not actually need
-        // to encode and send the data!
+        // the sinks might have been removed in the meantime
         if (cached_sinks_.empty()) {
-            audio_queue_.read_commit(); // !
-            if (had_sinks) {
-                assert(encoder_);
-                LOG_DEBUG("AooSource: clear encoder (no sinks)");
-                // reset encoder to prevent artifacts
-                AooEncoder_reset(encoder_.get());
-            }
             continue;
         }
 
-        auto ptr = (block_data *)audio_queue_.read_data();
-
         data_packet d;
         d.tt = tt;
-        d.samplerate = ptr->sr;
+        d.samplerate = send_block_.sr;
         d.channel = 0;
         d.flags = 0;
         d.msg_size = sendbuffer_.size();
         // message size must be a multiple of 4!
         assert((d.msg_size & 3) == 0);
 
-        // copy and convert audio samples to blob data
-        auto nchannels = format_->numChannels;
-        auto framesize = format_->blockSize;
-        auto nsamples = nchannels * framesize;
-    #if 0
-        Log log;
-        for (int i = 0; i < nsamples; ++i){
-            log << ptr->data[i] << " ";
-        }
-    #endif
-
-        int32_t audio_size = sizeof(double) * nsamples; // overallocate
-        sendbuffer_.resize(d.msg_size + audio_size);
-
-        auto err = AooEncoder_encode(encoder_.get(), ptr->data, framesize,
-            sendbuffer_.data() + d.msg_size, &audio_size);
-        d.total_size = d.msg_size + audio_size;
-
-        audio_queue_.read_commit(); // always commit!
-
-        if (err != kAooOk){
-            LOG_WARNING("AooSource: couldn't encode audio data!");
-            return;
-        }
+        // append audio data
+        auto& audio = send_block_.data;
+        sendbuffer_.insert(sendbuffer_.end(), audio.begin(), audio.end());
+        d.total_size = sendbuffer_.size();
 
         // NOTE: we're the only thread reading 'sequence_', so we can increment
         // it even while holding a reader lock!
@@ -2077,7 +2354,14 @@ void Source::send_data(const sendfn& fn){
         // save block (if we have a history buffer)
         if (history_.capacity() > 0){
             d.data = sendbuffer_.data();
-            history_.push()->set(d, maxpacketsize);
+            history_.push(d.sequence)->set(d, maxpacketsize);
+        }
+
+        // add block to the parity window (if enabled)
+        bool have_parity = false;
+        if (auto window = fec_window_.load(); window > 0 && binary) {
+            d.data = sendbuffer_.data();
+            have_parity = parity_.add(d, window);
         }
 
         // unlock before sending!
@@ -2088,32 +2372,212 @@ void Source::send_data(const sendfn& fn){
         // send a single frame to all sinks
         // /aoo/<sink>/data <src> <stream_id> <seq> <sr> <channel_onset>
         // <totalsize> <msgsize> <numframes> <frame> <data>
-        auto dosend = [&](int32_t frame, const AooByte* data, auto n){
+        // NB: all frames of a block are sent as a single batch.
+        auto dosend = [&](int32_t frame, const AooByte* data, auto n, bool more){
             d.frame_index = frame;
             d.data = data;
             d.size = n;
             // send block to all sinks
-            send_packet(cached_sinks_, id(), d, fn, binary);
+            send_packet(cached_sinks_, id(), d, fn, binary, more);
         };
 
         auto ntimes = redundancy_.load();
+        bool have_rest = dv.rem || d.total_size == 0;
         for (auto i = 0; i < ntimes; ++i){
             auto ptr = sendbuffer_.data();
+            // NB: the parity block is sent in the same batch
+            bool last_round = i == (ntimes - 1) && !have_parity;
             // send large frames (might be 0)
             for (int32_t j = 0; j < dv.quot; ++j, ptr += maxpacketsize){
-                dosend(j, ptr, maxpacketsize);
+                bool more = !last_round || have_rest || (j + 1) < dv.quot;
+                dosend(j, ptr, maxpacketsize, more);
             }
             // send remaining bytes as a single frame (might be the only one!)
             // also make sure to send frames encoded with null codec.
-            if (dv.rem || d.total_size == 0){
-                dosend(dv.quot, ptr, dv.rem);
+            if (have_rest){
+                dosend(dv.quot, ptr, dv.rem, !last_round);
             }
         }
 
+        // send parity block after the last block of the window
+        if (have_parity) {
+            send_parity(cached_sinks_, id(), parity_,
+                        packetsize - kBinParityHeaderSize, fn);
+            parity_.reset();
+        }
+
         updatelock.lock();
     }
+    updatelock.unlock();
+
+    // the encoder thread might wait for free space
+    notify_encoder();
+}
+
+// Read the next block from the audio queue and encode it.
+// Always called with update lock and only from a single thread.
+void Source::encode_block(encoded_block& block) {
+    assert(encoder_ != nullptr);
+    assert(audio_queue_.read_available() > 0);
+
+    // if we don't have any (active) sinks, we do not actually need
+    // to encode the data!
+    // Also get the highest packet loss reported by the sinks, see handle_pong().
+    bool active = false;
+    int32_t packet_loss = 0;
+    sink_lock lock(sinks_);
+    for (auto& s : sinks_){
+        if (s.is_active()){
+            active = true;
+            packet_loss = std::max<int32_t>(packet_loss, s.packet_loss());
+        }
+    }
+    lock.unlock();
+
+    auto ptr = (block_data *)audio_queue_.read_data();
+    block.sr = ptr->sr;
+
+    if (!active) {
+        audio_queue_.read_commit(); // !
+        if (encoder_active_) {
+            LOG_DEBUG("AooSource: clear encoder (no sinks)");
+            // reset encoder to prevent artifacts
+            sync::scoped_lock<sync::mutex> l(codec_mutex_);
+            AooEncoder_reset(encoder_.get());
+        }
+        encoder_active_ = false;
+        block.active = false;
+        block.data.clear();
+        return;
+    }
+    encoder_active_ = true;
+
+    // copy and convert audio samples to blob data
+    auto nchannels = format_->numChannels;
+    auto framesize = format_->blockSize;
+    auto nsamples = nchannels * framesize;
+#if 0
+    Log log;
+    for (int i = 0; i < nsamples; ++i){
+        log << ptr->data[i] << " ";
+    }
+#endif
+
+    int32_t audio_size = sizeof(double) * nsamples; // overallocate
+    block.data.resize(audio_size);
+
+    AooError err;
+    {
+        sync::scoped_lock<sync::mutex> l(codec_mutex_);
+        // update the expected packet loss (only for codecs with in-band FEC;
+        // other codecs would complain about an unsupported codec ctl)
+        if (packet_loss != encoder_packet_loss_ && AooEncoder_hasFec(encoder_.get())) {
+            LOG_DEBUG("AooSource: set expected packet loss to " << packet_loss << "%");
+            AooEncoder_control(encoder_.get(), kAooCodecCtlSetPacketLoss,
+                               AOO_ARG(packet_loss));
+            encoder_packet_loss_ = packet_loss;
+        }
+        if (planar_) {
+            auto channels = (const AooSample **)alloca(nchannels * sizeof(AooSample *));
+            for (int i = 0; i < nchannels; ++i) {
+                channels[i] = ptr->data + i * framesize;
+            }
+            err = AooEncoder_encodePlanar(encoder_.get(), channels, framesize,
+                                          block.data.data(), &audio_size);
+        } else {
+            err = AooEncoder_encode(encoder_.get(), ptr->data, framesize,
+                                    block.data.data(), &audio_size);
+        }
+    }
+
+    audio_queue_.read_commit(); // always commit!
+
+    if (err == kAooOk) {
+        block.data.resize(audio_size);
+        block.active = true;
+    } else {
+        LOG_WARNING("AooSource: couldn't encode audio data!");
+        block.data.clear();
+        block.active = false;
+    }
+}
+
+void Source::start_encoder_thread() {
+    if (encoder_thread_.joinable()) {
+        return; // already running
+    }
+    encoder_quit_.store(false);
+    encoder_sleeping_.store(false);
+    {
+        // NB: the send thread stops encoding blocks from now on.
+        scoped_lock lock(update_mutex_); // writer lock!
+        encoder_threaded_.store(true);
+    }
+    encoder_thread_ = std::thread([this]() {
+        encoder_thread_function();
+    });
+    LOG_DEBUG("AooSource: start encoder thread");
+}
+
+void Source::stop_encoder_thread() {
+    if (!encoder_thread_.joinable()) {
+        return; // not running
+    }
+    encoder_quit_.store(true);
+    encoder_semaphore_.post();
+    encoder_thread_.join();
+    {
+        // NB: the send thread will first drain the remaining blocks
+        // and then continue to encode blocks itself, see send_data().
+        scoped_lock lock(update_mutex_); // writer lock!
+        encoder_threaded_.store(false);
+    }
+    LOG_DEBUG("AooSource: stop encoder thread");
+}
+
+// Only wake up the encoder thread if it is (about to go) asleep, so that
+// the audio thread does not touch the semaphore on every block.
+void Source::notify_encoder() {
+    if (encoder_threaded_.load(std::memory_order_relaxed)
+            && encoder_sleeping_.exchange(false, std::memory_order_acq_rel)) {
+        encoder_semaphore_.post();
+    }
+}
+
+void Source::encoder_thread_function() {
+    auto ready = [this]() {
+        return encoder_ && audio_queue_.read_available() > 0
+            && encoded_queue_.write_available() > 0;
+    };
+    while (!encoder_quit_.load(std::memory_order_relaxed)) {
+        shared_lock updatelock(update_mutex_); // reader lock
+        while (ready()) {
+            encode_block(*encoded_queue_.write_data());
+            encoded_queue_.write_commit();
+            // give writers a chance
+            updatelock.unlock();
+            if (encoder_quit_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            updatelock.lock();
+        }
+        // Announce that we are going to sleep, then check again to avoid
+        // a lost wakeup. NB: if notify_encoder() has already reset the flag,
+        // our exchange synchronizes with it and we see the new block.
+        encoder_sleeping_.exchange(true, std::memory_order_acq_rel);
+        if (ready()) {
+            // NB: a concurrent post() only causes a spurious wakeup.
+            encoder_sleeping_.store(false, std::memory_order_relaxed);
+        } else {
+            updatelock.unlock();
+            encoder_semaphore_.wait();
+        }
+    }
 }
 
+// The resend budget may be used up in a single burst of this duration.
+#define RESEND_BURST_DURATION 0.02
+
 void Source::resend_data(const sendfn &fn) {
     shared_lock updatelock(update_mutex_); // reader lock for history buffer!
     if (!history_.capacity()){
@@ -2122,6 +2586,33 @@ void Source::resend_data(const sendfn &fn) {
         return;
     }
 
+    // Update resend budget. NB: the send thread also runs while the stream
+    // is stopped or the audio thread is stalled, so we use the system clock
+    // instead of the stream timer. The system clock may jump backwards,
+    // but resend_time_ must be monotonic!
+    auto now = time_tag::now();
+    if (!last_resend_time_.is_empty()) {
+        auto delta = time_tag::duration(last_resend_time_, now);
+        if (delta > 0) {
+            resend_time_ += delta;
+            resend_budget_.refill(delta);
+        }
+    }
+    last_resend_time_ = now;
+
+    auto bandwidth = resend_bandwidth_.load();
+    // NB: the bucket must be able to hold at least a single frame!
+    auto capacity = std::max<double>(bandwidth * RESEND_BURST_DURATION,
+                                     packet_size_.load());
+    bool changed = bandwidth != resend_budget_.rate();
+    resend_budget_.setup(bandwidth, capacity);
+    if (changed) {
+        resend_budget_.reset(); // start with a full bucket
+    }
+
+    auto dedup_interval = resend_dedup_interval_.load();
+    uint64_t requested = 0, sent = 0, suppressed = 0;
+
     struct frame_data {
         int32_t index;
         int32_t size;
@@ -2131,12 +2622,18 @@ void Source::resend_data(const sendfn &fn) {
     std::array<frame_data, 16> small_framevec;
     std::vector<frame_data> large_framevec;
 
-    // send block to sinks
-    sink_lock lock(sinks_);
-    for (auto& s : sinks_) {
+    // resend blocks to sink
+    auto resend_sink = [&](sink_desc& s) {
         int count = 0;
-        data_request r;
-        while (s.get_data_request(r)) {
+        // Members of a multicast group may ask for the same frame in different
+        // send cycles; a frame that has been resent to the group reaches every
+        // member after at most one round trip.
+        auto interval = dedup_interval;
+        if (s.is_multicast() && interval > 0) {
+            interval = std::max<double>(interval, s.max_member_rtt());
+        }
+
+        auto resend = [&](const data_request& r) {
         #if AOO_DEBUG_RESEND && 0
             LOG_DEBUG("AooSource: dispatch data request (" << r.sequence
                       << " " << r.offset << " " << r.bitset << ")");
@@ -2177,9 +2674,23 @@ void Source::resend_data(const sendfn &fn) {
                 if (d.num_frames > 0) {
                     // copy and send frames
                     auto copy_frame = [&](int32_t index) {
+                        requested++;
+                        if (interval > 0 &&
+                                s.recent_resends.contains(d.sequence, index,
+                                                          resend_time_, interval)) {
+                            suppressed++; // already in flight
+                            return;
+                        }
                         auto nbytes = block->get_frame(index, buf + buf_offset,
                                                        d.total_size - buf_offset);
                         if (nbytes > 0) {
+                            if (!resend_budget_.consume(nbytes)) {
+                                suppressed++; // the sink will ask again
+                                return;
+                            }
+                            if (interval > 0) {
+                                s.recent_resends.add(d.sequence, index, resend_time_);
+                            }
                             auto& frame = framevec[numframes];
                             frame.index = index;
                             frame.size = nbytes;
@@ -2213,12 +2724,25 @@ void Source::resend_data(const sendfn &fn) {
                     }
                 } else {
                     // resend empty block
+                    requested++;
+                    if (interval > 0 &&
+                            s.recent_resends.contains(d.sequence, 0,
+                                                      resend_time_, interval)) {
+                        suppressed++;
+                        return;
+                    }
+                    if (interval > 0) {
+                        s.recent_resends.add(d.sequence, 0, resend_time_);
+                    }
                     auto& frame = framevec[0];
                     frame.index = 0;
                     frame.size = 0;
                     frame.data = nullptr;
                     numframes = 1;
                 }
+                if (numframes == 0) {
+                    return; // all frames have been suppressed
+                }
                 // unlock before sending
                 updatelock.unlock();
 
@@ -2232,14 +2756,16 @@ void Source::resend_data(const sendfn &fn) {
                     LOG_DEBUG("AooSource: resend " << d.sequence
                               << " (" << d.frame << " / " << d.nframes << ")");
                 #endif
+                    AooFlag flags = (i + 1) < numframes ? kAooSendMore : 0;
                     if (binary){
-                        send_packet_bin(s.ep, id(), stream_id, d, fn);
+                        send_packet_bin(s.ep, id(), stream_id, d, fn, flags);
                     } else {
-                        send_packet_osc(s.ep, id(), stream_id, d, fn);
+                        send_packet_osc(s.ep, s.osc_header, id(), stream_id, d, fn, flags);
                     }
                 }
 
                 count += numframes;
+                sent += numframes;
 
                 // lock again
                 updatelock.lock();
@@ -2248,6 +2774,18 @@ void Source::resend_data(const sendfn &fn) {
                 LOG_DEBUG("AooSource: cannot find block " << r.sequence);
             #endif
             }
+        };
+
+        // Coalesce all pending requests, so that each frame is only
+        // requested once per send cycle. This is particularly important
+        // for multicast groups, where several members may miss the same frame.
+        data_request r;
+        resend_requests_.clear();
+        while (s.get_data_request(r)) {
+            coalesce_request(resend_requests_, r);
+        }
+        for (auto& r : resend_requests_) {
+            resend(r);
         }
 
         if (count > 0) {
@@ -2256,6 +2794,32 @@ void Source::resend_data(const sendfn &fn) {
             send_event(std::move(e), kAooThreadLevelNetwork);
             updatelock.lock();
         }
+    };
+
+    sink_lock lock(sinks_);
+    // Rotate the first sink, so that all sinks get their fair share
+    // of the resend budget.
+    int32_t numsinks = std::distance(sinks_.begin(), sinks_.end());
+    if (numsinks > 0) {
+        auto first = resend_rotation_ = (resend_rotation_ + 1) % numsinks;
+        int32_t index = 0;
+        for (auto& s : sinks_) {
+            if (index++ >= first) {
+                resend_sink(s);
+            }
+        }
+        index = 0;
+        for (auto& s : sinks_) {
+            if (index++ < first) {
+                resend_sink(s);
+            }
+        }
+    }
+
+    if (requested > 0) {
+        resend_requested_.fetch_add(requested, std::memory_order_relaxed);
+        resend_sent_.fetch_add(sent, std::memory_order_relaxed);
+        resend_suppressed_.fetch_add(suppressed, std::memory_order_relaxed);
     }
 }
 
@@ -2266,10 +2830,12 @@ void Source::send_ping(const sendfn& fn){
     auto interval = ping_interval_.load(); // 0: no ping
     if (interval > 0 && (elapsed - pingtime) >= interval){
         auto tt = aoo::time_tag::now();
+        bool group = false;
         // send ping to sinks
         sink_lock lock(sinks_);
         for (auto& sink : sinks_){
             if (sink.is_active()){
+                group |= sink.is_multicast();
                 // /aoo/sink/<id>/ping <src> <time>
                 LOG_DEBUG("AooSource: send " kAooMsgPing " to " << sink.ep);
 
@@ -2286,9 +2852,18 @@ void Source::send_ping(const sendfn& fn){
                     << osc::EndMessage;
 
                 sink.ep.send(msg, fn);
+
+                if (sink.is_multicast()) {
+                    sink.expire_members(AOO_MULTICAST_MEMBER_PINGS);
+                }
             }
         }
 
+        if (group) {
+            last_ping_tt_[1].store(last_ping_tt_[0].load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+            last_ping_tt_[0].store(tt.value(), std::memory_order_relaxed);
+        }
         last_ping_time_.store(elapsed);
     }
 }
@@ -2317,6 +2892,19 @@ void Source::handle_start_request(const osc::ReceivedMessage& msg,
     // check if sink exists (not strictly necessary, but might help catch errors)
     sink_lock lock(sinks_);
     auto sink = find_sink(addr, id);
+    if (!sink) {
+        // A (new) member of a multicast group. NB: new members can't prove
+        // that they receive the group traffic before they got the /start
+        // message, so we accept /start requests from anyone. This is safe
+        // because the /start message is only sent to the group itself;
+        // requests by several members are coalesced.
+        for (auto& s : sinks_){
+            if (s.is_multicast() && s.ep.id == id){
+                sink = &s;
+                break;
+            }
+        }
+    }
     if (sink){
         if (sink->is_active()){
             // just resend /start message
@@ -2345,13 +2933,21 @@ void Source::handle_stop_request(const osc::ReceivedMessage& msg,
     // check if sink exists (not strictly necessary, but might help catch errors)
     sink_lock lock(sinks_);
     auto sink = find_sink(addr, id);
+    auto group = sink ? nullptr : find_group(addr, id);
+    if (!sink && !group) {
+        group = join_group(addr, id, stream);
+    }
+    if (group) {
+        sink = group;
+    }
     if (sink) {
         // A stream can be considered stopped if the source is stopped (idle)
         // and/or the sink is deactivated.
         auto state = stream_state();
         if (state == stream_state::idle || !sink->is_active()){
-            // resend /stop message
-            sink_request r(request_type::stop, sink->ep);
+            // resend /stop message; only reply to the group member.
+            sink_request r(request_type::stop, group ?
+                           endpoint(addr, id, group->ep.binary) : sink->ep);
             r.stop.stream = stream; // use original stream ID!
             r.stop.offset = 0;
             push_request(r);
@@ -2386,6 +2982,13 @@ void Source::handle_data_request(const osc::ReceivedMessage& msg,
 
     sink_lock lock(sinks_);
     auto sink = find_sink(addr, id);
+    if (!sink) {
+        // requests from multicast group members are coalesced, see resend_data()
+        sink = find_group(addr, id);
+        if (!sink) {
+            sink = join_group(addr, id, stream_id);
+        }
+    }
     if (sink){
         if (sink->stream_id() != stream_id){
             LOG_VERBOSE("ignoring '" << kAooMsgData
@@ -2440,6 +3043,13 @@ void Source::handle_data_request(const AooByte *msg, int32_t n,
 
     sink_lock lock(sinks_);
     auto sink = find_sink(addr, id);
+    if (!sink) {
+        // requests from multicast group members are coalesced, see resend_data()
+        sink = find_group(addr, id);
+        if (!sink) {
+            sink = join_group(addr, id, stream_id);
+        }
+    }
     if (sink){
         if (sink->stream_id() != stream_id){
             LOG_VERBOSE("AooSource: ignore binary data message: stream ID mismatch (outdated?)");
@@ -2581,10 +3191,15 @@ void Source::handle_ping(const osc::ReceivedMessage& msg,
     // check if sink exists (not strictly necessary, but might help catch errors)
     sink_lock lock(sinks_);
     auto sink = find_sink(addr, id);
+    auto group = sink ? nullptr : find_group(addr, id);
+    if (group) {
+        sink = group;
+    }
     if (sink) {
         if (sink->is_active()){
-            // push pong request
-            sink_request r(request_type::pong, sink->ep);
+            // push pong request; only reply to the group member.
+            sink_request r(request_type::pong, group ?
+                           endpoint(addr, id, group->ep.binary) : sink->ep);
             r.pong.tt1 = tt1;
             r.pong.tt2 = aoo::time_tag::now(); // local receive time
             push_request(r);
@@ -2613,11 +3228,29 @@ void Source::handle_pong(const osc::ReceivedMessage& msg,
     // check if sink exists (not strictly necessary, but might help catch errors)
     sink_lock lock(sinks_);
     auto sink = find_sink(addr, id);
+    auto group = sink ? nullptr : find_group(addr, id);
+    if (!sink && !group && is_group_ping(tt1)) {
+        // only a group member can reply to a ping that we sent to the group
+        group = join_group(addr, id, kAooIdInvalid);
+    }
+    if (group) {
+        sink = group;
+    }
     if (sink) {
         if (sink->is_active()){
             auto tt4 = aoo::time_tag::now(); // source receive time
-            // send ping event
-            auto e = make_event<sink_ping_event>(sink->ep, tt1, tt2, tt3, tt4, packetloss);
+            if (group) {
+                auto rtt = time_tag::duration(tt1, tt4) - time_tag::duration(tt2, tt3);
+                group->set_member_rtt(addr, rtt);
+            }
+            // the encoder uses the packet loss for in-band FEC, see encode_block().
+            // NB: for multicast groups this is just the packet loss of the
+            // most recent member; the members report at different times anyway.
+            sink->set_packet_loss(packetloss * 100.f + 0.5f);
+            // send ping event (with the actual sink endpoint)
+            auto e = make_event<sink_ping_event>(group ? endpoint(addr, id, group->ep.binary)
+                                                       : sink->ep,
+                                                 tt1, tt2, tt3, tt4, packetloss);
             send_event(std::move(e), kAooThreadLevelNetwork);
         } else {
             LOG_VERBOSE("AooSource: ignoring '" << kAooMsgPong << "' message: sink not active");
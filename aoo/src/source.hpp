@@ -21,23 +21,20 @@
 #include "detail.hpp"
 #include "events.hpp"
 #include "resampler.hpp"
+#include "resend_scheduler.hpp"
 #include "time_dll.hpp"
 
 #include "osc/OscOutboundPacketStream.h"
 #include "osc/OscReceivedElements.h"
 
 #include <list>
+#include <unordered_map>
+#include <thread>
 
 namespace aoo {
 
 class Source;
 
-struct data_request {
-    int32_t sequence;
-    int16_t offset;
-    uint16_t bitset;
-};
-
 enum class request_type {
     none,
     stop,
@@ -71,22 +68,73 @@ struct sink_request {
     };
 };
 
+// Pre-serialized header of an OSC data message: address pattern,
+// type tag string and the (per stream) source and stream ID.
+// The type tag string always has the same size, so we only have to
+// patch the type tags and append the remaining arguments for each packet.
+// See send_packet_osc() in source.cpp.
+struct data_osc_header {
+    // address pattern (incl. sink ID and padding) + type tags + 2 args
+    static const int32_t max_size = kAooMsgDomainLen + kAooMsgSinkLen
+            + 16 + kAooMsgDataLen + 16 + 8;
+    static const int32_t typetag_size = 16;
+
+    bool valid(AooId source, AooId stream) const {
+        return source_id == source && stream_id == stream;
+    }
+
+    void update(AooId sink, AooId source, AooId stream);
+
+    AooByte data[max_size];
+    int32_t size = 0;
+    int32_t typetag_onset = 0;
+    AooId source_id = kAooIdInvalid;
+    AooId stream_id = kAooIdInvalid;
+};
+
 // NOTE: the stream ID can change anytime, it only
 // has to be synchronized with any format change.
 struct sink_desc {
 #if AOO_NET
     sink_desc(const ip_address& addr, const ip_address& relay,
               int32_t id, bool binary, AooId stream_id)
-        : ep(addr, relay, id, binary), stream_id_(stream_id) {}
+        : ep(addr, relay, id, binary), multicast_(addr.is_multicast()),
+          stream_id_(stream_id) {}
 #else
     sink_desc(const ip_address& addr, int32_t id, bool binary, AooId stream_id)
-        : ep(addr, id, binary), stream_id_(stream_id) {}
+        : ep(addr, id, binary), multicast_(addr.is_multicast()),
+          stream_id_(stream_id) {}
 #endif // USE_AOO_NEt
     sink_desc(const sink_desc& other) = delete;
     sink_desc& operator=(const sink_desc& other) = delete;
 
     const endpoint ep;
 
+    // A multicast sink stands for a group of sinks that have joined the
+    // multicast address and use the same sink ID. Every packet is only
+    // sent once to the whole group. Messages from group members come from
+    // their own (unicast) addresses, see Source::find_group().
+    bool is_multicast() const { return multicast_; }
+
+    // Members of a multicast group, see Source::find_group().
+    bool is_member(const ip_address& addr) const;
+
+    void add_member(const ip_address& addr);
+
+    // update the round trip time of a member, see Source::handle_pong().
+    void set_member_rtt(const ip_address& addr, double rtt);
+
+    // called after every ping to the group; removes members that have
+    // not answered the last 'max_pings' pings, see Source::send_ping().
+    void expire_members(int32_t max_pings);
+
+    int32_t member_count() const;
+
+    // the largest round trip time of all members, see Source::resend_data().
+    double max_member_rtt() const {
+        return max_member_rtt_.load(std::memory_order_relaxed);
+    }
+
     AooId stream_id() const {
         return stream_id_.load(std::memory_order_acquire);
     }
@@ -99,6 +147,15 @@ struct sink_desc {
         return channel_.load(std::memory_order_relaxed);
     }
 
+    // packet loss in percent, as reported by the sink
+    void set_packet_loss(int32_t loss){
+        packet_loss_.store(loss, std::memory_order_relaxed);
+    }
+
+    int32_t packet_loss() const {
+        return packet_loss_.load(std::memory_order_relaxed);
+    }
+
     // a new stream has been started by the user;
     // called while (try-)locked
     void start();
@@ -139,8 +196,26 @@ struct sink_desc {
     bool get_data_request(data_request& r){
         return data_requests_.try_pop(r);
     }
+
+    // recently resent frames; only accessed by the send thread,
+    // see Source::resend_data().
+    resend_filter recent_resends;
+
+    // only accessed by the send thread; lazily updated on
+    // source/stream ID changes, see send_packet_osc().
+    data_osc_header osc_header;
 private:
+    const bool multicast_;
+    struct member {
+        double rtt = 0;
+        int32_t pings = 0; // unanswered pings
+    };
+    // NB: looked up for every message from a group member
+    std::unordered_map<ip_address, member, ip_address::hash_type> members_;
+    mutable sync::mutex member_mutex_;
+    std::atomic<float> max_member_rtt_{0};
     std::atomic<int32_t> channel_{0};
+    std::atomic<int32_t> packet_loss_{0};
     std::atomic<int32_t> stream_id_ {kAooIdInvalid};
     int32_t invite_token_{kAooIdInvalid};
     int32_t uninvite_token_{kAooIdInvalid};
@@ -149,12 +224,16 @@ private:
 };
 
 struct cached_sink {
-    cached_sink(const sink_desc& s)
-        : ep(s.ep), stream_id(s.stream_id()), channel(s.channel()) {}
+    cached_sink(sink_desc& s)
+        : ep(s.ep), stream_id(s.stream_id()), channel(s.channel()),
+          osc_header(&s.osc_header) {}
 
     endpoint ep;
     AooId stream_id;
     int32_t channel;
+    // NB: sinks are only freed at the end of Source::send(),
+    // so we can safely keep a pointer while sending.
+    data_osc_header *osc_header;
 };
 
 template<typename Alloc>
@@ -314,6 +393,8 @@ class Source final : public AooSource, rt_memory_pool_client {
     aoo::time_tag start_tt_;
     std::atomic<float> xrunblocks_{0};
     std::atomic<float> last_ping_time_{0};
+    // the last two ping times; see is_group_ping()
+    std::array<std::atomic<uint64_t>, 2> last_ping_tt_{};
     std::atomic<float> elapsed_time_ = 0;
     std::atomic<bool> need_start_{false};
     std::atomic<bool> need_reset_timer_{false};
@@ -326,13 +407,27 @@ class Source final : public AooSource, rt_memory_pool_client {
     // buffers and queues
     aoo::vector<AooByte> sendbuffer_;
     dynamic_resampler resampler_;
+    // NB: samples are interleaved or planar, see planar_.
     struct block_data {
         static constexpr size_t header_size = 8;
         double sr;
         AooSample data[1];
     };
+    // use non-interleaved audio buffers, see set_format()
+    bool planar_ = false;
     aoo::spsc_queue<char> audio_queue_;
+    struct encoded_block {
+        double sr = 0;
+        bool active = false; // false: no active sinks or encoder error
+        aoo::vector<AooByte> data;
+    };
+    // blocks from the encoder thread; only accessed with update lock.
+    aoo::spsc_queue<encoded_block> encoded_queue_;
+    encoded_block send_block_; // only for the send thread
+    bool encoder_active_ = false; // only for the encoding thread
+    int32_t encoder_packet_loss_ = 0; // only for the encoding thread
     history_buffer history_;
+    parity_encoder parity_; // only for the send thread
     using message_queue = lockfree::unbounded_mpsc_queue<rt_stream_message, aoo::rt_allocator<rt_stream_message>>;
     message_queue message_queue_;
     using message_prio_queue = priority_queue<nrt_stream_message, stream_message_comp, aoo::allocator<nrt_stream_message>>;
@@ -351,13 +446,34 @@ class Source final : public AooSource, rt_memory_pool_client {
     sink_list sinks_;
     sync::mutex sink_mutex_;
     aoo::vector<cached_sink> cached_sinks_; // only for the send thread
+    // resend scheduling; only for the send thread
+    aoo::vector<data_request> resend_requests_;
+    token_bucket resend_budget_;
+    aoo::time_tag last_resend_time_;
+    double resend_time_ = 0;
+    int32_t resend_rotation_ = 0;
+    // resend statistics (in frames)
+    std::atomic<uint64_t> resend_requested_{0};
+    std::atomic<uint64_t> resend_sent_{0};
+    std::atomic<uint64_t> resend_suppressed_{0};
     // thread synchronization
     sync::shared_mutex update_mutex_;
+    // encoder thread
+    std::thread encoder_thread_;
+    sync::semaphore encoder_semaphore_;
+    std::atomic<bool> encoder_sleeping_{false};
+    std::atomic<bool> encoder_quit_{false};
+    std::atomic<bool> encoder_threaded_{false};
+    // serializes encoder access between the send and encoder thread
+    sync::mutex codec_mutex_;
     // options
     parameter<float> buffersize_{ AOO_SOURCE_BUFFER_SIZE };
     parameter<float> resend_buffersize_{ AOO_RESEND_BUFFER_SIZE };
     parameter<int32_t> packet_size_{ AOO_PACKET_SIZE };
     parameter<int32_t> redundancy_{ AOO_SEND_REDUNDANCY };
+    parameter<int32_t> fec_window_{ AOO_SEND_FEC_WINDOW };
+    parameter<int32_t> resend_bandwidth_{ AOO_RESEND_BANDWIDTH };
+    parameter<float> resend_dedup_interval_{ AOO_RESEND_DEDUP_INTERVAL };
     parameter<float> ping_interval_{ AOO_PING_INTERVAL };
     parameter<float> dll_bandwidth_{ AOO_DLL_BANDWIDTH };
     parameter<float> tt_interval_{ AOO_STREAM_TIME_SEND_INTERVAL };
@@ -378,6 +494,12 @@ class Source final : public AooSource, rt_memory_pool_client {
 
     sink_desc * find_sink(const ip_address& addr, AooId id);
 
+    sink_desc * find_group(const ip_address& addr, AooId id);
+
+    sink_desc * join_group(const ip_address& addr, AooId id, AooId stream_id);
+
+    bool is_group_ping(time_tag tt) const;
+
     sink_desc *get_sink_arg(intptr_t index);
 
     void send_event(event_ptr event, AooThreadLevel level);
@@ -394,6 +516,8 @@ class Source final : public AooSource, rt_memory_pool_client {
 
     void update_audio_queue();
 
+    void copy_input(const AooSample *const *data, AooSample *buf, int32_t nsamples);
+
     void update_resampler();
 
     void update_historybuffer();
@@ -406,6 +530,16 @@ class Source final : public AooSource, rt_memory_pool_client {
 
     void send_data(const sendfn& fn);
 
+    void encode_block(encoded_block& block);
+
+    void start_encoder_thread();
+
+    void stop_encoder_thread();
+
+    void notify_encoder();
+
+    void encoder_thread_function();
+
     void resend_data(const sendfn& fn);
 
     void send_ping(const sendfn& fn);
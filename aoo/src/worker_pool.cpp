@@ -0,0 +1,125 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#include "worker_pool.hpp"
+
+#include "common/log.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace aoo {
+
+void worker_pool::start(int nthreads) {
+    stop();
+    quit_.store(false);
+    tasks_.store(0);
+    pending_.store(0);
+    for (int i = 0; i < nthreads; ++i) {
+        threads_.emplace_back([this]() {
+            worker_thread();
+        });
+    }
+    LOG_DEBUG("worker_pool: started " << nthreads << " threads");
+}
+
+void worker_pool::stop() {
+    if (threads_.empty()) {
+        return;
+    }
+    quit_.store(true);
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        semaphore_.post();
+    }
+    for (auto& t : threads_) {
+        t.join();
+    }
+    threads_.clear();
+    // drain remaining wakeups
+    while (semaphore_.try_wait()) {}
+    LOG_DEBUG("worker_pool: stopped");
+}
+
+void worker_pool::run(task_fn fn, void *context, int count) {
+    if (count <= 0) {
+        return;
+    }
+    // all tasks of the previous run have finished (see below),
+    // so nobody can read 'fn_', 'context_' or 'caller_' at this point.
+    // Workers only access them after claiming a task, which
+    // synchronizes with the store to 'tasks_'.
+    fn_ = fn;
+    context_ = context;
+    caller_ = sync::current_thread();
+    pending_.store(count, std::memory_order_relaxed);
+    // NB: we do not wake up the workers because this might enter the kernel;
+    // idle workers poll for new tasks instead.
+    tasks_.store((uint64_t)count << 32, std::memory_order_release);
+    // do all tasks that have not been claimed by a worker
+    int32_t index;
+    while (claim_task(index)) {
+        do_task(index);
+    }
+    // wait for tasks that are still running on worker threads.
+    // NB: the workers have the same priority as the calling thread, so we
+    // must eventually yield in case one of them got preempted on our CPU.
+    const int spin_count = 1000;
+    for (int i = 0; pending_.load(std::memory_order_acquire) > 0; ++i) {
+        if (i < spin_count) {
+            sync::pause_cpu();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool worker_pool::claim_task(int32_t& index) {
+    // Check before we try to claim a task, so that polling
+    // workers do not increment the task index all the time.
+    // NB: a late worker might still increment the index past the
+    // task count; this is harmless because it is reset in the next run().
+    auto tasks = tasks_.load(std::memory_order_relaxed);
+    if ((int32_t)(tasks & 0xffffffff) >= (int32_t)(tasks >> 32)) {
+        return false;
+    }
+    tasks = tasks_.fetch_add(1, std::memory_order_acquire);
+    index = (int32_t)(tasks & 0xffffffff);
+    return index < (int32_t)(tasks >> 32);
+}
+
+void worker_pool::do_task(int32_t index) {
+    fn_(context_, index);
+    pending_.fetch_sub(1, std::memory_order_release);
+}
+
+void worker_pool::worker_thread() {
+    using clock = std::chrono::steady_clock;
+    sync::thread_handle caller{};
+    bool have_caller = false;
+    auto last_active = clock::now();
+    while (!quit_.load(std::memory_order_relaxed)) {
+        int32_t index;
+        if (claim_task(index)) {
+            // Adopt the priority of the calling thread (usually the audio thread).
+            // NB: the calling thread must be alive because it waits for this task.
+            if (!have_caller || !sync::thread_equal(caller, caller_)) {
+                caller = caller_;
+                have_caller = true;
+                sync::match_thread_priority(caller);
+            }
+            do_task(index);
+            last_active = clock::now();
+        } else if (std::chrono::duration<double>(clock::now() - last_active).count()
+                       < AOO_WORKER_POOL_SPIN_TIME) {
+            // NB: yield in case we share the CPU with the audio thread!
+            sync::pause_cpu();
+            std::this_thread::yield();
+        } else {
+            semaphore_.wait_for(AOO_WORKER_POOL_SLEEP_TIME);
+        }
+    }
+}
+
+} // namespace aoo
@@ -0,0 +1,82 @@
+/* Copyright (c) 2010-Now Christof Ressi, Winfried Ritsch and others.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
+
+#pragma once
+
+#include "common/sync.hpp"
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// time (in seconds) that idle workers keep polling for new tasks before
+// they go to sleep; should be larger than the audio block period.
+#ifndef AOO_WORKER_POOL_SPIN_TIME
+# define AOO_WORKER_POOL_SPIN_TIME 0.002
+#endif
+
+// polling interval (in seconds) of sleeping workers
+#ifndef AOO_WORKER_POOL_SLEEP_TIME
+# define AOO_WORKER_POOL_SLEEP_TIME 0.001
+#endif
+
+namespace aoo {
+
+//------------------------ worker_pool ----------------------------//
+
+// A tiny fork/join thread pool for the audio thread.
+//
+// run() distributes 'count' tasks among the worker threads *and*
+// the calling thread and returns once all tasks have finished.
+// run() never allocates memory, never blocks on a mutex and never
+// enters the kernel to wake up workers:
+// * Tasks are claimed with a single atomic counter right before they are
+//   executed. The caller does all tasks that have not been claimed by a
+//   worker (e.g. because it is still asleep) and only waits for tasks that
+//   are already running.
+// * Idle workers poll for new tasks. They spin for AOO_WORKER_POOL_SPIN_TIME
+//   after their last task and then sleep in intervals of AOO_WORKER_POOL_SLEEP_TIME.
+// * Workers adopt the scheduling priority of the thread that calls run(),
+//   so they are not preempted by ordinary threads while the caller waits.
+// * run() must not be called concurrently.
+// * start() and stop() must not be called concurrently with run().
+class worker_pool {
+public:
+    using task_fn = void (*)(void *context, int index);
+
+    worker_pool() = default;
+    ~worker_pool() { stop(); }
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    void start(int nthreads);
+
+    void stop();
+
+    int num_threads() const {
+        return threads_.size();
+    }
+
+    void run(task_fn fn, void *context, int count);
+private:
+    bool claim_task(int32_t& index);
+
+    void do_task(int32_t index);
+
+    void worker_thread();
+
+    std::vector<std::thread> threads_;
+    sync::semaphore semaphore_; // only used for stop()
+    task_fn fn_ = nullptr;
+    void *context_ = nullptr;
+    sync::thread_handle caller_{};
+    // task count (high 32 bits) + next task index (low 32 bits)
+    std::atomic<uint64_t> tasks_{0};
+    std::atomic<int32_t> pending_{0};
+    std::atomic<bool> quit_{false};
+};
+
+} // namespace aoo
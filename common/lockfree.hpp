@@ -89,6 +89,16 @@ class spsc_queue {
         return &data_[rdhead_];
     }
 
+    // get the n-th readable *block* without consuming it.
+    // NB: 'n' must be smaller than read_available()!
+    const T* peek_data(int32_t n) const {
+        auto onset = rdhead_ + n * blocksize_;
+        if (onset >= (int32_t)data_.size()) {
+            onset -= data_.size();
+        }
+        return &data_[onset];
+    }
+
     void read_commit() {
         read_commit(blocksize_);
     }
@@ -499,6 +499,23 @@ bool ip_address::is_ipv4_mapped() const {
     return false;
 }
 
+bool ip_address::is_multicast() const {
+#if AOO_USE_IPV6
+    if (addr_.sa_family == AF_INET6) {
+        if (is_ipv4_mapped()) {
+            return unmapped().is_multicast();
+        } else {
+            return addr_in6_.sin6_addr.s6_addr[0] == 0xff; // ff00::/8
+        }
+    }
+#endif
+    if (addr_.sa_family == AF_INET) {
+        // 224.0.0.0/4
+        return (ntohl(addr_in_.sin_addr.s_addr) >> 28) == 0xe;
+    }
+    return false;
+}
+
 ip_address ip_address::ipv4_mapped() const {
 #if AOO_USE_IPV6
     if (addr_.sa_family == AF_INET) {
@@ -697,12 +714,23 @@ socket_type create_from_family(int protocol, ip_address::ip_type family, bool du
 }
 
 // close the socket on failure
-void try_bind(socket_type sock, const ip_address& addr, bool reuse_port) {
+void try_bind(socket_type sock, const ip_address& addr, bool reuse_port,
+              bool share_port = false) {
     if (reuse_port) {
         if (set_int_option(sock, SOL_SOCKET, SO_REUSEADDR, true) != 0) {
             socket::print_last_error("socket: couldn't set SO_REUSEADDR");
         }
     }
+    if (share_port) {
+#ifdef SO_REUSEPORT
+        if (set_int_option(sock, SOL_SOCKET, SO_REUSEPORT, true) != 0) {
+            socket::print_last_error("socket: couldn't set SO_REUSEPORT");
+        }
+#else
+        fprintf(stderr, "socket: SO_REUSEPORT not supported\n");
+        fflush(stderr);
+#endif
+    }
     // finally bind the socket
     if (::bind(sock, addr.address(), addr.length()) != 0) {
         auto err = socket::get_last_error(); // cache errno
@@ -787,23 +815,33 @@ int base_socket::send(const void *buf, int size) {
     }
 }
 
+namespace {
+
+// wait until the socket becomes readable; returns false on timeout.
+bool wait_readable(socket_type sock, double timeout) {
+    struct pollfd p;
+    p.fd = sock;
+    p.revents = 0;
+    p.events = POLLIN;
+#ifdef _WIN32
+    int result = WSAPoll(&p, 1, timeout * 1000);
+#else
+    int result = poll(&p, 1, timeout * 1000);
+#endif
+    if (result < 0) {
+        // poll() failed
+        throw socket_error(socket::get_last_error());
+    }
+    return result > 0;
+}
+
+} // namespace
+
 std::pair<bool, int> base_socket::do_receive(void *buf, int size,
                                              ip_address* addr, double timeout) {
     if (timeout >= 0) {
         // non-blocking receive via poll()
-        struct pollfd p;
-        p.fd = socket_;
-        p.revents = 0;
-        p.events = POLLIN;
-#ifdef _WIN32
-        int result = WSAPoll(&p, 1, timeout * 1000);
-#else
-        int result = poll(&p, 1, timeout * 1000);
-#endif
-        if (result < 0) {
-            // poll() failed
-            throw socket_error(socket::get_last_error());
-        } else if (result == 0) {
+        if (!wait_readable(socket_, timeout)) {
             // timeout
             return { false, 0 };
         }
@@ -1030,6 +1068,12 @@ udp_socket::udp_socket(port_tag, port_type port, bool reuse_port) {
     socket_ = sock;
 }
 
+udp_socket::udp_socket(port_tag, port_type port, bool reuse_port, bool share_port) {
+    auto [sock, bindaddr] = create_from_port(SOCK_DGRAM, port);
+    try_bind(sock, bindaddr, reuse_port, share_port);
+    socket_ = sock;
+}
+
 int udp_socket::send(const void *buf, int size, const ip_address& addr) {
     auto ret = ::sendto(socket_, (const char *)buf, size, 0,
                         addr.address(), addr.length());
@@ -1040,6 +1084,175 @@ int udp_socket::send(const void *buf, int size, const ip_address& addr) {
     }
 }
 
+int udp_socket::send_batch(const udp_packet_ref *packets, int count) {
+    int sent = 0;
+    int err = 0;
+#ifdef __linux__
+    const int max_batch = 64;
+    struct mmsghdr msgs[max_batch];
+    struct iovec iovecs[max_batch];
+    int i = 0;
+    while (i < count) {
+        auto n = std::min(count - i, max_batch);
+        for (int j = 0; j < n; ++j) {
+            auto& p = packets[i + j];
+            iovecs[j].iov_base = (void *)p.data;
+            iovecs[j].iov_len = p.size;
+            auto& hdr = msgs[j].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = (void *)p.address->address();
+            hdr.msg_namelen = p.address->length();
+            hdr.msg_iov = &iovecs[j];
+            hdr.msg_iovlen = 1;
+            msgs[j].msg_len = 0;
+        }
+        auto ret = ::sendmmsg(socket_, msgs, n, 0);
+        if (ret > 0) {
+            sent += ret;
+            i += ret;
+        } else if (ret == 0) {
+            // nothing has been sent, but nothing failed either,
+            // so errno is meaningless; just stop.
+            break;
+        } else if (errno == EINTR) {
+            continue; // try again
+        } else {
+            // skip the offending packet
+            err = errno;
+            i++;
+        }
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        auto& p = packets[i];
+        auto ret = ::sendto(socket_, (const char *)p.data, p.size, 0,
+                            p.address->address(), p.address->length());
+        if (ret >= 0) {
+            sent++;
+        } else {
+            err = socket::get_last_error();
+        }
+    }
+#endif
+    if (err != 0) {
+        throw socket_error(err);
+    }
+    return sent;
+}
+
+std::pair<bool, int> udp_socket::receive_batch(udp_recv_slot *slots, int count,
+                                               double timeout) {
+    assert(count > 0);
+#ifdef __linux__
+    if (count > 1) {
+        if (timeout >= 0 && !wait_readable(socket_, timeout)) {
+            return { false, 0 }; // timeout
+        }
+        const int max_batch = 64;
+        count = std::min(count, max_batch);
+        struct mmsghdr msgs[max_batch];
+        struct iovec iovecs[max_batch];
+        for (int i = 0; i < count; ++i) {
+            auto& slot = slots[i];
+            slot.address.reserve();
+            iovecs[i].iov_base = slot.data;
+            iovecs[i].iov_len = slot.capacity;
+            auto& hdr = msgs[i].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = slot.address.address_ptr();
+            hdr.msg_namelen = slot.address.length();
+            hdr.msg_iov = &iovecs[i];
+            hdr.msg_iovlen = 1;
+            msgs[i].msg_len = 0;
+        }
+        // block until the first packet arrives, then take
+        // all other packets that are already available.
+        auto ret = ::recvmmsg(socket_, msgs, count, MSG_WAITFORONE, nullptr);
+        if (ret < 0) {
+            throw socket_error(socket::get_last_error());
+        }
+        for (int i = 0; i < ret; ++i) {
+            auto& slot = slots[i];
+            slot.address.resize(msgs[i].msg_hdr.msg_namelen);
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                slot.size = 0;
+            } else {
+                slot.size = msgs[i].msg_len;
+            }
+        }
+        return { true, ret };
+    }
+#endif
+    // receive a single packet
+    auto& slot = slots[0];
+    auto [success, result] = do_receive(slot.data, slot.capacity,
+                                        &slot.address, timeout);
+    if (success) {
+        slot.size = result;
+        return { true, 1 };
+    } else {
+        return { false, 0 };
+    }
+}
+
+namespace {
+
+void set_group_membership(socket_type sock, const ip_address& group, bool join) {
+    auto addr = group.unmapped();
+    if (!addr.valid()) {
+        throw socket_error(EINVAL, "invalid multicast group address");
+    }
+    int result;
+#if AOO_USE_IPV6
+    if (addr.type() == ip_address::IPv6) {
+        struct ipv6_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        memcpy(&mreq.ipv6mr_multiaddr, addr.address_bytes(), 16);
+        mreq.ipv6mr_interface = 0; // default interface
+        result = ::setsockopt(sock, IPPROTO_IPV6, join ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP,
+                              (const char *)&mreq, sizeof(mreq));
+    } else
+#endif
+    {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        memcpy(&mreq.imr_multiaddr, addr.address_bytes(), 4);
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY); // default interface
+        result = ::setsockopt(sock, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+                              (const char *)&mreq, sizeof(mreq));
+    }
+    if (result != 0) {
+        throw socket_error(socket::get_last_error());
+    }
+}
+
+} // namespace
+
+void udp_socket::join_group(const ip_address& group) {
+    set_group_membership(socket_, group, true);
+}
+
+void udp_socket::leave_group(const ip_address& group) {
+    set_group_membership(socket_, group, false);
+}
+
+void udp_socket::set_multicast_ttl(int ttl) {
+    // NB: dual-stack sockets may send both IPv4 and IPv6 packets,
+    // so we try to set both options.
+    bool ok = false;
+#if AOO_USE_IPV6
+    if (family() == ip_address::IPv6) {
+        ok = set_int_option(socket_, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, ttl) == 0;
+    }
+#endif
+    if (set_int_option(socket_, IPPROTO_IP, IP_MULTICAST_TTL, ttl) == 0) {
+        ok = true;
+    }
+    if (!ok) {
+        throw socket_error(socket::get_last_error());
+    }
+}
+
 bool udp_socket::signal() noexcept {
     // wake up blocking recv() by sending an empty packet to itself
     try {
@@ -185,6 +185,13 @@ public:
 
     size_t hash() const;
 
+    // hash function object, e.g. for std::unordered_map
+    struct hash_type {
+        size_t operator()(const ip_address& addr) const {
+            return addr.hash();
+        }
+    };
+
     const char* name() const;
 
     const char* name_unmapped() const;
@@ -201,6 +208,9 @@ public:
 
     bool is_ipv4_mapped() const;
 
+    // IPv4 (also IPv4-mapped) or IPv6 multicast address
+    bool is_multicast() const;
+
     ip_address ipv4_mapped() const;
 
     ip_address unmapped() const;
@@ -348,6 +358,21 @@ protected:
 
 //-------------------------- udp_socket ------------------------//
 
+// a single outgoing packet for udp_socket::send_batch()
+struct udp_packet_ref {
+    const void *data;
+    int size;
+    const ip_address *address;
+};
+
+// a single packet slot for udp_socket::receive_batch()
+struct udp_recv_slot {
+    AooByte *data;
+    int capacity;
+    int size;
+    ip_address address;
+};
+
 class udp_socket : public base_socket {
 public:
     udp_socket() = default;
@@ -359,6 +384,11 @@ public:
 
     udp_socket(port_tag, port_type port, bool reuse_port = false);
 
+    // 'share_port' sets SO_REUSEPORT, so that several sockets can be bound
+    // to the same port. On Linux, incoming packets are distributed among
+    // the sockets by hashing the source address.
+    udp_socket(port_tag, port_type port, bool reuse_port, bool share_port);
+
     explicit udp_socket(const ip_address& addr, bool reuse_port = false);
 
     udp_socket(udp_socket&& other) noexcept
@@ -371,6 +401,28 @@ public:
 
     int send(const void *buf, int size, const ip_address& address);
 
+    // Send several packets with as few system calls as possible
+    // (sendmmsg() on Linux) and return the number of sent packets.
+    // Throws socket_error if one or more packets could not be sent;
+    // the remaining packets are sent nevertheless.
+    int send_batch(const udp_packet_ref *packets, int count);
+
+    // Receive up to 'count' packets with a single system call (recvmmsg()
+    // on Linux; other platforms only receive a single packet). Blocks until
+    // at least one packet is available, unless 'timeout' is non-negative.
+    // Returns false on timeout, otherwise the number of received packets.
+    // NB: truncated packets are returned with size 0.
+    std::pair<bool, int> receive_batch(udp_recv_slot *slots, int count, double timeout);
+
+    // Join resp. leave a multicast group on the default interface.
+    // NB: on Linux, IPv4 groups can also be joined with dual-stack sockets.
+    void join_group(const ip_address& group);
+
+    void leave_group(const ip_address& group);
+
+    // set the TTL (IPv4) resp. hop limit (IPv6) for outgoing multicast packets
+    void set_multicast_ttl(int ttl);
+
     bool signal() noexcept;
 };
 
@@ -31,6 +31,42 @@ void lower_thread_priority()
 #endif
 }
 
+thread_handle current_thread() {
+#ifdef _WIN32
+    return GetCurrentThreadId();
+#else
+    return pthread_self();
+#endif
+}
+
+bool thread_equal(thread_handle a, thread_handle b) {
+#ifdef _WIN32
+    return a == b;
+#else
+    return pthread_equal(a, b);
+#endif
+}
+
+void match_thread_priority(thread_handle thread) {
+#ifdef _WIN32
+    HANDLE h = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, thread);
+    if (h) {
+        int priority = GetThreadPriority(h);
+        if (priority != THREAD_PRIORITY_ERROR_RETURN) {
+            SetThreadPriority(GetCurrentThread(), priority);
+        }
+        CloseHandle(h);
+    }
+#else
+    int policy;
+    struct sched_param param;
+    if (pthread_getschedparam(thread, &policy, &param) == 0) {
+        // NB: this fails if we are not allowed to use realtime scheduling
+        pthread_setschedparam(pthread_self(), policy, &param);
+    }
+#endif
+}
+
 //---------------------------- atomics -------------------------------------//
 
 namespace detail {
@@ -368,9 +404,10 @@ bool semaphore::try_wait() {
                     std::memory_order_acquire, std::memory_order_relaxed))
                 return true;
             // try again; count has been updated
+        } else {
+            return false;
         }
     }
-    return false;
 }
 
 bool semaphore::wait_for(double seconds) {
@@ -509,9 +546,10 @@ bool event::try_wait() {
                     std::memory_order_acquire, std::memory_order_relaxed))
                 return true;
             // try again; count has been updated
+        } else {
+            return false;
         }
     }
-    return false;
 }
 
 bool event::wait_for(double seconds) {
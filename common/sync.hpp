@@ -70,6 +70,22 @@ inline void pause_cpu() {
 
 void lower_thread_priority();
 
+#ifdef _WIN32
+using thread_handle = unsigned long; // thread ID
+#else
+using thread_handle = pthread_t;
+#endif
+
+// NB: this never enters the kernel, so it can be called on the audio thread.
+thread_handle current_thread();
+
+bool thread_equal(thread_handle a, thread_handle b);
+
+// Give the calling thread the same scheduling policy and priority
+// as the given thread, e.g. for helper threads of the audio thread.
+// NB: the other thread must be alive!
+void match_thread_priority(thread_handle thread);
+
 //----------------- relaxed atomics ---------------//
 
 namespace detail {
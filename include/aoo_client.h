@@ -238,6 +238,38 @@ AOO_INLINE AooError AooClient_clearInterfaceAddresses(AooClient *client)
     return AooClient_control(client, kAooCtlRemoveInterfaceAddress, 0, NULL, 0);
 }
 
+/** \copydoc AooClient::setSendAggregation() */
+AOO_INLINE AooError AooClient_setSendAggregation(AooClient *client, AooBool b)
+{
+    return AooClient_control(client, kAooCtlSetSendAggregation, 0, AOO_ARG(b));
+}
+
+/** \copydoc AooClient::getSendAggregation() */
+AOO_INLINE AooError AooClient_getSendAggregation(AooClient *client, AooBool *b)
+{
+    return AooClient_control(client, kAooCtlGetSendAggregation, 0, AOO_ARG(*b));
+}
+
+/** \copydoc AooClient::joinMulticastGroup() */
+AOO_INLINE AooError AooClient_joinMulticastGroup(
+    AooClient *client, const AooChar *group)
+{
+    return AooClient_control(client, kAooCtlJoinMulticastGroup, (AooIntPtr)group, NULL, 0);
+}
+
+/** \copydoc AooClient::leaveMulticastGroup() */
+AOO_INLINE AooError AooClient_leaveMulticastGroup(
+    AooClient *client, const AooChar *group)
+{
+    return AooClient_control(client, kAooCtlLeaveMulticastGroup, (AooIntPtr)group, NULL, 0);
+}
+
+/** \copydoc AooClient::setMulticastTTL() */
+AOO_INLINE AooError AooClient_setMulticastTTL(AooClient *client, AooInt32 ttl)
+{
+    return AooClient_control(client, kAooCtlSetMulticastTTL, 0, AOO_ARG(ttl));
+}
+
 /*--------------------------------------------*/
 /*         type-safe request functions        */
 /*--------------------------------------------*/
@@ -457,6 +457,52 @@ public:
         return control(kAooCtlRemoveInterfaceAddress, 0, NULL, 0);
     }
 
+    /** \brief Enable/disable send aggregation
+     *
+     * If enabled, AooClient::send() collects the outgoing packets of all
+     * sources, sinks and peers and sends them in as few system calls as
+     * possible (e.g. with `sendmmsg()` on Linux). Packets are always
+     * sent in order.
+     *
+     * \note This has no effect if the client uses an external socket,
+     * see AooClientSettings::sendFunc.
+     */
+    AooError setSendAggregation(AooBool b) {
+        return control(kAooCtlSetSendAggregation, 0, AOO_ARG(b));
+    }
+
+    /** \brief Check if send aggregation is enabled */
+    AooError getSendAggregation(AooBool& b) {
+        return control(kAooCtlGetSendAggregation, 0, AOO_ARG(b));
+    }
+
+    /** \brief Join a multicast group
+     *
+     * Sinks can receive a stream that a source sends to a multicast
+     * address (see AooSource::addSink()). All members of the group
+     * must use the same sink ID.
+     *
+     * \param group The IPv4 or IPv6 multicast address
+     * \note Only available with the internal UDP socket.
+     */
+    AooError joinMulticastGroup(const AooChar *group) {
+        return control(kAooCtlJoinMulticastGroup, (AooIntPtr)group, NULL, 0);
+    }
+
+    /** \brief Leave a multicast group */
+    AooError leaveMulticastGroup(const AooChar *group) {
+        return control(kAooCtlLeaveMulticastGroup, (AooIntPtr)group, NULL, 0);
+    }
+
+    /** \brief Set the TTL resp. hop limit for outgoing multicast packets
+     *
+     * The default is 1, i.e. multicast packets do not leave the local network.
+     * \note Only available with the internal UDP socket.
+     */
+    AooError setMulticastTTL(AooInt32 ttl) {
+        return control(kAooCtlSetMulticastTTL, 0, AOO_ARG(ttl));
+    }
+
     /*--------------------------------------------*/
     /*         type-safe request functions        */
     /*--------------------------------------------*/
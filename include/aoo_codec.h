@@ -68,6 +68,64 @@ typedef AooError (AOO_CALL *AooCodecDecodeFunc)(
         AooInt32 *numFrames
 );
 
+/** \brief encode non-interleaved audio samples to bytes
+ *
+ * Optional alternative to AooCodecEncodeFunc; the encoded data must be
+ * the same as with interleaved input.
+ */
+typedef AooError (AOO_CALL *AooCodecEncodePlanarFunc)(
+        /** the encoder instance */
+        AooCodec *encoder,
+        /** [in] input channels (one pointer per channel) */
+        const AooSample *const *inChannels,
+        /** [in] frame size (number of sample per-channel) */
+        AooInt32 frameSize,
+        /** [out] output buffer */
+        AooByte *outData,
+        /** [in,out] max. buffer size in bytes
+         * (updated to actual size) */
+        AooInt32 *outSize
+);
+
+/** \brief decode bytes to non-interleaved samples
+ *
+ * Optional alternative to AooCodecDecodeFunc.
+ */
+typedef AooError (AOO_CALL *AooCodecDecodePlanarFunc)(
+        /** the decoder instance */
+        AooCodec *decoder,
+        /** [in] input data */
+        const AooByte *inData,
+        /** [in] input data size in bytes */
+        AooInt32 numBytes,
+        /** [out] output channels (one pointer per channel) */
+        AooSample *const *outChannels,
+        /** [in,out] max. number of frames
+         * (updated to actual number) */
+        AooInt32 *numFrames
+);
+
+/** \brief recover a lost block from redundant data
+ *
+ * Optional; reconstruct the block *preceding* the given packet from
+ * redundant data (e.g. Opus in-band FEC) in the packet. If the packet
+ * does not contain any redundant data, the codec should fall back to
+ * packet loss concealment.
+ */
+typedef AooError (AOO_CALL *AooCodecDecodeFecFunc)(
+        /** the decoder instance */
+        AooCodec *decoder,
+        /** [in] data of the packet *following* the lost block */
+        const AooByte *inData,
+        /** [in] input data size in bytes */
+        AooInt32 numBytes,
+        /** [out] output samples (interleaved) */
+        AooSample *outSamples,
+        /** [in,out] number of frames of the lost block
+         * (updated to actual number) */
+        AooInt32 *numFrames
+);
+
 /** \brief AOO codec controls
  *
  * Negative values are reserved for generic controls;
@@ -78,7 +136,12 @@ AOO_ENUM(AooCodecCtl)
     /** reset the codec state (`NULL`) */
     kAooCodecCtlReset = -1000,
     /** get encoding/decoding latency in samples (AooInt32) */
-    kAooCodecCtlGetLatency
+    kAooCodecCtlGetLatency,
+    /** set the expected packet loss in percent (AooInt32)
+     *
+     * This is only a hint for encoders with in-band FEC;
+     * it is only sent to codecs which implement `decoderDecodeFec`. */
+    kAooCodecCtlSetPacketLoss
 };
 
 /** \brief codec control function */
@@ -160,6 +223,14 @@ typedef struct AooCodecInterface
     AooCodecSerializeFunc serialize;
     /** deserialize format extension */
     AooCodecDeserializeFunc deserialize;
+    /* optional non-interleaved methods; may be `NULL` */
+    /** encode non-interleaved audio data */
+    AooCodecEncodePlanarFunc encoderEncodePlanar;
+    /** decode to non-interleaved audio data */
+    AooCodecDecodePlanarFunc decoderDecodePlanar;
+    /* optional FEC method; may be `NULL` */
+    /** recover lost block from redundant data */
+    AooCodecDecodeFecFunc decoderDecodeFec;
 } AooCodecInterface;
 
 /*----------------- helper functions ----------------------*/
@@ -181,6 +252,32 @@ AOO_INLINE AooError AooEncoder_encode(
     return enc->cls->encoderEncode(enc, inSamples, frameSize, outData, size);
 }
 
+/** \brief check if the encoder accepts non-interleaved input */
+AOO_INLINE AooBool AooEncoder_hasPlanar(AooCodec *enc)
+{
+    return AOO_CHECK_FIELD(enc->cls, AooCodecInterface, encoderEncodePlanar)
+        && enc->cls->encoderEncodePlanar != NULL;
+}
+
+/** \brief encode non-interleaved audio samples to bytes
+ *  \see AooCodecEncodePlanarFunc */
+AOO_INLINE AooError AooEncoder_encodePlanar(
+        AooCodec *enc, const AooSample *const *inChannels, AooInt32 frameSize,
+        AooByte *outData, AooInt32 *size)
+{
+    return enc->cls->encoderEncodePlanar(enc, inChannels, frameSize, outData, size);
+}
+
+/** \brief check if the encoder produces redundant data for FEC
+ *
+ * The encoder and decoder share the same codec interface, so this
+ * is the case if the codec implements `decoderDecodeFec`. */
+AOO_INLINE AooBool AooEncoder_hasFec(AooCodec *enc)
+{
+    return AOO_CHECK_FIELD(enc->cls, AooCodecInterface, decoderDecodeFec)
+        && enc->cls->decoderDecodeFec != NULL;
+}
+
 /** \brief control encoder instance
  *  \see AooCodecControlFunc */
 AOO_INLINE AooError AooEncoder_control(
@@ -212,6 +309,38 @@ AOO_INLINE AooError AooDecoder_decode(
     return dec->cls->decoderDecode(dec, inData, size, outSamples, frameSize);
 }
 
+/** \brief check if the decoder supports non-interleaved output */
+AOO_INLINE AooBool AooDecoder_hasPlanar(AooCodec *dec)
+{
+    return AOO_CHECK_FIELD(dec->cls, AooCodecInterface, decoderDecodePlanar)
+        && dec->cls->decoderDecodePlanar != NULL;
+}
+
+/** \brief decode bytes to non-interleaved audio samples
+ *  \see AooCodecDecodePlanarFunc */
+AOO_INLINE AooError AooDecoder_decodePlanar(
+        AooCodec *dec, const AooByte *inData, AooInt32 size,
+        AooSample *const *outChannels, AooInt32 *frameSize)
+{
+    return dec->cls->decoderDecodePlanar(dec, inData, size, outChannels, frameSize);
+}
+
+/** \brief check if the decoder can recover lost blocks from redundant data */
+AOO_INLINE AooBool AooDecoder_hasFec(AooCodec *dec)
+{
+    return AOO_CHECK_FIELD(dec->cls, AooCodecInterface, decoderDecodeFec)
+        && dec->cls->decoderDecodeFec != NULL;
+}
+
+/** \brief recover lost block from the following packet
+ *  \see AooCodecDecodeFecFunc */
+AOO_INLINE AooError AooDecoder_decodeFec(
+        AooCodec *dec, const AooByte *inData, AooInt32 size,
+        AooSample *outSamples, AooInt32 *frameSize)
+{
+    return dec->cls->decoderDecodeFec(dec, inData, size, outSamples, frameSize);
+}
+
 /** \brief control decoder instance
  *  \see AooCodecControlFunc */
 AOO_INLINE AooError AooDecoder_control(
@@ -59,6 +59,11 @@
 # define AOO_CLIP_OUTPUT 0
 #endif
 
+/** \brief use non-interleaved audio buffers if the codec supports it */
+#ifndef AOO_PLANAR_AUDIO
+# define AOO_PLANAR_AUDIO 1
+#endif
+
 /** \brief use built-in Opus codec */
 #ifndef AOO_USE_OPUS
 #define AOO_USE_OPUS 1
@@ -72,6 +72,20 @@ enum
     kAooCtlGetBinaryFormat,
     kAooCtlSetStreamTimeSendInterval,
     kAooCtlGetStreamTimeSendInterval,
+    kAooCtlSetProcessThreadCount,
+    kAooCtlGetProcessThreadCount,
+    kAooCtlSetEncoderThread,
+    kAooCtlGetEncoderThread,
+    kAooCtlSetFecWindow,
+    kAooCtlGetFecWindow,
+    kAooCtlSetAdaptiveLatency,
+    kAooCtlGetAdaptiveLatency,
+    kAooCtlGetFrameAllocatorStats,
+    kAooCtlSetResendBandwidth,
+    kAooCtlGetResendBandwidth,
+    kAooCtlSetResendDedupInterval,
+    kAooCtlGetResendDedupInterval,
+    kAooCtlGetResendStats,
 #if AOO_NET
     kAooCtlSetPassword = 1000,
     kAooCtlSetRelayHost,
@@ -86,6 +100,17 @@ enum
     /* server group controls */
     kAooCtlUpdateGroup,
     kAooCtlUpdateUser,
+    /* more server controls */
+    kAooCtlGetUdpReceiveStats,
+    /* more client controls */
+    kAooCtlSetSendAggregation,
+    kAooCtlGetSendAggregation,
+    kAooCtlJoinMulticastGroup,
+    kAooCtlLeaveMulticastGroup,
+    kAooCtlSetMulticastTTL,
+    /* more server controls */
+    kAooCtlSetClientQueueLimit,
+    kAooCtlGetClientQueueLimit,
 #endif
     kAooCtlSentinel
 };
@@ -102,6 +127,11 @@ enum
  #define AOO_SINK_LATENCY 0.05
 #endif
 
+/** \brief enable/disable adaptive sink latency by default */
+#ifndef AOO_SINK_ADAPTIVE_LATENCY
+ #define AOO_SINK_ADAPTIVE_LATENCY 0
+#endif
+
 /** \brief use binary data message format by default */
 #ifndef AOO_BINARY_FORMAT
  #define AOO_BINARY_FORMAT 1
@@ -142,6 +172,11 @@ enum
  #define AOO_SEND_REDUNDANCY 1
 #endif
 
+/** \brief default FEC window size (0 = off) */
+#ifndef AOO_SEND_FEC_WINDOW
+ #define AOO_SEND_FEC_WINDOW 0
+#endif
+
 /** \brief enable/disable packet resending by default */
 #ifndef AOO_RESEND_DATA
  #define AOO_RESEND_DATA 1
@@ -157,6 +192,22 @@ enum
  #define AOO_RESEND_LIMIT 16
 #endif
 
+/** \brief default max. resend bandwidth in bytes per second (0 = unlimited) */
+#ifndef AOO_RESEND_BANDWIDTH
+ #define AOO_RESEND_BANDWIDTH 0
+#endif
+
+/** \brief default resend deduplication interval in seconds (0 = off) */
+#ifndef AOO_RESEND_DEDUP_INTERVAL
+ #define AOO_RESEND_DEDUP_INTERVAL 0.005
+#endif
+
+/** \brief number of unanswered pings after which
+ * a member of a multicast sink group is removed */
+#ifndef AOO_MULTICAST_MEMBER_PINGS
+ #define AOO_MULTICAST_MEMBER_PINGS 4
+#endif
+
 /** \brief default source timeout */
 #ifndef AOO_SOURCE_TIMEOUT
  #define AOO_SOURCE_TIMEOUT 10.0
@@ -172,6 +223,12 @@ enum
  #define AOO_SERVER_INTERNAL_RELAY 0
 #endif
 
+/** \brief default max. number of bytes that may be queued
+ * for a single client before it is disconnected (0 = unlimited) */
+#ifndef AOO_SERVER_CLIENT_QUEUE_LIMIT
+ #define AOO_SERVER_CLIENT_QUEUE_LIMIT (1 << 22)
+#endif
+
 /** \brief enable/disable automatic group creation by default */
 #ifndef AOO_GROUP_AUTO_CREATE
 #define AOO_GROUP_AUTO_CREATE 1
@@ -182,6 +239,11 @@ enum
 #define AOO_USER_AUTO_CREATE 1
 #endif
 
+/** \brief enable/disable client send aggregation by default */
+#ifndef AOO_CLIENT_SEND_AGGREGATION
+#define AOO_CLIENT_SEND_AGGREGATION 1
+#endif
+
 /*------------------------------------------------------*/
 /*               user defined controls                  */
 /*------------------------------------------------------*/
@@ -210,7 +210,8 @@
 /** \brief commands for 'data' binary message */
 enum
 {
-    kAooBinMsgCmdData = 0
+    kAooBinMsgCmdData = 0,
+    kAooBinMsgCmdParity = 1
 };
 
 /** \brief flags for 'data' binary message */
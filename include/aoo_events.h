@@ -70,6 +70,8 @@ AOO_ENUM(AooEventType)
     kAooEventBlockXRun,
     /** AooSource: frames have been resent */
     kAooEventFrameResend,
+    /** AooSink: blocks have been recovered from parity data */
+    kAooEventBlockRecover,
     /*--------------------------------------------*/
     /*         AooClient/AooServer events         */
     /*--------------------------------------------*/
@@ -335,6 +337,9 @@ typedef AooEventBlock AooEventBlockResend;
 /** \brief (AooSink) empty blocks caused by source xrun */
 typedef AooEventBlock AooEventBlockXRun;
 
+/** \brief (AooSink) blocks have been recovered from parity data */
+typedef AooEventBlock AooEventBlockRecover;
+
 /** \brief (AooSource) frames have been resent */
 typedef struct AooEventFrameResend
 {
@@ -591,6 +596,7 @@ union AooEvent
     AooEventBlockResend blockResend; /**< \brief bock resent */
     AooEventBlockXRun blockXRun; /**< \brief empty block for source xrun */
     AooEventFrameResend frameResend; /**< \brief frames resent */
+    AooEventBlockRecover blockRecover; /**< \brief block recovered */
     /* AooClient/AooServer events */
     AooEventDisconnect disconnect; /**< \brief disconnected from server */
     AooEventNotification notification; /**< \brief server notification */
@@ -183,6 +183,25 @@ AOO_INLINE AooError AooServer_getPingSettings(
     return AooServer_control(server, kAooCtlGetPingSettings, 0, AOO_ARG(*settings));
 }
 
+/** \copydoc AooServer::setClientQueueLimit() */
+AOO_INLINE AooError AooServer_setClientQueueLimit(AooServer *server, AooInt32 n)
+{
+    return AooServer_control(server, kAooCtlSetClientQueueLimit, 0, AOO_ARG(n));
+}
+
+/** \copydoc AooServer::getClientQueueLimit() */
+AOO_INLINE AooError AooServer_getClientQueueLimit(AooServer *server, AooInt32 *n)
+{
+    return AooServer_control(server, kAooCtlGetClientQueueLimit, 0, AOO_ARG(*n));
+}
+
+/** \copydoc AooServer::getUdpReceiveStats() */
+AOO_INLINE AooError AooServer_getUdpReceiveStats(
+    AooServer *server, AooUdpReceiveStats *stats)
+{
+    return AooServer_control(server, kAooCtlGetUdpReceiveStats, 0, AOO_ARG(*stats));
+}
+
 /*--------------------------------------------------*/
 /*         type-safe group control functions        */
 /*--------------------------------------------------*/
@@ -261,6 +261,29 @@ public:
         return control(kAooCtlGetPingSettings, 0, AOO_ARG(settings));
     }
 
+    /** \brief Set the client send queue limit (in bytes)
+     *
+     * Outgoing messages are queued if a client can't keep up;
+     * if the queue grows beyond this limit, the client is disconnected.
+     * A value of 0 means no limit.
+     */
+    AooError setClientQueueLimit(AooInt32 n) {
+        return control(kAooCtlSetClientQueueLimit, 0, AOO_ARG(n));
+    }
+
+    /** \brief Get the client send queue limit (in bytes) */
+    AooError getClientQueueLimit(AooInt32& n) {
+        return control(kAooCtlGetClientQueueLimit, 0, AOO_ARG(n));
+    }
+
+    /** \brief Get UDP receive statistics
+     *
+     * NB: only available with the internal UDP socket.
+     */
+    AooError getUdpReceiveStats(AooUdpReceiveStats& stats) {
+        return control(kAooCtlGetUdpReceiveStats, 0, AOO_ARG(stats));
+    }
+
     /*--------------------------------------------------*/
     /*         type-safe group control functions        */
     /*--------------------------------------------------*/
@@ -292,3 +292,35 @@ AOO_INLINE AooError AooSink_getBinaryFormat(AooSink *sink, AooBool *b)
 {
     return AooSink_control(sink, kAooCtlGetBinaryFormat, 0, AOO_ARG(*b));
 }
+
+/** \copydoc AooSink::setProcessThreadCount() */
+AOO_INLINE AooError AooSink_setProcessThreadCount(AooSink *sink, AooInt32 n)
+{
+    return AooSink_control(sink, kAooCtlSetProcessThreadCount, 0, AOO_ARG(n));
+}
+
+/** \copydoc AooSink::getProcessThreadCount() */
+AOO_INLINE AooError AooSink_getProcessThreadCount(AooSink *sink, AooInt32 *n)
+{
+    return AooSink_control(sink, kAooCtlGetProcessThreadCount, 0, AOO_ARG(*n));
+}
+
+/** \copydoc AooSink::setAdaptiveLatency() */
+AOO_INLINE AooError AooSink_setAdaptiveLatency(AooSink *sink, AooBool b)
+{
+    return AooSink_control(sink, kAooCtlSetAdaptiveLatency, 0, AOO_ARG(b));
+}
+
+/** \copydoc AooSink::getAdaptiveLatency() */
+AOO_INLINE AooError AooSink_getAdaptiveLatency(AooSink *sink, AooBool *b)
+{
+    return AooSink_control(sink, kAooCtlGetAdaptiveLatency, 0, AOO_ARG(*b));
+}
+
+/** \copydoc AooSink::getFrameAllocatorStats() */
+AOO_INLINE AooError AooSink_getFrameAllocatorStats(
+        AooSink *sink, const AooEndpoint *source, AooFrameAllocatorStats *stats)
+{
+    return AooSink_control(sink, kAooCtlGetFrameAllocatorStats,
+                           (AooIntPtr)source, AOO_ARG(*stats));
+}
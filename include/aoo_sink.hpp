@@ -446,6 +446,55 @@ public:
     AooError getBinaryFormat(AooBool& b) {
         return control(kAooCtlGetBinaryFormat, 0, AOO_ARG(b));
     }
+
+    /** \brief Set number of process worker threads
+     *
+     * With more than one source, the sink can decode and resample
+     * the individual streams in parallel; the final mix always happens
+     * on the audio thread. The audio thread takes part in the work
+     * and only waits for streams that are currently being decoded on
+     * a worker thread. The worker threads adopt the priority of the
+     * audio thread and poll for new work, so this is only worth it
+     * for many sources and/or expensive codecs.
+     * 0 = disabled (default)
+     */
+    AooError setProcessThreadCount(AooInt32 n) {
+        return control(kAooCtlSetProcessThreadCount, 0, AOO_ARG(n));
+    }
+
+    /** \brief Get number of process worker threads */
+    AooError getProcessThreadCount(AooInt32& n) {
+        return control(kAooCtlGetProcessThreadCount, 0, AOO_ARG(n));
+    }
+
+    /** \brief Enable/disable adaptive latency
+     *
+     * If enabled, the sink measures the network jitter of each source and
+     * continuously adjusts the buffer latency to the lowest safe value.
+     * The latency is changed smoothly by slightly speeding up or slowing
+     * down the playback (similar to dynamic resampling), so the resampler
+     * is always active. Every change is reported as kAooEventStreamLatency.
+     *
+     * The latency set with AooSink::setLatency() serves as the initial
+     * *and* maximum latency. The default is AOO_SINK_ADAPTIVE_LATENCY.
+     */
+    AooError setAdaptiveLatency(AooBool b) {
+        return control(kAooCtlSetAdaptiveLatency, 0, AOO_ARG(b));
+    }
+
+    /** \brief Check if adaptive latency is enabled */
+    AooError getAdaptiveLatency(AooBool& b) {
+        return control(kAooCtlGetAdaptiveLatency, 0, AOO_ARG(b));
+    }
+
+    /** \brief Get data frame allocator statistics
+     *
+     * \param source The source endpoint.
+     * \param [out] stats The allocator statistics
+     */
+    AooError getFrameAllocatorStats(const AooEndpoint& source, AooFrameAllocatorStats& stats) {
+        return control(kAooCtlGetFrameAllocatorStats, (AooIntPtr)&source, AOO_ARG(stats));
+    }
 protected:
     ~AooSink(){} // non-virtual!
 };
@@ -246,6 +246,36 @@ AOO_INLINE AooError AooSource_getResendBufferSize(AooSource *source, AooSeconds
     return AooSource_control(source, kAooCtlGetResendBufferSize, 0, AOO_ARG(*s));
 }
 
+/** \copydoc AooSource::setResendBandwidth() */
+AOO_INLINE AooError AooSource_setResendBandwidth(AooSource *source, AooInt32 n)
+{
+    return AooSource_control(source, kAooCtlSetResendBandwidth, 0, AOO_ARG(n));
+}
+
+/** \copydoc AooSource::getResendBandwidth() */
+AOO_INLINE AooError AooSource_getResendBandwidth(AooSource *source, AooInt32 *n)
+{
+    return AooSource_control(source, kAooCtlGetResendBandwidth, 0, AOO_ARG(*n));
+}
+
+/** \copydoc AooSource::setResendDedupInterval() */
+AOO_INLINE AooError AooSource_setResendDedupInterval(AooSource *source, AooSeconds s)
+{
+    return AooSource_control(source, kAooCtlSetResendDedupInterval, 0, AOO_ARG(s));
+}
+
+/** \copydoc AooSource::getResendDedupInterval() */
+AOO_INLINE AooError AooSource_getResendDedupInterval(AooSource *source, AooSeconds *s)
+{
+    return AooSource_control(source, kAooCtlGetResendDedupInterval, 0, AOO_ARG(*s));
+}
+
+/** \copydoc AooSource::getResendStats() */
+AOO_INLINE AooError AooSource_getResendStats(AooSource *source, AooResendStats *stats)
+{
+    return AooSource_control(source, kAooCtlGetResendStats, 0, AOO_ARG(*stats));
+}
+
 /** \copydoc AooSource::setRedundancy() */
 AOO_INLINE AooError AooSource_setRedundancy(AooSource *source, AooInt32 n)
 {
@@ -282,6 +312,30 @@ AOO_INLINE AooError AooSource_getStreamTimeSendInterval(AooSource *source, AooSe
     return AooSource_control(source, kAooCtlGetStreamTimeSendInterval, 0, AOO_ARG(*s));
 }
 
+/** \copydoc AooSource::setEncoderThread() */
+AOO_INLINE AooError AooSource_setEncoderThread(AooSource *source, AooBool b)
+{
+    return AooSource_control(source, kAooCtlSetEncoderThread, 0, AOO_ARG(b));
+}
+
+/** \copydoc AooSource::getEncoderThread() */
+AOO_INLINE AooError AooSource_getEncoderThread(AooSource *source, AooBool *b)
+{
+    return AooSource_control(source, kAooCtlGetEncoderThread, 0, AOO_ARG(*b));
+}
+
+/** \copydoc AooSource::setFecWindow() */
+AOO_INLINE AooError AooSource_setFecWindow(AooSource *source, AooInt32 n)
+{
+    return AooSource_control(source, kAooCtlSetFecWindow, 0, AOO_ARG(n));
+}
+
+/** \copydoc AooSource::getFecWindow() */
+AOO_INLINE AooError AooSource_getFecWindow(AooSource *source, AooInt32 *n)
+{
+    return AooSource_control(source, kAooCtlGetFecWindow, 0, AOO_ARG(*n));
+}
+
 /** \copydoc AooSource::setSinkChannelOffset() */
 AOO_INLINE AooError AooSource_setSinkChannelOffset(
         AooSource *source, const AooEndpoint *sink, AooInt32 onset)
@@ -166,6 +166,12 @@ public:
      *
      * If `active` is true, the sink will start active, otherwise
      * it has to be activated manually with AooSource_activateSink().
+     *
+     * The address may also be an IPv4 or IPv6 multicast address. In this case,
+     * all sinks that have joined the multicast group (see
+     * AooClient::joinMulticastGroup()) and use the given sink ID receive the
+     * stream. Every packet is only sent once; resend requests by several
+     * group members are coalesced.
      */
     virtual AooError AOO_CALL addSink(
             const AooEndpoint& sink, AooBool active) = 0;
@@ -397,6 +403,49 @@ public:
         return control(kAooCtlGetResendBufferSize, 0, AOO_ARG(s));
     }
 
+    /** \brief Set the max. resend bandwidth (in bytes per second)
+     *
+     * Limits the rate at which data is resent to all sinks combined,
+     * so that a burst of packet loss does not cause a burst of resent data.
+     * Frames that exceed the budget are skipped; the sink will request
+     * them again if they are still needed.
+     *
+     * If set to 0, the resend bandwidth is unlimited (default).
+     */
+    AooError setResendBandwidth(AooInt32 n) {
+        return control(kAooCtlSetResendBandwidth, 0, AOO_ARG(n));
+    }
+
+    /** \brief Get the max. resend bandwidth (in bytes per second) */
+    AooError getResendBandwidth(AooInt32& n) {
+        return control(kAooCtlGetResendBandwidth, 0, AOO_ARG(n));
+    }
+
+    /** \brief Set the resend deduplication interval (in seconds)
+     *
+     * A frame is resent at most once per interval to the same sink resp.
+     * multicast group, even if it is requested several times. This avoids
+     * resending frames which are still in flight. The interval should be
+     * smaller than the resend interval of the sink, see
+     * AooSink::setResendInterval(). Set to 0 to disable.
+     */
+    AooError setResendDedupInterval(AooSeconds s) {
+        return control(kAooCtlSetResendDedupInterval, 0, AOO_ARG(s));
+    }
+
+    /** \brief Get the resend deduplication interval (in seconds) */
+    AooError getResendDedupInterval(AooSeconds& s) {
+        return control(kAooCtlGetResendDedupInterval, 0, AOO_ARG(s));
+    }
+
+    /** \brief Get resend statistics
+     *
+     * \param [out] stats The resend statistics
+     */
+    AooError getResendStats(AooResendStats& stats) {
+        return control(kAooCtlGetResendStats, 0, AOO_ARG(stats));
+    }
+
     /** \brief Set redundancy
      *
      * The number of times each frames is sent (default = 1). This is a primitive
@@ -443,6 +492,43 @@ public:
         return control(kAooCtlGetStreamTimeSendInterval, 0, AOO_ARG(s));
     }
 
+    /** \brief Enable/disable encoder thread
+     *
+     * By default, audio is encoded in AooSource::send(), so expensive
+     * codecs can delay other network messages, like pings or resent data.
+     * If enabled, audio is encoded on a dedicated thread instead and
+     * AooSource::send() only sends the encoded blocks.
+     */
+    AooError setEncoderThread(AooBool b) {
+        return control(kAooCtlSetEncoderThread, 0, AOO_ARG(b));
+    }
+
+    /** \brief Check if encoder thread is enabled */
+    AooError getEncoderThread(AooBool& b) {
+        return control(kAooCtlGetEncoderThread, 0, AOO_ARG(b));
+    }
+
+    /** \brief Set FEC window size (in blocks)
+     *
+     * After every `n` blocks, the source sends an additional parity block
+     * (the XOR of these blocks), so that the sink can rebuild a single lost
+     * block per window without having to wait for resent data.
+     * This adds roughly 1/n of bandwidth. Set to 0 to disable (default).
+     *
+     * \note Parity blocks are only sent with the binary message format,
+     * see AooSource::setBinaryFormat(). Also, the sink latency should be
+     * larger than the window, otherwise blocks might be played before
+     * they could be recovered.
+     */
+    AooError setFecWindow(AooInt32 n) {
+        return control(kAooCtlSetFecWindow, 0, AOO_ARG(n));
+    }
+
+    /** \brief Get FEC window size (in blocks) */
+    AooError getFecWindow(AooInt32& n) {
+        return control(kAooCtlGetFecWindow, 0, AOO_ARG(n));
+    }
+
     /** \brief Set the sink channel offset
      *
      * Set the starting channel where the source signal should be received
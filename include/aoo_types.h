@@ -290,6 +290,8 @@ AOO_ENUM(AooResampleMethod)
     kAooResampleLinear,
     /** cubic interpolation */
     kAooResampleCubic,
+    /** polyphase windowed sinc interpolation (band-limited) */
+    kAooResamplePolyphase,
     /** sentinel */
     kAooResampleMethodEnd
 };
@@ -418,6 +420,18 @@ typedef void (AOO_CALL *AooEventHandler)(
 
 /*------------------------------------------------------------------*/
 
+/** \brief flags for #AooSendFunc */
+AOO_FLAG(AooSendFlags)
+{
+    /** More packets will follow immediately, e.g. the same
+     * data frame for other sinks. The send function may queue
+     * the packet and send all pending packets together when it
+     * receives a packet without this flag (e.g. with `sendmmsg()`).
+     * NB: the packet data is only valid during the function call,
+     * so it must be copied! Send functions may simply ignore this flag. */
+    kAooSendMore = 0x01
+};
+
 /** \brief UDP send function
  *
  * The function type that is passed to #AooSource,
@@ -434,8 +448,7 @@ typedef AooInt32 (AOO_CALL *AooSendFunc)(
         const void *address,
         /** the socket address length */
         AooAddrSize addrlen,
-        /** optional flags */
-        /* TODO do we need this? */
+        /** optional flags, see #AooSendFlags */
         AooFlag flags
 );
 
@@ -717,9 +730,9 @@ typedef struct AooServerSettings
 #ifdef __cplusplus
     /** default constructor */
     AooServerSettings()
-        : structSize(AOO_STRUCT_SIZE(AooServerSettings, userData)),
+        : structSize(AOO_STRUCT_SIZE(AooServerSettings, relayThreads)),
           options(0), portNumber(0), socketType(kAooSocketDefault),
-          userData(NULL), sendFunc(NULL) {}
+          userData(NULL), sendFunc(NULL), relayThreads(1) {}
 #endif
 
     /** struct size */
@@ -735,12 +748,20 @@ typedef struct AooServerSettings
     void *userData;
     /** (optional) send function for external UDP socket */
     AooSendFunc sendFunc;
+    /** (optional) number of UDP receive threads for relaying.
+     *
+     * If larger than 1, the server opens additional UDP sockets on the same
+     * port, each with its own receive thread; incoming packets are sharded
+     * by their source address. The first socket is still served by
+     * AooServer::receive(). Only supported with the internal UDP socket
+     * on Linux, otherwise this setting is ignored. Default: 1 */
+    AooInt32 relayThreads;
 } AooServerSettings;
 
 /** \brief (C only) default initializer for AooServerSettings struct */
 #define AOO_SERVER_SETTINGS_INIT() \
-    { AOO_STRUCT_SIZE(AooServerSettings, userData), 0, 0, \
-        kAooSocketDefault, NULL, NULL }
+    { AOO_STRUCT_SIZE(AooServerSettings, relayThreads), 0, 0, \
+        kAooSocketDefault, NULL, NULL, 1 }
 
 /*------------------------------------------------------------------*/
 
@@ -759,6 +780,71 @@ typedef struct AooPingSettings
 
 /*------------------------------------------------------------------*/
 
+/** \brief UDP receive statistics
+ *
+ * Can be used to check how many packets are received per system call.
+ */
+typedef struct AooUdpReceiveStats
+{
+    /** total number of received packets */
+    AooUInt64 packetCount;
+    /** number of receive calls that returned at least one packet */
+    AooUInt64 callCount;
+    /** max. number of packets returned by a single receive call */
+    AooInt32 maxBatchSize;
+    /** number of packets that have been dropped because the receive
+     * queue was full or the packet was too large (threaded mode only) */
+    AooUInt64 overflowCount;
+} AooUdpReceiveStats;
+
+/*------------------------------------------------------------------*/
+
+/** \brief max. number of bins in AooFrameAllocatorStats */
+#define kAooFrameAllocatorMaxBins 16
+
+/** \brief data frame allocator statistics
+ *
+ * The sink stores incoming stream data in a pooling allocator with
+ * power-of-2 size classes ("bins"). Can be used to check how often
+ * allocations are served from the pool and how much memory it holds.
+ */
+typedef struct AooFrameAllocatorStats
+{
+    /** number of allocations that have been served from the pool */
+    AooUInt64 hitCount;
+    /** number of allocations that required new memory */
+    AooUInt64 missCount;
+    /** size of the first bin in bytes; each bin is twice as large as the previous one */
+    AooInt32 minBinSize;
+    /** number of bins */
+    AooInt32 numBins;
+    /** allocated memory per bin in bytes */
+    AooUInt64 binBytes[kAooFrameAllocatorMaxBins];
+} AooFrameAllocatorStats;
+
+/*------------------------------------------------------------------*/
+
+/** \brief resend statistics
+ *
+ * All values are frame counts since the source has been created.
+ * Requests for the same frame that arrive in the same send cycle
+ * (e.g. from several members of a multicast group) are only counted once.
+ * Frames that are no longer in the history buffer are neither counted
+ * as sent nor as suppressed.
+ */
+typedef struct AooResendStats
+{
+    /** number of requested frames */
+    AooUInt64 requestCount;
+    /** number of resent frames */
+    AooUInt64 sentCount;
+    /** number of frames that have not been resent because they had
+     * already been resent recently or the resend bandwidth was exhausted */
+    AooUInt64 suppressedCount;
+} AooResendStats;
+
+/*------------------------------------------------------------------*/
+
 /** \cond DO_NOT_DOCUMENT */
 typedef union AooRequest AooRequest;
 /** \endcond */
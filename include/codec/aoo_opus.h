@@ -133,6 +133,59 @@ AOO_INLINE AooError AooSource_getOpusSignalType(
                 signalType, sizeof(*signalType));
 }
 
+/** \brief enable/disable in-band FEC
+ *
+ * If enabled, the encoder adds redundant data to each packet,
+ * so that the sink can recover a lost packet from the following one.
+ * The amount of redundancy depends on the expected packet loss,
+ * which is automatically updated with the packet loss reported by the sinks.
+ *
+ * \param src the AOO source
+ * \param sink the AOO sink (`NULL` for all sinks)
+ * \param fec `0`: off, `1`: on
+ */
+AOO_INLINE AooError AooSource_setOpusInbandFec(
+        struct AooSource *src, const AooEndpoint *sink, opus_int32 fec)
+{
+    return AooSource_codecControl(src, kAooCodecOpus,
+                OPUS_SET_INBAND_FEC_REQUEST, (AooIntPtr)sink,
+                &fec, sizeof(fec));
+}
+
+/** \brief check if in-band FEC is enabled */
+AOO_INLINE AooError AooSource_getOpusInbandFec(
+        struct AooSource *src, const AooEndpoint *sink, opus_int32 *fec)
+{
+    return AooSource_codecControl(src, kAooCodecOpus,
+                OPUS_GET_INBAND_FEC_REQUEST, (AooIntPtr)sink,
+                fec, sizeof(*fec));
+}
+
+/** \brief set expected packet loss
+ *
+ * \note This is overwritten whenever the packet loss reported by the sinks changes.
+ *
+ * \param src the AOO source
+ * \param sink the AOO sink (`NULL` for all sinks)
+ * \param loss packet loss in percent (0-100)
+ */
+AOO_INLINE AooError AooSource_setOpusPacketLoss(
+        struct AooSource *src, const AooEndpoint *sink, opus_int32 loss)
+{
+    return AooSource_codecControl(src, kAooCodecOpus,
+                OPUS_SET_PACKET_LOSS_PERC_REQUEST, (AooIntPtr)sink,
+                &loss, sizeof(loss));
+}
+
+/** \brief get expected packet loss */
+AOO_INLINE AooError AooSource_getOpusPacketLoss(
+        struct AooSource *src, const AooEndpoint *sink, opus_int32 *loss)
+{
+    return AooSource_codecControl(src, kAooCodecOpus,
+                OPUS_GET_PACKET_LOSS_PERC_REQUEST, (AooIntPtr)sink,
+                loss, sizeof(*loss));
+}
+
 /*--------------------------------------------------------------------*/
 
 AOO_PACK_END
@@ -284,6 +284,8 @@ static void aoo_receive_resample_method(t_aoo_receive *x, t_symbol *s)
         method = kAooResampleLinear;
     } else if (name == "cubic") {
         method = kAooResampleCubic;
+    } else if (name == "polyphase") {
+        method = kAooResamplePolyphase;
     } else {
         pd_error(x, "%s: bad resample method '%s'",
                  classname(x), name.data());
@@ -300,6 +302,37 @@ static void aoo_receive_dynamic_resampling(t_aoo_receive *x, t_floatarg f)
     x->x_sink->setDynamicResampling(f);
 }
 
+static void aoo_receive_adaptive_latency(t_aoo_receive *x, t_floatarg f)
+{
+    x->x_sink->setAdaptiveLatency(f);
+}
+
+static void aoo_receive_join_multicast(t_aoo_receive *x, t_symbol *group)
+{
+    if (!x->x_node) {
+        pd_error(x, "%s: no socket!", classname(x));
+        return;
+    }
+    auto err = x->x_node->client()->joinMulticastGroup(group->s_name);
+    if (err != kAooOk) {
+        pd_error(x, "%s: couldn't join multicast group %s: %s",
+                 classname(x), group->s_name, aoo_strerror(err));
+    }
+}
+
+static void aoo_receive_leave_multicast(t_aoo_receive *x, t_symbol *group)
+{
+    if (!x->x_node) {
+        pd_error(x, "%s: no socket!", classname(x));
+        return;
+    }
+    auto err = x->x_node->client()->leaveMulticastGroup(group->s_name);
+    if (err != kAooOk) {
+        pd_error(x, "%s: couldn't leave multicast group %s: %s",
+                 classname(x), group->s_name, aoo_strerror(err));
+    }
+}
+
 static void aoo_receive_dll_bandwidth(t_aoo_receive *x, t_floatarg f)
 {
     x->x_sink->setDllBandwidth(f);
@@ -420,6 +453,7 @@ static void aoo_receive_handle_event(t_aoo_receive *x, const AooEvent *event, in
     case kAooEventBlockDrop:
     case kAooEventBlockResend:
     case kAooEventBlockXRun:
+    case kAooEventBlockRecover:
     case kAooEventSourcePing:
     {
         // common endpoint header
@@ -596,6 +630,12 @@ static void aoo_receive_handle_event(t_aoo_receive *x, const AooEvent *event, in
             outlet_anything(x->x_msgout, gensym("block_xrun"), 4, msg);
             break;
         }
+        case kAooEventBlockRecover:
+        {
+            SETFLOAT(msg + 3, event->blockRecover.count);
+            outlet_anything(x->x_msgout, gensym("block_recovered"), 4, msg);
+            break;
+        }
         default:
             bug("aoo_receive_handle_event: bad case label!");
             break;
@@ -956,6 +996,12 @@ void aoo_receive_tilde_setup(void)
                     gensym("resample_method"), A_SYMBOL, A_NULL);
     class_addmethod(aoo_receive_class, (t_method)aoo_receive_dynamic_resampling,
                     gensym("dynamic_resampling"), A_FLOAT, A_NULL);
+    class_addmethod(aoo_receive_class, (t_method)aoo_receive_adaptive_latency,
+                    gensym("adaptive_latency"), A_FLOAT, A_NULL);
+    class_addmethod(aoo_receive_class, (t_method)aoo_receive_join_multicast,
+                    gensym("join_multicast"), A_SYMBOL, A_NULL);
+    class_addmethod(aoo_receive_class, (t_method)aoo_receive_leave_multicast,
+                    gensym("leave_multicast"), A_SYMBOL, A_NULL);
     class_addmethod(aoo_receive_class, (t_method)aoo_receive_dll_bandwidth,
                     gensym("dll_bandwidth"), A_FLOAT, A_NULL);
     class_addmethod(aoo_receive_class, (t_method)aoo_receive_real_samplerate,
@@ -369,6 +369,28 @@ static void set_opus_signal(t_aoo_send *x, const t_atom *a){
     }
 }
 
+static bool get_opus_fec(t_aoo_send *x, t_atom *a){
+    opus_int32 value;
+    auto err = AooSource_getOpusInbandFec(x->x_source.get(), 0, &value);
+    if (err != kAooOk){
+        pd_error(x, "%s: could not get FEC: %s",
+                 classname(x), aoo_strerror(err));
+        return false;
+    }
+    SETFLOAT(a, value != 0);
+    return true;
+}
+
+static void set_opus_fec(t_aoo_send *x, const t_atom *a){
+    // 0 or 1
+    opus_int32 value = atom_getfloat(a) != 0;
+    auto err = AooSource_setOpusInbandFec(x->x_source.get(), 0, value);
+    if (err != kAooOk){
+        pd_error(x, "%s: could not set FEC: %s",
+                 classname(x), aoo_strerror(err));
+    }
+}
+
 #endif
 
 static void aoo_send_codec_set(t_aoo_send *x, t_symbol *s, int argc, t_atom *argv){
@@ -387,6 +409,9 @@ static void aoo_send_codec_set(t_aoo_send *x, t_symbol *s, int argc, t_atom *arg
         } else if (name == gensym("signal")){
             set_opus_signal(x, argv + 1);
             return;
+        } else if (name == gensym("fec")){
+            set_opus_fec(x, argv + 1);
+            return;
         }
     }
 #endif
@@ -420,6 +445,12 @@ static void aoo_send_codec_get(t_aoo_send *x, t_symbol *s){
             } else {
                 return;
             }
+        } else if (s == gensym("fec")){
+            if (get_opus_fec(x, msg + 1)){
+                goto codec_sendit;
+            } else {
+                return;
+            }
         }
     }
 #endif
@@ -674,6 +705,16 @@ static void aoo_send_redundancy(t_aoo_send *x, t_floatarg f)
     x->x_source->setRedundancy(f);
 }
 
+static void aoo_send_parity(t_aoo_send *x, t_floatarg f)
+{
+    x->x_source->setFecWindow(f);
+}
+
+static void aoo_send_resend_bandwidth(t_aoo_send *x, t_floatarg f)
+{
+    x->x_source->setResendBandwidth(f);
+}
+
 static void aoo_send_resample_method(t_aoo_send *x, t_symbol *s)
 {
     AooResampleMethod method;
@@ -684,6 +725,8 @@ static void aoo_send_resample_method(t_aoo_send *x, t_symbol *s)
         method = kAooResampleLinear;
     } else if (name == "cubic") {
         method = kAooResampleCubic;
+    } else if (name == "polyphase") {
+        method = kAooResamplePolyphase;
     } else {
         pd_error(x, "%s: bad resample method '%s'",
                  classname(x), name.data());
@@ -1186,6 +1229,10 @@ void aoo_send_tilde_setup(void)
                     gensym("resend"), A_FLOAT, A_NULL);
     class_addmethod(aoo_send_class, (t_method)aoo_send_redundancy,
                     gensym("redundancy"), A_FLOAT, A_NULL);
+    class_addmethod(aoo_send_class, (t_method)aoo_send_parity,
+                    gensym("parity"), A_FLOAT, A_NULL);
+    class_addmethod(aoo_send_class, (t_method)aoo_send_resend_bandwidth,
+                    gensym("resend_bandwidth"), A_FLOAT, A_NULL);
     class_addmethod(aoo_send_class, (t_method)aoo_send_resample_method,
                     gensym("resample_method"), A_SYMBOL, A_NULL);
     class_addmethod(aoo_send_class, (t_method)aoo_send_dynamic_resampling,
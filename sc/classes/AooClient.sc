@@ -428,6 +428,16 @@ AooClient {
 		server.sendMsg('/cmd', '/aoo_ping', this.port, seconds);
 	}
 
+	// Join a multicast group, e.g. "239.255.0.1", on the client's UDP socket,
+	// so that AooReceive objects on this port get streams sent to the group.
+	joinMulticast { arg group;
+		server.sendMsg('/cmd', '/aoo_client_multicast', this.port, 1, group.asString);
+	}
+
+	leaveMulticast { arg group;
+		server.sendMsg('/cmd', '/aoo_client_multicast', this.port, 0, group.asString);
+	}
+
 	// Try to find peer, but only if no IP/port is given.
 	// So far only called by send().
 	prResolveAddr { arg addr;
@@ -97,6 +97,7 @@ AooReceiveCtl : AooCtl {
 			\blockDropped, { ^event ++ args[3] },
 			\blockResent, { ^event ++ args[3] },
 			\blockXRun, { ^event ++ args[3] },
+			\blockRecovered, { ^event ++ args[3] },
 			\overrun, { ^event },
 			\underrun, { ^event },
 			{ "%: ignore unknown event '%'".format(this.class, type).warn; ^nil }
@@ -194,6 +195,10 @@ AooReceiveCtl : AooCtl {
 		this.prSendMsg('/dynamic_resampling', enable);
 	}
 
+	adaptiveLatency { arg enable;
+		this.prSendMsg('/adaptive_latency', enable);
+	}
+
 	dllBandwidth { arg bandwidth;
 		this.prSendMsg('/dll_bw', bandwidth);
 	}
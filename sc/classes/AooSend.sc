@@ -226,6 +226,14 @@ AooSendCtl : AooCtl {
 		this.prSendMsg('/redundancy', count);
 	}
 
+	parity { arg window;
+		this.prSendMsg('/parity', window);
+	}
+
+	resendBandwidth { arg bytes;
+		this.prSendMsg('/resend_bandwidth', bytes);
+	}
+
 	dynamicResampling { arg enable;
 		this.prSendMsg('/dynamic_resampling', enable);
 	}
@@ -200,6 +200,22 @@ void AooClient::leaveGroup(int token, AooId group) {
     node_->client()->leaveGroup(group, cb, new RequestData { this, token });
 }
 
+void AooClient::joinMulticastGroup(const char *group) {
+    auto err = node_->client()->joinMulticastGroup(group);
+    if (err != kAooOk) {
+        LOG_ERROR("AooClient: could not join multicast group "
+                  << group << ": " << aoo_strerror(err));
+    }
+}
+
+void AooClient::leaveMulticastGroup(const char *group) {
+    auto err = node_->client()->leaveMulticastGroup(group);
+    if (err != kAooOk) {
+        LOG_ERROR("AooClient: could not leave multicast group "
+                  << group << ": " << aoo_strerror(err));
+    }
+}
+
 // called from network thread
 void AooClient::handleEvent(const AooEvent* event) {
     if (event->type == kAooEventPeerMessage) {
@@ -647,6 +663,38 @@ void aoo_client_packet_size(World* world, void* user,
     }
 }
 
+void aoo_client_multicast(World* world, void* user,
+                          sc_msg_iter* args, void* replyAddr)
+{
+    auto port = args->geti();
+    auto join = args->geti();
+    auto group = args->gets();
+
+    auto cmdData = CmdData::create<sc::MulticastCmd>(world);
+    if (cmdData) {
+        cmdData->port = port;
+        cmdData->token = -1;
+        cmdData->join = join;
+        snprintf(cmdData->group, sizeof(cmdData->group), "%s", group);
+
+        auto fn = [](World * world, void* cmdData) {
+            auto data = (sc::MulticastCmd *)cmdData;
+            auto client = getClient(world, data->port, 0, nullptr);
+            if (client) {
+                if (data->join) {
+                    client->joinMulticastGroup(data->group);
+                } else {
+                    client->leaveMulticastGroup(data->group);
+                }
+            }
+
+            return false; // done
+        };
+
+        doCommand(world, replyAddr, cmdData, fn);
+    }
+}
+
 } // namespace
 
 /*////////////// Setup /////////////////*/
@@ -662,4 +710,5 @@ void AooClientLoad(InterfaceTable *inTable){
     AooPluginCmd(aoo_client_group_leave);
     AooPluginCmd(aoo_client_packet_size);
     AooPluginCmd(aoo_client_ping);
+    AooPluginCmd(aoo_client_multicast);
 }
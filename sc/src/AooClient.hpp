@@ -38,6 +38,10 @@ public:
     void setPacketSize(AooInt32 size) {
         node_->client()->setPacketSize(size);
     }
+
+    void joinMulticastGroup(const char *group);
+
+    void leaveMulticastGroup(const char *group);
 private:
     std::shared_ptr<INode> node_;
 
@@ -88,6 +92,11 @@ struct GroupLeaveCmd : AooClientCmd {
     AooId group;
 };
 
+struct MulticastCmd : AooClientCmd {
+    int join;
+    char group[64];
+};
+
 struct ControlCmd : AooClientCmd {
     union {
         int i;
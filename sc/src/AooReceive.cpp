@@ -192,6 +192,13 @@ void AooReceive::handleEvent(const AooEvent *event){
         sendMsgRT(msg);
         break;
     }
+    case kAooEventBlockRecover:
+    {
+        beginEvent(msg, "blockRecovered", event->blockRecover.endpoint)
+            << event->blockRecover.count;
+        sendMsgRT(msg);
+        break;
+    }
     case kAooEventBufferOverrun:
     {
         beginEvent(msg, "overrun", event->bufferOverrrun.endpoint);
@@ -410,6 +417,10 @@ void aoo_recv_dynamic_resampling(AooReceiveUnit *unit, sc_msg_iter *args){
     unit->delegate().sink()->setDynamicResampling(args->geti());
 }
 
+void aoo_recv_adaptive_latency(AooReceiveUnit *unit, sc_msg_iter *args){
+    unit->delegate().sink()->setAdaptiveLatency(args->geti());
+}
+
 void aoo_recv_dll_bw(AooReceiveUnit *unit, sc_msg_iter *args){
     unit->delegate().sink()->setDllBandwidth(args->getf());
 }
@@ -450,5 +461,6 @@ void AooReceiveLoad(InterfaceTable* inTable) {
     AooUnitCmd(resend_interval);
     AooUnitCmd(reset);
     AooUnitCmd(dynamic_resampling);
+    AooUnitCmd(adaptive_latency);
     AooUnitCmd(dll_bw);
 }
@@ -672,6 +672,14 @@ void aoo_send_redundancy(AooSendUnit *unit, sc_msg_iter* args){
     unit->delegate().source()->setRedundancy(args->geti());
 }
 
+void aoo_send_parity(AooSendUnit *unit, sc_msg_iter* args){
+    unit->delegate().source()->setFecWindow(args->geti());
+}
+
+void aoo_send_resend_bandwidth(AooSendUnit *unit, sc_msg_iter* args){
+    unit->delegate().source()->setResendBandwidth(args->geti());
+}
+
 void aoo_send_dynamic_resampling(AooSendUnit *unit, sc_msg_iter* args){
     unit->delegate().source()->setDynamicResampling(args->geti());
 }
@@ -721,6 +729,8 @@ void AooSendLoad(InterfaceTable *inTable){
     AooUnitCmd(ping);
     AooUnitCmd(resend);
     AooUnitCmd(redundancy);
+    AooUnitCmd(parity);
+    AooUnitCmd(resend_bandwidth);
     AooUnitCmd(dynamic_resampling);
     AooUnitCmd(dll_bw);
 }
@@ -144,6 +144,8 @@ void print_usage() {
         << "  -p, --port=PORT        port number (default = " << AOO_DEFAULT_SERVER_PORT << ")\n"
         << "  -P, --password=PWD     password\n"
         << "  -r, --relay            enable server relay\n"
+        << "  -t, --relay-threads=N  number of UDP relay threads (default = "
+        << AooServerSettings().relayThreads << ")\n"
         << "  -l, --log-level=LEVEL  set log level\n"
         << std::endl;
 }
@@ -226,6 +228,7 @@ int main(int argc, const char **argv) {
     // parse command line options
     int port = AOO_DEFAULT_SERVER_PORT;
     bool relay = false;
+    int relay_threads = AooServerSettings().relayThreads;
     std::string password;
 
     argc--; argv++;
@@ -248,6 +251,12 @@ int main(int argc, const char **argv) {
                 password = *arg;
             } else if (match_option(argv, argc, "-r", "--relay")) {
                 relay = true;
+            } else if (auto arg = match_option<int>(argv, argc, "-t", "--relay-threads")) {
+                relay_threads = *arg;
+                if (relay_threads < 1) {
+                    std::cout << "Number of relay threads must be at least 1" << std::endl;
+                    return EXIT_FAILURE;
+                }
             } else if (auto arg = match_option<int>(argv, argc, "-l", "--log-level")) {
                 auto level = *arg;
                 if (level < kAooLogLevelNone || level > kAooLogLevelDebug) {
@@ -298,6 +307,7 @@ int main(int argc, const char **argv) {
 
     AooServerSettings server_settings;
     server_settings.portNumber = port;
+    server_settings.relayThreads = relay_threads;
 
     auto err = g_server->setup(server_settings);
     if (err != kAooOk) {
@@ -0,0 +1,487 @@
+#include "aoo.h"
+#include "aoo_client.hpp"
+#include "aoo_events.h"
+#include "aoo_requests.h"
+#include "aoo_server.hpp"
+#include "aoo_source.hpp"
+#include "codec/aoo_pcm.h"
+
+#include "aoo/src/net/timer_queue.hpp"
+#include "common/net_utils.hpp"
+#include "common/time.hpp"
+
+#include "osc/OscReceivedElements.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace aoo;
+
+using seconds = std::chrono::duration<double>;
+using hrclock = std::chrono::high_resolution_clock;
+
+constexpr int port = 47279;
+
+int errors = 0;
+
+void check(bool cond, const char *what) {
+    if (!cond) {
+        std::cout << "error: " << what << std::endl;
+        errors++;
+    }
+}
+
+//------------------------ timer queue ------------------------//
+
+struct object {
+    time_tag scheduled;
+    int visits = 0;
+
+    time_tag scheduled_time() const { return scheduled; }
+    void set_scheduled_time(time_tag t) { scheduled = t; }
+};
+
+time_tag at(double s) {
+    return time_tag::from_seconds(100.0 + s);
+}
+
+void test_timer_queue() {
+    object objects[2];
+    bool removed = false;
+    net::timer_queue<int, object> queue;
+    auto find = [&](int key) -> object * {
+        return (key == 1 && removed) ? nullptr : &objects[key];
+    };
+    auto visit = [](object& o) { o.visits++; };
+
+    // timers are dispatched when they are due
+    queue.schedule(objects[0], 0, at(1));
+    check(queue.next() == at(1), "wrong next deadline");
+    queue.dispatch(at(0.5), find, visit);
+    check(objects[0].visits == 0, "object visited before its deadline");
+    queue.dispatch(at(1), find, visit);
+    check(objects[0].visits == 1, "object not visited at its deadline");
+    check(objects[0].scheduled.is_empty(), "scheduled time not cleared");
+    check(queue.next().is_empty(), "timer not removed");
+
+    // a later deadline doesn't add a timer...
+    queue.schedule(objects[0], 0, at(2));
+    check(!queue.schedule(objects[0], 0, at(3)), "later deadline added a timer");
+    // ...but an earlier deadline does; the old timer becomes stale.
+    check(queue.schedule(objects[0], 0, at(1.5)), "earlier deadline did not add a timer");
+    check(queue.size() == 2, "wrong number of timers");
+    // the object reschedules itself when visited
+    auto resched = [&](object& o) {
+        o.visits++;
+        queue.schedule(o, 0, at(4));
+    };
+    objects[0].visits = 0;
+    queue.dispatch(at(1.5), find, resched);
+    check(objects[0].visits == 1, "object not visited at the earlier deadline");
+    queue.dispatch(at(2), find, resched);
+    check(objects[0].visits == 1, "stale timer has not been ignored");
+    check(queue.next() == at(4), "wrong next deadline after stale timer");
+    queue.dispatch(at(4), find, visit);
+    check(objects[0].visits == 2, "object not visited after rescheduling");
+
+    // an object is only visited once, even if several (stale) timers are due;
+    // timers of removed objects are ignored.
+    objects[0].visits = 0;
+    queue.schedule(objects[0], 0, at(6));
+    queue.schedule(objects[0], 0, at(5));
+    queue.schedule(objects[1], 1, at(5));
+    removed = true;
+    queue.dispatch(at(10), find, visit);
+    check(objects[0].visits == 1, "object visited more than once");
+    check(objects[1].visits == 0, "removed object visited");
+    check(queue.size() == 0, "due timers not removed");
+}
+
+//------------------------ client ------------------------//
+
+struct test_client {
+    AooClient::Ptr client;
+    std::thread run_thread;
+    std::thread receive_thread;
+    std::thread send_thread;
+    std::atomic<bool> connected{false};
+    std::atomic<AooId> group{kAooIdInvalid};
+    std::atomic<AooId> peer{kAooIdInvalid};
+    std::atomic<int> messages{0};
+
+    test_client(bool send_thread);
+    ~test_client();
+
+    void handle_event(const AooEvent& e) {
+        if (e.type == kAooEventPeerJoin) {
+            peer.store(e.peer.userId);
+        } else if (e.type == kAooEventPeerMessage) {
+            messages++;
+        }
+    }
+};
+
+// NB: only ping very rarely, so that neither the server nor the peer
+// can make the client busy during the test.
+const AooPingSettings ping_settings { 10.0, 20.0, 1.0, 3 };
+
+test_client::test_client(bool threaded) {
+    client = AooClient::create();
+    client->setEventHandler([](void *user, const AooEvent *e, AooThreadLevel) {
+        static_cast<test_client *>(user)->handle_event(*e);
+    }, this, kAooEventModeCallback);
+    AooClientSettings settings;
+    settings.socketType = kAooSocketIPv4;
+    if (client->setup(settings) != kAooOk) {
+        throw std::runtime_error("could not setup client");
+    }
+    client->setPeerPingSettings(ping_settings);
+    client->setServerPingSettings(ping_settings);
+    run_thread = std::thread([this]() { client->run(kAooInfinite); });
+    receive_thread = std::thread([this]() { client->receive(kAooInfinite); });
+    if (threaded) {
+        send_thread = std::thread([this]() { client->send(kAooInfinite); });
+    }
+}
+
+test_client::~test_client() {
+    client->stop();
+    run_thread.join();
+    receive_thread.join();
+    if (send_thread.joinable()) {
+        send_thread.join();
+    }
+}
+
+// wait for a condition while calling 'fn'
+template<typename Cond, typename Fn>
+bool wait_for(Cond&& cond, Fn&& fn, double timeout = 5.0) {
+    auto t1 = hrclock::now();
+    while (!cond()) {
+        fn();
+        if (seconds(hrclock::now() - t1).count() > timeout) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+bool connect(test_client& c, const char *name) {
+    AooClientConnect args;
+    args.hostName = "127.0.0.1";
+    args.port = port;
+    c.client->connect(args, [](void *user, const AooRequest *, AooError result,
+                               const AooResponse *) {
+        static_cast<test_client *>(user)->connected.store(result == kAooOk);
+    }, &c);
+    if (!wait_for([&]() { return c.connected.load(); }, [](){})) {
+        return false;
+    }
+    AooClientJoinGroup join;
+    join.groupName = "test";
+    join.userName = name;
+    c.client->joinGroup(join, [](void *user, const AooRequest *, AooError result,
+                                 const AooResponse *response) {
+        if (result == kAooOk) {
+            static_cast<test_client *>(user)->group.store(response->groupJoin.groupId);
+        }
+    }, &c);
+    return wait_for([&]() { return c.group.load() != kAooIdInvalid; }, [](){});
+}
+
+// call send(0) until there is nothing left to do; returns the number of calls.
+int settle(AooClient& client) {
+    for (int i = 1; i <= 100; ++i) {
+        if (client.send(0) == kAooErrorWouldBlock) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// call send() until it has not done anything for the given duration.
+bool wait_idle(AooClient& client, double duration = 1.5, double timeout = 10.0) {
+    auto t1 = hrclock::now();
+    auto last = t1;
+    for (;;) {
+        auto err = client.send(0.1);
+        auto now = hrclock::now();
+        if (err == kAooOk) {
+            last = now;
+        } else if (seconds(now - last).count() >= duration) {
+            return true;
+        }
+        if (seconds(now - t1).count() > timeout) {
+            return false;
+        }
+    }
+}
+
+// CPU time of the whole process
+double cpu_time() {
+    return (double)std::clock() / CLOCKS_PER_SEC;
+}
+
+void test_client_send() {
+    auto server = AooServer::create();
+    AooServerSettings settings;
+    settings.portNumber = port;
+    if (server->setup(settings) != kAooOk) {
+        std::cout << "error: could not setup server" << std::endl;
+        errors++;
+        return;
+    }
+    std::thread server_thread([&]() { server->run(kAooInfinite); });
+    std::thread server_udp_thread([&]() { server->receive(kAooInfinite); });
+
+    {
+        // the send() method of 'a' is called manually by the test
+        test_client a(false), b(true);
+
+        // 1) a disconnected client without sources and sinks has nothing to do,
+        // so send() must block for the whole duration without burning the CPU.
+        {
+            settle(*a.client);
+            auto t1 = hrclock::now();
+            auto c1 = cpu_time();
+            auto err = a.client->send(0.3);
+            auto elapsed = seconds(hrclock::now() - t1).count();
+            auto cpu = cpu_time() - c1;
+            check(err == kAooErrorWouldBlock, "idle send() did not return kAooErrorWouldBlock");
+            check(elapsed >= 0.25, "idle send() returned too early");
+            std::cout << "idle send(0.3): " << elapsed << " s, CPU time " << cpu << " s" << std::endl;
+        #ifndef _WIN32
+            // NB: on Windows, std::clock() returns the wall clock time
+            check(cpu < 0.1, "idle send() is busy");
+        #endif
+        }
+
+        // connect the clients; they become peers.
+        bool connected = connect(b, "b");
+        std::thread a_thread([&]() {
+            connected = connect(a, "a") && connected;
+        });
+        // drive 'a' until the peer handshake has finished
+        auto joined = wait_for([&]() { return a.peer.load() != kAooIdInvalid
+                                           && b.peer.load() != kAooIdInvalid; },
+                               [&]() { a.client->send(0); });
+        a_thread.join();
+        check(connected, "could not connect clients");
+        check(joined, "peers did not join");
+        if (!connected || !joined) {
+            server->stop();
+            server_thread.join();
+            server_udp_thread.join();
+            return;
+        }
+
+        // 2) once everything is sent, send(0) returns kAooErrorWouldBlock.
+        // NB: wait until the handshakes (with the server and the peer) have
+        // settled; after that, the next pings are only due in a few seconds.
+        check(wait_idle(*a.client), "client did not become idle");
+        check(a.client->send(0) == kAooErrorWouldBlock,
+              "send(0) did not return kAooErrorWouldBlock although nothing was due");
+
+        // 3) a connected, but idle client sleeps until the next deadline.
+        {
+            auto t1 = hrclock::now();
+            auto c1 = cpu_time();
+            auto err = a.client->send(0.3);
+            auto elapsed = seconds(hrclock::now() - t1).count();
+            auto cpu = cpu_time() - c1;
+            check(err == kAooErrorWouldBlock, "send() with peers did not return kAooErrorWouldBlock");
+            check(elapsed >= 0.25, "send() with peers returned too early");
+            std::cout << "send(0.3) with peers: " << elapsed << " s, CPU time " << cpu << " s" << std::endl;
+        #ifndef _WIN32
+            check(cpu < 0.1, "send() with peers is busy");
+        #endif
+        }
+
+        // 4) a peer which has been marked dirty (because of an outgoing message)
+        // is visited in the very next cycle.
+        {
+            const char msg[] = "hello";
+            AooData data { kAooDataText, (const AooByte *)msg, sizeof(msg) };
+            a.client->sendMessage(a.group.load(), a.peer.load(), data, 0, 0);
+            check(a.client->send(0) == kAooOk, "send(0) did not return kAooOk after sendMessage()");
+            // NB: don't call a.send() while waiting!
+            check(wait_for([&]() { return b.messages.load() > 0; }, [](){}, 1.0),
+                  "peer message has not been sent in the next cycle");
+            settle(*a.client);
+        }
+
+        // 5) changing the ping settings reschedules all peers in the next cycle;
+        // afterwards the client is idle again.
+        {
+            a.client->setPeerPingSettings(ping_settings);
+            check(a.client->send(0) == kAooOk, "peers not visited after changing the ping settings");
+            check(settle(*a.client) > 0, "send(0) never returned kAooErrorWouldBlock after rescheduling");
+        }
+
+        // 6) packets of sources (and sinks) count as activity.
+        {
+            auto source = AooSource::create(0);
+            source->setup(1, 48000, 64, 0);
+            AooFormatPcm fmt;
+            AooFormatPcm_init(&fmt, 1, 48000, 64, kAooPcmFloat32);
+            source->setFormat(fmt.header);
+            ip_address addr("127.0.0.1", 9, ip_address::IPv4); // discard
+            AooEndpoint ep { addr.address(), (AooAddrSize)addr.length(), 0 };
+            source->addSink(ep, true);
+            a.client->addSource(source.get());
+            source->startStream(0, nullptr);
+            settle(*a.client);
+
+            AooSample buf[64] = { 0 };
+            AooSample *channels[1] = { buf };
+            source->process(channels, 64, aoo_getCurrentNtpTime());
+            check(a.client->send(0) == kAooOk, "send(0) did not return kAooOk after sending audio");
+
+            a.client->removeSource(source.get());
+        }
+    }
+
+    server->stop();
+    server_thread.join();
+    server_udp_thread.join();
+}
+
+//------------------------ send aggregation ------------------------//
+
+// Two sources stream to a UDP socket; every source has several data packets
+// per cycle, so with aggregation the client must flush the send queue
+// (more than once), both when it is full and at the end of the cycle.
+void test_send_aggregation(bool aggregate) {
+    const char *what = aggregate ? "with aggregation" : "without aggregation";
+    constexpr int num_sources = 2;
+
+    auto client = AooClient::create();
+    AooClientSettings settings;
+    settings.socketType = kAooSocketIPv4;
+    if (client->setup(settings) != kAooOk) {
+        std::cout << "error: could not setup client" << std::endl;
+        errors++;
+        return;
+    }
+    client->setSendAggregation(aggregate);
+    AooBool b = !aggregate;
+    client->getSendAggregation(b);
+    check(b == (AooBool)aggregate, "getSendAggregation() returned the wrong value");
+
+    udp_socket receiver(port_tag{}, 0);
+    ip_address addr("127.0.0.1", receiver.port(), ip_address::IPv4);
+
+    AooSource::Ptr sources[num_sources];
+    for (int i = 0; i < num_sources; ++i) {
+        auto& source = sources[i];
+        source = AooSource::create(i + 1);
+        source->setup(1, 48000, 64, 0);
+        source->setBufferSize(1.0); // don't drop any blocks
+        source->setBinaryFormat(false);
+        AooFormatPcm fmt;
+        AooFormatPcm_init(&fmt, 1, 48000, 64, kAooPcmFloat32);
+        source->setFormat(fmt.header);
+        AooEndpoint ep { addr.address(), (AooAddrSize)addr.length(), 0 };
+        source->addSink(ep, true);
+        client->addSource(source.get());
+        source->startStream(0, nullptr);
+    }
+    settle(*client);
+
+    // receive all pending packets, but don't call send() in the meantime;
+    // returns the (source, sequence) pairs of all data messages.
+    auto receive = [&]() {
+        std::vector<std::pair<int32_t, int32_t>> result;
+        AooByte buf[AOO_MAX_PACKET_SIZE];
+        for (;;) {
+            auto [success, size] = receiver.receive(buf, sizeof(buf), 0.2);
+            if (!success) {
+                break;
+            }
+            try {
+                osc::ReceivedPacket packet((const char *)buf, size);
+                osc::ReceivedMessage msg(packet);
+                if (std::string(msg.AddressPattern()) == "/aoo/sink/0/data") {
+                    auto it = msg.ArgumentsBegin();
+                    auto src = (it++)->AsInt32();
+                    it++; // stream ID
+                    result.emplace_back(src, it->AsInt32());
+                }
+            } catch (const osc::Exception& e) {
+                std::cout << "error: bad message: " << e.what() << std::endl;
+                errors++;
+            }
+        }
+        return result;
+    };
+    receive(); // /start messages, etc.
+
+    auto t = aoo_getCurrentNtpTime();
+    AooSample buf[64] = { 0 };
+    AooSample *channels[1] = { buf };
+    // NB: 2 * 40 packets exceed the send queue size (64)
+    for (int nblocks : { 40, 5, 1 }) {
+        for (int k = 0; k < nblocks; ++k) {
+            t += time_tag::from_seconds(64.0 / 48000).value();
+            for (auto& source : sources) {
+                source->process(channels, 64, t);
+            }
+        }
+        // all packets must be sent in a single cycle...
+        check(client->send(0) == kAooOk, "send(0) did not return kAooOk");
+        auto packets = receive();
+        if (packets.size() != (size_t)(nblocks * num_sources)) {
+            std::cout << "error: " << what << ": received " << packets.size()
+                      << " of " << (nblocks * num_sources) << " packets" << std::endl;
+            errors++;
+            continue;
+        }
+        // ... and in order: first all packets of source 1, then source 2.
+        for (int i = 0; i < num_sources; ++i) {
+            auto first = packets[i * nblocks].second;
+            for (int k = 0; k < nblocks; ++k) {
+                auto& p = packets[i * nblocks + k];
+                if (p.first != i + 1 || p.second != first + k) {
+                    std::cout << "error: " << what << ": packet " << (i * nblocks + k)
+                              << " has wrong source or sequence number: "
+                              << p.first << ", " << p.second << std::endl;
+                    errors++;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (auto& source : sources) {
+        client->removeSource(source.get());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    aoo_initialize(nullptr);
+
+    test_timer_queue();
+
+    test_send_aggregation(true);
+    test_send_aggregation(false);
+
+    test_client_send();
+
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
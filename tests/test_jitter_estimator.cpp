@@ -0,0 +1,283 @@
+#include "aoo/src/jitter_estimator.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace aoo;
+
+constexpr double samplerate = 48000;
+constexpr double blocksize = 64;
+constexpr double period = blocksize / samplerate;
+constexpr double resolution = ADAPTIVE_LATENCY_RESOLUTION;
+constexpr double range = 0.1;
+
+bool near(double a, double b, double tolerance) {
+    return std::abs(a - b) <= tolerance;
+}
+
+// 1) percentile estimate without decay
+int test_percentile() {
+    int errors = 0;
+    jitter_estimator est;
+    est.setup(resolution, range, 1.0);
+
+    // uniform distribution between 0 and 50 ms
+    for (int i = 0; i < 10000; ++i) {
+        est.add(i, (i % 200) * 0.00025);
+    }
+    if (est.count() != 10000) {
+        std::cout << "error: count is " << est.count() << std::endl;
+        errors++;
+    }
+    for (auto p : { 0.02, 0.1, 0.5, 0.9 }) {
+        auto expected = p * 0.05;
+        auto result = est.percentile(p);
+        if (!near(result, expected, resolution)) {
+            std::cout << "error: percentile(" << p << ") is " << result
+                      << " (expected " << expected << ")" << std::endl;
+            errors++;
+        }
+    }
+
+    // late blocks go into the first bin, very early blocks into the last bin
+    est.reset();
+    if (est.count() != 0) {
+        std::cout << "error: count not reset" << std::endl;
+        errors++;
+    }
+    for (int i = 0; i < 100; ++i) {
+        est.add(i, (i < 10) ? -1.0 : 1.0);
+    }
+    if (est.percentile(0.05) != 0) {
+        std::cout << "error: late blocks not in the first bin" << std::endl;
+        errors++;
+    }
+    if (!near(est.percentile(0.5), range, resolution)) {
+        std::cout << "error: early blocks not in the last bin" << std::endl;
+        errors++;
+    }
+
+    return errors;
+}
+
+// 2) RFC 3550 interarrival jitter
+int test_jitter() {
+    int errors = 0;
+    jitter_estimator est;
+    est.setup(resolution, range, 1.0);
+
+    // constant headroom -> no jitter
+    for (int i = 0; i < 1000; ++i) {
+        est.add(i, 0.01);
+    }
+    if (est.jitter() != 0) {
+        std::cout << "error: jitter is " << est.jitter()
+                  << " for a constant headroom" << std::endl;
+        errors++;
+    }
+
+    // alternating +/- 1 ms -> D is always 2 ms
+    est.reset();
+    for (int i = 0; i < 1000; ++i) {
+        est.add(i, (i & 1) ? 0.011 : 0.009);
+    }
+    if (!near(est.jitter(), 0.002, 1e-6)) {
+        std::cout << "error: jitter is " << est.jitter()
+                  << " (expected 0.002)" << std::endl;
+        errors++;
+    }
+
+    // non-consecutive blocks are ignored
+    est.reset();
+    for (int i = 0; i < 1000; ++i) {
+        est.add(i * 2, (i & 1) ? 0.011 : 0.009);
+    }
+    if (est.jitter() != 0) {
+        std::cout << "error: jitter is " << est.jitter()
+                  << " for non-consecutive blocks" << std::endl;
+        errors++;
+    }
+
+    return errors;
+}
+
+// 3) the statistics must follow changing network conditions
+int test_decay() {
+    int errors = 0;
+    auto decay = std::exp(-period / ADAPTIVE_LATENCY_MEMORY);
+    // 10 seconds of blocks
+    int n = 10.0 / period;
+
+    jitter_estimator est;
+    est.setup(resolution, range, decay);
+    jitter_estimator ref;
+    ref.setup(resolution, range, 1.0);
+
+    for (int i = 0; i < n; ++i) {
+        est.add(i, 0.01);
+        ref.add(i, 0.01);
+    }
+    // the headroom drops from 10 ms to 2 ms
+    for (int i = n; i < 2 * n; ++i) {
+        est.add(i, 0.002);
+        ref.add(i, 0.002);
+    }
+    // After 2 time constants, most of the weight is on the new values...
+    auto result = est.percentile(0.5);
+    if (!near(result, 0.002, resolution)) {
+        std::cout << "error: percentile(0.5) is " << result
+                  << " with decay (expected 0.002)" << std::endl;
+        errors++;
+    }
+    // ...but the old values still affect the lower percentiles.
+    result = est.percentile(0.95);
+    if (!near(result, 0.01, resolution)) {
+        std::cout << "error: percentile(0.95) is " << result
+                  << " with decay (expected 0.01)" << std::endl;
+        errors++;
+    }
+    // without decay, both halves have the same weight.
+    result = ref.percentile(0.75);
+    if (!near(result, 0.01, resolution)) {
+        std::cout << "error: percentile(0.75) is " << result
+                  << " without decay (expected 0.01)" << std::endl;
+        errors++;
+    }
+
+    // the weight is rescaled before it overflows
+    jitter_estimator fast;
+    fast.setup(resolution, range, 0.5);
+    for (int i = 0; i < 100000; ++i) {
+        fast.add(i, (i < 99990) ? 0.01 : 0.005);
+    }
+    result = fast.percentile(ADAPTIVE_LATENCY_PERCENTILE);
+    if (!std::isfinite(result) || !near(result, 0.005, resolution)) {
+        std::cout << "error: percentile is " << result
+                  << " after rescaling (expected 0.005)" << std::endl;
+        errors++;
+    }
+
+    return errors;
+}
+
+// 4) bounds of the playback speed
+int test_speed() {
+    int errors = 0;
+    auto check = [&](double headroom, double latency, double expected) {
+        auto margin = 0.003;
+        auto min_latency = 0.005;
+        auto max_latency = 0.05;
+        auto speed = adaptive_latency_speed(headroom, margin, latency,
+                                            min_latency, max_latency);
+        if (speed != expected) {
+            std::cout << "error: speed is " << speed << " for headroom " << headroom
+                      << " and latency " << latency << " (expected "
+                      << expected << ")" << std::endl;
+            errors++;
+        }
+    };
+    // too much headroom -> shrink...
+    check(0.01, 0.02, ADAPTIVE_LATENCY_SHRINK);
+    // ...but not below the min. latency
+    check(0.01, 0.005, 1);
+    check(0.01, 0.004, 1);
+    // hysteresis
+    check(0.003 + ADAPTIVE_LATENCY_HYSTERESIS * 0.5, 0.02, 1);
+    check(0.003, 0.02, 1);
+    // not enough headroom -> grow...
+    check(0.002, 0.02, ADAPTIVE_LATENCY_GROW);
+    check(-0.01, 0.02, ADAPTIVE_LATENCY_GROW);
+    // ...but not above the max. latency
+    check(0.002, 0.05, 1);
+    check(0.002, 0.06, 1);
+    return errors;
+}
+
+// 5) closed loop, see source_desc::update_jitter() and source_desc::adapt_latency().
+// The network delay is uniformly distributed between 0 and 5 ms.
+int test_adaptive_latency() {
+    int errors = 0;
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> delay(0, 0.005);
+
+    auto latency_base = 0.05;
+    auto min_latency = period;
+    auto latency_adjust = 0.0;
+    jitter_estimator est;
+    est.setup(resolution, range, std::exp(-period / ADAPTIVE_LATENCY_MEMORY));
+
+    // 60 seconds
+    int n = 60.0 / period;
+    int count[3] = { 0 };
+    double headroom = 0, margin = 0;
+    for (int i = 0; i < n; ++i) {
+        // headroom at the current latency, normalized to the base latency
+        auto ahead = latency_base + latency_adjust - delay(gen);
+        est.add(i, ahead - latency_adjust);
+        if (est.count() < ADAPTIVE_LATENCY_MIN_COUNT) {
+            continue;
+        }
+        headroom = est.percentile(ADAPTIVE_LATENCY_PERCENTILE) + latency_adjust;
+        margin = period + est.jitter();
+        auto speed = adaptive_latency_speed(headroom, margin, latency_base + latency_adjust,
+                                            min_latency, latency_base);
+        if (speed == 1) {
+            count[0]++;
+        } else if (speed == ADAPTIVE_LATENCY_SHRINK) {
+            count[1]++;
+        } else if (speed == ADAPTIVE_LATENCY_GROW) {
+            count[2]++;
+        } else {
+            std::cout << "error: bad speed " << speed << std::endl;
+            errors++;
+            break;
+        }
+        // a playback speed > 1 reduces the latency and vice versa
+        latency_adjust -= period * (speed - 1);
+        // the latency may overshoot by at most one block
+        auto latency = latency_base + latency_adjust;
+        auto tolerance = period * (ADAPTIVE_LATENCY_SHRINK - 1);
+        if (latency < min_latency - tolerance || latency > latency_base + tolerance) {
+            std::cout << "error: latency " << latency << " out of bounds" << std::endl;
+            errors++;
+            break;
+        }
+    }
+    auto latency = latency_base + latency_adjust;
+    std::cout << "latency: " << (latency * 1000) << " ms, headroom: "
+              << (headroom * 1000) << " ms, margin: " << (margin * 1000) << " ms" << std::endl;
+    std::cout << "speed: 1 = " << count[0] << ", shrink = " << count[1]
+              << ", grow = " << count[2] << std::endl;
+    // the headroom must have converged towards the margin
+    if (headroom < margin - resolution * 2
+            || headroom > margin + ADAPTIVE_LATENCY_HYSTERESIS + resolution * 2) {
+        std::cout << "error: headroom has not converged" << std::endl;
+        errors++;
+    }
+    // the speed must have settled
+    if (count[0] < count[1] + count[2]) {
+        std::cout << "error: speed has not settled" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    int errors = 0;
+
+    errors += test_percentile();
+    errors += test_jitter();
+    errors += test_decay();
+    errors += test_speed();
+    errors += test_adaptive_latency();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
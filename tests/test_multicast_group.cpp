@@ -0,0 +1,261 @@
+#include "aoo.h"
+#include "aoo_events.h"
+#include "aoo_source.hpp"
+#include "codec/aoo_pcm.h"
+
+#include "common/net_utils.hpp"
+#include "common/time.hpp"
+
+#include "osc/OscOutboundPacketStream.h"
+#include "osc/OscReceivedElements.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace aoo;
+
+// A source streams to a multicast sink group. The group members are simulated
+// by sending the sink messages (data requests, pings, pongs) directly to the source.
+
+constexpr int blocksize = 64;
+constexpr int samplerate = 48000;
+constexpr AooId source_id = 0;
+constexpr AooId group_id = 1;
+constexpr double ping_interval = 0.01;
+
+const ip_address group_addr("239.1.2.3", 9000, ip_address::IPv4);
+
+struct member {
+    ip_address address;
+    bool answer_pings = false;
+    int replies = 0; // replies to our pings
+};
+
+member member_a { ip_address("127.0.0.1", 9001, ip_address::IPv4) };
+member member_b { ip_address("127.0.0.1", 9002, ip_address::IPv4) };
+member outsider { ip_address("127.0.0.1", 9999, ip_address::IPv4) };
+member * const members[] = { &member_a, &member_b, &outsider };
+
+AooSource *source;
+AooId stream_id = kAooIdInvalid;
+time_tag last_group_ping;
+int group_pings = 0;
+int resent_frames = 0;
+std::vector<std::vector<char>> pending; // messages to the source
+
+void send_to_source(const member& m, const osc::OutboundPacketStream& msg) {
+    source->handleMessage((const AooByte *)msg.Data(), msg.Size(),
+                          m.address.address(), m.address.length());
+}
+
+// /aoo/src/<id>/pong <sink> <tt1> <tt2> <tt3>
+void send_pong(const member& m, time_tag tt1, double rtt = 0) {
+    char buf[256];
+    osc::OutboundPacketStream msg(buf, sizeof(buf));
+    auto tt2 = time_tag::now();
+    // the sink processing time is subtracted from the round trip time
+    auto tt3 = tt2 - time_tag::from_seconds(rtt);
+    msg << osc::BeginMessage("/aoo/src/0/pong") << group_id << osc::TimeTag(tt1.value())
+        << osc::TimeTag(tt2.value()) << osc::TimeTag(tt3.value()) << osc::EndMessage;
+    send_to_source(m, msg);
+}
+
+// /aoo/src/<id>/ping <sink> <tt>
+void send_ping(const member& m) {
+    char buf[256];
+    osc::OutboundPacketStream msg(buf, sizeof(buf));
+    msg << osc::BeginMessage("/aoo/src/0/ping") << group_id
+        << osc::TimeTag(time_tag::now().value()) << osc::EndMessage;
+    send_to_source(m, msg);
+}
+
+// /aoo/src/<id>/data <sink> <stream_id> <seq> <frame>
+void send_data_request(const member& m, AooId stream, int32_t seq) {
+    char buf[256];
+    osc::OutboundPacketStream msg(buf, sizeof(buf));
+    msg << osc::BeginMessage("/aoo/src/0/data") << group_id << stream
+        << seq << (int32_t)0 << osc::EndMessage;
+    send_to_source(m, msg);
+}
+
+AooInt32 AOO_CALL send_fn(void *user, const AooByte *data, AooInt32 size,
+                          const void *address, AooAddrSize addrlen, AooFlag flags) {
+    ip_address dest((const sockaddr *)address, addrlen);
+    if (data[0] != '/') {
+        return 0; // binary data message
+    }
+    osc::ReceivedPacket packet((const char *)data, size);
+    osc::ReceivedMessage msg(packet);
+    std::string pattern = msg.AddressPattern();
+    if (dest == group_addr) {
+        auto it = msg.ArgumentsBegin();
+        if (pattern == "/aoo/sink/1/start") {
+            it++; it++; // source ID + version
+            stream_id = it->AsInt32();
+        } else if (pattern == "/aoo/sink/1/ping") {
+            it++; // source ID
+            last_group_ping = time_tag(it->AsTimeTag());
+            group_pings++;
+            // NB: reply after send() has returned
+            for (auto m : members) {
+                if (m->answer_pings) {
+                    char buf[256];
+                    osc::OutboundPacketStream msg(buf, sizeof(buf));
+                    msg << osc::BeginMessage("/aoo/src/0/pong") << group_id
+                        << osc::TimeTag(last_group_ping.value())
+                        << osc::TimeTag(time_tag::now().value())
+                        << osc::TimeTag(time_tag::now().value()) << osc::EndMessage;
+                    pending.emplace_back(msg.Data(), msg.Data() + msg.Size());
+                    pending.back().push_back((char)(m - members[0])); // member index
+                }
+            }
+        }
+    } else if (pattern == "/aoo/sink/1/pong") {
+        for (auto m : members) {
+            if (m->address == dest) {
+                m->replies++;
+            }
+        }
+    }
+    return 0;
+}
+
+void AOO_CALL handle_event(void *user, const AooEvent *e, AooThreadLevel level) {
+    if (e->type == kAooEventFrameResend) {
+        resent_frames += e->frameResend.count;
+    }
+}
+
+void send() {
+    source->send(send_fn, nullptr);
+    // deliver pongs to group pings
+    auto messages = std::move(pending);
+    pending.clear();
+    for (auto& msg : messages) {
+        auto m = members[(int)msg.back()];
+        msg.pop_back();
+        source->handleMessage((const AooByte *)msg.data(), msg.size(),
+                              m->address.address(), m->address.length());
+    }
+}
+
+AooNtpTime ntp_time = 0;
+
+void process(int nblocks) {
+    std::vector<AooSample> buf(blocksize);
+    AooSample *channels[1] = { buf.data() };
+    for (int i = 0; i < nblocks; ++i) {
+        ntp_time += time_tag::from_seconds((double)blocksize / samplerate).value();
+        source->process(channels, blocksize, ntp_time);
+        send();
+    }
+}
+
+// request a frame and return the number of resent frames
+int resend(const member& m, int32_t seq, AooId stream = kAooIdInvalid) {
+    auto count = resent_frames;
+    send_data_request(m, stream != kAooIdInvalid ? stream : stream_id, seq);
+    send();
+    return resent_frames - count;
+}
+
+// check if the source replies to our pings
+bool is_member(member& m) {
+    auto count = m.replies;
+    send_ping(m);
+    send();
+    return m.replies > count;
+}
+
+int main(int argc, char *argv[]) {
+    aoo_initialize(nullptr);
+
+    int errors = 0;
+    auto check = [&](bool cond, const char *what) {
+        if (!cond) {
+            std::cout << "error: " << what << std::endl;
+            errors++;
+        }
+    };
+
+    source = AooSource_new(source_id);
+    source->setEventHandler(handle_event, nullptr, kAooEventModeCallback);
+    source->setup(1, samplerate, blocksize, kAooFixedBlockSize);
+    AooFormatPcm fmt;
+    AooFormatPcm_init(&fmt, 1, samplerate, blocksize, kAooPcmFloat32);
+    source->setFormat(fmt.header);
+    source->setPingInterval(ping_interval);
+    AooEndpoint ep { group_addr.address(), (AooAddrSize)group_addr.length(), group_id };
+    source->addSink(ep, true);
+    ntp_time = aoo_getCurrentNtpTime();
+    source->startStream(0, nullptr);
+    process(20);
+    check(stream_id != kAooIdInvalid, "no /start message");
+    check(group_pings > 0, "no ping to the group");
+
+    // 1) non-members are ignored
+    check(!is_member(outsider), "ping from outsider accepted");
+    check(resend(outsider, 5, stream_id + 1) == 0, "data request with wrong stream ID accepted");
+    send_pong(outsider, time_tag::now()); // not a group ping
+    send();
+    check(!is_member(outsider), "outsider joined the group");
+
+    // 2) join with the current stream ID
+    check(!is_member(member_a), "A is member before joining");
+    check(resend(member_a, 5) == 1, "data request from A not answered");
+    check(is_member(member_a), "A has not joined the group");
+    member_a.answer_pings = true;
+
+    // 3) join by answering a group ping; B reports a large round trip time
+    check(!is_member(member_b), "B is member before joining");
+    send_pong(member_b, last_group_ping, 0.2);
+    send();
+    check(is_member(member_b), "B has not joined the group");
+
+    // 4) a frame requested by several members in the same cycle is only resent once
+    send_data_request(member_a, stream_id, 6);
+    send_data_request(member_b, stream_id, 6);
+    auto count = resent_frames;
+    send();
+    check(resent_frames - count == 1, "frame resent more than once in a single cycle");
+
+    // 5) ...and not in the following cycles while the first resend is in flight,
+    // i.e. within the largest round trip time (0.2 s).
+    check(resend(member_a, 7) == 1, "frame 7 not resent");
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    check(resend(member_b, 7) == 0, "frame 7 resent again within the round trip time");
+
+    // 6) B stops answering pings and is removed from the group
+    // after AOO_MULTICAST_MEMBER_PINGS pings.
+    auto pings = group_pings;
+    while (group_pings - pings <= AOO_MULTICAST_MEMBER_PINGS) {
+        process(1);
+    }
+    check(!is_member(member_b), "B has not been removed from the group");
+    check(is_member(member_a), "A has been removed from the group");
+    // the large round trip time of B is gone
+    check(resend(member_a, 9) == 1, "frame 9 not resent");
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    check(resend(member_a, 9) == 1, "frame 9 not resent after the dedup interval");
+
+    // 7) B can join again
+    check(resend(member_b, 10) == 1, "data request from B not answered");
+    check(is_member(member_b), "B has not rejoined the group");
+
+    AooSource_free(source);
+
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
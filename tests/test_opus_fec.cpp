@@ -0,0 +1,184 @@
+#include "aoo.h"
+#include "aoo_codec.h"
+#include "aoo_controls.h"
+#include "codec/aoo_opus.h"
+
+#include "aoo/src/detail.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace aoo;
+
+// Encode a signal with Opus in-band FEC, drop block N and recover it from block N+1.
+
+constexpr int32_t samplerate = 48000;
+constexpr int32_t blocksize = 960; // 20 ms; in-band FEC requires at least 10 ms
+constexpr int32_t num_blocks = 20;
+constexpr int32_t lost_block = 10;
+constexpr int32_t packet_loss = 20; // percent
+constexpr int32_t max_packet_size = 1500;
+constexpr double pi = 3.14159265358979323846;
+
+using block = std::vector<AooSample>;
+using packet = std::vector<AooByte>;
+
+// signal to noise ratio in dB
+double snr(const block& ref, const block& x) {
+    double signal = 0, noise = 0;
+    for (size_t i = 0; i < ref.size(); ++i) {
+        signal += ref[i] * ref[i];
+        noise += (ref[i] - x[i]) * (ref[i] - x[i]);
+    }
+    if (noise == 0) {
+        return 1000;
+    }
+    return 10 * std::log10(signal / noise);
+}
+
+// decode all packets; if 'lost' is a valid block index, skip that packet
+// and recover it from the following one (FEC) or with packet loss concealment.
+std::vector<block> decode(const AooCodecInterface *codec, const std::vector<packet>& packets,
+                          int32_t lost, bool fec, int& errors) {
+    auto dec = codec->decoderNew();
+    AooFormatOpus fmt;
+    AooFormatOpus_init(&fmt, 1, samplerate, blocksize, OPUS_APPLICATION_VOIP);
+    AooDecoder_setup(dec, &fmt.header);
+
+    std::vector<block> result;
+    for (int32_t i = 0; i < (int32_t)packets.size(); ++i) {
+        block out(blocksize);
+        AooInt32 n = blocksize;
+        AooError err;
+        if (i == lost) {
+            if (fec) {
+                auto& next = packets[i + 1];
+                err = AooDecoder_decodeFec(dec, next.data(), next.size(), out.data(), &n);
+            } else {
+                // packet loss concealment
+                err = AooDecoder_decode(dec, nullptr, 0, out.data(), &n);
+            }
+        } else {
+            err = AooDecoder_decode(dec, packets[i].data(), packets[i].size(), out.data(), &n);
+        }
+        if (err != kAooOk || n != blocksize) {
+            std::cout << "error: could not decode block " << i
+                      << (i == lost ? (fec ? " (FEC)" : " (PLC)") : "")
+                      << ": " << aoo_strerror(err) << ", " << n << " frames" << std::endl;
+            errors++;
+        }
+        result.push_back(std::move(out));
+    }
+
+    codec->decoderFree(dec);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    aoo_initialize(nullptr);
+
+    int errors = 0;
+
+    auto codec = aoo::find_codec(kAooCodecOpus);
+    if (!codec) {
+        std::cout << "Opus codec not found!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto enc = codec->encoderNew();
+    if (!AooEncoder_hasFec(enc)) {
+        std::cout << "error: Opus encoder does not report FEC support" << std::endl;
+        errors++;
+    }
+
+    AooFormatOpus fmt;
+    AooFormatOpus_init(&fmt, 1, samplerate, blocksize, OPUS_APPLICATION_VOIP);
+    AooEncoder_setup(enc, &fmt.header);
+    // NB: Opus only adds redundant data if FEC is enabled
+    // *and* the expected packet loss is larger than zero.
+    opus_int32 fec = 1;
+    AooEncoder_control(enc, (AooCodecCtl)OPUS_SET_INBAND_FEC_REQUEST, AOO_ARG(fec));
+    opus_int32 bitrate = 32000; // make sure that Opus uses SILK (which provides the FEC data)
+    AooEncoder_control(enc, (AooCodecCtl)OPUS_SET_BITRATE_REQUEST, AOO_ARG(bitrate));
+    opus_int32 loss = packet_loss;
+    if (AooEncoder_control(enc, kAooCodecCtlSetPacketLoss, AOO_ARG(loss)) != kAooOk) {
+        std::cout << "error: kAooCodecCtlSetPacketLoss failed" << std::endl;
+        errors++;
+    }
+    loss = 0;
+    AooEncoder_control(enc, (AooCodecCtl)OPUS_GET_PACKET_LOSS_PERC_REQUEST, AOO_ARG(loss));
+    if (loss != packet_loss) {
+        std::cout << "error: expected packet loss is " << loss
+                  << " (expected " << packet_loss << ")" << std::endl;
+        errors++;
+    }
+
+    // encode a sine tone with a slow amplitude modulation
+    std::vector<packet> packets;
+    for (int32_t i = 0; i < num_blocks; ++i) {
+        block in(blocksize);
+        for (int32_t j = 0; j < blocksize; ++j) {
+            auto t = (double)(i * blocksize + j) / samplerate;
+            in[j] = 0.5 * std::sin(2 * pi * 440 * t) * (0.75 + 0.25 * std::sin(2 * pi * 3 * t));
+        }
+        packet p(max_packet_size);
+        AooInt32 size = p.size();
+        auto err = AooEncoder_encode(enc, in.data(), blocksize, p.data(), &size);
+        if (err != kAooOk) {
+            std::cout << "error: could not encode block " << i << ": "
+                      << aoo_strerror(err) << std::endl;
+            errors++;
+        }
+        p.resize(size);
+        packets.push_back(std::move(p));
+    }
+    codec->encoderFree(enc);
+
+    if (!errors) {
+        auto ref = decode(codec, packets, -1, false, errors);
+        auto plc = decode(codec, packets, lost_block, false, errors);
+        auto recovered = decode(codec, packets, lost_block, true, errors);
+
+        // the recovered block should be close to the original block.
+        // NB: without redundant data, the decoder would fall back to
+        // packet loss concealment and produce the same output as 'plc'.
+        auto snr_fec = snr(ref[lost_block], recovered[lost_block]);
+        auto snr_plc = snr(ref[lost_block], plc[lost_block]);
+        std::cout << "SNR of lost block: FEC = " << snr_fec << " dB, PLC = "
+                  << snr_plc << " dB" << std::endl;
+        if (recovered[lost_block] == plc[lost_block]) {
+            std::cout << "error: no FEC data in block " << (lost_block + 1) << std::endl;
+            errors++;
+        }
+        if (snr_fec < 3.0) {
+            std::cout << "error: recovered block is too different" << std::endl;
+            errors++;
+        }
+        // the blocks before the lost block must be identical
+        for (int32_t i = 0; i < lost_block; ++i) {
+            if (recovered[i] != ref[i]) {
+                std::cout << "error: block " << i << " differs" << std::endl;
+                errors++;
+            }
+        }
+        // the decoder state converges after the lost block
+        auto snr_last = snr(ref.back(), recovered.back());
+        if (snr_last < 10.0) {
+            std::cout << "error: decoder did not recover after FEC (SNR = "
+                      << snr_last << " dB)" << std::endl;
+            errors++;
+        }
+    }
+
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,247 @@
+#include "aoo.h"
+#include "aoo_source.hpp"
+#include "codec/aoo_pcm.h"
+
+#include "common/net_utils.hpp"
+#include "common/time.hpp"
+
+#include "osc/OscOutboundPacketStream.h"
+#include "osc/OscReceivedElements.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace aoo;
+
+// The source serializes OSC data messages with a cached header, see data_osc_header.
+// Rebuild every data message with osc::OutboundPacketStream and check that
+// the messages are byte-identical.
+
+constexpr int blocksize = 64;
+constexpr int samplerate = 48000;
+
+struct sink {
+    ip_address address;
+    AooId id;
+    AooId stream_id = kAooIdInvalid; // of the current stream
+    int messages = 0;
+};
+
+// different sink IDs to test the padding of the address pattern
+sink sinks[] = {
+    { ip_address("127.0.0.1", 9001, ip_address::IPv4), 1 },
+    { ip_address("127.0.0.1", 9002, ip_address::IPv4), 12 },
+    { ip_address("127.0.0.1", 9003, ip_address::IPv4), 123 },
+    { ip_address("127.0.0.1", 9004, ip_address::IPv4), 123456 }
+};
+
+AooSource *source;
+AooId source_id = 0;
+int errors = 0;
+int mismatches = 0;
+int blob_sizes[2] = { 0, 0 }; // even/odd
+int stream_messages = 0;
+
+// rebuild the message with oscpack
+bool compare(const sink& s, const AooByte *data, AooInt32 size) {
+    try {
+        osc::ReceivedPacket packet((const char *)data, size);
+        osc::ReceivedMessage msg(packet);
+
+        std::vector<char> buf(AOO_MAX_PACKET_SIZE);
+        osc::OutboundPacketStream ref(buf.data(), buf.size());
+        ref << osc::BeginMessage(msg.AddressPattern());
+        for (auto it = msg.ArgumentsBegin(); it != msg.ArgumentsEnd(); ++it) {
+            switch (it->TypeTag()) {
+            case 'i':
+                ref << it->AsInt32();
+                break;
+            case 't':
+                ref << osc::TimeTag(it->AsTimeTag());
+                break;
+            case 'd':
+                ref << it->AsDouble();
+                break;
+            case 'N':
+                ref << osc::OscNil;
+                break;
+            case 'b':
+            {
+                const void *blob;
+                osc::osc_bundle_element_size_t n;
+                it->AsBlob(blob, n);
+                ref << osc::Blob(blob, n);
+                blob_sizes[n & 1]++;
+                break;
+            }
+            default:
+                std::cout << "unexpected type tag " << it->TypeTag() << std::endl;
+                return false;
+            }
+        }
+        ref << osc::EndMessage;
+
+        if (ref.Size() != (size_t)size || memcmp(ref.Data(), data, size) != 0) {
+            std::cout << "error: data message '" << msg.AddressPattern() << "' ("
+                      << size << " bytes) differs from oscpack output ("
+                      << ref.Size() << " bytes)" << std::endl;
+            return false;
+        }
+        // check source and stream ID
+        auto it = msg.ArgumentsBegin();
+        auto src = (it++)->AsInt32();
+        auto stream = (it++)->AsInt32();
+        if (src != source_id || stream != s.stream_id) {
+            std::cout << "error: wrong source or stream ID: " << src << ", "
+                      << stream << " (expected " << source_id << ", "
+                      << s.stream_id << ")" << std::endl;
+            return false;
+        }
+        // skip <seq> <tt> <sr> <channel> <totalsize> -> <msgsize>
+        it++; it++; it++; it++; it++;
+        if (it->TypeTag() == 'i') {
+            stream_messages++;
+        }
+        return true;
+    } catch (const osc::Exception& e) {
+        std::cout << "error: bad data message: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+AooInt32 AOO_CALL send_fn(void *user, const AooByte *data, AooInt32 size,
+                          const void *address, AooAddrSize addrlen, AooFlag flags) {
+    ip_address addr((const sockaddr *)address, addrlen);
+    for (auto& s : sinks) {
+        if (s.address != addr) {
+            continue;
+        }
+        try {
+            osc::ReceivedPacket packet((const char *)data, size);
+            osc::ReceivedMessage msg(packet);
+            std::string pattern = msg.AddressPattern();
+            auto prefix = "/aoo/sink/" + std::to_string(s.id);
+            if (pattern == prefix + "/start") {
+                auto it = msg.ArgumentsBegin();
+                it++; it++; // source ID + version
+                s.stream_id = it->AsInt32();
+            } else if (pattern == prefix + "/data") {
+                s.messages++;
+                if (!compare(s, data, size)) {
+                    mismatches++;
+                }
+            }
+        } catch (const osc::Exception& e) {
+            std::cout << "error: bad message: " << e.what() << std::endl;
+            mismatches++;
+        }
+    }
+    return 0;
+}
+
+AooNtpTime ntp_time = 0;
+
+// process and send the given number of blocks and check that
+// every sink has received (correct) data messages.
+void process(int nblocks, const char *what) {
+    for (auto& s : sinks) {
+        s.messages = 0;
+    }
+    mismatches = 0;
+
+    std::vector<AooSample> buf(blocksize);
+    AooSample *channels[1] = { buf.data() };
+    for (int i = 0; i < nblocks; ++i) {
+        for (int j = 0; j < blocksize; ++j) {
+            buf[j] = (AooSample)(i * blocksize + j) / (nblocks * blocksize) - 0.5;
+        }
+        ntp_time += time_tag::from_seconds((double)blocksize / samplerate).value();
+        source->process(channels, blocksize, ntp_time);
+        source->send(send_fn, nullptr);
+    }
+
+    for (auto& s : sinks) {
+        if (s.messages == 0) {
+            std::cout << "error: " << what << ": no data messages for sink "
+                      << s.id << std::endl;
+            errors++;
+        }
+    }
+    if (mismatches > 0) {
+        std::cout << "error: " << what << ": " << mismatches
+                  << " data messages differ" << std::endl;
+        errors++;
+    }
+}
+
+void set_format(int nframes, AooPcmBitDepth bitdepth) {
+    AooFormatPcm fmt;
+    AooFormatPcm_init(&fmt, 1, samplerate, nframes, bitdepth);
+    source->setFormat(fmt.header);
+}
+
+int main(int argc, char *argv[]) {
+    aoo_initialize(nullptr);
+
+    source = AooSource_new(source_id);
+    source->setup(1, samplerate, blocksize, 0);
+    source->setBinaryFormat(false);
+    // int24 with an odd number of frames -> odd blob size
+    set_format(63, kAooPcmInt24);
+    for (auto& s : sinks) {
+        AooEndpoint ep { s.address.address(), (AooAddrSize)s.address.length(), s.id };
+        source->addSink(ep, true);
+    }
+    ntp_time = aoo_getCurrentNtpTime();
+    source->startStream(0, nullptr);
+    process(20, "odd blob size");
+    if (blob_sizes[1] == 0) {
+        std::cout << "error: no odd blob sizes" << std::endl;
+        errors++;
+    }
+
+    // even blob size + stream time + stream messages
+    set_format(64, kAooPcmInt16);
+    source->setStreamTimeSendInterval(0.001);
+    const char msg[] = "hello";
+    AooStreamMessage sm { 0, 0, kAooDataText, (AooInt32)strlen(msg), (const AooByte *)msg };
+    source->addStreamMessage(sm);
+    process(20, "even blob size");
+    if (blob_sizes[0] == 0) {
+        std::cout << "error: no even blob sizes" << std::endl;
+        errors++;
+    }
+    if (stream_messages == 0) {
+        std::cout << "error: no stream messages" << std::endl;
+        errors++;
+    }
+
+    // new stream ID
+    auto old_stream = sinks[0].stream_id;
+    source->startStream(0, nullptr);
+    process(20, "stream ID change");
+    if (sinks[0].stream_id == old_stream) {
+        std::cout << "error: stream ID has not changed" << std::endl;
+        errors++;
+    }
+
+    // new source ID (restarts the stream)
+    source_id = 7777777;
+    source->setId(source_id);
+    process(20, "source ID change");
+
+    AooSource_free(source);
+
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,252 @@
+#include "aoo/src/net/osc_stream_receiver.hpp"
+#include "common/utils.hpp"
+
+#include "osc/OscOutboundPacketStream.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace aoo;
+using namespace aoo::net;
+
+using seconds = std::chrono::duration<double>;
+using hrclock = std::chrono::high_resolution_clock;
+
+constexpr int num_iterations = 200;
+constexpr int num_messages = 100;
+constexpr int num_fuzz_iterations = 20000;
+constexpr int chunk_size = 4096; // see Client::receive_data()
+constexpr int bench_size = 32 * 1024 * 1024;
+
+using message = std::vector<char>;
+
+// the original implementation, for comparison
+class legacy_receiver {
+public:
+    template<typename Fn>
+    void handle_message(const char *data, int32_t n, Fn&& handler) {
+        const char *ptr = data;
+        int32_t remaining = n;
+        while (remaining > 0) {
+            if (buffer_.size() < sizeof(message_size_)) {
+                auto bytes_missing = sizeof(message_size_) - buffer_.size();
+                auto count = std::min<int32_t>(bytes_missing, remaining);
+                buffer_.insert(buffer_.end(), ptr, ptr + count);
+                ptr += count;
+                remaining -= count;
+                if (buffer_.size() == sizeof(message_size_)) {
+                    message_size_ = aoo::from_bytes<int32_t>(buffer_.data());
+                }
+            } else {
+                int32_t bytes_received = buffer_.size() - sizeof(message_size_);
+                int32_t bytes_missing = message_size_ - bytes_received;
+                auto count = std::min<int32_t>(bytes_missing, remaining);
+                buffer_.insert(buffer_.end(), ptr, ptr + count);
+                ptr += count;
+                remaining -= count;
+                if (bytes_missing == count) {
+                    osc::ReceivedPacket packet(buffer_.data() + sizeof(message_size_), message_size_);
+                    handler(packet);
+                    buffer_.clear();
+                    message_size_ = 0;
+                }
+            }
+        }
+    }
+private:
+    std::vector<char> buffer_;
+    int32_t message_size_ = 0;
+};
+
+message make_message(std::mt19937& gen, int max_blob_size) {
+    std::uniform_int_distribution<int> dist(0, max_blob_size);
+    std::vector<char> blob(dist(gen));
+    for (auto& c : blob) {
+        c = gen() & 255;
+    }
+    std::vector<char> buf(blob.size() + 256);
+    osc::OutboundPacketStream msg(buf.data(), buf.size());
+    msg << osc::BeginMessage("/aoo/test") << (int32_t)gen()
+        << osc::Blob(blob.data(), blob.size()) << osc::EndMessage;
+    return message(msg.Data(), msg.Data() + msg.Size());
+}
+
+// append message with size prefix
+void write_message(std::vector<char>& stream, const message& msg) {
+    char size[4];
+    aoo::to_bytes<int32_t>(msg.size(), size);
+    stream.insert(stream.end(), size, size + 4);
+    stream.insert(stream.end(), msg.begin(), msg.end());
+}
+
+// feed the stream in random chunks
+template<typename Fn>
+void feed(osc_stream_receiver& receiver, const std::vector<char>& stream,
+          std::mt19937& gen, int max_chunk, Fn&& handler) {
+    std::uniform_int_distribution<int> dist(1, max_chunk);
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        auto n = std::min<size_t>(dist(gen), stream.size() - pos);
+        receiver.handle_message(stream.data() + pos, n, handler);
+        pos += n;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int errors = 0;
+    std::mt19937 gen(1234);
+
+    // 1) valid messages, randomly split into chunks.
+    for (int i = 0; i < num_iterations && !errors; ++i) {
+        // alternate between small messages in tiny chunks
+        // and large messages in socket-sized chunks.
+        int max_blob_size = (i & 1) ? 16384 : 64;
+        int max_chunk = (i & 1) ? chunk_size : (i % 4 == 0) ? 1 : 7;
+        std::vector<message> messages;
+        std::vector<char> stream;
+        for (int j = 0; j < num_messages; ++j) {
+            messages.push_back(make_message(gen, max_blob_size));
+            write_message(stream, messages.back());
+        }
+        osc_stream_receiver receiver;
+        size_t count = 0;
+        feed(receiver, stream, gen, max_chunk, [&](const osc::ReceivedPacket& packet) {
+            if (count >= messages.size()
+                    || packet.Size() != (int32_t)messages[count].size()
+                    || memcmp(packet.Contents(), messages[count].data(), packet.Size()) != 0) {
+                std::cout << "error: message " << count << " differs" << std::endl;
+                errors++;
+            }
+            count++;
+        });
+        if (count != messages.size()) {
+            std::cout << "error: got " << count << " of " << messages.size()
+                      << " messages" << std::endl;
+            errors++;
+        }
+        if (receiver.pending() != 0) {
+            std::cout << "error: " << receiver.pending() << " bytes pending" << std::endl;
+            errors++;
+        }
+    }
+
+    // 2) fuzzing: corrupt some bytes in a valid stream. The receiver must
+    // either throw an exception or deliver well-formed packets and must
+    // never buffer more than the max. message size. After an exception,
+    // the receiver must work again.
+    int exceptions = 0;
+    for (int i = 0; i < num_fuzz_iterations && !errors; ++i) {
+        std::vector<char> stream;
+        for (int j = 0; j < 4; ++j) {
+            write_message(stream, make_message(gen, 32));
+        }
+        int num_mutations = 1 + gen() % 4;
+        for (int j = 0; j < num_mutations; ++j) {
+            auto& c = stream[gen() % stream.size()];
+            switch (gen() % 3) {
+            case 0: c = gen() & 255; break;
+            case 1: c ^= 0x80; break;
+            default: c = 0; break;
+            }
+        }
+        osc_stream_receiver receiver;
+        try {
+            feed(receiver, stream, gen, 64, [&](const osc::ReceivedPacket& packet) {
+                if (packet.Size() <= 0 || (packet.Size() & 3) != 0
+                        || packet.Contents()[0] != '/') {
+                    std::cout << "error: malformed packet" << std::endl;
+                    errors++;
+                }
+            });
+        } catch (const osc::Exception& e) {
+            exceptions++;
+            if (receiver.pending() != 0) {
+                std::cout << "error: receiver not reset after exception" << std::endl;
+                errors++;
+            }
+        }
+        if (receiver.pending() > AOO_MAX_STREAM_MESSAGE_SIZE + 4) {
+            std::cout << "error: " << receiver.pending() << " bytes pending" << std::endl;
+            errors++;
+        }
+        // the receiver must be usable again
+        receiver.reset();
+        std::vector<char> valid;
+        auto msg = make_message(gen, 32);
+        write_message(valid, msg);
+        int count = 0;
+        receiver.handle_message(valid.data(), valid.size(), [&](const osc::ReceivedPacket& packet) {
+            count++;
+        });
+        if (count != 1) {
+            std::cout << "error: receiver not usable after fuzzing" << std::endl;
+            errors++;
+        }
+    }
+    std::cout << "fuzzing: " << num_fuzz_iterations << " iterations, "
+              << exceptions << " exceptions" << std::endl;
+
+    // 3) huge message size must be rejected immediately
+    if (!errors) {
+        osc_stream_receiver receiver;
+        char data[8];
+        aoo::to_bytes<int32_t>(AOO_MAX_STREAM_MESSAGE_SIZE + 4, data);
+        memcpy(data + 4, "/foo", 4);
+        try {
+            receiver.handle_message(data, sizeof(data), [](auto&) {});
+            std::cout << "error: huge message not rejected" << std::endl;
+            errors++;
+        } catch (const osc::Exception& e) {}
+    }
+
+    // 4) benchmark: small messages (e.g. notifications or pings) in
+    // socket-sized chunks, compared to the original implementation.
+    if (!errors) {
+        std::vector<char> stream;
+        int count = 0;
+        while (stream.size() < bench_size) {
+            write_message(stream, make_message(gen, 32));
+            count++;
+        }
+        auto bench = [&](auto& receiver) {
+            int64_t sum = 0;
+            auto t1 = hrclock::now();
+            for (size_t pos = 0; pos < stream.size(); pos += chunk_size) {
+                auto n = std::min<size_t>(chunk_size, stream.size() - pos);
+                receiver.handle_message(stream.data() + pos, n,
+                                        [&](const osc::ReceivedPacket& packet) {
+                    sum += packet.Size();
+                });
+            }
+            auto elapsed = seconds(hrclock::now() - t1).count();
+            return std::make_pair(elapsed, sum);
+        };
+        legacy_receiver legacy;
+        auto [t_legacy, sum_legacy] = bench(legacy);
+        osc_stream_receiver receiver;
+        auto [t_new, sum_new] = bench(receiver);
+        if (sum_legacy != sum_new) {
+            std::cout << "error: benchmark results differ" << std::endl;
+            errors++;
+        }
+        auto mb = stream.size() / 1e6;
+        std::cout << count << " messages (" << mb << " MB)" << std::endl;
+        std::cout << "legacy: " << (mb / t_legacy) << " MB/s, "
+                  << (count / t_legacy) << " messages/s" << std::endl;
+        std::cout << "in place: " << (mb / t_new) << " MB/s, "
+                  << (count / t_new) << " messages/s" << std::endl;
+    }
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
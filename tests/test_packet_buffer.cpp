@@ -0,0 +1,800 @@
+#include "aoo.h"
+
+#include "aoo/src/packet_buffer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace aoo;
+
+constexpr double duration = 0.5; // seconds per benchmark
+
+using seconds = std::chrono::duration<double>;
+
+// push 'count' consecutive placeholder blocks
+void push_blocks(jitter_buffer& jb, int32_t first, int32_t count) {
+    for (int32_t seq = first; seq < first + count; ++seq) {
+        jb.push(seq)->init(seq);
+    }
+}
+
+// check that all blocks in [first, last] can be found and
+// that the neighbors (first - 1) and (last + 1) can't be found.
+bool check_range(jitter_buffer& jb, int32_t first, int32_t last) {
+    for (auto seq = first; seq <= last; ++seq) {
+        auto b = jb.find(seq);
+        if (!b || b->sequence != seq) {
+            std::cout << "error: couldn't find block " << seq << std::endl;
+            return false;
+        }
+    }
+    for (auto seq : { first - 1, last + 1 }) {
+        if (jb.find(seq)) {
+            std::cout << "error: found block " << seq << " outside of range ["
+                      << first << ", " << last << "]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int test_jitter_buffer() {
+    int errors = 0;
+    data_frame_allocator alloc;
+    jitter_buffer jb(alloc);
+    jb.resize(16);
+
+    // 1) start at an arbitrary sequence number and wrap around the ring
+    jb.reset();
+    push_blocks(jb, 1000, 10);
+    errors += !check_range(jb, 1000, 1009);
+    for (int i = 0; i < 6; ++i) {
+        jb.pop();
+    }
+    push_blocks(jb, 1010, 12); // full
+    errors += !check_range(jb, 1006, 1021);
+    if (!jb.full()) {
+        std::cout << "error: jitter buffer should be full" << std::endl;
+        errors++;
+    }
+
+    // 2) drain the buffer completely, then continue
+    while (!jb.empty()) {
+        jb.pop();
+    }
+    if (jb.find(1021)) {
+        std::cout << "error: found block in empty jitter buffer" << std::endl;
+        errors++;
+    }
+    push_blocks(jb, 1022, 5);
+    errors += !check_range(jb, 1022, 1026);
+
+    // 3) negative sequence numbers
+    jb.reset();
+    push_blocks(jb, -7, 14);
+    errors += !check_range(jb, -7, 6);
+
+    // 4) reset and start a new stream
+    jb.reset();
+    push_blocks(jb, 0, 3);
+    errors += !check_range(jb, 0, 2);
+    if (jb.find(1022)) {
+        std::cout << "error: found block of old stream" << std::endl;
+        errors++;
+    }
+
+    // 5) extreme sequence numbers (e.g. from a malicious sender)
+    // must not overflow the range check.
+    jb.reset();
+    push_blocks(jb, INT32_MAX - 4, 4);
+    errors += !check_range(jb, INT32_MAX - 4, INT32_MAX - 1);
+    for (auto seq : { INT32_MIN, INT32_MIN + 1, -1, 0 }) {
+        if (jb.find(seq)) {
+            std::cout << "error: found block " << seq << std::endl;
+            errors++;
+        }
+    }
+    jb.reset();
+    push_blocks(jb, -3, 3);
+    for (auto seq : { INT32_MAX, INT32_MAX - 1, INT32_MIN }) {
+        if (jb.find(seq)) {
+            std::cout << "error: found block " << seq << std::endl;
+            errors++;
+        }
+    }
+
+    jb.reset(); // release frames before the allocator goes away
+    return errors;
+}
+
+int test_history_buffer() {
+    int errors = 0;
+    history_buffer hb;
+    hb.resize(8);
+
+    data_packet d{};
+    for (int32_t seq = 0; seq < 20; ++seq) {
+        d.sequence = seq;
+        hb.push(seq)->set(d, 0);
+    }
+    for (int32_t seq = 12; seq < 20; ++seq) {
+        auto b = hb.find(seq);
+        if (!b || b->sequence != seq) {
+            std::cout << "error: couldn't find sent block " << seq << std::endl;
+            errors++;
+        }
+    }
+    std::cout << "NB: the following lookups are supposed to fail" << std::endl;
+    for (int32_t seq : { 11, 20 }) {
+        if (hb.find(seq)) {
+            std::cout << "error: found sent block " << seq << std::endl;
+            errors++;
+        }
+    }
+    // a new stream starts at sequence number 0
+    hb.clear();
+    d.sequence = 0;
+    hb.push(0)->set(d, 0);
+    if (hb.find(16)) {
+        std::cout << "error: found sent block of old stream" << std::endl;
+        errors++;
+    }
+    if (!hb.find(0)) {
+        std::cout << "error: couldn't find sent block 0" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+// make a data packet for the given frame of a block with
+// 'nframes' frames of 'framesize' bytes (the last frame is smaller)
+data_packet make_frame(int32_t seq, int32_t index, int32_t nframes,
+                       int32_t framesize, const std::vector<AooByte>& block) {
+    data_packet d{};
+    d.sequence = seq;
+    d.total_size = block.size();
+    d.num_frames = nframes;
+    d.frame_index = index;
+    d.data = block.data() + index * framesize;
+    d.size = (index == nframes - 1) ? block.size() - index * framesize : framesize;
+    return d;
+}
+
+int test_block_assembler() {
+    int errors = 0;
+    const int32_t nframes = 5;
+    const int32_t framesize = 100;
+    std::vector<AooByte> data(nframes * framesize - 30);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i * 7;
+    }
+
+    data_frame_allocator alloc;
+    jitter_buffer jb(alloc);
+    jb.resize(4);
+    block_assembler assembler(alloc);
+    assembler.resize(4);
+
+    // 1) bad frame offsets
+    {
+        auto d = make_frame(0, 1, nframes, framesize, data);
+        d.size = data.size(); // too large
+        if (block_assembler::frame_offset(d) >= 0) {
+            std::cout << "error: frame offset should be invalid" << std::endl;
+            errors++;
+        }
+        d = make_frame(0, nframes - 1, nframes, framesize, data);
+        if (block_assembler::frame_offset(d) != (nframes - 1) * framesize) {
+            std::cout << "error: wrong offset for last frame" << std::endl;
+            errors++;
+        }
+    }
+
+    // 2) receive frames out of order; the block is evicted from the assembler
+    // in between, so the remaining frames go to another block buffer.
+    auto block = jb.push(0);
+    auto add = [&](int32_t index) {
+        auto d = make_frame(0, index, nframes, framesize, data);
+        bool duplicate;
+        auto buffer = assembler.write(d, duplicate);
+        if (!buffer) {
+            return !duplicate ? -1 : 0;
+        }
+        if (block->placeholder()) {
+            block->init(d);
+        }
+        auto offset = block_assembler::frame_offset(d);
+        return block->add_frame(index, offset, d.size, buffer, alloc) ? 1 : 0;
+    };
+    block->init(0);
+    if (add(3) != 1 || add(0) != 1) {
+        std::cout << "error: couldn't add frames" << std::endl;
+        errors++;
+    }
+    if (add(3) != 0) {
+        std::cout << "error: duplicate frame not detected" << std::endl;
+        errors++;
+    }
+    // evict block 0
+    {
+        std::vector<AooByte> other(framesize, 0xff);
+        auto d = make_frame(4, 0, 1, framesize, other);
+        bool duplicate;
+        auto buffer = assembler.write(d, duplicate);
+        if (!buffer) {
+            std::cout << "error: couldn't write block 4" << std::endl;
+            errors++;
+        } else {
+            buffer->release(alloc);
+        }
+    }
+    for (int32_t i : { 4, 1, 2 }) {
+        if (add(i) != 1) {
+            std::cout << "error: couldn't add frame " << i << " after eviction" << std::endl;
+            errors++;
+        }
+    }
+    if (!block->complete()) {
+        std::cout << "error: block should be complete" << std::endl;
+        errors++;
+    } else if (!block->data() || memcmp(block->data(), data.data(), data.size()) != 0) {
+        std::cout << "error: wrong block data" << std::endl;
+        errors++;
+    }
+
+    assembler.reset(); // release buffers before the allocator goes away
+    jb.reset();
+    return errors;
+}
+
+// Benchmark the reassembly of blocks on the receiver side:
+// a) copy each frame into a data frame and then copy all frames into
+//    a contiguous buffer (the old way);
+// b) write the frames directly into a block buffer and read it in place.
+// The network thread and audio thread part are measured separately.
+// Returns the average time per block in nanoseconds.
+struct reassembly_result {
+    double network;
+    double audio;
+};
+
+reassembly_result run_reassembly_benchmark(int32_t nframes, int32_t framesize, bool assemble) {
+    const int32_t nblocks = 256;
+    std::vector<AooByte> data(nframes * framesize);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i;
+    }
+    std::vector<AooByte> output(data.size());
+    data_frame_allocator alloc;
+    jitter_buffer jb(alloc);
+    jb.resize(nblocks);
+    block_assembler assembler(alloc);
+    assembler.resize(nblocks);
+    // incoming packets, see source_desc::handle_data()
+    struct packet {
+        data_packet d;
+        block_buffer *buffer;
+    };
+    std::vector<packet> packets(nblocks * nframes);
+
+    using clock = std::chrono::high_resolution_clock;
+    seconds network_time(0), audio_time(0);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    int32_t seq = 0;
+    while ((network_time + audio_time).count() < duration) {
+        // network thread
+        auto t1 = clock::now();
+        for (int32_t i = 0; i < nblocks; ++i) {
+            for (int32_t j = 0; j < nframes; ++j) {
+                auto& p = packets[i * nframes + j];
+                p.d = make_frame(seq + i, j, nframes, framesize, data);
+                if (assemble) {
+                    bool duplicate;
+                    p.buffer = assembler.write(p.d, duplicate);
+                } else {
+                    auto frame = alloc.allocate(p.d.size);
+                    memcpy(frame->data, p.d.data, p.d.size);
+                    p.d.frame = frame;
+                    p.buffer = nullptr;
+                }
+            }
+        }
+        // audio thread
+        auto t2 = clock::now();
+        for (auto& p : packets) {
+            auto& d = p.d;
+            auto block = (d.frame_index == 0) ? jb.push(d.sequence) : &jb.back();
+            if (d.frame_index == 0) {
+                block->init(d);
+            }
+            if (p.buffer) {
+                block->add_frame(d.frame_index, block_assembler::frame_offset(d),
+                                 d.size, p.buffer, alloc);
+            } else {
+                block->add_frame(d.frame_index, d.frame);
+            }
+        }
+        while (!jb.empty()) {
+            auto& block = jb.front();
+            const AooByte *ptr = block.data();
+            if (!ptr) {
+                block.copy_frames(output.data());
+                ptr = output.data();
+            }
+            sum += ptr[data.size() - 1];
+            jb.pop();
+        }
+        auto t3 = clock::now();
+        network_time += t2 - t1;
+        audio_time += t3 - t2;
+        seq += nblocks;
+        count += nblocks;
+    }
+    // prevent the compiler from optimizing away the loop
+    if (sum == 12345) {
+        std::cout << sum;
+    }
+    assembler.reset();
+    jb.reset();
+    return { network_time.count() * 1e9 / count, audio_time.count() * 1e9 / count };
+}
+
+// Allocate frames on 'nproducers' threads and deallocate them on another
+// thread, just like the network thread(s) and the audio thread of a sink.
+// Returns the number of errors; 'elapsed' receives the elapsed time.
+int run_frame_allocator(data_frame_allocator& alloc, int32_t nproducers,
+                        int32_t nframes, double& elapsed) {
+    std::vector<lockfree::spsc_queue<data_frame*>> queues(nproducers);
+    for (auto& q : queues) {
+        q.resize(256);
+    }
+    std::atomic<int> errors{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> producers;
+    for (int32_t i = 0; i < nproducers; ++i) {
+        producers.emplace_back([&, i]() {
+            auto& q = queues[i];
+            for (int32_t j = 0; j < nframes; ++j) {
+                while (q.write_available() == 0) {
+                    std::this_thread::yield();
+                }
+                // mostly full-size frames, sometimes smaller ones
+                auto size = (j % 8) ? 512 : 17 + (j % 200);
+                auto frame = alloc.allocate(size);
+                frame->data[0] = i;
+                frame->data[size - 1] = j;
+                q.write(frame);
+            }
+        });
+    }
+    // consumer; just like the audio thread, it gets a dedicated magazine.
+    data_frame_allocator::set_process_thread();
+    int64_t remaining = (int64_t)nproducers * nframes;
+    std::vector<int32_t> counts(nproducers, 0);
+    while (remaining > 0) {
+        bool empty = true;
+        for (int32_t i = 0; i < nproducers; ++i) {
+            auto& q = queues[i];
+            while (q.read_available() > 0) {
+                empty = false;
+                data_frame *frame;
+                q.read(frame);
+                auto j = counts[i]++;
+                auto size = (j % 8) ? 512 : 17 + (j % 200);
+                if (frame->header.size != size || frame->data[0] != (AooByte)i ||
+                        frame->data[size - 1] != (AooByte)j) {
+                    errors++;
+                }
+                alloc.deallocate(frame);
+                remaining--;
+            }
+        }
+        if (empty) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    elapsed = seconds(std::chrono::high_resolution_clock::now() - start).count();
+    if (errors > 0) {
+        std::cout << "error: " << errors << " corrupted data frames" << std::endl;
+    }
+    return errors;
+}
+
+int test_frame_allocator() {
+    int errors = 0;
+    data_frame_allocator alloc;
+    data_frame_allocator::stats s;
+
+    // 1) allocate and deallocate on a single thread
+    std::vector<data_frame*> frames;
+    for (int k = 0; k < 2; ++k) {
+        for (int i = 0; i < 100; ++i) {
+            frames.push_back(alloc.allocate(100));
+        }
+        for (auto f : frames) {
+            alloc.deallocate(f);
+        }
+        frames.clear();
+    }
+    alloc.get_stats(s);
+    auto bytes = 100 * (128 + sizeof(data_frame_header));
+    if (s.hits != 100 || s.misses != 100 || s.bytes[1] != bytes) {
+        std::cout << "error: bad frame allocator stats (hits: " << s.hits
+                  << ", misses: " << s.misses << ", bytes: " << s.bytes[1] << ")" << std::endl;
+        errors++;
+    }
+    alloc.release_memory();
+    alloc.get_stats(s);
+    if (s.bytes[1] != 0) {
+        std::cout << "error: frame allocator did not release memory" << std::endl;
+        errors++;
+    }
+
+    // 2) allocate on several threads and deallocate on another thread.
+    // NB: with more producers than magazines, some producers share a magazine.
+    double elapsed;
+    uint64_t total = 0;
+    for (auto nproducers : { 1, 3, 6 }) {
+        errors += run_frame_allocator(alloc, nproducers, 100000, elapsed);
+        total += nproducers * 100000;
+    }
+    alloc.get_stats(s);
+    if (s.hits + s.misses != total + 200) {
+        std::cout << "error: frame allocator stats don't add up" << std::endl;
+        errors++;
+    }
+    // check that the frames are actually reused
+    if (s.misses * 10 > s.hits) {
+        std::cout << "error: too many frame allocator misses (hits: " << s.hits
+                  << ", misses: " << s.misses << ")" << std::endl;
+        errors++;
+    }
+    alloc.release_memory(); // check for leaks
+
+    return errors;
+}
+
+// returns the number of lookups per second
+template<typename Fn>
+double run_benchmark(Fn&& lookup) {
+    uint64_t count = 0;
+    uint64_t found = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (;;) {
+        for (int i = 0; i < 10000; ++i) {
+            found += lookup(count++);
+        }
+        auto now = std::chrono::high_resolution_clock::now();
+        if (seconds(now - start).count() >= duration) {
+            break;
+        }
+    }
+    auto elapsed = seconds(std::chrono::high_resolution_clock::now() - start).count();
+    if (found != count) {
+        std::cout << "error: " << (count - found) << " lookups failed" << std::endl;
+        return 0;
+    }
+    return count / elapsed;
+}
+
+// a data block as sent by the source, see Source::send_data()
+struct test_block {
+    data_packet packet;
+    std::vector<AooByte> data;
+};
+
+constexpr double nominal_samplerate = 48000;
+
+test_block make_block(int32_t seq) {
+    test_block b;
+    auto& d = b.packet;
+    d = data_packet{};
+    d.sequence = seq;
+    d.total_size = (seq % 4 == 3) ? 17 : 64 + (seq % 4) * 100;
+    d.msg_size = (seq % 3 == 0) ? 16 : 0;
+    d.num_frames = 1;
+    d.flags = 0;
+    if (d.msg_size > 0) {
+        d.flags |= kAooBinMsgDataStreamMessage;
+    }
+    if (seq % 2) {
+        d.tt = 1000 + seq;
+        d.flags |= kAooBinMsgDataTimeStamp;
+    }
+    if (seq % 3 == 1) {
+        d.samplerate = nominal_samplerate + 0.25 * seq;
+        d.flags |= kAooBinMsgDataSampleRate;
+    } else {
+        d.samplerate = 0; // not transmitted
+    }
+    b.data.resize(d.total_size);
+    for (int32_t i = 0; i < d.total_size; ++i) {
+        b.data[i] = seq * 31 + i * 7;
+    }
+    d.data = b.data.data();
+    return b;
+}
+
+void add_frame(received_block& block, data_frame_allocator& alloc, const AooByte *data) {
+    auto frame = alloc.allocate(block.total_size);
+    memcpy(frame->data, data, block.total_size);
+    block.add_frame(0, frame);
+}
+
+// see source_desc::add_packet()
+void receive_block(jitter_buffer& jb, data_frame_allocator& alloc, const test_block& b) {
+    auto d = b.packet;
+    if (d.samplerate == 0) {
+        d.samplerate = nominal_samplerate; // see Sink::handle_data_packet()
+    }
+    auto block = jb.find(d.sequence);
+    if (!block) {
+        block = jb.push(d.sequence);
+    }
+    block->clear(alloc);
+    block->init(d);
+    add_frame(*block, alloc, b.data.data());
+}
+
+// see source_desc::add_parity()
+void receive_parity(parity_buffer& pb, data_frame_allocator& alloc,
+                    const parity_encoder& encoder) {
+    data_packet d{};
+    d.sequence = encoder.sequence();
+    d.total_size = encoder.size();
+    d.num_frames = 1;
+    auto p = pb.push(encoder.sequence(), encoder.count());
+    p->block.init(d);
+    add_frame(p->block, alloc, encoder.data());
+}
+
+bool check_block(received_block& block, const test_block& b) {
+    auto& d = b.packet;
+    auto sr = (d.flags & kAooBinMsgDataSampleRate) ? d.samplerate : nominal_samplerate;
+    if (!block.complete() || block.total_size != d.total_size
+            || block.message_size != d.msg_size || block.flags != d.flags
+            || block.tt != (uint64_t)d.tt || block.samplerate != sr) {
+        std::cout << "error: recovered block " << d.sequence << " has wrong header" << std::endl;
+        return false;
+    }
+    std::vector<AooByte> data(block.total_size);
+    block.copy_frames(data.data());
+    if (data != b.data) {
+        std::cout << "error: recovered block " << d.sequence << " has wrong data" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int test_parity() {
+    int errors = 0;
+    const int32_t window = 4;
+    const int32_t first = 100;
+    const int32_t num_groups = 5;
+
+    std::vector<test_block> blocks;
+    for (int32_t i = 0; i < window * num_groups; ++i) {
+        blocks.push_back(make_block(first + i));
+    }
+
+    // 1) round trip: XOR the parity block with all but one block of
+    // the window and compare the result with the remaining block.
+    {
+        parity_encoder encoder;
+        for (int32_t i = 0; i < window; ++i) {
+            auto done = encoder.add(blocks[i].packet, window);
+            if (done != (i == window - 1)) {
+                std::cout << "error: parity window should " << (done ? "not " : "")
+                          << "be complete" << std::endl;
+                errors++;
+            }
+        }
+        for (int32_t i = 0; i < window && !errors; ++i) {
+            std::vector<AooByte> data(encoder.data(), encoder.data() + encoder.size());
+            for (int32_t j = 0; j < window; ++j) {
+                if (j != i) {
+                    auto& d = blocks[j].packet;
+                    std::vector<AooByte> temp(parity_encoder::header_size + d.total_size);
+                    parity_encoder::write_header(d.total_size, d.msg_size, d.flags,
+                                                 d.samplerate, d.tt, temp.data());
+                    memcpy(temp.data() + parity_encoder::header_size, d.data, d.total_size);
+                    parity_encoder::xor_bytes(data.data(), temp.data(), temp.size());
+                }
+            }
+            data_packet d{};
+            auto it = parity_encoder::read_header(data.data(), d);
+            auto& expected = blocks[i].packet;
+            if (d.total_size != expected.total_size || d.msg_size != expected.msg_size
+                    || d.flags != expected.flags || d.samplerate != expected.samplerate
+                    || d.tt != expected.tt
+                    || memcmp(it, blocks[i].data.data(), d.total_size) != 0) {
+                std::cout << "error: parity round trip failed for block "
+                          << expected.sequence << std::endl;
+                errors++;
+            }
+        }
+    }
+
+    data_frame_allocator alloc;
+    jitter_buffer jb(alloc);
+    jb.resize(32);
+    parity_buffer pb(alloc);
+    pb.resize(8);
+
+    // 2) lose one block per group; all of them must be recovered
+    {
+        parity_encoder encoder;
+        for (int32_t i = 0; i < (int32_t)blocks.size(); ++i) {
+            auto& b = blocks[i];
+            if (encoder.add(b.packet, window)) {
+                receive_parity(pb, alloc, encoder);
+                encoder.reset(); // see Source::send_data()
+            }
+            auto group = i / window;
+            if (i % window == group % window) {
+                jb.push(b.packet.sequence)->init(b.packet.sequence); // lost
+            } else {
+                receive_block(jb, alloc, b);
+            }
+        }
+        auto count = pb.recover(jb, nominal_samplerate);
+        if (count != num_groups) {
+            std::cout << "error: recovered " << count << " of "
+                      << num_groups << " blocks" << std::endl;
+            errors++;
+        }
+        for (auto& b : blocks) {
+            if (!check_block(*jb.find(b.packet.sequence), b)) {
+                errors++;
+            }
+        }
+        if (!pb.empty()) {
+            std::cout << "error: parity buffer should be empty" << std::endl;
+            errors++;
+        }
+    }
+
+    // 3) lose two blocks of the same group; the block can't be recovered
+    // until one of them arrives (e.g. as resent data).
+    {
+        jb.reset();
+        pb.reset();
+        parity_encoder encoder;
+        for (int32_t i = 0; i < window; ++i) {
+            auto& b = blocks[i];
+            if (encoder.add(b.packet, window)) {
+                receive_parity(pb, alloc, encoder);
+                encoder.reset(); // see Source::send_data()
+            }
+            if (i == 1 || i == 2) {
+                jb.push(b.packet.sequence)->init(b.packet.sequence); // lost
+            } else {
+                receive_block(jb, alloc, b);
+            }
+        }
+        if (auto count = pb.recover(jb, nominal_samplerate); count != 0) {
+            std::cout << "error: recovered " << count
+                      << " blocks although two blocks are missing" << std::endl;
+            errors++;
+        }
+        if (jb.find(blocks[1].packet.sequence)->complete()
+                || jb.find(blocks[2].packet.sequence)->complete()) {
+            std::cout << "error: missing blocks should not be complete" << std::endl;
+            errors++;
+        }
+        if (pb.empty()) {
+            std::cout << "error: parity block should not have been discarded" << std::endl;
+            errors++;
+        }
+        // block 1 has been resent
+        receive_block(jb, alloc, blocks[1]);
+        if (auto count = pb.recover(jb, nominal_samplerate); count != 1) {
+            std::cout << "error: could not recover block after resending" << std::endl;
+            errors++;
+        }
+        if (!check_block(*jb.find(blocks[2].packet.sequence), blocks[2])) {
+            errors++;
+        }
+    }
+
+    // release frames before the allocator goes away
+    jb.reset();
+    pb.reset();
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    int errors = 0;
+
+    errors += test_jitter_buffer();
+    errors += test_history_buffer();
+    errors += test_block_assembler();
+    errors += test_frame_allocator();
+    errors += test_parity();
+
+    // benchmark: jitter buffer lookup. The buffer is always full and the
+    // head does not sit at the beginning of the ring. NB: with small packet
+    // sizes, every incoming frame needs such a lookup.
+    for (auto size : { 8, 64, 512 }) {
+        data_frame_allocator alloc;
+        jitter_buffer jb(alloc);
+        jb.resize(size);
+        push_blocks(jb, 12345, size);
+        // newest block (the common case) vs. any block (resent data)
+        auto newest = run_benchmark([&](uint64_t i) {
+            return jb.find(12345 + size - 1) != nullptr;
+        });
+        auto any = run_benchmark([&](uint64_t i) {
+            return jb.find(12345 + (i * 7) % size) != nullptr;
+        });
+        if (newest == 0 || any == 0) {
+            errors++;
+        }
+        std::cout << "jitter buffer find (" << size << " blocks): newest: "
+                  << (newest * 1e-6) << " M/s, any: " << (any * 1e-6)
+                  << " M/s" << std::endl;
+        jb.reset();
+    }
+
+    // benchmark: history buffer lookup (resend requests)
+    for (auto size : { 8, 64, 512 }) {
+        history_buffer hb;
+        hb.resize(size);
+        data_packet d{};
+        auto total = size * 3 + 5; // wrap around a few times
+        for (int32_t seq = 0; seq < total; ++seq) {
+            d.sequence = seq;
+            hb.push(seq)->set(d, 0);
+        }
+        auto rate = run_benchmark([&](uint64_t i) {
+            return hb.find(total - 1 - (i * 7) % size) != nullptr;
+        });
+        if (rate == 0) {
+            errors++;
+        }
+        std::cout << "history buffer find (" << size << " blocks): "
+                  << (rate * 1e-6) << " M/s" << std::endl;
+    }
+
+    // benchmark: block reassembly with different packet sizes
+    for (auto nframes : { 1, 4, 16 }) {
+        auto framesize = 2048 / nframes;
+        auto copy = run_reassembly_benchmark(nframes, framesize, false);
+        auto assemble = run_reassembly_benchmark(nframes, framesize, true);
+        std::cout << "block reassembly (" << nframes << " x " << framesize << " bytes):\n"
+                  << "  copy: network: " << copy.network << " ns, audio: "
+                  << copy.audio << " ns\n"
+                  << "  in place: network: " << assemble.network << " ns, audio: "
+                  << assemble.audio << " ns" << std::endl;
+    }
+
+    // benchmark: frame allocator with several producer threads
+    for (auto nproducers : { 1, 2, 4 }) {
+        data_frame_allocator alloc;
+        double elapsed;
+        const int32_t nframes = 1000000;
+        errors += run_frame_allocator(alloc, nproducers, nframes, elapsed);
+        data_frame_allocator::stats s;
+        alloc.get_stats(s);
+        std::cout << "frame allocator (" << nproducers << " thread(s)): "
+                  << (nproducers * nframes / elapsed * 1e-6) << " M frames/s, hits: "
+                  << s.hits << ", misses: " << s.misses << std::endl;
+    }
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
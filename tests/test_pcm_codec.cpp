@@ -0,0 +1,203 @@
+#include "aoo.h"
+#include "aoo_codec.h"
+#include "codec/aoo_pcm.h"
+
+#include "aoo/src/codec/pcm_kernels.hpp"
+#include "aoo/src/detail.hpp"
+
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace aoo;
+
+constexpr int32_t max_samples = 1027; // odd size to test the scalar tail
+constexpr int32_t sample_sizes[] = { 1, 2, 3, 4, 8 };
+constexpr const char *bitdepth_names[] = {
+    "int8", "int16", "int24", "float32", "float64"
+};
+
+std::vector<AooSample> make_samples(std::mt19937& gen, int32_t n) {
+    std::uniform_real_distribution<AooSample> dist(-1.5, 1.5);
+    std::vector<AooSample> samples(n);
+    for (auto& s : samples) {
+        s = dist(gen);
+    }
+    // edge cases
+    const AooSample special[] = {
+        0, -0.0, 1, -1, 0.5, -0.5, 1e-9, -1e-9, 1e10, -1e10,
+        1.0 / 127, 0.5 / 127, 1.5 / 127, 0.5 / 32767, 2.5 / 32767
+    };
+    for (int i = 0; i < (int)(sizeof(special) / sizeof(AooSample)) && i < n; ++i) {
+        samples[i] = special[i];
+    }
+    return samples;
+}
+
+// Encode/decode the same multi-channel block with the interleaved and
+// the non-interleaved codec functions and compare the results.
+int test_planar(std::mt19937& gen) {
+    auto codec = aoo::find_codec(kAooCodecPcm);
+    if (!codec) {
+        std::cout << "PCM codec not found!" << std::endl;
+        return 1;
+    }
+    int errors = 0;
+    auto enc = codec->encoderNew();
+    auto dec = codec->decoderNew();
+    // NB: the source only sends kAooCodecCtlSetPacketLoss to codecs with FEC
+    if (AooEncoder_hasFec(enc) || AooDecoder_hasFec(dec)) {
+        std::cout << "PCM codec reports FEC support!" << std::endl;
+        errors++;
+    }
+    if (!AooEncoder_hasPlanar(enc) || !AooDecoder_hasPlanar(dec)) {
+        std::cout << "PCM codec does not support planar audio!" << std::endl;
+        errors++;
+    } else {
+        for (int bd = 0; bd < kAooPcmBitDepthSize; ++bd) {
+            for (int32_t nchannels : { 1, 2, 5 }) {
+                for (int32_t nframes : { 1, 64, 333, 1000 }) {
+                    AooFormatPcm fmt;
+                    AooFormatPcm_init(&fmt, nchannels, 48000, nframes, (AooPcmBitDepth)bd);
+                    AooEncoder_setup(enc, &fmt.header);
+                    AooFormatPcm_init(&fmt, nchannels, 48000, nframes, (AooPcmBitDepth)bd);
+                    AooDecoder_setup(dec, &fmt.header);
+
+                    auto nsamples = nframes * nchannels;
+                    auto samples = make_samples(gen, nsamples);
+                    std::vector<AooSample> planar(nsamples);
+                    std::vector<const AooSample *> inchannels(nchannels);
+                    for (int i = 0; i < nchannels; ++i) {
+                        for (int j = 0; j < nframes; ++j) {
+                            planar[i * nframes + j] = samples[j * nchannels + i];
+                        }
+                        inchannels[i] = planar.data() + i * nframes;
+                    }
+                    // encode
+                    auto bufsize = nsamples * sample_sizes[bd];
+                    std::vector<AooByte> ref_bytes(bufsize), bytes(bufsize);
+                    AooInt32 size1 = bufsize, size2 = bufsize;
+                    AooEncoder_encode(enc, samples.data(), nframes, ref_bytes.data(), &size1);
+                    AooEncoder_encodePlanar(enc, inchannels.data(), nframes, bytes.data(), &size2);
+                    if (size1 != size2 || memcmp(bytes.data(), ref_bytes.data(), bufsize) != 0) {
+                        std::cout << "planar encode mismatch: " << bitdepth_names[bd]
+                                  << ", " << nchannels << " channels, " << nframes
+                                  << " frames" << std::endl;
+                        errors++;
+                    }
+                    // decode
+                    std::vector<AooSample> ref_out(nsamples), out(nsamples);
+                    std::vector<AooSample *> outchannels(nchannels);
+                    for (int i = 0; i < nchannels; ++i) {
+                        outchannels[i] = out.data() + i * nframes;
+                    }
+                    AooInt32 n1 = nframes, n2 = nframes;
+                    AooDecoder_decode(dec, ref_bytes.data(), size1, ref_out.data(), &n1);
+                    AooDecoder_decodePlanar(dec, ref_bytes.data(), size1, outchannels.data(), &n2);
+                    bool ok = (n1 == n2);
+                    for (int i = 0; ok && i < nchannels; ++i) {
+                        for (int j = 0; j < nframes; ++j) {
+                            if (out[i * nframes + j] != ref_out[j * nchannels + i]) {
+                                ok = false;
+                                break;
+                            }
+                        }
+                    }
+                    if (!ok) {
+                        std::cout << "planar decode mismatch: " << bitdepth_names[bd]
+                                  << ", " << nchannels << " channels, " << nframes
+                                  << " frames" << std::endl;
+                        errors++;
+                    }
+                }
+            }
+        }
+    }
+    codec->encoderFree(enc);
+    codec->decoderFree(dec);
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    std::mt19937 gen(12345);
+
+    auto scalar = pcm::get_kernels(0);
+    if (!scalar) {
+        std::cout << "no scalar kernels!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "available PCM kernels:";
+    for (int k = 0; pcm::get_kernels(k); ++k) {
+        std::cout << " " << pcm::get_kernels(k)->name;
+    }
+    std::cout << std::endl;
+    std::cout << "default PCM kernels: " << pcm::default_kernels().name << std::endl;
+
+    int errors = 0;
+
+    for (int bd = 0; bd < kAooPcmBitDepthSize; ++bd) {
+        auto samplesize = sample_sizes[bd];
+        for (int32_t n = 0; n <= max_samples; n += (n < 70) ? 1 : 97) {
+            auto samples = make_samples(gen, n);
+            // reference encoding
+            std::vector<AooByte> ref_bytes(n * samplesize);
+            scalar->encode[bd](samples.data(), ref_bytes.data(), n);
+            // for integer formats also decode arbitrary data
+            std::vector<AooByte> rand_bytes = ref_bytes;
+            if (bd <= kAooPcmInt24) {
+                std::uniform_int_distribution<int> dist(0, 255);
+                for (auto& b : rand_bytes) {
+                    b = (AooByte)dist(gen);
+                }
+            }
+            // reference decoding
+            std::vector<AooSample> ref_samples(n);
+            scalar->decode[bd](ref_bytes.data(), ref_samples.data(), n);
+            std::vector<AooSample> ref_rand_samples(n);
+            scalar->decode[bd](rand_bytes.data(), ref_rand_samples.data(), n);
+
+            for (int k = 1; pcm::get_kernels(k); ++k) {
+                auto kernels = pcm::get_kernels(k);
+                // NOTE: allocate exact sizes so that out-of-bounds
+                // access can be detected with sanitizers.
+                std::vector<AooByte> bytes(n * samplesize);
+                kernels->encode[bd](samples.data(), bytes.data(), n);
+                if (memcmp(bytes.data(), ref_bytes.data(), bytes.size()) != 0) {
+                    std::cout << "encode mismatch: " << kernels->name << ", "
+                              << bitdepth_names[bd] << ", n = " << n << std::endl;
+                    errors++;
+                }
+
+                std::vector<AooSample> out(n);
+                kernels->decode[bd](ref_bytes.data(), out.data(), n);
+                if (memcmp(out.data(), ref_samples.data(), n * sizeof(AooSample)) != 0) {
+                    std::cout << "decode mismatch: " << kernels->name << ", "
+                              << bitdepth_names[bd] << ", n = " << n << std::endl;
+                    errors++;
+                }
+
+                kernels->decode[bd](rand_bytes.data(), out.data(), n);
+                if (memcmp(out.data(), ref_rand_samples.data(), n * sizeof(AooSample)) != 0) {
+                    std::cout << "decode mismatch (random data): " << kernels->name << ", "
+                              << bitdepth_names[bd] << ", n = " << n << std::endl;
+                    errors++;
+                }
+            }
+        }
+    }
+
+    aoo_initialize(nullptr);
+    errors += test_planar(gen);
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
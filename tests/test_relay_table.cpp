@@ -0,0 +1,344 @@
+#include "aoo/src/binmsg.hpp"
+#include "aoo/src/net/relay_table.hpp"
+#include "common/net_utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace aoo;
+using namespace aoo::net;
+
+constexpr int num_readers = 4;
+constexpr int num_entries = 256;
+constexpr int payload_size = 64;
+constexpr double duration = 0.5; // seconds per benchmark
+constexpr auto update_interval = std::chrono::milliseconds(1);
+
+using seconds = std::chrono::duration<double>;
+
+std::vector<ip_address> make_addresses(int count) {
+    std::vector<ip_address> result;
+    for (int i = 0; i < count; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "10.0.%d.%d", (i >> 8) & 255, i & 255);
+        result.emplace_back(name, 10000 + i, ip_address::IPv4);
+    }
+    return result;
+}
+
+relay_table::map_type make_map(const std::vector<ip_address>& addresses) {
+    relay_table::map_type map;
+    for (auto& addr : addresses) {
+        map.emplace(addr, addr);
+    }
+    return map;
+}
+
+// binary relay messages (header + payload), one per address
+std::vector<std::vector<AooByte>> make_packets(const std::vector<ip_address>& addresses) {
+    std::vector<std::vector<AooByte>> result;
+    for (auto& addr : addresses) {
+        std::vector<AooByte> packet(20 + payload_size);
+        auto onset = binmsg_write_relay(packet.data(), packet.size(), addr);
+        packet.resize(onset + payload_size);
+        result.push_back(std::move(packet));
+    }
+    return result;
+}
+
+// The address checks of the original Server::handle_relay(), for comparison.
+// Note that it forwards to any (valid) destination address.
+bool baseline_check_address(ip_address& addr, ip_address::ip_type family,
+                            bool use_ipv4_mapped) {
+    if (addr.is_ipv4_mapped()) {
+        return false;
+    }
+    if (family == ip_address::IPv6 && addr.type() == ip_address::IPv4) {
+        if (use_ipv4_mapped) {
+            addr = addr.ipv4_mapped();
+        } else {
+            return false;
+        }
+    } else if (family == ip_address::IPv4 && addr.type() == ip_address::IPv6) {
+        return false;
+    }
+    return true;
+}
+
+// Run 'num_readers' threads that route relay messages like
+// Server::handle_relay() - i.e. read the destination address, check it
+// and rewrite the header with the source address - while the main thread
+// keeps updating the table. Returns the number of messages per second.
+template<typename Check, typename Update>
+double run_benchmark(const std::vector<ip_address>& addresses,
+                     Check&& check, Update&& update) {
+    auto packets = make_packets(addresses);
+    ip_address src_addr("192.168.1.1", 9999, ip_address::IPv4);
+
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> misses{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_readers; ++i) {
+        threads.emplace_back([&, i]() {
+            uint64_t count = 0;
+            uint64_t missed = 0;
+            size_t index = i;
+            AooByte buf[20 + payload_size];
+            while (running.load(std::memory_order_relaxed)) {
+                auto k = index++ % packets.size();
+                auto& packet = packets[k];
+                ip_address dst_addr;
+                auto onset = binmsg_read_relay(packet.data(), packet.size(), dst_addr);
+                if (onset > 0 && check(dst_addr) && dst_addr == addresses[k]) {
+                    // NB: the server rewrites the header in place
+                    memcpy(buf, packet.data(), packet.size());
+                    binmsg_write_relay(buf, packet.size(), src_addr);
+                } else {
+                    missed++;
+                }
+                count++;
+            }
+            total += count;
+            misses += missed;
+        });
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (;;) {
+        update();
+        std::this_thread::sleep_for(update_interval);
+        auto now = std::chrono::high_resolution_clock::now();
+        if (seconds(now - start).count() >= duration) {
+            break;
+        }
+    }
+    running.store(false);
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto elapsed = seconds(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (misses.load() > 0) {
+        std::cout << "error: " << misses.load() << " messages dropped!" << std::endl;
+        return -1;
+    }
+    return total.load() / elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    auto addresses = make_addresses(num_entries);
+    int errors = 0;
+
+    // 1) basic functionality
+    {
+        relay_table table;
+        ip_address result;
+        if (table.find(addresses[0], result)) {
+            std::cout << "error: empty table should not contain any entries" << std::endl;
+            errors++;
+        }
+        table.update(make_map(addresses));
+        if (table.size() != addresses.size()) {
+            std::cout << "error: wrong table size" << std::endl;
+            errors++;
+        }
+        for (auto& addr : addresses) {
+            if (!table.find(addr, result) || result != addr) {
+                std::cout << "error: could not find " << addr << std::endl;
+                errors++;
+            }
+        }
+        ip_address other("192.168.1.1", 9999, ip_address::IPv4);
+        if (table.find(other, result)) {
+            std::cout << "error: found unknown address " << other << std::endl;
+            errors++;
+        }
+        // without readers all old tables must be reclaimed immediately
+        table.update(make_map(addresses));
+        if (!table.reclaim()) {
+            std::cout << "error: could not reclaim old table" << std::endl;
+            errors++;
+        }
+        table.clear();
+        if (table.find(addresses[0], result)) {
+            std::cout << "error: cleared table should not contain any entries" << std::endl;
+            errors++;
+        }
+    }
+
+    // 2) benchmark: relay_table vs. the original relay code path.
+    // NB: the socket send is the same in both cases and not included.
+    {
+        relay_table table;
+        table.update(make_map(addresses));
+
+        auto rate1 = run_benchmark(addresses,
+            [&](ip_address& addr) {
+                return table.find(addr, addr);
+            },
+            [&]() {
+                table.update(make_map(addresses));
+            });
+
+        auto rate2 = run_benchmark(addresses,
+            [&](ip_address& addr) {
+                return baseline_check_address(addr, ip_address::IPv4, false);
+            },
+            [&]() {});
+
+        if (rate1 < 0 || rate2 < 0) {
+            errors++;
+        } else {
+            std::cout << num_readers << " readers, " << num_entries << " entries:" << std::endl;
+            std::cout << "relay_table: " << (rate1 * 1e-6) << " M messages/s" << std::endl;
+            std::cout << "baseline: " << (rate2 * 1e-6) << " M messages/s" << std::endl;
+        }
+    }
+
+    // 3) visit() + synchronize(): the writer must not free an object while
+    // a reader is still using it (see Client::removeSource()).
+    {
+        struct object {
+            std::atomic<bool> alive{true};
+        };
+        rcu_table<int, object *> table;
+        std::vector<object *> objects;
+        auto update = [&]() {
+            decltype(table)::map_type map;
+            for (int i = 0; i < (int)objects.size(); ++i) {
+                map.emplace(i, objects[i]);
+            }
+            table.update(std::move(map));
+        };
+        for (int i = 0; i < 16; ++i) {
+            objects.push_back(new object);
+        }
+        update();
+
+        std::atomic<bool> running{true};
+        std::atomic<uint64_t> dead{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_readers; ++i) {
+            threads.emplace_back([&, i]() {
+                int key = i;
+                while (running.load(std::memory_order_relaxed)) {
+                    table.visit(key++ % 16, [&](object *obj) {
+                        for (int k = 0; k < 100; ++k) {
+                            if (!obj->alive.load(std::memory_order_relaxed)) {
+                                dead++;
+                            }
+                        }
+                    });
+                }
+            });
+        }
+        // keep removing and freeing the last object
+        for (int i = 0; i < 2000; ++i) {
+            auto obj = objects.back();
+            objects.pop_back();
+            update();
+            table.synchronize();
+            obj->alive.store(false);
+            delete obj;
+            objects.push_back(new object);
+            update();
+        }
+        running.store(false);
+        for (auto& t : threads) {
+            t.join();
+        }
+        for (auto& obj : objects) {
+            delete obj;
+        }
+        if (dead.load() > 0) {
+            std::cout << "error: visited " << dead.load() << " dead objects" << std::endl;
+            errors++;
+        }
+    }
+
+    // 4) synchronize() must not be starved by readers that never pause.
+    // We use more readers than reader slots, so that some readers share
+    // the same slot; with a single (global or per-slot) reader count, the
+    // count would hardly ever drop to zero.
+    {
+        constexpr int num_busy_readers = AOO_RCU_READER_SLOTS + 4;
+        constexpr int num_updates = 20;
+        constexpr double max_time = 10.0; // seconds
+
+        rcu_table<int, int> table;
+        auto update = [&](int value) {
+            decltype(table)::map_type map;
+            map.emplace(0, value);
+            table.update(std::move(map));
+        };
+        update(0);
+
+        std::atomic<bool> running{true};
+        std::atomic<int> num_running{0};
+        std::atomic<int> last_value{0};
+        std::atomic<uint64_t> stale{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_busy_readers; ++i) {
+            threads.emplace_back([&]() {
+                num_running++;
+                while (running.load(std::memory_order_relaxed)) {
+                    // after synchronize() readers must not see old values
+                    auto min = last_value.load(std::memory_order_acquire);
+                    table.visit(0, [&](int value) {
+                        if (value < min) {
+                            stale++;
+                        }
+                    });
+                }
+            });
+        }
+        while (num_running.load() < num_busy_readers) {
+            std::this_thread::yield();
+        }
+
+        double max_elapsed = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 1; i <= num_updates && !errors; ++i) {
+            auto t1 = std::chrono::high_resolution_clock::now();
+            update(i);
+            // like synchronize(), but with a timeout
+            while (!table.reclaim()) {
+                auto now = std::chrono::high_resolution_clock::now();
+                if (seconds(now - start).count() > max_time) {
+                    std::cout << "error: synchronize() starved after " << (i - 1)
+                              << " of " << num_updates << " updates" << std::endl;
+                    errors++;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            last_value.store(i, std::memory_order_release);
+            auto t2 = std::chrono::high_resolution_clock::now();
+            max_elapsed = std::max(max_elapsed, seconds(t2 - t1).count());
+        }
+        running.store(false);
+        for (auto& t : threads) {
+            t.join();
+        }
+        std::cout << num_busy_readers << " busy readers: max. synchronize() time: "
+                  << (max_elapsed * 1000) << " ms" << std::endl;
+        if (stale.load() > 0) {
+            std::cout << "error: saw " << stale.load() << " old values" << std::endl;
+            errors++;
+        }
+    }
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,382 @@
+#include "aoo.h"
+
+#include "aoo/src/resampler.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace aoo;
+
+constexpr int32_t blocksize = 64;
+constexpr double duration = 0.5; // seconds per benchmark
+constexpr double pi = 3.14159265358979323846;
+
+using seconds = std::chrono::duration<double>;
+
+const char *method_name(AooResampleMethod method) {
+    switch (method) {
+    case kAooResampleHold: return "hold";
+    case kAooResampleLinear: return "linear";
+    case kAooResampleCubic: return "cubic";
+    case kAooResamplePolyphase: return "polyphase";
+    default: return "?";
+    }
+}
+
+// Resample a (mono) sine wave and return the output.
+// If 'drift' is not zero, the ratio is modulated periodically.
+std::vector<AooSample> resample_sine(AooResampleMethod method, int32_t srfrom, int32_t srto,
+                                     double freq, int32_t nframes, double drift = 0) {
+    dynamic_resampler r;
+    r.setup(blocksize, blocksize, true, srfrom, srto, drift == 0, 1, method);
+
+    std::vector<AooSample> result;
+    std::vector<AooSample> in(blocksize), out(blocksize);
+    int64_t phase = 0;
+    int32_t count = 0;
+    while ((int32_t)result.size() < nframes) {
+        if (drift != 0 && (++count % 16) == 0) {
+            auto factor = 1.0 + drift * std::sin(count * 0.01);
+            r.update(srfrom * factor, srto);
+        }
+        for (auto& x : in) {
+            x = 0.5 * std::sin(2.0 * pi * freq * (double)(phase++) / srfrom);
+        }
+        if (!r.write(in.data(), blocksize)) {
+            std::cout << "error: could not write to resampler" << std::endl;
+            return {};
+        }
+        while (r.read(out.data(), blocksize)) {
+            result.insert(result.end(), out.begin(), out.end());
+        }
+    }
+    result.resize(nframes);
+    return result;
+}
+
+// Fit a sine wave of the given frequency (+ DC offset) with linear least squares
+// and return the ratio between the residual and the fitted sine in dB (THD+N).
+// If 'amplitude' is not null, also return the amplitude of the fitted sine.
+double measure_thdn(const std::vector<AooSample>& x, int32_t onset,
+                    double freq, double sr, double *amplitude = nullptr) {
+    // normal equations for [sin, cos, 1]
+    double m[3][3] = {}, v[3] = {};
+    for (size_t i = onset; i < x.size(); ++i) {
+        double basis[3] = { std::sin(2.0 * pi * freq * i / sr),
+                            std::cos(2.0 * pi * freq * i / sr), 1.0 };
+        for (int j = 0; j < 3; ++j) {
+            for (int k = 0; k < 3; ++k) {
+                m[j][k] += basis[j] * basis[k];
+            }
+            v[j] += basis[j] * x[i];
+        }
+    }
+    // solve with Gaussian elimination
+    for (int j = 0; j < 3; ++j) {
+        for (int k = j + 1; k < 3; ++k) {
+            auto f = m[k][j] / m[j][j];
+            for (int l = j; l < 3; ++l) {
+                m[k][l] -= f * m[j][l];
+            }
+            v[k] -= f * v[j];
+        }
+    }
+    double c[3];
+    for (int j = 2; j >= 0; --j) {
+        auto sum = v[j];
+        for (int k = j + 1; k < 3; ++k) {
+            sum -= m[j][k] * c[k];
+        }
+        c[j] = sum / m[j][j];
+    }
+    double signal = 0, noise = 0;
+    for (size_t i = onset; i < x.size(); ++i) {
+        auto s = c[0] * std::sin(2.0 * pi * freq * i / sr)
+            + c[1] * std::cos(2.0 * pi * freq * i / sr);
+        auto e = x[i] - s - c[2];
+        signal += s * s;
+        noise += e * e;
+    }
+    if (amplitude) {
+        *amplitude = std::sqrt(c[0] * c[0] + c[1] * c[1]);
+    }
+    return 10.0 * std::log10(noise / signal);
+}
+
+double measure_rms(const std::vector<AooSample>& x, int32_t onset) {
+    double sum = 0;
+    for (size_t i = onset; i < x.size(); ++i) {
+        sum += x[i] * x[i];
+    }
+    return std::sqrt(sum / (x.size() - onset));
+}
+
+// Resample the same multi-channel signal with interleaved and planar
+// data and check that the results are the same. NB: the library may be
+// compiled with -ffast-math, so we can't expect bit-identical results.
+bool compare_planar(AooResampleMethod method, int32_t nfrom, int32_t nto,
+                    int32_t srfrom, int32_t srto, int32_t nchannels) {
+    dynamic_resampler r1, r2;
+    r1.setup(nfrom, nto, true, srfrom, srto, true, nchannels, method, false);
+    r2.setup(nfrom, nto, true, srfrom, srto, true, nchannels, method, true);
+
+    std::vector<AooSample> in1(nfrom * nchannels), in2(nfrom * nchannels);
+    std::vector<AooSample> out1(nto * nchannels), out2(nto * nchannels);
+    int64_t phase = 0;
+    int32_t count = 0;
+    for (int k = 0; k < 1000; ++k) {
+        for (int i = 0; i < nfrom; ++i, ++phase) {
+            for (int j = 0; j < nchannels; ++j) {
+                auto value = std::sin(phase * 0.01 * (j + 1));
+                in1[i * nchannels + j] = value;
+                in2[j * nfrom + i] = value;
+            }
+        }
+        auto ok1 = r1.write(in1.data(), nfrom);
+        auto ok2 = r2.write(in2.data(), nfrom);
+        if (ok1 != ok2) {
+            return false;
+        }
+        for (;;) {
+            ok1 = r1.read(out1.data(), nto);
+            ok2 = r2.read(out2.data(), nto);
+            if (ok1 != ok2) {
+                return false;
+            }
+            if (!ok1) {
+                break;
+            }
+            for (int i = 0; i < nto; ++i) {
+                for (int j = 0; j < nchannels; ++j) {
+                    if (std::abs(out1[i * nchannels + j] - out2[j * nto + i]) > 1e-5) {
+                        return false;
+                    }
+                }
+            }
+            count++;
+        }
+    }
+    return count > 0;
+}
+
+// Keep the resampler as full as possible (like the sink does) and check that
+// the output is the same as with write-then-read, i.e. write() must not
+// overwrite frames that read() still needs.
+bool compare_full(AooResampleMethod method, int32_t nfrom, int32_t nto,
+                  int32_t srfrom, int32_t srto) {
+    dynamic_resampler r1, r2;
+    r1.setup(nfrom, nto, true, srfrom, srto, true, 1, method);
+    r2.setup(nfrom, nto, true, srfrom, srto, true, 1, method);
+
+    const int32_t nframes = 16384;
+    std::vector<AooSample> out1, out2;
+    std::vector<AooSample> in(nfrom), out(nto);
+    int64_t phase1 = 0, phase2 = 0;
+    auto next_block = [&](int64_t& phase) {
+        for (auto& x : in) {
+            x = std::sin(2.0 * pi * 1000.0 * (double)(phase++) / srfrom);
+        }
+    };
+    // write-then-read
+    while ((int32_t)out1.size() < nframes) {
+        next_block(phase1);
+        if (!r1.write(in.data(), nfrom)) {
+            return false;
+        }
+        while (r1.read(out.data(), nto)) {
+            out1.insert(out1.end(), out.begin(), out.end());
+        }
+    }
+    // write until refused, then read a single block
+    while ((int32_t)out2.size() < nframes) {
+        for (;;) {
+            next_block(phase2);
+            if (!r2.write(in.data(), nfrom)) {
+                phase2 -= nfrom; // try again
+                break;
+            }
+        }
+        if (!r2.read(out.data(), nto)) {
+            return false;
+        }
+        out2.insert(out2.end(), out.begin(), out.end());
+    }
+    for (int i = 0; i < nframes; ++i) {
+        if (std::abs(out1[i] - out2[i]) > 1e-5) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// returns the number of output frames per second
+double run_benchmark(AooResampleMethod method, int32_t srfrom, int32_t srto,
+                     int32_t nchannels, bool planar = false) {
+    dynamic_resampler r;
+    r.setup(blocksize, blocksize, true, srfrom, srto, true, nchannels, method, planar);
+
+    std::vector<AooSample> in(blocksize * nchannels), out(blocksize * nchannels);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = std::sin(i * 0.1);
+    }
+    uint64_t count = 0;
+    double sum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (;;) {
+        for (int i = 0; i < 100; ++i) {
+            r.write(in.data(), blocksize);
+            while (r.read(out.data(), blocksize)) {
+                sum += out[0];
+                count += blocksize;
+            }
+        }
+        auto now = std::chrono::high_resolution_clock::now();
+        if (seconds(now - start).count() >= duration) {
+            break;
+        }
+    }
+    auto elapsed = seconds(std::chrono::high_resolution_clock::now() - start).count();
+    // prevent the compiler from optimizing away the loop
+    if (sum == 12345.0) {
+        std::cout << sum;
+    }
+    return count / elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    const AooResampleMethod methods[] = {
+        kAooResampleLinear, kAooResampleCubic, kAooResamplePolyphase
+    };
+    const int32_t nframes = 48000;
+    const int32_t onset = 4096; // skip the initial transient
+    int errors = 0;
+
+    // 1) THD+N of a 1 kHz and a 10 kHz sine wave (44.1 kHz -> 48 kHz)
+    for (auto freq : { 1000.0, 10000.0 }) {
+        std::cout << "THD+N (" << freq << " Hz, 44100 -> 48000 Hz):" << std::endl;
+        for (auto method : methods) {
+            auto out = resample_sine(method, 44100, 48000, freq, nframes);
+            if (out.empty()) {
+                errors++;
+                continue;
+            }
+            double amp;
+            auto thdn = measure_thdn(out, onset, freq, 48000, &amp);
+            std::cout << "  " << method_name(method) << ": " << thdn << " dB" << std::endl;
+            if (method == kAooResamplePolyphase) {
+                if (thdn > -80) {
+                    std::cout << "error: THD+N too high" << std::endl;
+                    errors++;
+                }
+                if (std::abs(20.0 * std::log10(amp / 0.5)) > 0.1) {
+                    std::cout << "error: wrong gain (" << amp << ")" << std::endl;
+                    errors++;
+                }
+            }
+        }
+    }
+
+    // 2) aliasing: 23 kHz sine wave (48 kHz -> 44.1 kHz) must be filtered out
+    std::cout << "aliasing (23000 Hz, 48000 -> 44100 Hz):" << std::endl;
+    for (auto method : methods) {
+        auto out = resample_sine(method, 48000, 44100, 23000, nframes);
+        if (out.empty()) {
+            errors++;
+            continue;
+        }
+        auto level = 20.0 * std::log10(measure_rms(out, onset) / (0.5 / std::sqrt(2.0)));
+        std::cout << "  " << method_name(method) << ": " << level << " dB" << std::endl;
+        if (method == kAooResamplePolyphase && level > -60) {
+            std::cout << "error: insufficient anti-aliasing" << std::endl;
+            errors++;
+        }
+    }
+
+    // 3) integer downsampling (96 kHz -> 48 kHz) must not alias either
+    {
+        auto out = resample_sine(kAooResamplePolyphase, 96000, 48000, 30000, nframes);
+        auto level = out.empty() ? 0 :
+            20.0 * std::log10(measure_rms(out, onset) / (0.5 / std::sqrt(2.0)));
+        std::cout << "aliasing (30000 Hz, 96000 -> 48000 Hz): polyphase: "
+                  << level << " dB" << std::endl;
+        if (level > -60) {
+            std::cout << "error: insufficient anti-aliasing" << std::endl;
+            errors++;
+        }
+    }
+
+    // 4) dynamic resampling: the ratio follows the (simulated) drift
+    {
+        auto out = resample_sine(kAooResamplePolyphase, 44100, 48000, 1000,
+                                 nframes, 0.001);
+        if (out.empty()) {
+            errors++;
+        } else {
+            std::cout << "dynamic resampling: polyphase: RMS = "
+                      << measure_rms(out, onset) << std::endl;
+        }
+    }
+
+    // 5) planar vs. interleaved data
+    for (auto method : { kAooResampleHold, kAooResampleLinear,
+                         kAooResampleCubic, kAooResamplePolyphase }) {
+        struct {
+            int32_t nfrom, nto, srfrom, srto;
+        } configs[] = {
+            { 64, 64, 44100, 48000 },
+            { 64, 64, 48000, 44100 },
+            { 64, 64, 96000, 48000 }, // skip (except for polyphase)
+            { 64, 48, 48000, 48000 }, // reblock only
+            { 32, 100, 22050, 48000 }
+        };
+        for (auto& c : configs) {
+            if (!compare_planar(method, c.nfrom, c.nto, c.srfrom, c.srto, 3)) {
+                std::cout << "error: planar and interleaved results differ ("
+                          << method_name(method) << ", " << c.nfrom << " -> " << c.nto
+                          << ", " << c.srfrom << " -> " << c.srto << " Hz)" << std::endl;
+                errors++;
+            }
+        }
+    }
+
+    // 6) full buffer vs. write-then-read
+    for (auto method : { kAooResampleLinear, kAooResampleCubic, kAooResamplePolyphase }) {
+        for (auto nto : { 64, 60, 50 }) {
+            for (auto srto : { 48000, 22050 }) {
+                if (!compare_full(method, 64, nto, 44100, srto)) {
+                    std::cout << "error: full buffer gives different results ("
+                              << method_name(method) << ", 64 -> " << nto
+                              << ", 44100 -> " << srto << " Hz)" << std::endl;
+                    errors++;
+                }
+            }
+        }
+    }
+
+    // 7) benchmark: polyphase vs. cubic, interleaved vs. planar
+    for (auto nchannels : { 1, 2, 16 }) {
+        std::cout << "benchmark (44100 -> 48000 Hz, " << nchannels
+                  << " channel(s)):" << std::endl;
+        for (auto method : methods) {
+            for (auto planar : { false, true }) {
+                if (planar && nchannels == 1) {
+                    continue;
+                }
+                auto rate = run_benchmark(method, 44100, 48000, nchannels, planar);
+                std::cout << "  " << method_name(method) << (planar ? " (planar)" : "")
+                          << ": " << (rate * 1e-6) << " M frames/s" << std::endl;
+            }
+        }
+    }
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
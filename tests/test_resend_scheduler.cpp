@@ -0,0 +1,246 @@
+#include "aoo.h"
+#include "aoo_sink.hpp"
+#include "aoo_source.hpp"
+#include "codec/aoo_pcm.h"
+
+#include "aoo/src/resend_scheduler.hpp"
+#include "common/net_utils.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace aoo;
+
+int test_coalesce_request() {
+    int errors = 0;
+    aoo::vector<data_request> requests;
+
+    // partial requests for the same offset are merged
+    coalesce_request(requests, { 5, 0, 0x3 });
+    coalesce_request(requests, { 5, 0, 0x6 });
+    coalesce_request(requests, { 5, 16, 0x1 });
+    coalesce_request(requests, { 6, 0, 0x1 });
+    if (requests.size() != 3 || requests[0].bitset != 0x7) {
+        std::cout << "error: couldn't merge partial requests" << std::endl;
+        errors++;
+    }
+    // whole block replaces partial requests...
+    coalesce_request(requests, { 5, -1, 0 });
+    if (requests.size() != 2 || requests[1].sequence != 5
+            || requests[1].offset >= 0) {
+        std::cout << "error: whole block didn't replace partial requests" << std::endl;
+        errors++;
+    }
+    // ...and absorbs subsequent partial requests
+    coalesce_request(requests, { 5, 0, 0x8 });
+    coalesce_request(requests, { 5, -1, 0 });
+    if (requests.size() != 2) {
+        std::cout << "error: whole block didn't absorb partial request" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+int test_resend_filter() {
+    int errors = 0;
+    resend_filter filter;
+    const double interval = 0.005;
+
+    filter.add(10, 0, 0.0);
+    filter.add(10, 1, 0.001);
+    filter.add(11, 0, 0.002);
+    if (!filter.contains(10, 1, 0.003, interval)
+            || filter.contains(10, 2, 0.003, interval)) {
+        std::cout << "error: wrong resend filter result" << std::endl;
+        errors++;
+    }
+    // the first two records have expired
+    if (filter.contains(10, 0, 0.0065, interval) || filter.size() != 1) {
+        std::cout << "error: resend filter record didn't expire" << std::endl;
+        errors++;
+    }
+    // many records over a long time span; the filter must stay small.
+    for (int i = 0; i < 10000; ++i) {
+        auto t = 1.0 + i * 0.0001;
+        if (filter.contains(i, 0, t, interval)) {
+            std::cout << "error: found record " << i << std::endl;
+            errors++;
+            break;
+        }
+        filter.add(i, 0, t);
+    }
+    if (filter.size() > 51) {
+        std::cout << "error: resend filter too large (" << filter.size() << ")" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+int test_token_bucket() {
+    int errors = 0;
+    token_bucket bucket;
+
+    // unlimited
+    bucket.setup(0, 0);
+    if (!bucket.consume(1000000)) {
+        std::cout << "error: unlimited bucket refused tokens" << std::endl;
+        errors++;
+    }
+    // 10000 bytes/s, burst of 1000 bytes
+    bucket.setup(10000, 1000);
+    bucket.reset();
+    int count = 0;
+    while (bucket.consume(100)) {
+        count++;
+    }
+    if (count != 10) {
+        std::cout << "error: expected burst of 10 frames, got " << count << std::endl;
+        errors++;
+    }
+    bucket.refill(0.025); // 250 bytes
+    count = 0;
+    while (bucket.consume(100)) {
+        count++;
+    }
+    if (count != 2) {
+        std::cout << "error: expected 2 frames after refill, got " << count << std::endl;
+        errors++;
+    }
+    bucket.refill(10.0); // limited by capacity
+    if (bucket.tokens() != 1000) {
+        std::cout << "error: bucket exceeds capacity" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+//----------------------- source/sink test ----------------------//
+
+const int kBlockSize = 64;
+const int kSampleRate = 48000;
+const int kNumChannels = 2;
+
+struct lossy_link {
+    AooSource *source;
+    AooSink *sink;
+    ip_address source_addr { "127.0.0.1", 10000, ip_address::IPv4 };
+    ip_address sink_addr { "127.0.0.1", 9000, ip_address::IPv4 };
+    int count = 0;
+    // sink messages that are delivered again in the next cycle,
+    // as if the sink had repeated its data requests.
+    std::vector<std::vector<AooByte>> repeated;
+};
+
+AooInt32 AOO_CALL source_send(void *user, const AooByte *data, AooInt32 size,
+                              const void *, AooAddrSize, AooFlag) {
+    auto x = (lossy_link *)user;
+    if ((++x->count % 13) != 0) { // drop every 13th packet
+        x->sink->handleMessage(data, size, x->source_addr.address(),
+                               x->source_addr.length());
+    }
+    return 0;
+}
+
+AooInt32 AOO_CALL sink_send(void *user, const AooByte *data, AooInt32 size,
+                            const void *, AooAddrSize, AooFlag) {
+    auto x = (lossy_link *)user;
+    x->source->handleMessage(data, size, x->sink_addr.address(), x->sink_addr.length());
+    x->repeated.emplace_back(data, data + size);
+    return 0;
+}
+
+bool run_source_sink(AooInt32 bandwidth, AooResendStats& stats) {
+    lossy_link x;
+    x.sink = AooSink_new(1);
+    x.sink->setup(kNumChannels, kSampleRate, kBlockSize, kAooFixedBlockSize);
+    x.sink->setLatency(0.05);
+    x.source = AooSource_new(0);
+    x.source->setup(kNumChannels, kSampleRate, kBlockSize, kAooFixedBlockSize);
+    x.source->setResendBandwidth(bandwidth);
+    AooFormatPcm fmt;
+    AooFormatPcm_init(&fmt, kNumChannels, kSampleRate, kBlockSize, kAooPcmFloat32);
+    x.source->setFormat(fmt.header);
+    AooEndpoint ep { x.sink_addr.address(), (AooAddrSize)x.sink_addr.length(), 1 };
+    x.source->addSink(ep, true);
+    x.source->startStream(0, nullptr);
+
+    std::vector<AooSample> buf(kBlockSize * kNumChannels, 0);
+    AooSample *channels[] = { buf.data(), buf.data() + kBlockSize };
+    AooNtpTime t = aoo_getCurrentNtpTime();
+    for (int i = 0; i < 1000; ++i) {
+        t += (AooNtpTime)((double)kBlockSize / kSampleRate * 4294967296.0);
+        x.source->process(channels, kBlockSize, t);
+        x.source->send(source_send, &x);
+        // deliver repeated data requests
+        auto repeated = std::move(x.repeated);
+        x.repeated.clear();
+        for (auto& msg : repeated) {
+            x.source->handleMessage(msg.data(), msg.size(), x.sink_addr.address(),
+                                    x.sink_addr.length());
+        }
+        x.sink->process(channels, kBlockSize, t, nullptr, nullptr);
+        x.sink->send(sink_send, &x);
+    }
+    auto err = x.source->getResendStats(stats);
+
+    AooSource_free(x.source);
+    AooSink_free(x.sink);
+
+    return err == kAooOk;
+}
+
+int test_source_sink() {
+    int errors = 0;
+    AooResendStats stats;
+
+    // unlimited bandwidth: every request is repeated once, so about half
+    // of the requested frames should be suppressed.
+    if (!run_source_sink(0, stats)) {
+        std::cout << "error: couldn't get resend stats" << std::endl;
+        return 1;
+    }
+    std::cout << "unlimited: requested: " << stats.requestCount << ", sent: "
+              << stats.sentCount << ", suppressed: " << stats.suppressedCount << std::endl;
+    if (stats.sentCount == 0 || stats.suppressedCount == 0
+            || stats.sentCount + stats.suppressedCount > stats.requestCount) {
+        std::cout << "error: wrong resend stats" << std::endl;
+        errors++;
+    }
+    auto unlimited = stats.sentCount;
+
+    // limited bandwidth: much fewer frames should be sent.
+    if (!run_source_sink(1000, stats)) {
+        std::cout << "error: couldn't get resend stats" << std::endl;
+        return 1;
+    }
+    std::cout << "1000 bytes/s: requested: " << stats.requestCount << ", sent: "
+              << stats.sentCount << ", suppressed: " << stats.suppressedCount << std::endl;
+    if (stats.sentCount == 0 || stats.sentCount >= unlimited) {
+        std::cout << "error: resend bandwidth has not been limited" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    int errors = 0;
+
+    aoo_initialize(nullptr);
+
+    errors += test_coalesce_request();
+    errors += test_resend_filter();
+    errors += test_token_bucket();
+    errors += test_source_sink();
+
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,223 @@
+#include "aoo.h"
+#include "aoo_server.hpp"
+
+#include "aoo/src/net/detail.hpp"
+#include "common/net_utils.hpp"
+#include "common/utils.hpp"
+
+#include "osc/OscReceivedElements.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace aoo;
+
+using seconds = std::chrono::duration<double>;
+using hrclock = std::chrono::high_resolution_clock;
+
+constexpr int port = 47278;
+constexpr int num_clients = 100;
+constexpr int num_broadcasts = 200;
+constexpr int bulk_message_size = 4096;
+constexpr int num_bulk_messages = 8192; // 32 MB
+constexpr int max_in_flight = 64; // 256 KB
+constexpr AooInt32 queue_limit = 1 << 20;
+
+bool receive_all(tcp_socket& sock, AooByte *buf, int size, double timeout = 5.0) {
+    int count = 0;
+    while (count < size) {
+        auto [ok, n] = sock.receive(buf + count, size - count, timeout);
+        if (!ok || n <= 0) {
+            return false;
+        }
+        count += n;
+    }
+    return true;
+}
+
+// Receive the next notification (= "/aoo/client/msg") from the server;
+// other messages, like pings, are ignored.
+bool receive_notification(tcp_socket& sock, std::vector<AooByte>& result,
+                          double timeout = 5.0) {
+    std::vector<AooByte> buf;
+    for (;;) {
+        AooByte header[4];
+        if (!receive_all(sock, header, 4, timeout)) {
+            return false;
+        }
+        auto size = aoo::from_bytes<int32_t>(header);
+        buf.resize(size);
+        if (!receive_all(sock, buf.data(), size, timeout)) {
+            return false;
+        }
+        osc::ReceivedPacket packet((const char *)buf.data(), size);
+        osc::ReceivedMessage msg(packet);
+        if (!strcmp(msg.AddressPattern(), kAooMsgClientMessage)) {
+            const void *blobdata;
+            osc::osc_bundle_element_size_t blobsize;
+            msg.ArgumentsBegin()->AsBlob(blobdata, blobsize);
+            auto ptr = (const AooByte *)blobdata;
+            result.assign(ptr, ptr + blobsize);
+            return true;
+        }
+    }
+}
+
+AooError notify(AooServer& server, AooId client, const std::vector<AooByte>& data) {
+    AooData msg { kAooDataBinary, data.data(), (AooSize)data.size() };
+    return server.notifyClient(client, msg);
+}
+
+int main(int argc, char *argv[]) {
+    aoo_initialize(nullptr);
+    socket::init();
+
+    int errors = 0;
+
+    auto server = AooServer::create();
+    AooServerSettings settings;
+    settings.portNumber = port;
+    if (server->setup(settings) != kAooOk) {
+        std::cout << "error: could not setup server" << std::endl;
+        return EXIT_FAILURE;
+    }
+    server->setClientQueueLimit(queue_limit);
+    std::thread thread([&]() { server->run(kAooInfinite); });
+
+    // 1) connect clients; client IDs are assigned in order.
+    ip_address addr("127.0.0.1", port, ip_address::IPv4);
+    std::vector<tcp_socket> clients;
+    std::vector<AooByte> data(4);
+    std::vector<AooByte> result;
+    try {
+        for (int i = 0; i < num_clients; ++i) {
+            tcp_socket sock(family_tag{}, ip_address::IPv4);
+            sock.connect(addr);
+            clients.push_back(std::move(sock));
+        }
+    } catch (const socket_error& e) {
+        std::cout << "error: could not connect: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    // wait until all clients have been accepted; each client
+    // receives a single probe message.
+    auto t1 = hrclock::now();
+    for (int i = 0; i < num_clients && !errors; ++i) {
+        while (notify(*server, i, data) != kAooOk) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (seconds(hrclock::now() - t1).count() > 5.0) {
+                std::cout << "error: client " << i << " not accepted" << std::endl;
+                errors++;
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < num_clients && !errors; ++i) {
+        if (!receive_notification(clients[i], result)) {
+            std::cout << "error: client " << i << " got no probe message" << std::endl;
+            errors++;
+        }
+    }
+
+    // 2) broadcast small messages to all clients; they should
+    // arrive in order. The server coalesces them per client.
+    if (!errors) {
+        auto t2 = hrclock::now();
+        for (int i = 0; i < num_broadcasts; ++i) {
+            aoo::to_bytes<int32_t>(i, data.data());
+            notify(*server, kAooIdInvalid, data);
+        }
+        for (int i = 0; i < num_clients && !errors; ++i) {
+            for (int j = 0; j < num_broadcasts; ++j) {
+                if (!receive_notification(clients[i], result) || result.size() != 4
+                        || aoo::from_bytes<int32_t>(result.data()) != j) {
+                    std::cout << "error: client " << i << " got no or wrong message "
+                              << j << std::endl;
+                    errors++;
+                    break;
+                }
+            }
+        }
+        auto elapsed = seconds(hrclock::now() - t2).count();
+        std::cout << "broadcast: " << (num_broadcasts * num_clients / elapsed)
+                  << " messages/s" << std::endl;
+    }
+
+    // 3) a client that doesn't read must not stall the server or other
+    // clients; it is disconnected as soon as its send queue overflows.
+    if (!errors) {
+        AooId slow_id = 0, fast_id = 1;
+        std::atomic<int> fast_count{0};
+        std::thread reader([&]() {
+            std::vector<AooByte> result;
+            for (int i = 0; i < num_bulk_messages; ++i) {
+                if (!receive_notification(clients[fast_id], result)
+                        || result.size() != bulk_message_size
+                        || aoo::from_bytes<int32_t>(result.data()) != i) {
+                    break;
+                }
+                fast_count++;
+            }
+        });
+        std::vector<AooByte> bulk(bulk_message_size);
+        bool slow_removed = false;
+        for (int i = 0; i < num_bulk_messages; ++i) {
+            aoo::to_bytes<int32_t>(i, bulk.data());
+            if (!slow_removed) {
+                slow_removed = notify(*server, slow_id, bulk) != kAooOk;
+            }
+            // don't get too far ahead of the fast client
+            while (i - fast_count.load() > max_in_flight) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            notify(*server, fast_id, bulk);
+        }
+        reader.join();
+        if (fast_count.load() != num_bulk_messages) {
+            std::cout << "error: fast client only received " << fast_count.load()
+                      << " of " << num_bulk_messages << " messages" << std::endl;
+            errors++;
+        }
+        // the slow client must have been removed...
+        auto t3 = hrclock::now();
+        while (!slow_removed && notify(*server, slow_id, data) == kAooOk) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (seconds(hrclock::now() - t3).count() > 5.0) {
+                std::cout << "error: slow client has not been disconnected" << std::endl;
+                errors++;
+                break;
+            }
+        }
+        // ...and the connection must have been closed before
+        // all messages were delivered.
+        int slow_count = 0;
+        while (receive_notification(clients[slow_id], result)) {
+            slow_count++;
+        }
+        std::cout << "slow client: received " << slow_count << " of "
+                  << num_bulk_messages << " messages" << std::endl;
+        if (slow_count >= num_bulk_messages) {
+            std::cout << "error: slow client received all messages" << std::endl;
+            errors++;
+        }
+    }
+
+    clients.clear();
+    server->stop();
+    thread.join();
+
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
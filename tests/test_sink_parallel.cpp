@@ -0,0 +1,154 @@
+#include "aoo.h"
+#include "aoo_sink.hpp"
+#include "aoo_source.hpp"
+#include "codec/aoo_pcm.h"
+
+#include "common/net_utils.hpp"
+#include "common/time.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace aoo;
+
+// Several sources stream to two sinks which receive exactly the same packets.
+// One sink decodes the sources serially, the other one in parallel with
+// a worker pool (see AooSink::setProcessThreadCount()); the output must be
+// identical.
+
+constexpr int num_sources = 4;
+constexpr int num_blocks = 400;
+constexpr int blocksize = 64;
+constexpr int samplerate = 48000;
+constexpr double pi = 3.14159265358979323846;
+
+const ip_address sink_addr("127.0.0.1", 9000, ip_address::IPv4);
+constexpr AooId sink_id = 0;
+
+AooSource *sources[num_sources];
+ip_address source_addr[num_sources];
+AooSink *serial_sink;
+AooSink *parallel_sink;
+
+// forward source messages to both sinks
+AooInt32 AOO_CALL source_send(void *user, const AooByte *data, AooInt32 size,
+                              const void *address, AooAddrSize addrlen, AooFlag flags) {
+    auto& addr = source_addr[(intptr_t)user];
+    serial_sink->handleMessage(data, size, addr.address(), addr.length());
+    parallel_sink->handleMessage(data, size, addr.address(), addr.length());
+    return 0;
+}
+
+// NB: we do not need to reply to the sources.
+AooInt32 AOO_CALL sink_send(void *user, const AooByte *data, AooInt32 size,
+                            const void *address, AooAddrSize addrlen, AooFlag flags) {
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    aoo_initialize(nullptr);
+
+    int errors = 0;
+
+    // the sources use different formats and sample rates,
+    // so that the sinks have to decode and resample.
+    for (int i = 0; i < num_sources; ++i) {
+        source_addr[i] = ip_address("127.0.0.1", 9001 + i, ip_address::IPv4);
+        auto sr = (i & 1) ? 44100 : samplerate;
+        sources[i] = AooSource_new(i);
+        sources[i]->setup(1, sr, blocksize, 0);
+        AooFormatPcm fmt;
+        AooFormatPcm_init(&fmt, 1, sr, blocksize, (i & 2) ? kAooPcmInt16 : kAooPcmFloat32);
+        sources[i]->setFormat(fmt.header);
+        AooEndpoint ep { sink_addr.address(), (AooAddrSize)sink_addr.length(), sink_id };
+        sources[i]->addSink(ep, true);
+    }
+
+    serial_sink = AooSink_new(sink_id);
+    serial_sink->setup(1, samplerate, blocksize, 0);
+    parallel_sink = AooSink_new(sink_id);
+    parallel_sink->setup(1, samplerate, blocksize, 0);
+    parallel_sink->setProcessThreadCount(3);
+
+    AooInt32 count = 0;
+    parallel_sink->getProcessThreadCount(count);
+    if (count != 3) {
+        std::cout << "error: process thread count is " << count << " (expected 3)" << std::endl;
+        errors++;
+    }
+
+    auto t = aoo_getCurrentNtpTime();
+    for (int i = 0; i < num_sources; ++i) {
+        sources[i]->startStream(0, nullptr);
+    }
+
+    std::vector<AooSample> input(blocksize);
+    AooSample *inchannels[1] = { input.data() };
+    std::vector<AooSample> out1(blocksize), out2(blocksize);
+    AooSample *outchannels1[1] = { out1.data() };
+    AooSample *outchannels2[1] = { out2.data() };
+    int mismatches = 0;
+    double energy = 0;
+    for (int k = 0; k < num_blocks; ++k) {
+        // reconfigure the worker pool while streaming
+        if (k == num_blocks / 2) {
+            parallel_sink->setProcessThreadCount(1);
+            parallel_sink->getProcessThreadCount(count);
+            if (count != 1) {
+                std::cout << "error: process thread count is " << count
+                          << " (expected 1)" << std::endl;
+                errors++;
+            }
+        }
+        t += time_tag::from_seconds((double)blocksize / samplerate).value();
+        for (int i = 0; i < num_sources; ++i) {
+            for (int j = 0; j < blocksize; ++j) {
+                auto phase = (double)(k * blocksize + j) * (i + 1) * 200 / samplerate;
+                input[j] = 0.2 * std::sin(2 * pi * phase);
+            }
+            sources[i]->process(inchannels, blocksize, t);
+            sources[i]->send(source_send, (void *)(intptr_t)i);
+        }
+        serial_sink->send(sink_send, nullptr);
+        parallel_sink->send(sink_send, nullptr);
+
+        serial_sink->process(outchannels1, blocksize, t, nullptr, nullptr);
+        parallel_sink->process(outchannels2, blocksize, t, nullptr, nullptr);
+
+        if (memcmp(out1.data(), out2.data(), blocksize * sizeof(AooSample)) != 0) {
+            if (mismatches++ == 0) {
+                std::cout << "error: block " << k << ": parallel output differs" << std::endl;
+            }
+        }
+        for (auto& x : out1) {
+            energy += x * x;
+        }
+    }
+    if (mismatches > 0) {
+        std::cout << "error: " << mismatches << " blocks differ" << std::endl;
+        errors++;
+    }
+    if (energy == 0) {
+        std::cout << "error: no output" << std::endl;
+        errors++;
+    }
+
+    for (auto& s : sources) {
+        AooSource_free(s);
+    }
+    AooSink_free(serial_sink);
+    AooSink_free(parallel_sink);
+
+    aoo_terminate();
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
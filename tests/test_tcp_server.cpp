@@ -0,0 +1,268 @@
+#include "aoo/src/net/tcp_server.hpp"
+#include "common/net_utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace aoo;
+
+using seconds = std::chrono::duration<double>;
+using hrclock = std::chrono::high_resolution_clock;
+
+constexpr int default_num_clients = 1000;
+constexpr int num_rounds = 20;
+constexpr int num_ping_pongs = 2000;
+constexpr int message_size = 16;
+constexpr int bulk_size = 16 * 1024 * 1024;
+
+#if AOO_TCP_SERVER_EPOLL
+const char *backend = "epoll";
+#else
+const char *backend = "poll";
+#endif
+
+// echo server
+struct echo_server {
+    tcp_server server;
+    std::unordered_map<AooId, tcp_server::reply_func> replies; // network thread only
+    std::atomic<int> accepted{0};
+    std::thread thread;
+    AooId next_id = 0;
+
+    void start() {
+        server.start(0,
+            [this](const ip_address& addr, tcp_server::reply_func fn) {
+                auto id = next_id++;
+                replies.emplace(id, std::move(fn));
+                accepted++;
+                return id;
+            },
+            [this](AooId id, int err, const AooByte *data, AooSize size,
+                   const ip_address& addr) {
+                if (err == 0 && size > 0) {
+                    try {
+                        replies[id](data, size);
+                    } catch (const socket_error& e) {
+                        std::cout << "error: could not reply: " << e.what() << std::endl;
+                    }
+                } else {
+                    replies.erase(id);
+                }
+            });
+        thread = std::thread([this]() { server.run(); });
+    }
+
+    void stop() {
+        server.stop();
+        thread.join();
+    }
+};
+
+bool receive_all(tcp_socket& sock, AooByte *buf, int size, double timeout = 5.0) {
+    int count = 0;
+    while (count < size) {
+        auto [ok, n] = sock.receive(buf + count, size - count, timeout);
+        if (!ok || n <= 0) {
+            return false;
+        }
+        count += n;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    socket::init();
+
+    int num_clients = argc > 1 ? std::max(std::atoi(argv[1]), 2) : default_num_clients;
+    int errors = 0;
+
+    echo_server echo;
+    try {
+        echo.start();
+    } catch (const tcp_error& e) {
+        std::cout << "error: could not start TCP server: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    ip_address addr("127.0.0.1", echo.server.port(), ip_address::IPv4);
+    std::cout << "backend: " << backend << ", port: " << addr.port()
+              << ", clients: " << num_clients << std::endl;
+
+    // 1) connect clients
+    std::vector<tcp_socket> clients;
+    auto t1 = hrclock::now();
+    try {
+        for (int i = 0; i < num_clients; ++i) {
+            tcp_socket sock(family_tag{}, ip_address::IPv4);
+            sock.connect(addr);
+            clients.push_back(std::move(sock));
+        }
+    } catch (const socket_error& e) {
+        std::cout << "could only connect " << clients.size() << " clients: "
+                  << e.what() << std::endl;
+        num_clients = clients.size();
+        if (num_clients < 2) {
+            return EXIT_FAILURE;
+        }
+    }
+    while (echo.accepted.load() < num_clients) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (seconds(hrclock::now() - t1).count() > 10.0) {
+            std::cout << "error: server only accepted " << echo.accepted.load()
+                      << " of " << num_clients << " clients" << std::endl;
+            errors++;
+            break;
+        }
+    }
+    auto t2 = hrclock::now();
+    std::cout << "connect: " << seconds(t2 - t1).count() * 1000 << " ms" << std::endl;
+
+    // 2) round trips: every client sends a message, then all replies are read.
+    // With poll() the cost of a single wakeup grows with the number of clients.
+    AooByte msg[message_size];
+    AooByte reply[message_size];
+    for (int round = 0; round < num_rounds && !errors; ++round) {
+        for (int i = 0; i < num_clients; ++i) {
+            memset(msg, (i + round) & 255, sizeof(msg));
+            clients[i].send(msg, sizeof(msg));
+        }
+        for (int i = 0; i < num_clients; ++i) {
+            if (!receive_all(clients[i], reply, sizeof(reply))
+                    || reply[0] != ((i + round) & 255)) {
+                std::cout << "error: client " << i << " got no or wrong reply" << std::endl;
+                errors++;
+                break;
+            }
+        }
+    }
+    auto t3 = hrclock::now();
+    auto elapsed = seconds(t3 - t2).count();
+    std::cout << "round trips: " << (num_rounds * num_clients / elapsed)
+              << " messages/s" << std::endl;
+
+    // 3) ping-pong with a single client while all other clients are idle.
+    if (!errors) {
+        auto t1 = hrclock::now();
+        for (int i = 0; i < num_ping_pongs; ++i) {
+            memset(msg, i & 255, sizeof(msg));
+            clients[1].send(msg, sizeof(msg));
+            if (!receive_all(clients[1], reply, sizeof(reply)) || reply[0] != (i & 255)) {
+                std::cout << "error: got no or wrong reply" << std::endl;
+                errors++;
+                break;
+            }
+        }
+        auto elapsed = seconds(hrclock::now() - t1).count();
+        std::cout << "single client: " << (elapsed / num_ping_pongs * 1e6)
+                  << " us per round trip" << std::endl;
+    }
+
+    // 4) slow client: the server must not block while sending lots of data
+    // to a client that doesn't read. Other clients must still get replies.
+    if (!errors) {
+        // client IDs are assigned in order
+        AooId slow_id = 0;
+        std::vector<AooByte> bulk(bulk_size);
+        for (size_t i = 0; i < bulk.size(); ++i) {
+            bulk[i] = i & 255;
+        }
+        auto t4 = hrclock::now();
+        echo.server.send(slow_id, bulk.data(), bulk.size());
+        auto send_time = seconds(hrclock::now() - t4).count();
+        auto queued = echo.server.queued_bytes(slow_id);
+        std::cout << "slow client: send() took " << send_time * 1000 << " ms, "
+                  << queued << " bytes queued" << std::endl;
+        if (queued == 0) {
+            std::cout << "error: expected queued data" << std::endl;
+            errors++;
+        }
+        // another client still gets its reply
+        memset(msg, 77, sizeof(msg));
+        clients[1].send(msg, sizeof(msg));
+        if (!receive_all(clients[1], reply, sizeof(reply)) || reply[0] != 77) {
+            std::cout << "error: server blocked by slow client" << std::endl;
+            errors++;
+        }
+        // now read everything from the slow client
+        std::vector<AooByte> result(bulk_size);
+        if (!receive_all(clients[0], result.data(), result.size())) {
+            std::cout << "error: slow client did not receive all data" << std::endl;
+            errors++;
+        } else if (result != bulk) {
+            std::cout << "error: slow client received wrong data" << std::endl;
+            errors++;
+        }
+        if (echo.server.queued_bytes(slow_id) != 0) {
+            std::cout << "error: send queue not empty" << std::endl;
+            errors++;
+        }
+    }
+
+    // 5) disconnect clients
+    clients.clear();
+    auto t5 = hrclock::now();
+    while (echo.server.client_count() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (seconds(hrclock::now() - t5).count() > 10.0) {
+            std::cout << "error: server still has " << echo.server.client_count()
+                      << " clients" << std::endl;
+            errors++;
+            break;
+        }
+    }
+
+    echo.stop();
+
+    // 6) the last data and the EOF arrive at the same time; the server
+    // must still notice the disconnect (edge-triggered epoll!).
+    if (!errors) {
+        tcp_server server;
+        int received = 0, disconnects = 0;
+        server.start(0,
+            [](const ip_address& addr, tcp_server::reply_func fn) {
+                return 0;
+            },
+            [&](AooId id, int err, const AooByte *data, AooSize size,
+                const ip_address& addr) {
+                if (err == 0 && size > 0) {
+                    received += size;
+                } else {
+                    disconnects++;
+                }
+            });
+        ip_address addr("127.0.0.1", server.port(), ip_address::IPv4);
+        tcp_socket sock(family_tag{}, ip_address::IPv4);
+        sock.connect(addr);
+        for (int i = 0; i < 100 && server.client_count() == 0; ++i) {
+            server.run(0.01);
+        }
+        memset(msg, 1, 6);
+        sock.send(msg, 6);
+        sock.shutdown(shutdown_send);
+        // make sure that both arrive before the server wakes up
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        for (int i = 0; i < 5; ++i) {
+            server.run(0.01);
+        }
+        std::cout << "data + EOF: received " << received << " bytes, disconnect events: "
+                  << disconnects << ", clients: " << server.client_count() << std::endl;
+        if (received != 6 || disconnects != 1 || server.client_count() != 0) {
+            std::cout << "error: disconnect not detected" << std::endl;
+            errors++;
+        }
+        server.stop();
+    }
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
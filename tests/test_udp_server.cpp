@@ -0,0 +1,207 @@
+#include "aoo/src/net/udp_server.hpp"
+#include "common/net_utils.hpp"
+#include "common/utils.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace aoo;
+
+using seconds = std::chrono::duration<double>;
+using hrclock = std::chrono::high_resolution_clock;
+
+constexpr int queue_capacity = 16;
+constexpr int queue_packet_size = 512;
+
+struct packet {
+    int32_t seq;
+    int32_t size;
+    bool valid;
+};
+
+// packets start with a sequence number, followed by a byte pattern
+std::vector<AooByte> make_packet(int32_t seq, int32_t size) {
+    std::vector<AooByte> data(size);
+    aoo::to_bytes<int32_t>(seq, data.data());
+    for (int i = 4; i < size; ++i) {
+        data[i] = (seq + i) & 255;
+    }
+    return data;
+}
+
+packet check_packet(const AooByte *data, AooSize size) {
+    auto seq = aoo::from_bytes<int32_t>(data);
+    bool valid = true;
+    for (int i = 4; i < (int)size; ++i) {
+        if (data[i] != ((seq + i) & 255)) {
+            valid = false;
+            break;
+        }
+    }
+    return packet { seq, (int32_t)size, valid };
+}
+
+// Dispatch queued packets until the receive thread has handled the given
+// number of packets, i.e. they have been either queued or dropped.
+// NB: don't use run() with a timeout because the event might still be
+// set from previous packets.
+bool wait_for_packets(udp_server& server, size_t& received, uint64_t count,
+                      double timeout = 5.0) {
+    auto t1 = hrclock::now();
+    for (;;) {
+        server.run(0);
+        auto stats = server.get_receive_stats();
+        if (received + stats.overflow >= count) {
+            return true;
+        }
+        if (seconds(hrclock::now() - t1).count() > timeout) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    socket::init();
+
+    int errors = 0;
+    std::vector<packet> received;
+    size_t total = 0;
+    auto handler = [&](const AooByte *data, AooSize size, const ip_address& addr) {
+        received.push_back(check_packet(data, size));
+        total++;
+    };
+    // check that we have received the given packets (in this order)
+    auto check_received = [&](const std::vector<int32_t>& seqs, const char *what) {
+        bool ok = received.size() == seqs.size();
+        for (size_t i = 0; ok && i < seqs.size(); ++i) {
+            ok = received[i].seq == seqs[i] && received[i].valid;
+        }
+        if (!ok) {
+            std::cout << "error: " << what << ": got " << received.size()
+                      << " of " << seqs.size() << " packets or wrong data" << std::endl;
+            errors++;
+        }
+        received.clear();
+    };
+
+    udp_socket sender(family_tag{}, ip_address::IPv4);
+
+    // 1) threaded mode with a small queue
+    udp_server server;
+    server.set_queue_capacity(queue_capacity);
+    server.set_queue_packet_size(queue_packet_size);
+    try {
+        server.start(0, handler, true);
+    } catch (const udp_error& e) {
+        std::cout << "error: could not start UDP server: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    ip_address addr("127.0.0.1", server.port(), ip_address::IPv4);
+
+    // a) packets arrive in order; a packet that is too large is dropped
+    {
+        std::vector<int32_t> expected;
+        for (int i = 0; i < 10; ++i) {
+            auto size = (i == 5) ? queue_packet_size + 1 : 100 + i * 40;
+            auto data = make_packet(i, size);
+            sender.send(data.data(), data.size(), addr);
+            if (i != 5) {
+                expected.push_back(i);
+            }
+        }
+        if (!wait_for_packets(server, total, 10)) {
+            std::cout << "error: receive thread did not get all packets" << std::endl;
+            errors++;
+        }
+        check_received(expected, "packet too large");
+        auto stats = server.get_receive_stats();
+        if (stats.overflow != 1) {
+            std::cout << "error: overflow count is " << stats.overflow
+                      << " (expected 1)" << std::endl;
+            errors++;
+        }
+    }
+
+    // b) the queue overflows if the network thread doesn't keep up;
+    // the oldest packets are kept and the queue works again afterwards.
+    if (!errors) {
+        const int count = queue_capacity * 3;
+        for (int i = 0; i < count; ++i) {
+            auto data = make_packet(100 + i, 64);
+            sender.send(data.data(), data.size(), addr);
+        }
+        // NB: don't dispatch while sending
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (!wait_for_packets(server, total, 10 + count)) {
+            std::cout << "error: receive thread did not get all packets" << std::endl;
+            errors++;
+        }
+        std::vector<int32_t> expected;
+        for (int i = 0; i < queue_capacity; ++i) {
+            expected.push_back(100 + i);
+        }
+        check_received(expected, "queue full");
+        auto stats = server.get_receive_stats();
+        std::cout << "queue full: " << stats.packets << " packets, "
+                  << stats.overflow << " dropped" << std::endl;
+        if (stats.overflow != 1 + count - queue_capacity) {
+            std::cout << "error: overflow count is " << stats.overflow << " (expected "
+                      << (1 + count - queue_capacity) << ")" << std::endl;
+            errors++;
+        }
+        auto data = make_packet(200, 64);
+        sender.send(data.data(), data.size(), addr);
+        if (!wait_for_packets(server, total, 10 + count + 1)) {
+            std::cout << "error: no packet after overflow" << std::endl;
+            errors++;
+        }
+        check_received({ 200 }, "after overflow");
+    }
+    server.stop();
+
+    // 2) with the default settings, any UDP packet fits into the queue,
+    // e.g. relayed packets which are larger than AOO_MAX_PACKET_SIZE.
+    if (!errors) {
+        udp_server server;
+        server.start(0, handler, true);
+        total = 0;
+        ip_address addr("127.0.0.1", server.port(), ip_address::IPv4);
+        std::vector<int32_t> sizes = { AOO_MAX_PACKET_SIZE, AOO_MAX_PACKET_SIZE + 64, 60000 };
+        std::vector<int32_t> expected;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            auto data = make_packet(i, sizes[i]);
+            sender.send(data.data(), data.size(), addr);
+            expected.push_back(i);
+        }
+        if (!wait_for_packets(server, total, sizes.size())) {
+            std::cout << "error: receive thread did not get all packets" << std::endl;
+            errors++;
+        }
+        auto sizes_ok = received.size() == sizes.size();
+        for (size_t i = 0; sizes_ok && i < sizes.size(); ++i) {
+            sizes_ok = received[i].size == sizes[i];
+        }
+        check_received(expected, "large packets");
+        if (!sizes_ok) {
+            std::cout << "error: large packets have wrong size" << std::endl;
+            errors++;
+        }
+        if (server.get_receive_stats().overflow != 0) {
+            std::cout << "error: large packets have been dropped" << std::endl;
+            errors++;
+        }
+        server.stop();
+    }
+
+    if (errors > 0) {
+        std::cout << errors << " errors!" << std::endl;
+        return EXIT_FAILURE;
+    } else {
+        std::cout << "done!" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}